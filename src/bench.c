@@ -0,0 +1,1958 @@
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bench_baselines.h"
+#include "bench_histogram.h"
+#include "bench_perf.h"
+#include "skiplist.h"
+#include "timestamp.h"
+
+#define NELEMS(_array) (sizeof((_array)) / sizeof((_array)[0]))
+
+/** The number of operations generated up front and then executed back to back. */
+#define BENCH_BATCH (1024)
+
+/** The largest list size the benchmark accepts. */
+#define BENCH_MAX_SIZE (100000000UL)
+
+/** The largest number of threads the multithreaded benchmark will start. */
+#define BENCH_MAX_THREADS (1024)
+
+/** The maximum number of values in a --size or --links sweep. */
+#define BENCH_MAX_SWEEP (32)
+
+/** The percentiles reported for each operation's latency. */
+static const double bench_percentiles[] = { 50.0, 90.0, 99.0, 99.9 };
+
+/** Names of the reported percentiles, indexed as bench_percentiles. */
+static const char *bench_percentile_names[] = { "p50", "p90", "p99", "p999" };
+
+/** The skew of the zipfian key distribution, the same as YCSB's default. */
+#define BENCH_ZIPF_THETA (0.99)
+
+/** The number of consecutive keys drawn near the same point by the clustered distribution. */
+#define BENCH_CLUSTER_LENGTH (64)
+
+/** The spread of the keys drawn around each point by the clustered distribution. */
+#define BENCH_CLUSTER_SPREAD (256)
+
+/**
+ * @brief The kinds of operation a workload is made of.
+ */
+typedef enum bench_op_type_t
+{
+	BENCH_OP_READ = 0,
+	BENCH_OP_INSERT,
+	BENCH_OP_REMOVE,
+	BENCH_OP_RANK,
+	BENCH_OP_SCAN,
+	BENCH_OP_COUNT
+} bench_op_type_t;
+
+/** Names of the operations, indexed by bench_op_type_t. */
+static const char *bench_op_names[BENCH_OP_COUNT] = { "read", "insert", "remove", "rank", "scan" };
+
+/**
+ * @brief The distributions keys are drawn from.
+ */
+typedef enum bench_dist_t
+{
+	BENCH_DIST_SEQUENTIAL = 0,
+	BENCH_DIST_UNIFORM,
+	BENCH_DIST_ZIPFIAN,
+	BENCH_DIST_CLUSTERED,
+	BENCH_DIST_COUNT
+} bench_dist_t;
+
+/** Names of the distributions, indexed by bench_dist_t. */
+static const char *bench_dist_names[BENCH_DIST_COUNT] = { "sequential", "uniform", "zipfian", "clustered" };
+
+/**
+ * @brief How the lists are shared between threads in the multithreaded benchmark.
+ */
+typedef enum bench_sharing_t
+{
+	/** Every thread works on a list of its own. */
+	BENCH_SHARING_PRIVATE = 0,
+
+	/** Every thread works on the same list, serialized by a mutex. */
+	BENCH_SHARING_SHARED,
+
+	/** Measure both of the above. */
+	BENCH_SHARING_BOTH
+} bench_sharing_t;
+
+/** Names of the sharing modes, indexed by bench_sharing_t. */
+static const char *bench_sharing_names[] = { "private", "shared", "both" };
+
+/**
+ * @brief What the benchmark measures.
+ */
+typedef enum bench_mode_t
+{
+	BENCH_MODE_TIME = 0,
+	BENCH_MODE_MEMORY,
+	BENCH_MODE_QUEUE
+} bench_mode_t;
+
+/**
+ * @brief Output formats for the results.
+ */
+typedef enum bench_format_t
+{
+	BENCH_FORMAT_CSV = 0,
+	BENCH_FORMAT_JSON
+} bench_format_t;
+
+/**
+ * @brief The benchmark's command line configuration.
+ */
+typedef struct bench_config_t
+{
+	/** The list sizes to measure, the number of elements inserted before measuring. */
+	unsigned long sizes[BENCH_MAX_SWEEP];
+
+	/** The number of entries in sizes. */
+	unsigned int num_sizes;
+
+	/** The number of operations measured per repetition. */
+	unsigned long ops;
+
+	/** The distribution operation keys are drawn from. */
+	bench_dist_t dist;
+
+	/** The percentage of operations of each type. */
+	unsigned int mix[BENCH_OP_COUNT];
+
+	/** The containers to run the workload against, the first is the one the others are compared with. */
+	const bench_container_ops_t *containers[BENCH_MAX_SWEEP];
+
+	/** The number of entries in containers. */
+	unsigned int num_containers;
+
+	/** The numbers of links per skiplist to measure, i.e. size_estimate_log2. */
+	unsigned long links[BENCH_MAX_SWEEP];
+
+	/** The number of entries in links. */
+	unsigned int num_links;
+
+	/** The number of times the workload is run. */
+	unsigned int reps;
+
+	/** Seed for the key and operation generator. */
+	unsigned long seed;
+
+	/** The number of elements visited by each scan. */
+	unsigned int scan_length;
+
+	/** The maximum number of consecutive operations of the same type timed together
+	    when recording latencies, 0 to not record latencies. */
+	unsigned int latency_batch;
+
+	/** Where the skiplist's memory comes from. */
+	skiplist_memory_backend_t memory_backend;
+
+	/** The largest number of threads to sweep up to, 0 to run the single threaded benchmark. */
+	unsigned int threads;
+
+	/** How lists are shared between threads. */
+	bench_sharing_t sharing;
+
+	/** Non-zero to count hardware events around the build and run phases. */
+	unsigned int perf;
+
+	/** Whether to time operations, report the memory used by each list or time priority queue operations. */
+	bench_mode_t mode;
+
+	/** The format results are written in. */
+	bench_format_t format;
+
+	/** The file results are written to, NULL for stdout. */
+	const char *output;
+} bench_config_t;
+
+/**
+ * @brief A single generated operation.
+ */
+typedef struct bench_op_t
+{
+	/** The operation to perform, a bench_op_type_t. */
+	unsigned int type;
+
+	/** The key for reads, inserts and removes, a random number for ranks and scans. */
+	uintptr_t key;
+} bench_op_t;
+
+/**
+ * @brief xorshift64* generator state, used instead of rand() for its range and speed.
+ */
+typedef struct bench_rng_t
+{
+	/** The generator state, never 0. */
+	unsigned long long state;
+} bench_rng_t;
+
+/**
+ * @brief State for generating keys from a distribution.
+ */
+typedef struct bench_keygen_t
+{
+	/** The distribution keys are drawn from. */
+	bench_dist_t dist;
+
+	/** Keys are drawn from [0, key_space). */
+	unsigned long long key_space;
+
+	/** The next key for the sequential distribution. */
+	unsigned long long next;
+
+	/** The centre of the current cluster for the clustered distribution. */
+	unsigned long long cluster;
+
+	/** The number of keys left to draw from the current cluster. */
+	unsigned int cluster_remaining;
+
+	/** Zipfian constants, see Gray et al. "Quickly Generating Billion-Record Synthetic Databases". */
+	double zipf_zetan;
+	double zipf_alpha;
+	double zipf_eta;
+	double zipf_half_pow_theta;
+} bench_keygen_t;
+
+/**
+ * @brief The measurements from one repetition of a workload.
+ */
+typedef struct bench_result_t
+{
+	/** The time taken to insert the initial elements. */
+	unsigned long long build_ns;
+
+	/** The time taken to execute the measured operations. */
+	unsigned long long run_ns;
+
+	/** The number of operations of each type executed. */
+	unsigned long count[BENCH_OP_COUNT];
+
+	/** The number of reads that found their key and removes that found theirs. */
+	unsigned long hits;
+
+	/** The number of elements in the list after the run. */
+	unsigned long final_size;
+
+	/** The bytes requested from malloc() by the container once it held the initial elements. */
+	size_t memory_bytes;
+
+	/** Folded results of lookups so they can't be optimized away. */
+	uintptr_t checksum;
+
+	/** The latency of each type of operation in nanoseconds, when enabled. */
+	bench_histogram_t latency[BENCH_OP_COUNT];
+
+	/** Hardware events counted while inserting the initial elements, when enabled. */
+	bench_perf_counts_t perf_build;
+
+	/** Hardware events counted while executing the measured operations, when enabled. */
+	bench_perf_counts_t perf_run;
+} bench_result_t;
+
+static unsigned long long bench_rng_next( bench_rng_t *rng )
+{
+	rng->state ^= rng->state >> 12;
+	rng->state ^= rng->state << 25;
+	rng->state ^= rng->state >> 27;
+	return rng->state * 2685821657736338717ULL;
+}
+
+/**
+ * @brief Returns a uniformly distributed double in [0, 1).
+ */
+static double bench_rng_double( bench_rng_t *rng )
+{
+	return (bench_rng_next( rng ) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void bench_rng_seed( bench_rng_t *rng, unsigned long seed )
+{
+	rng->state = seed * 0x9E3779B97F4A7C15ULL + 0x2545F4914F6CDD1DULL;
+	if( 0 == rng->state )
+	{
+		rng->state = 1;
+	}
+}
+
+/**
+ * @brief Approximates the generalized harmonic number sum(i = 1..n) 1 / i^theta.
+ *
+ * The first terms are summed exactly and the tail is integrated, computing
+ * the exact sum for 10^8 keys would take longer than most runs.
+ */
+static double bench_zeta( unsigned long long n, double theta )
+{
+	const unsigned long long exact = 10000;
+	unsigned long long i;
+	double sum = 0.0;
+
+	for( i = 1; i <= n && i <= exact; ++i )
+	{
+		sum += 1.0 / pow( (double) i, theta );
+	}
+
+	if( n > exact )
+	{
+		sum += (pow( n + 0.5, 1.0 - theta ) - pow( exact + 0.5, 1.0 - theta )) / (1.0 - theta);
+	}
+
+	return sum;
+}
+
+static void bench_keygen_init( bench_keygen_t *keygen, bench_dist_t dist, unsigned long long key_space )
+{
+	memset( keygen, 0, sizeof( *keygen ) );
+	keygen->dist = dist;
+	keygen->key_space = key_space;
+
+	if( BENCH_DIST_ZIPFIAN == dist )
+	{
+		keygen->zipf_zetan = bench_zeta( key_space, BENCH_ZIPF_THETA );
+		keygen->zipf_alpha = 1.0 / (1.0 - BENCH_ZIPF_THETA);
+		keygen->zipf_eta = (1.0 - pow( 2.0 / key_space, 1.0 - BENCH_ZIPF_THETA )) /
+		                   (1.0 - bench_zeta( 2, BENCH_ZIPF_THETA ) / keygen->zipf_zetan);
+		keygen->zipf_half_pow_theta = pow( 0.5, BENCH_ZIPF_THETA );
+	}
+}
+
+static uintptr_t bench_keygen_next( bench_keygen_t *keygen, bench_rng_t *rng )
+{
+	unsigned long long rank;
+	double u;
+
+	switch( keygen->dist )
+	{
+	case BENCH_DIST_SEQUENTIAL:
+		rank = keygen->next;
+		keygen->next = (keygen->next + 1) % keygen->key_space;
+		return (uintptr_t) rank;
+
+	case BENCH_DIST_ZIPFIAN:
+		u = bench_rng_double( rng );
+		if( u * keygen->zipf_zetan < 1.0 )
+		{
+			rank = 0;
+		}
+		else if( u * keygen->zipf_zetan < 1.0 + keygen->zipf_half_pow_theta )
+		{
+			rank = 1;
+		}
+		else
+		{
+			rank = (unsigned long long) (keygen->key_space *
+			                             pow( keygen->zipf_eta * u - keygen->zipf_eta + 1.0, keygen->zipf_alpha ));
+		}
+
+		/* Scatter the popular keys over the key space rather than having them all at the front of the list. */
+		return (uintptr_t) ((rank * 0x9E3779B97F4A7C15ULL) % keygen->key_space);
+
+	case BENCH_DIST_CLUSTERED:
+		if( 0 == keygen->cluster_remaining )
+		{
+			keygen->cluster = bench_rng_next( rng ) % keygen->key_space;
+			keygen->cluster_remaining = BENCH_CLUSTER_LENGTH;
+		}
+		--keygen->cluster_remaining;
+		return (uintptr_t) ((keygen->cluster + bench_rng_next( rng ) % BENCH_CLUSTER_SPREAD) % keygen->key_space);
+
+	case BENCH_DIST_UNIFORM:
+	default:
+		return (uintptr_t) (bench_rng_next( rng ) % keygen->key_space);
+	}
+}
+
+/**
+ * @brief Compares two keys.
+ */
+static int bench_compare( const uintptr_t a, const uintptr_t b )
+{
+	return a < b ? -1 : a > b;
+}
+
+/**
+ * @brief Prints a key to the file stream.
+ */
+static void bench_fprintf( FILE *stream, const uintptr_t value )
+{
+	fprintf( stream, "%lu", (unsigned long) value );
+}
+
+/**
+ * @brief Fill @p ops with a batch of operations following the configured mix.
+ */
+static void bench_generate( const bench_config_t *config, bench_keygen_t *keygen, bench_rng_t *rng,
+                            bench_op_t *ops, size_t count )
+{
+	size_t i;
+
+	for( i = 0; i < count; ++i )
+	{
+		unsigned int pick = (unsigned int) (bench_rng_next( rng ) % 100);
+		unsigned int type;
+
+		for( type = 0; type + 1 < BENCH_OP_COUNT && pick >= config->mix[type]; ++type )
+		{
+			pick -= config->mix[type];
+		}
+
+		ops[i].type = type;
+		if( BENCH_OP_RANK == type || BENCH_OP_SCAN == type )
+		{
+			ops[i].key = (uintptr_t) bench_rng_next( rng );
+		}
+		else
+		{
+			ops[i].key = bench_keygen_next( keygen, rng );
+		}
+	}
+}
+
+static void *bench_skiplist_create( const bench_container_params_t *params )
+{
+	skiplist_options_t options;
+
+	skiplist_options_init( &options );
+	options.size_estimate_log2 = params->links;
+	options.compare = bench_compare;
+	options.print = bench_fprintf;
+	options.memory_backend = params->huge_pages ? SKIPLIST_MEMORY_HUGE_PAGES : SKIPLIST_MEMORY_MALLOC;
+
+	return skiplist_create_with_options( &options, NULL );
+}
+
+static void bench_skiplist_destroy( void *container )
+{
+	skiplist_destroy( container );
+}
+
+static int bench_skiplist_insert( void *container, uintptr_t value )
+{
+	return SKIPLIST_ERROR_SUCCESS == skiplist_insert( container, value ) ? 0 : -1;
+}
+
+static int bench_skiplist_contains( const void *container, uintptr_t value )
+{
+	return skiplist_contains( container, value, NULL );
+}
+
+static int bench_skiplist_remove( void *container, uintptr_t value )
+{
+	return SKIPLIST_ERROR_SUCCESS == skiplist_remove( container, value );
+}
+
+static unsigned long bench_skiplist_size( const void *container )
+{
+	return skiplist_size( container, NULL );
+}
+
+static uintptr_t bench_skiplist_at_index( const void *container, unsigned long index )
+{
+	return skiplist_at_index( container, (skiplist_size_t) index, NULL );
+}
+
+static uintptr_t bench_skiplist_scan( const void *container, unsigned long count )
+{
+	uintptr_t values[256];
+	uintptr_t sum = 0;
+	skiplist_size_t copied;
+	skiplist_size_t start = 0;
+	skiplist_size_t i;
+
+	/* Copy the values out a buffer at a time rather than stepping an iterator per value. */
+	do
+	{
+		copied = skiplist_copy_range( container, start,
+		                              (skiplist_size_t) (count < 256 ? count : 256), values, NULL );
+		for( i = 0; i < copied; ++i )
+		{
+			sum += values[i];
+		}
+		start += copied;
+		count -= copied;
+	} while( 0 != copied && 0 != count );
+
+	return sum;
+}
+
+static size_t bench_skiplist_memory( const void *container )
+{
+	return skiplist_memory_held( container, NULL );
+}
+
+/** The skiplist behind the same interface as the baseline containers. */
+static const bench_container_ops_t bench_skiplist_ops =
+{
+	"skiplist",
+	bench_skiplist_create,
+	bench_skiplist_destroy,
+	bench_skiplist_insert,
+	bench_skiplist_contains,
+	bench_skiplist_remove,
+	bench_skiplist_size,
+	bench_skiplist_at_index,
+	bench_skiplist_scan,
+	bench_skiplist_memory
+};
+
+/** Every container that can be selected with --container. */
+static const bench_container_ops_t *bench_containers[] =
+{
+	&bench_skiplist_ops, &bench_sorted_array_ops, &bench_rbtree_ops, &bench_btree_ops
+};
+
+/**
+ * @brief Execute a single operation against @p container.
+ */
+static void bench_execute_one( const bench_config_t *config, const bench_container_ops_t *type, void *container,
+                               const bench_op_t *op, bench_result_t *result )
+{
+	unsigned long size;
+
+	switch( op->type )
+	{
+	case BENCH_OP_READ:
+		result->hits += type->contains( container, op->key );
+		break;
+
+	case BENCH_OP_INSERT:
+		type->insert( container, op->key );
+		break;
+
+	case BENCH_OP_REMOVE:
+		result->hits += type->remove( container, op->key );
+		break;
+
+	case BENCH_OP_RANK:
+		size = type->size( container );
+		if( size )
+		{
+			result->checksum += type->at_index( container, op->key % size );
+		}
+		break;
+
+	case BENCH_OP_SCAN:
+		/* There's no way to position an iterator at an arbitrary element, so scans start at the front. */
+		result->checksum += type->scan( container, config->scan_length );
+		break;
+	}
+
+	++result->count[op->type];
+}
+
+/**
+ * @brief Measure the cost of taking a pair of timestamps, so it can be removed from latencies.
+ */
+static unsigned long long bench_timer_overhead( void )
+{
+	unsigned long long overhead = (unsigned long long) -1;
+	struct timespec start, end;
+	unsigned int i;
+
+	for( i = 0; i < 1000; ++i )
+	{
+		time_stamp( &start );
+		time_stamp( &end );
+		if( time_diff_ns( &start, &end ) < overhead )
+		{
+			overhead = time_diff_ns( &start, &end );
+		}
+	}
+
+	return overhead;
+}
+
+/**
+ * @brief Execute a batch of operations against @p container.
+ *
+ * When latencies are recorded, runs of up to config->latency_batch consecutive
+ * operations of the same type are timed together and each is recorded with the
+ * run's mean latency. A latency batch of 1 times every operation individually.
+ */
+static void bench_execute( const bench_config_t *config, const bench_container_ops_t *type, void *container,
+                           pthread_mutex_t *lock,
+                           const bench_op_t *ops, size_t count, unsigned long long timer_overhead,
+                           bench_result_t *result )
+{
+	size_t i;
+
+	if( 0 == config->latency_batch )
+	{
+		for( i = 0; i < count; ++i )
+		{
+			if( lock )
+				pthread_mutex_lock( lock );
+			bench_execute_one( config, type, container, &ops[i], result );
+			if( lock )
+				pthread_mutex_unlock( lock );
+		}
+		return;
+	}
+
+	for( i = 0; i < count; )
+	{
+		struct timespec start, end;
+		unsigned long long elapsed;
+		size_t run;
+
+		time_stamp( &start );
+		for( run = 0; i + run < count && run < config->latency_batch && ops[i + run].type == ops[i].type; ++run )
+		{
+			if( lock )
+				pthread_mutex_lock( lock );
+			bench_execute_one( config, type, container, &ops[i + run], result );
+			if( lock )
+				pthread_mutex_unlock( lock );
+		}
+		time_stamp( &end );
+
+		elapsed = time_diff_ns( &start, &end );
+		elapsed = elapsed > timer_overhead ? elapsed - timer_overhead : 0;
+		bench_histogram_record( &result->latency[ops[i].type], elapsed / run, run );
+
+		i += run;
+	}
+}
+
+/**
+ * @brief Create a container holding @p size elements, a skiplist is given @p links links.
+ *
+ * The container holds the even keys, so about half of the uniformly drawn keys are present.
+ *
+ * @return The new container, NULL if out of memory.
+ */
+static void *bench_build( const bench_config_t *config, const bench_container_ops_t *type,
+                          unsigned long size, unsigned int links )
+{
+	bench_container_params_t params;
+	void *container;
+	unsigned long i;
+
+	params.links = links;
+	params.huge_pages = SKIPLIST_MEMORY_HUGE_PAGES == config->memory_backend;
+
+	container = type->create( &params );
+	if( !container )
+		return NULL;
+
+	for( i = 0; i < size; ++i )
+	{
+		if( type->insert( container, (uintptr_t) i * 2 ) )
+		{
+			type->destroy( container );
+			return NULL;
+		}
+	}
+
+	return container;
+}
+
+/**
+ * @brief Run the configured operations against a container whose keys are drawn from [0, 2 * size).
+ *
+ * @param [in]     config     The benchmark configuration.
+ * @param [in]     type       The kind of container.
+ * @param [in]     container  The container to run against.
+ * @param [in]     lock       Held around each operation if not NULL.
+ * @param [in]     perf       Counts hardware events around each batch of operations if not NULL.
+ * @param [in]     size       The number of elements @p container was built with.
+ * @param [in]     seed       Seed for the operation generator.
+ * @param [in,out] result     Receives the run time, counts, latencies and event counts.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+static int bench_operate( const bench_config_t *config, const bench_container_ops_t *type, void *container,
+                          pthread_mutex_t *lock, bench_perf_t *perf, unsigned long size, unsigned long seed,
+                          bench_result_t *result )
+{
+	bench_keygen_t keygen;
+	bench_rng_t rng;
+	bench_op_t *ops;
+	struct timespec start, end;
+	unsigned long long timer_overhead;
+	unsigned long done;
+
+	ops = malloc( sizeof( *ops ) * BENCH_BATCH );
+	if( !ops )
+		return -1;
+
+	bench_rng_seed( &rng, seed );
+	bench_keygen_init( &keygen, config->dist, size ? 2ULL * size : 2ULL );
+	timer_overhead = config->latency_batch ? bench_timer_overhead() : 0;
+
+	for( done = 0; done < config->ops; done += BENCH_BATCH )
+	{
+		size_t count = config->ops - done < BENCH_BATCH ? config->ops - done : BENCH_BATCH;
+
+		bench_generate( config, &keygen, &rng, ops, count );
+
+		if( perf )
+			bench_perf_start( perf );
+		time_stamp( &start );
+		bench_execute( config, type, container, lock, ops, count, timer_overhead, result );
+		time_stamp( &end );
+		if( perf )
+			bench_perf_stop( perf, &result->perf_run );
+		result->run_ns += time_diff_ns( &start, &end );
+	}
+
+	free( ops );
+
+	return 0;
+}
+
+/**
+ * @brief Run one repetition of the configured workload on a container of @p size elements.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+static int bench_run( const bench_config_t *config, const bench_container_ops_t *type, unsigned long size,
+                      unsigned int links, unsigned int rep, bench_result_t *result )
+{
+	void *container;
+	struct timespec start, end;
+	bench_perf_t perf;
+	int failed;
+
+	memset( result, 0, sizeof( *result ) );
+	if( config->perf )
+		bench_perf_open( &perf );
+
+	if( config->perf )
+		bench_perf_start( &perf );
+	time_stamp( &start );
+	container = bench_build( config, type, size, links );
+	time_stamp( &end );
+	if( config->perf )
+		bench_perf_stop( &perf, &result->perf_build );
+	result->build_ns = time_diff_ns( &start, &end );
+
+	if( container )
+		result->memory_bytes = type->memory( container );
+
+	failed = !container || bench_operate( config, type, container, NULL, config->perf ? &perf : NULL,
+	                                      size, config->seed + rep, result );
+
+	if( config->perf )
+		bench_perf_close( &perf );
+	if( !container )
+		return -1;
+
+	result->final_size = type->size( container );
+	type->destroy( container );
+
+	return failed ? -1 : 0;
+}
+
+static void bench_print_footer( FILE *fp, const bench_config_t *config )
+{
+	if( BENCH_FORMAT_JSON == config->format )
+	{
+		fprintf( fp, "\n]\n" );
+	}
+}
+
+/**
+ * @brief Report the memory used by lists of every configured size and level cap.
+ *
+ * The lists are built the same way as for the timed runs but no operations are run.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+static int bench_memory( FILE *fp, const bench_config_t *config )
+{
+	static const char *backend_names[] = { "malloc", "hugepages" };
+	skiplist_memory_usage_t usage;
+	skiplist_t *skiplist;
+	const char *separator = "";
+	unsigned int size;
+	unsigned int links;
+
+	if( BENCH_FORMAT_CSV == config->format )
+	{
+		fprintf( fp, "memory,size,links,header,node_headers,link_bytes,slack,total,bytes_per_element\n" );
+	}
+	else
+	{
+		fprintf( fp, "[" );
+	}
+
+	for( size = 0; size < config->num_sizes; ++size )
+	{
+		for( links = 0; links < config->num_links; ++links )
+		{
+			double per_element;
+
+			skiplist = bench_build( config, &bench_skiplist_ops, config->sizes[size], (unsigned int) config->links[links] );
+			if( !skiplist || skiplist_memory_usage( skiplist, &usage ) )
+				return -1;
+			skiplist_destroy( skiplist );
+
+			per_element = config->sizes[size] ? (double) usage.total / config->sizes[size] : 0.0;
+
+			if( BENCH_FORMAT_CSV == config->format )
+			{
+				fprintf( fp, "%s,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%.2f\n", backend_names[config->memory_backend],
+				         config->sizes[size], config->links[links], (unsigned long) usage.header,
+				         (unsigned long) usage.node_headers, (unsigned long) usage.links,
+				         (unsigned long) usage.slack, (unsigned long) usage.total, per_element );
+			}
+			else
+			{
+				fprintf( fp, "%s\n{\"memory\":\"%s\",\"size\":%lu,\"links\":%lu,\"header\":%lu,\"node_headers\":%lu,"
+				         "\"link_bytes\":%lu,\"slack\":%lu,\"total\":%lu,\"bytes_per_element\":%.2f}",
+				         separator, backend_names[config->memory_backend], config->sizes[size], config->links[links],
+				         (unsigned long) usage.header, (unsigned long) usage.node_headers,
+				         (unsigned long) usage.links, (unsigned long) usage.slack, (unsigned long) usage.total,
+				         per_element );
+			}
+			separator = ",";
+			fflush( fp );
+		}
+	}
+
+	bench_print_footer( fp, config );
+
+	return 0;
+}
+
+/**
+ * @brief Prints one line of the priority queue results.
+ */
+static void bench_print_queue( FILE *fp, const bench_config_t *config, const char *container, unsigned long size,
+                               unsigned long links, double hold_ns, double update_ns, const char *separator )
+{
+	if( BENCH_FORMAT_CSV == config->format )
+	{
+		fprintf( fp, "%s,%lu,%lu,%.1f,%.1f\n", container, size, links, hold_ns, update_ns );
+	}
+	else
+	{
+		fprintf( fp, "%s\n{\"container\":\"%s\",\"size\":%lu,\"links\":%lu,\"hold_ns\":%.1f,\"update_ns\":%.1f}",
+		         separator, container, size, links, hold_ns, update_ns );
+	}
+	fflush( fp );
+}
+
+/**
+ * @brief Time a skiplist used as a priority queue against an indexed binary heap.
+ *
+ * Each queue holds --size entries. The hold phase pops the smallest entry and
+ * pushes it back with a later priority, like a scheduler running a task and
+ * queueing it again. The update phase moves random entries by a small amount
+ * either way through their handles. Both run --ops operations, and the
+ * skiplist is measured for each --links.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+static int bench_queue( FILE *fp, const bench_config_t *config )
+{
+	skiplist_options_t options;
+	skiplist_t *skiplist;
+	skiplist_node_t **handles;
+	uintptr_t *priorities;
+	bench_heap_t heap;
+	bench_heap_entry_t entry;
+	bench_rng_t rng;
+	struct timespec start;
+	struct timespec end;
+	const char *separator = "";
+	unsigned long long hold_ns;
+	unsigned long id;
+	unsigned long op;
+	unsigned int size;
+	unsigned int links;
+
+	if( BENCH_FORMAT_CSV == config->format )
+	{
+		fprintf( fp, "container,size,links,hold_ns,update_ns\n" );
+	}
+	else
+	{
+		fprintf( fp, "[" );
+	}
+
+	for( size = 0; size < config->num_sizes; ++size )
+	{
+		unsigned long entries = config->sizes[size] ? config->sizes[size] : 1;
+
+		handles = malloc( sizeof( *handles ) * entries );
+		priorities = malloc( sizeof( *priorities ) * entries );
+		if( !handles || !priorities || bench_heap_init( &heap, entries ) )
+			return -1;
+
+		/* The heap is run once, the skiplist once for each level cap, from the same seed. */
+		for( links = 0; links <= config->num_links; ++links )
+		{
+			bench_rng_seed( &rng, config->seed );
+
+			if( links < config->num_links )
+			{
+				/* Back links let an entry moving to a smaller priority stay in place when it can. */
+				skiplist_options_init( &options );
+				options.properties = SKIPLIST_PROPERTY_BACK_LINKS;
+				options.size_estimate_log2 = (unsigned int) config->links[links];
+				options.compare = bench_compare;
+				options.print = bench_fprintf;
+				options.payload_size = sizeof( id );
+				options.memory_backend = config->memory_backend;
+				skiplist = skiplist_create_with_options( &options, NULL );
+				if( !skiplist )
+					return -1;
+			}
+			else
+			{
+				skiplist = NULL;
+			}
+
+			for( id = 0; id < entries; ++id )
+			{
+				priorities[id] = (uintptr_t) (bench_rng_next( &rng ) >> 24);
+				if( skiplist )
+				{
+					handles[id] = skiplist_push( skiplist, priorities[id], NULL );
+					if( !handles[id] )
+						return -1;
+					memcpy( skiplist_node_payload( handles[id], NULL ), &id, sizeof( id ) );
+				}
+				else
+				{
+					bench_heap_push( &heap, id, priorities[id] );
+				}
+			}
+
+			time_stamp( &start );
+			for( op = 0; op < config->ops; ++op )
+			{
+				uintptr_t later = (uintptr_t) (bench_rng_next( &rng ) >> 40);
+
+				if( skiplist )
+				{
+					later += skiplist_pop_min( skiplist, &id, NULL );
+					priorities[id] = later;
+					handles[id] = skiplist_push( skiplist, later, NULL );
+					if( !handles[id] )
+						return -1;
+					memcpy( skiplist_node_payload( handles[id], NULL ), &id, sizeof( id ) );
+				}
+				else
+				{
+					entry = bench_heap_pop_min( &heap );
+					priorities[entry.id] = entry.priority + later;
+					bench_heap_push( &heap, entry.id, priorities[entry.id] );
+				}
+			}
+			time_stamp( &end );
+			hold_ns = time_diff_ns( &start, &end );
+
+			time_stamp( &start );
+			for( op = 0; op < config->ops; ++op )
+			{
+				unsigned long long random = bench_rng_next( &rng );
+
+				/* Move by up to 2^16 either way, which rarely passes more than a few neighbours. */
+				id = (unsigned long) (random % entries);
+				priorities[id] += (uintptr_t) ((random >> 32) & 0xffff);
+				priorities[id] -= (uintptr_t) ((random >> 48) & 0xffff);
+
+				if( skiplist )
+				{
+					handles[id] = skiplist_update_node( skiplist, handles[id], priorities[id], NULL );
+					if( !handles[id] )
+						return -1;
+				}
+				else
+				{
+					bench_heap_update( &heap, id, priorities[id] );
+				}
+			}
+			time_stamp( &end );
+
+			bench_print_queue( fp, config, skiplist ? "skiplist" : "heap", config->sizes[size],
+			                   skiplist ? config->links[links] : 0, config->ops ? (double) hold_ns / config->ops : 0.0,
+			                   config->ops ? (double) time_diff_ns( &start, &end ) / config->ops : 0.0, separator );
+			separator = ",";
+
+			if( skiplist )
+			{
+				skiplist_destroy( skiplist );
+			}
+			else
+			{
+				while( heap.size )
+				{
+					bench_heap_pop_min( &heap );
+				}
+			}
+		}
+
+		bench_heap_free( &heap );
+		free( priorities );
+		free( handles );
+	}
+
+	bench_print_footer( fp, config );
+
+	return 0;
+}
+
+/**
+ * @brief Holds the threads of the multithreaded benchmark until they're all ready to start.
+ */
+typedef struct bench_gate_t
+{
+	/** Protects the other members. */
+	pthread_mutex_t mutex;
+
+	/** Signalled when a thread becomes ready and when the gate opens. */
+	pthread_cond_t cond;
+
+	/** The number of threads waiting at the gate. */
+	unsigned int ready;
+
+	/** Set once the threads may start. */
+	unsigned int open;
+} bench_gate_t;
+
+/**
+ * @brief The state of one thread in the multithreaded benchmark.
+ */
+typedef struct bench_thread_t
+{
+	/** The thread's handle. */
+	pthread_t thread;
+
+	/** The benchmark configuration. */
+	const bench_config_t *config;
+
+	/** The gate the thread waits at before starting to measure. */
+	bench_gate_t *gate;
+
+	/** The list the thread works on, NULL to build a private list. */
+	skiplist_t *skiplist;
+
+	/** Held around each operation on a shared list, NULL for private lists. */
+	pthread_mutex_t *lock;
+
+	/** The number of elements in the list. */
+	unsigned long size;
+
+	/** The number of links in a private list. */
+	unsigned int links;
+
+	/** Seed for the thread's operation generator. */
+	unsigned long seed;
+
+	/** Non-zero if the thread failed. */
+	int failed;
+
+	/** The thread's measurements. */
+	bench_result_t *result;
+} bench_thread_t;
+
+static void *bench_thread_main( void *arg )
+{
+	bench_thread_t *thread = arg;
+	skiplist_t *skiplist = thread->skiplist;
+
+	/* Private lists are built by their own thread, so the nodes come from that thread's allocator arena. */
+	if( !skiplist )
+	{
+		skiplist = bench_build( thread->config, &bench_skiplist_ops, thread->size, thread->links );
+		thread->failed = NULL == skiplist;
+	}
+
+	pthread_mutex_lock( &thread->gate->mutex );
+	++thread->gate->ready;
+	pthread_cond_broadcast( &thread->gate->cond );
+	while( !thread->gate->open )
+	{
+		pthread_cond_wait( &thread->gate->cond, &thread->gate->mutex );
+	}
+	pthread_mutex_unlock( &thread->gate->mutex );
+
+	if( !thread->failed )
+	{
+		thread->failed = bench_operate( thread->config, &bench_skiplist_ops, skiplist, thread->lock, NULL,
+		                                thread->size, thread->seed, thread->result );
+	}
+
+	if( skiplist && !thread->skiplist )
+	{
+		skiplist_destroy( skiplist );
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Run the workload on @p count threads at once.
+ *
+ * @param [out] wall_ns   The time from releasing the threads until the last one finished.
+ * @param [out] combined  The latencies and counts of all threads combined.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+static int bench_run_threads( const bench_config_t *config, bench_sharing_t sharing, unsigned long size,
+                              unsigned int links, unsigned int count, unsigned int rep,
+                              unsigned long long *wall_ns, bench_result_t *combined )
+{
+	bench_thread_t *threads;
+	bench_gate_t gate;
+	pthread_mutex_t lock;
+	skiplist_t *shared = NULL;
+	struct timespec start, end;
+	unsigned int started;
+	unsigned int i;
+	int failed = 0;
+
+	threads = calloc( count, sizeof( *threads ) );
+	if( !threads )
+		return -1;
+
+	if( BENCH_SHARING_SHARED == sharing )
+	{
+		shared = bench_build( config, &bench_skiplist_ops, size, links );
+		if( !shared )
+		{
+			free( threads );
+			return -1;
+		}
+	}
+
+	pthread_mutex_init( &lock, NULL );
+	pthread_mutex_init( &gate.mutex, NULL );
+	pthread_cond_init( &gate.cond, NULL );
+	gate.ready = 0;
+	gate.open = 0;
+
+	for( started = 0; started < count; ++started )
+	{
+		threads[started].config = config;
+		threads[started].gate = &gate;
+		threads[started].skiplist = shared;
+		threads[started].lock = shared ? &lock : NULL;
+		threads[started].size = size;
+		threads[started].links = links;
+		threads[started].seed = config->seed + rep * BENCH_MAX_THREADS + started;
+		threads[started].result = calloc( 1, sizeof( bench_result_t ) );
+		if( !threads[started].result ||
+		    pthread_create( &threads[started].thread, NULL, bench_thread_main, &threads[started] ) )
+		{
+			free( threads[started].result );
+			failed = -1;
+			break;
+		}
+	}
+
+	/* Open the gate once every thread has built its list, or straight away if a thread failed to start. */
+	pthread_mutex_lock( &gate.mutex );
+	while( !failed && gate.ready < started )
+	{
+		pthread_cond_wait( &gate.cond, &gate.mutex );
+	}
+	time_stamp( &start );
+	gate.open = 1;
+	pthread_cond_broadcast( &gate.cond );
+	pthread_mutex_unlock( &gate.mutex );
+
+	for( i = 0; i < started; ++i )
+	{
+		pthread_join( threads[i].thread, NULL );
+	}
+	time_stamp( &end );
+	*wall_ns = time_diff_ns( &start, &end );
+
+	memset( combined, 0, sizeof( *combined ) );
+	for( i = 0; i < started; ++i )
+	{
+		unsigned int op;
+
+		failed |= threads[i].failed;
+		for( op = 0; op < BENCH_OP_COUNT; ++op )
+		{
+			combined->count[op] += threads[i].result->count[op];
+			bench_histogram_merge( &combined->latency[op], &threads[i].result->latency[op] );
+		}
+		combined->hits += threads[i].result->hits;
+		free( threads[i].result );
+	}
+
+	if( shared )
+	{
+		combined->final_size = skiplist_size( shared, NULL );
+		skiplist_destroy( shared );
+	}
+
+	pthread_cond_destroy( &gate.cond );
+	pthread_mutex_destroy( &gate.mutex );
+	pthread_mutex_destroy( &lock );
+	free( threads );
+
+	return failed ? -1 : 0;
+}
+
+static void bench_print_threads_header( FILE *fp, const bench_config_t *config )
+{
+	if( BENCH_FORMAT_CSV == config->format )
+	{
+		fprintf( fp, "sharing,threads,dist,size,links,rep,ops_per_thread,wall_ns,ops_per_sec,efficiency" );
+		if( config->latency_batch )
+		{
+			fprintf( fp, ",p50_ns,p99_ns,p999_ns,max_ns" );
+		}
+		fprintf( fp, "\n" );
+	}
+	else
+	{
+		fprintf( fp, "[" );
+	}
+}
+
+/**
+ * @brief Print the result of a multithreaded run.
+ *
+ * Latencies are reported over every operation type combined as the lock wait dominates them.
+ */
+static void bench_print_threads_result( FILE *fp, const bench_config_t *config, bench_sharing_t sharing,
+                                        unsigned int threads, unsigned long size, unsigned int links,
+                                        unsigned int rep, unsigned long long wall_ns, double efficiency,
+                                        const bench_result_t *result, const char *separator )
+{
+	bench_histogram_t all;
+	unsigned int i;
+	double ops_per_sec = wall_ns ? (double) config->ops * threads * 1e9 / wall_ns : 0.0;
+
+	bench_histogram_reset( &all );
+	for( i = 0; i < BENCH_OP_COUNT; ++i )
+	{
+		bench_histogram_merge( &all, &result->latency[i] );
+	}
+
+	if( BENCH_FORMAT_CSV == config->format )
+	{
+		fprintf( fp, "%s,%u,%s,%lu,%u,%u,%lu,%llu,%.1f,%.3f", bench_sharing_names[sharing], threads,
+		         bench_dist_names[config->dist], size, links, rep, config->ops, wall_ns, ops_per_sec, efficiency );
+		if( config->latency_batch )
+		{
+			fprintf( fp, ",%llu,%llu,%llu,%llu", bench_histogram_percentile( &all, 50.0 ),
+			         bench_histogram_percentile( &all, 99.0 ), bench_histogram_percentile( &all, 99.9 ), all.max );
+		}
+		fprintf( fp, "\n" );
+	}
+	else
+	{
+		fprintf( fp, "%s\n{\"sharing\":\"%s\",\"threads\":%u,\"dist\":\"%s\",\"size\":%lu,\"links\":%u,"
+		         "\"rep\":%u,\"ops_per_thread\":%lu,\"wall_ns\":%llu,\"ops_per_sec\":%.1f,\"efficiency\":%.3f",
+		         separator, bench_sharing_names[sharing], threads, bench_dist_names[config->dist], size, links,
+		         rep, config->ops, wall_ns, ops_per_sec, efficiency );
+		if( config->latency_batch )
+		{
+			fprintf( fp, ",\"latency_ns\":{\"p50\":%llu,\"p99\":%llu,\"p999\":%llu,\"max\":%llu}",
+			         bench_histogram_percentile( &all, 50.0 ), bench_histogram_percentile( &all, 99.0 ),
+			         bench_histogram_percentile( &all, 99.9 ), all.max );
+		}
+		fprintf( fp, "}" );
+	}
+}
+
+/**
+ * @brief Sweep the thread count from 1 up to config->threads, doubling each time.
+ *
+ * Scaling efficiency is the throughput divided by the single threaded throughput
+ * times the number of threads, 1.0 being perfect scaling.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+static int bench_threads( FILE *fp, const bench_config_t *config, bench_result_t *result )
+{
+	const char *separator = "";
+	unsigned int sharing;
+	unsigned int size;
+	unsigned int links;
+	unsigned int rep;
+	unsigned int threads;
+
+	bench_print_threads_header( fp, config );
+
+	for( size = 0; size < config->num_sizes; ++size )
+	{
+		for( links = 0; links < config->num_links; ++links )
+		{
+			for( sharing = BENCH_SHARING_PRIVATE; sharing <= BENCH_SHARING_SHARED; ++sharing )
+			{
+				if( BENCH_SHARING_BOTH != config->sharing && sharing != config->sharing )
+					continue;
+
+				for( rep = 0; rep < config->reps; ++rep )
+				{
+					double single = 0.0;
+
+					for( threads = 1; threads <= config->threads;
+					     threads = threads < config->threads && threads * 2 > config->threads ? config->threads : threads * 2 )
+					{
+						unsigned long long wall_ns;
+						double ops_per_sec;
+
+						if( bench_run_threads( config, (bench_sharing_t) sharing, config->sizes[size],
+						                       (unsigned int) config->links[links], threads, rep, &wall_ns, result ) )
+							return -1;
+
+						ops_per_sec = wall_ns ? (double) config->ops * threads * 1e9 / wall_ns : 0.0;
+						if( 1 == threads )
+							single = ops_per_sec;
+
+						bench_print_threads_result( fp, config, (bench_sharing_t) sharing, threads,
+						                            config->sizes[size], (unsigned int) config->links[links], rep,
+						                            wall_ns, single > 0.0 ? ops_per_sec / (single * threads) : 0.0,
+						                            result, separator );
+						separator = ",";
+						fflush( fp );
+
+						if( threads == config->threads )
+							break;
+					}
+				}
+			}
+		}
+	}
+
+	bench_print_footer( fp, config );
+
+	return 0;
+}
+
+static void bench_print_header( FILE *fp, const bench_config_t *config )
+{
+	unsigned int i;
+	unsigned int j;
+
+	if( BENCH_FORMAT_CSV == config->format )
+	{
+		fprintf( fp, "container,dist,size,links,read,insert,remove,rank,scan,rep,ops,build_ns,run_ns,ops_per_sec,"
+		         "relative_throughput,hits,final_size,memory_bytes,bytes_per_element" );
+		if( config->latency_batch )
+		{
+			for( i = 0; i < BENCH_OP_COUNT; ++i )
+			{
+				for( j = 0; j < NELEMS( bench_percentiles ); ++j )
+				{
+					fprintf( fp, ",%s_%s_ns", bench_op_names[i], bench_percentile_names[j] );
+				}
+				fprintf( fp, ",%s_max_ns", bench_op_names[i] );
+			}
+		}
+		if( config->perf )
+		{
+			for( i = 0; i < BENCH_PERF_COUNT; ++i )
+			{
+				fprintf( fp, ",build_%s_per_op", bench_perf_names[i] );
+			}
+			for( i = 0; i < BENCH_PERF_COUNT; ++i )
+			{
+				fprintf( fp, ",run_%s_per_op", bench_perf_names[i] );
+			}
+		}
+		fprintf( fp, "\n" );
+	}
+	else
+	{
+		fprintf( fp, "[" );
+	}
+}
+
+/**
+ * @brief Print the event counts divided by @p ops, as CSV columns or a JSON object.
+ *
+ * Events which weren't counted are left empty in CSV and are null in JSON.
+ */
+static void bench_print_perf( FILE *fp, const bench_config_t *config, const bench_perf_counts_t *counts,
+                              unsigned long ops )
+{
+	unsigned int i;
+
+	for( i = 0; i < BENCH_PERF_COUNT; ++i )
+	{
+		if( BENCH_FORMAT_CSV == config->format )
+		{
+			fprintf( fp, "," );
+		}
+		else
+		{
+			fprintf( fp, "%s\"%s\":", i ? "," : "{", bench_perf_names[i] );
+		}
+
+		if( counts->valid[i] && ops )
+		{
+			fprintf( fp, "%.3f", counts->value[i] / ops );
+		}
+		else if( BENCH_FORMAT_JSON == config->format )
+		{
+			fprintf( fp, "null" );
+		}
+	}
+
+	if( BENCH_FORMAT_JSON == config->format )
+	{
+		fprintf( fp, "}" );
+	}
+}
+
+/**
+ * @brief Print the result of one repetition.
+ *
+ * @param [in] reference  The throughput of the first configured container on the same workload,
+ *                        the relative throughput is reported against it.
+ */
+static void bench_print_result( FILE *fp, const bench_config_t *config, const bench_container_ops_t *type,
+                                unsigned long size, unsigned int links, unsigned int rep,
+                                const bench_result_t *result, double reference, const char *separator )
+{
+	unsigned int i;
+	unsigned int j;
+	double ops_per_sec = result->run_ns ? config->ops * 1e9 / result->run_ns : 0.0;
+	double relative = reference > 0.0 ? ops_per_sec / reference : 0.0;
+	double per_element = size ? (double) result->memory_bytes / size : 0.0;
+
+	if( BENCH_FORMAT_CSV == config->format )
+	{
+		fprintf( fp, "%s,%s,%lu,%u", type->name, bench_dist_names[config->dist], size, links );
+		for( i = 0; i < BENCH_OP_COUNT; ++i )
+		{
+			fprintf( fp, ",%u", config->mix[i] );
+		}
+		fprintf( fp, ",%u,%lu,%llu,%llu,%.1f,%.3f,%lu,%lu,%lu,%.2f", rep, config->ops, result->build_ns,
+		         result->run_ns, ops_per_sec, relative, result->hits, result->final_size,
+		         (unsigned long) result->memory_bytes, per_element );
+		if( config->latency_batch )
+		{
+			for( i = 0; i < BENCH_OP_COUNT; ++i )
+			{
+				for( j = 0; j < NELEMS( bench_percentiles ); ++j )
+				{
+					fprintf( fp, ",%llu", bench_histogram_percentile( &result->latency[i], bench_percentiles[j] ) );
+				}
+				fprintf( fp, ",%llu", result->latency[i].max );
+			}
+		}
+		if( config->perf )
+		{
+			bench_print_perf( fp, config, &result->perf_build, size );
+			bench_print_perf( fp, config, &result->perf_run, config->ops );
+		}
+		fprintf( fp, "\n" );
+	}
+	else
+	{
+		fprintf( fp, "%s\n{\"container\":\"%s\",\"dist\":\"%s\",\"size\":%lu,\"links\":%u,\"mix\":{", separator,
+		         type->name, bench_dist_names[config->dist], size, links );
+		for( i = 0; i < BENCH_OP_COUNT; ++i )
+		{
+			fprintf( fp, "%s\"%s\":%u", i ? "," : "", bench_op_names[i], config->mix[i] );
+		}
+		fprintf( fp, "},\"rep\":%u,\"ops\":%lu,\"build_ns\":%llu,\"run_ns\":%llu,\"ops_per_sec\":%.1f,"
+		         "\"relative_throughput\":%.3f,\"hits\":%lu,\"final_size\":%lu,\"memory_bytes\":%lu,"
+		         "\"bytes_per_element\":%.2f,\"count\":{",
+		         rep, config->ops, result->build_ns, result->run_ns, ops_per_sec, relative, result->hits,
+		         result->final_size, (unsigned long) result->memory_bytes, per_element );
+		for( i = 0; i < BENCH_OP_COUNT; ++i )
+		{
+			fprintf( fp, "%s\"%s\":%lu", i ? "," : "", bench_op_names[i], result->count[i] );
+		}
+		fprintf( fp, "}" );
+		if( config->latency_batch )
+		{
+			fprintf( fp, ",\"latency_ns\":{" );
+			for( i = 0; i < BENCH_OP_COUNT; ++i )
+			{
+				fprintf( fp, "%s\"%s\":{\"mean\":%.1f", i ? "," : "", bench_op_names[i],
+				         bench_histogram_mean( &result->latency[i] ) );
+				for( j = 0; j < NELEMS( bench_percentiles ); ++j )
+				{
+					fprintf( fp, ",\"%s\":%llu", bench_percentile_names[j],
+					         bench_histogram_percentile( &result->latency[i], bench_percentiles[j] ) );
+				}
+				fprintf( fp, ",\"max\":%llu}", result->latency[i].max );
+			}
+			fprintf( fp, "}" );
+		}
+		if( config->perf )
+		{
+			fprintf( fp, ",\"build_per_op\":" );
+			bench_print_perf( fp, config, &result->perf_build, size );
+			fprintf( fp, ",\"run_per_op\":" );
+			bench_print_perf( fp, config, &result->perf_run, config->ops );
+		}
+		fprintf( fp, "}" );
+	}
+}
+
+static void bench_usage( const char *program )
+{
+	fprintf( stderr, "usage: %s [options]\n", program );
+	fprintf( stderr, "  --size LIST      elements inserted before measuring, up to %lu (default 1000000)\n",
+	         BENCH_MAX_SIZE );
+	fprintf( stderr, "  --ops N          operations measured per repetition (default 1000000)\n" );
+	fprintf( stderr, "  --dist NAME      key distribution: sequential, uniform, zipfian or clustered (default uniform)\n" );
+	fprintf( stderr, "  --mix LIST       operation percentages, e.g. read=90,insert=5,remove=5,rank=0,scan=0\n" );
+	fprintf( stderr, "  --container LIST skiplist, array, rbtree or btree, compared with the first (default skiplist)\n" );
+	fprintf( stderr, "  --links LIST     links per skiplist, 1 to %u (default %u)\n",
+	         SKIPLIST_MAX_LINKS, SKIPLIST_MAX_LINKS );
+	fprintf( stderr, "  --reps N         repetitions (default 3)\n" );
+	fprintf( stderr, "  --seed N         random seed (default 1)\n" );
+	fprintf( stderr, "  --scan N         elements visited per scan (default 100)\n" );
+	fprintf( stderr, "  --latency N      record latency percentiles, timing up to N operations together (default 0, off)\n" );
+	fprintf( stderr, "  --mode NAME      time, memory to report the memory used by each list, or queue to time\n" );
+	fprintf( stderr, "                   priority queue operations against a binary heap (default time)\n" );
+	fprintf( stderr, "  --threads N      sweep 1 to N threads doubling each time, 'cores' for every online core (default 0, off)\n" );
+	fprintf( stderr, "  --sharing NAME   lists used by threads: private, shared (behind a mutex) or both (default both)\n" );
+	fprintf( stderr, "  --perf on|off    count hardware events per operation, single threaded runs only (default off)\n" );
+	fprintf( stderr, "  --memory NAME    memory backend: malloc or hugepages (default malloc)\n" );
+	fprintf( stderr, "  --format NAME    csv or json (default csv)\n" );
+	fprintf( stderr, "  --output FILE    write results to FILE instead of stdout\n" );
+	fprintf( stderr, "LIST is a single number or a comma separated list to sweep, e.g. --size 1000,1000000\n" );
+}
+
+/**
+ * @brief Parse an operation mix such as "read=90,insert=10".
+ *
+ * Operations that aren't listed get 0%.
+ *
+ * @return 0 on success, -1 if the mix is malformed or doesn't add up to 100%.
+ */
+static int bench_parse_mix( const char *text, unsigned int mix[BENCH_OP_COUNT] )
+{
+	unsigned int total = 0;
+	unsigned int i;
+
+	memset( mix, 0, sizeof( mix[0] ) * BENCH_OP_COUNT );
+
+	while( *text )
+	{
+		const char *equals = strchr( text, '=' );
+		char *end;
+		unsigned long percent;
+
+		if( !equals )
+			return -1;
+
+		for( i = 0; i < BENCH_OP_COUNT; ++i )
+			if( strlen( bench_op_names[i] ) == (size_t) (equals - text ) &&
+			    0 == strncmp( bench_op_names[i], text, equals - text ) )
+				break;
+		if( BENCH_OP_COUNT == i )
+			return -1;
+
+		percent = strtoul( equals + 1, &end, 10 );
+		if( end == equals + 1 || percent > 100 || (*end && ',' != *end) )
+			return -1;
+
+		mix[i] = (unsigned int) percent;
+		total += (unsigned int) percent;
+		text = *end ? end + 1 : end;
+	}
+
+	return 100 == total ? 0 : -1;
+}
+
+/**
+ * @brief Parse an unsigned number in [min, max].
+ *
+ * @return 0 on success, -1 if @p text isn't a number in range.
+ */
+static int bench_parse_ulong( const char *text, unsigned long min, unsigned long max, unsigned long *value )
+{
+	char *end;
+
+	*value = strtoul( text, &end, 10 );
+
+	return (end == text || *end || *value < min || *value > max) ? -1 : 0;
+}
+
+/**
+ * @brief Parse a comma separated list of unsigned numbers in [min, max].
+ *
+ * @return 0 on success, -1 if @p text isn't a list of numbers in range.
+ */
+static int bench_parse_ulong_list( const char *text, unsigned long min, unsigned long max,
+                                   unsigned long values[BENCH_MAX_SWEEP], unsigned int *count )
+{
+	char buffer[32];
+	const char *comma;
+	size_t length;
+
+	*count = 0;
+	do
+	{
+		comma = strchr( text, ',' );
+		length = comma ? (size_t) (comma - text) : strlen( text );
+		if( length >= sizeof( buffer ) || BENCH_MAX_SWEEP == *count )
+			return -1;
+
+		memcpy( buffer, text, length );
+		buffer[length] = '\0';
+		if( bench_parse_ulong( buffer, min, max, &values[*count] ) )
+			return -1;
+
+		++*count;
+		text = comma + 1;
+	} while( comma );
+
+	return 0;
+}
+
+/**
+ * @brief Look @p text up in a table of names.
+ *
+ * @return The index of the name or -1 if it isn't in the table.
+ */
+static int bench_parse_name( const char *text, const char **names, unsigned int count )
+{
+	unsigned int i;
+
+	for( i = 0; i < count; ++i )
+		if( 0 == strcmp( text, names[i] ) )
+			return (int) i;
+
+	return -1;
+}
+
+/**
+ * @brief Parse the command line into @p config.
+ *
+ * @return 0 on success, -1 if the command line is invalid.
+ */
+/**
+ * @brief Parse a comma separated list of container names.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+static int bench_parse_container_list( const char *text, bench_config_t *config )
+{
+	char buffer[32];
+	const char *comma;
+	size_t length;
+	unsigned int i;
+
+	config->num_containers = 0;
+	do
+	{
+		comma = strchr( text, ',' );
+		length = comma ? (size_t) (comma - text) : strlen( text );
+		if( length >= sizeof( buffer ) || BENCH_MAX_SWEEP == config->num_containers )
+			return -1;
+
+		memcpy( buffer, text, length );
+		buffer[length] = '\0';
+		for( i = 0; i < NELEMS( bench_containers ) && strcmp( buffer, bench_containers[i]->name ); ++i )
+		{
+		}
+		if( NELEMS( bench_containers ) == i )
+			return -1;
+
+		config->containers[config->num_containers++] = bench_containers[i];
+		text = comma + 1;
+	} while( comma );
+
+	return 0;
+}
+
+static int bench_parse_args( int argc, char *argv[], bench_config_t *config )
+{
+	static const char *memory_names[] = { "malloc", "hugepages" };
+	static const char *mode_names[] = { "time", "memory", "queue" };
+	static const char *format_names[] = { "csv", "json" };
+	static const char *switch_names[] = { "off", "on" };
+	int i;
+
+	memset( config, 0, sizeof( *config ) );
+	config->sizes[0] = 1000000;
+	config->num_sizes = 1;
+	config->ops = 1000000;
+	config->dist = BENCH_DIST_UNIFORM;
+	config->mix[BENCH_OP_READ] = 90;
+	config->mix[BENCH_OP_INSERT] = 5;
+	config->mix[BENCH_OP_REMOVE] = 5;
+	config->containers[0] = &bench_skiplist_ops;
+	config->num_containers = 1;
+	config->links[0] = SKIPLIST_MAX_LINKS;
+	config->num_links = 1;
+	config->reps = 3;
+	config->seed = 1;
+	config->scan_length = 100;
+	config->memory_backend = SKIPLIST_MEMORY_MALLOC;
+	config->threads = 0;
+	config->sharing = BENCH_SHARING_BOTH;
+	config->perf = 0;
+	config->format = BENCH_FORMAT_CSV;
+	config->output = NULL;
+
+	for( i = 1; i < argc; ++i )
+	{
+		const char *arg = argv[i];
+		const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+		unsigned long number;
+		int index;
+
+		if( !value )
+			return -1;
+		++i;
+
+		if( 0 == strcmp( arg, "--size" ) )
+		{
+			if( bench_parse_ulong_list( value, 0, BENCH_MAX_SIZE, config->sizes, &config->num_sizes ) )
+				return -1;
+		}
+		else if( 0 == strcmp( arg, "--ops" ) )
+		{
+			if( bench_parse_ulong( value, 0, (unsigned long) -1, &config->ops ) )
+				return -1;
+		}
+		else if( 0 == strcmp( arg, "--dist" ) )
+		{
+			if( (index = bench_parse_name( value, bench_dist_names, BENCH_DIST_COUNT )) < 0 )
+				return -1;
+			config->dist = (bench_dist_t) index;
+		}
+		else if( 0 == strcmp( arg, "--mix" ) )
+		{
+			if( bench_parse_mix( value, config->mix ) )
+				return -1;
+		}
+		else if( 0 == strcmp( arg, "--links" ) )
+		{
+			if( bench_parse_ulong_list( value, 1, SKIPLIST_MAX_LINKS, config->links, &config->num_links ) )
+				return -1;
+		}
+		else if( 0 == strcmp( arg, "--reps" ) )
+		{
+			if( bench_parse_ulong( value, 1, 1000000, &number ) )
+				return -1;
+			config->reps = (unsigned int) number;
+		}
+		else if( 0 == strcmp( arg, "--seed" ) )
+		{
+			if( bench_parse_ulong( value, 0, (unsigned long) -1, &config->seed ) )
+				return -1;
+		}
+		else if( 0 == strcmp( arg, "--scan" ) )
+		{
+			if( bench_parse_ulong( value, 1, 1000000000, &number ) )
+				return -1;
+			config->scan_length = (unsigned int) number;
+		}
+		else if( 0 == strcmp( arg, "--latency" ) )
+		{
+			if( bench_parse_ulong( value, 0, BENCH_BATCH, &number ) )
+				return -1;
+			config->latency_batch = (unsigned int) number;
+		}
+		else if( 0 == strcmp( arg, "--threads" ) )
+		{
+			if( 0 == strcmp( value, "cores" ) )
+			{
+				long cores = sysconf( _SC_NPROCESSORS_ONLN );
+				config->threads = cores > 0 ? (unsigned int) cores : 1;
+			}
+			else
+			{
+				if( bench_parse_ulong( value, 0, BENCH_MAX_THREADS, &number ) )
+					return -1;
+				config->threads = (unsigned int) number;
+			}
+		}
+		else if( 0 == strcmp( arg, "--sharing" ) )
+		{
+			if( (index = bench_parse_name( value, bench_sharing_names, NELEMS( bench_sharing_names ) )) < 0 )
+				return -1;
+			config->sharing = (bench_sharing_t) index;
+		}
+		else if( 0 == strcmp( arg, "--perf" ) )
+		{
+			if( (index = bench_parse_name( value, switch_names, NELEMS( switch_names ) )) < 0 )
+				return -1;
+			config->perf = (unsigned int) index;
+		}
+		else if( 0 == strcmp( arg, "--memory" ) )
+		{
+			if( (index = bench_parse_name( value, memory_names, NELEMS( memory_names ) )) < 0 )
+				return -1;
+			config->memory_backend = (skiplist_memory_backend_t) index;
+		}
+		else if( 0 == strcmp( arg, "--container" ) )
+		{
+			if( bench_parse_container_list( value, config ) )
+				return -1;
+		}
+		else if( 0 == strcmp( arg, "--mode" ) )
+		{
+			if( (index = bench_parse_name( value, mode_names, NELEMS( mode_names ) )) < 0 )
+				return -1;
+			config->mode = (bench_mode_t) index;
+		}
+		else if( 0 == strcmp( arg, "--format" ) )
+		{
+			if( (index = bench_parse_name( value, format_names, NELEMS( format_names ) )) < 0 )
+				return -1;
+			config->format = (bench_format_t) index;
+		}
+		else if( 0 == strcmp( arg, "--output" ) )
+		{
+			config->output = value;
+		}
+		else
+		{
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Warn about hardware events that can't be counted on this machine.
+ *
+ * The benchmark still runs, with the missing events left out of the results.
+ */
+static void bench_perf_check( const char *program )
+{
+	bench_perf_t perf;
+	unsigned int i;
+
+	if( 0 == bench_perf_open( &perf ) )
+	{
+		fprintf( stderr, "%s: hardware counters are unavailable, check /proc/sys/kernel/perf_event_paranoid\n",
+		         program );
+		return;
+	}
+
+	for( i = 0; i < BENCH_PERF_COUNT; ++i )
+	{
+		if( perf.fd[i] < 0 )
+		{
+			fprintf( stderr, "%s: unable to count %s\n", program, bench_perf_names[i] );
+		}
+	}
+
+	bench_perf_close( &perf );
+}
+
+int main( int argc, char *argv[] )
+{
+	bench_config_t config;
+	bench_result_t *result;
+	const char *separator;
+	unsigned int size;
+	unsigned int container;
+	unsigned int links;
+	unsigned int rep;
+	FILE *fp;
+
+	if( bench_parse_args( argc, argv, &config ) )
+	{
+		bench_usage( argv[0] );
+		return EXIT_FAILURE;
+	}
+
+	fp = config.output ? fopen( config.output, "w" ) : stdout;
+	if( !fp )
+	{
+		fprintf( stderr, "%s: unable to open %s\n", argv[0], config.output );
+		return EXIT_FAILURE;
+	}
+
+	/* The latency histograms make the result too large to comfortably live on the stack. */
+	result = malloc( sizeof( *result ) );
+	if( !result )
+	{
+		fprintf( stderr, "%s: out of memory\n", argv[0] );
+		return EXIT_FAILURE;
+	}
+
+	if( BENCH_MODE_MEMORY == config.mode || BENCH_MODE_QUEUE == config.mode )
+	{
+		if( BENCH_MODE_MEMORY == config.mode ? bench_memory( fp, &config ) : bench_queue( fp, &config ) )
+		{
+			fprintf( stderr, "%s: out of memory\n", argv[0] );
+			return EXIT_FAILURE;
+		}
+
+		free( result );
+		if( fp != stdout )
+			fclose( fp );
+
+		return EXIT_SUCCESS;
+	}
+
+	if( config.threads )
+	{
+		if( bench_threads( fp, &config, result ) )
+		{
+			fprintf( stderr, "%s: out of memory\n", argv[0] );
+			return EXIT_FAILURE;
+		}
+
+		free( result );
+		if( fp != stdout )
+			fclose( fp );
+
+		return EXIT_SUCCESS;
+	}
+
+	if( config.perf )
+	{
+		bench_perf_check( argv[0] );
+	}
+
+	bench_print_header( fp, &config );
+	separator = "";
+	for( size = 0; size < config.num_sizes; ++size )
+	{
+		for( rep = 0; rep < config.reps; ++rep )
+		{
+			double reference = 0.0;
+
+			for( container = 0; container < config.num_containers; ++container )
+			{
+				const bench_container_ops_t *type = config.containers[container];
+
+				/* The level cap only means something to the skiplist, the other containers are run once. */
+				for( links = 0; links < config.num_links; ++links )
+				{
+					if( links && type != &bench_skiplist_ops )
+						break;
+
+					if( bench_run( &config, type, config.sizes[size], (unsigned int) config.links[links], rep, result ) )
+					{
+						fprintf( stderr, "%s: out of memory\n", argv[0] );
+						return EXIT_FAILURE;
+					}
+
+					if( 0 == container && 0 == links )
+						reference = result->run_ns ? config.ops * 1e9 / result->run_ns : 0.0;
+
+					bench_print_result( fp, &config, type, config.sizes[size], (unsigned int) config.links[links],
+					                    rep, result, reference, separator );
+					separator = ",";
+					fflush( fp );
+				}
+			}
+		}
+	}
+	bench_print_footer( fp, &config );
+
+	free( result );
+	if( fp != stdout )
+		fclose( fp );
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,1151 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_baselines.h"
+
+/**
+ * @brief A sorted array of values.
+ */
+typedef struct bench_array_t
+{
+	/** The values in ascending order. */
+	uintptr_t *values;
+
+	/** The number of values in use. */
+	unsigned long size;
+
+	/** The number of values allocated. */
+	unsigned long capacity;
+} bench_array_t;
+
+/**
+ * @brief Returns the index of the first value in @p array that is not less than @p value.
+ */
+static unsigned long bench_array_lower_bound( const bench_array_t *array, uintptr_t value )
+{
+	unsigned long low = 0;
+	unsigned long high = array->size;
+
+	while( low < high )
+	{
+		unsigned long mid = low + (high - low) / 2;
+
+		if( array->values[mid] < value )
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return low;
+}
+
+/**
+ * @brief Returns the index of the first value in @p array that is greater than @p value.
+ */
+static unsigned long bench_array_upper_bound( const bench_array_t *array, uintptr_t value )
+{
+	unsigned long low = 0;
+	unsigned long high = array->size;
+
+	while( low < high )
+	{
+		unsigned long mid = low + (high - low) / 2;
+
+		if( array->values[mid] <= value )
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return low;
+}
+
+static void *bench_array_create( const bench_container_params_t *params )
+{
+	(void) params;
+	return calloc( 1, sizeof( bench_array_t ) );
+}
+
+static void bench_array_destroy( void *container )
+{
+	bench_array_t *array = container;
+
+	free( array->values );
+	free( array );
+}
+
+static int bench_array_insert( void *container, uintptr_t value )
+{
+	bench_array_t *array = container;
+	unsigned long index;
+
+	if( array->size == array->capacity )
+	{
+		unsigned long capacity = array->capacity ? array->capacity * 2 : 16;
+		uintptr_t *values = realloc( array->values, sizeof( *values ) * capacity );
+
+		if( !values )
+			return -1;
+		array->values = values;
+		array->capacity = capacity;
+	}
+
+	index = bench_array_upper_bound( array, value );
+	memmove( &array->values[index + 1], &array->values[index], sizeof( *array->values ) * (array->size - index) );
+	array->values[index] = value;
+	++array->size;
+
+	return 0;
+}
+
+static int bench_array_contains( const void *container, uintptr_t value )
+{
+	const bench_array_t *array = container;
+	unsigned long index = bench_array_lower_bound( array, value );
+
+	return index < array->size && array->values[index] == value;
+}
+
+static int bench_array_remove( void *container, uintptr_t value )
+{
+	bench_array_t *array = container;
+	unsigned long index = bench_array_lower_bound( array, value );
+
+	if( index == array->size || array->values[index] != value )
+		return 0;
+
+	--array->size;
+	memmove( &array->values[index], &array->values[index + 1], sizeof( *array->values ) * (array->size - index) );
+
+	return 1;
+}
+
+static unsigned long bench_array_size( const void *container )
+{
+	return ((const bench_array_t *) container)->size;
+}
+
+static uintptr_t bench_array_at_index( const void *container, unsigned long index )
+{
+	return ((const bench_array_t *) container)->values[index];
+}
+
+static uintptr_t bench_array_scan( const void *container, unsigned long count )
+{
+	const bench_array_t *array = container;
+	uintptr_t sum = 0;
+	unsigned long i;
+
+	for( i = 0; i < count && i < array->size; ++i )
+	{
+		sum += array->values[i];
+	}
+
+	return sum;
+}
+
+static size_t bench_array_memory( const void *container )
+{
+	const bench_array_t *array = container;
+
+	return sizeof( *array ) + sizeof( *array->values ) * array->capacity;
+}
+
+const bench_container_ops_t bench_sorted_array_ops =
+{
+	"array",
+	bench_array_create,
+	bench_array_destroy,
+	bench_array_insert,
+	bench_array_contains,
+	bench_array_remove,
+	bench_array_size,
+	bench_array_at_index,
+	bench_array_scan,
+	bench_array_memory
+};
+
+/**
+ * @brief A node in an order statistic red-black tree.
+ */
+typedef struct bench_rb_node_t
+{
+	/** The parent node, the tree's sentinel for the root. */
+	struct bench_rb_node_t *parent;
+
+	/** The left and right children, the tree's sentinel where there is no child. */
+	struct bench_rb_node_t *child[2];
+
+	/** The number of nodes in the subtree rooted here, 0 for the sentinel. */
+	unsigned long size;
+
+	/** The node's value. */
+	uintptr_t value;
+
+	/** Non-zero for red nodes. */
+	int red;
+} bench_rb_node_t;
+
+/**
+ * @brief An order statistic red-black tree, after Cormen et al. "Introduction to Algorithms".
+ */
+typedef struct bench_rbtree_t
+{
+	/** The root node, &nil for an empty tree. */
+	bench_rb_node_t *root;
+
+	/** The black sentinel used in place of NULL children. */
+	bench_rb_node_t nil;
+} bench_rbtree_t;
+
+static void *bench_rbtree_create( const bench_container_params_t *params )
+{
+	bench_rbtree_t *tree;
+
+	(void) params;
+
+	tree = malloc( sizeof( *tree ) );
+	if( tree )
+	{
+		memset( &tree->nil, 0, sizeof( tree->nil ) );
+		tree->nil.parent = &tree->nil;
+		tree->nil.child[0] = &tree->nil;
+		tree->nil.child[1] = &tree->nil;
+		tree->root = &tree->nil;
+	}
+
+	return tree;
+}
+
+static void bench_rbtree_destroy( void *container )
+{
+	bench_rbtree_t *tree = container;
+	bench_rb_node_t *cur = tree->root;
+
+	/* Free the tree without recursion by rotating left children up into right spines. */
+	while( cur != &tree->nil )
+	{
+		bench_rb_node_t *left = cur->child[0];
+
+		if( left == &tree->nil )
+		{
+			bench_rb_node_t *next = cur->child[1];
+			free( cur );
+			cur = next;
+		}
+		else
+		{
+			cur->child[0] = left->child[1];
+			left->child[1] = cur;
+			cur = left;
+		}
+	}
+
+	free( tree );
+}
+
+/**
+ * @brief Rotate @p node down towards side @p dir, its child on the other side takes its place.
+ */
+static void bench_rbtree_rotate( bench_rbtree_t *tree, bench_rb_node_t *node, int dir )
+{
+	bench_rb_node_t *up = node->child[!dir];
+
+	node->child[!dir] = up->child[dir];
+	if( up->child[dir] != &tree->nil )
+		up->child[dir]->parent = node;
+
+	up->parent = node->parent;
+	if( node->parent == &tree->nil )
+		tree->root = up;
+	else
+		node->parent->child[node == node->parent->child[1]] = up;
+
+	up->child[dir] = node;
+	node->parent = up;
+
+	up->size = node->size;
+	node->size = node->child[0]->size + node->child[1]->size + 1;
+}
+
+static int bench_rbtree_insert( void *container, uintptr_t value )
+{
+	bench_rbtree_t *tree = container;
+	bench_rb_node_t *parent = &tree->nil;
+	bench_rb_node_t *cur = tree->root;
+	bench_rb_node_t *node;
+
+	node = malloc( sizeof( *node ) );
+	if( !node )
+		return -1;
+
+	/* Equal values go to the right so duplicates keep their insertion order. */
+	while( cur != &tree->nil )
+	{
+		++cur->size;
+		parent = cur;
+		cur = cur->child[value >= cur->value];
+	}
+
+	node->parent = parent;
+	node->child[0] = &tree->nil;
+	node->child[1] = &tree->nil;
+	node->size = 1;
+	node->value = value;
+	node->red = 1;
+
+	if( parent == &tree->nil )
+		tree->root = node;
+	else
+		parent->child[value >= parent->value] = node;
+
+	while( node->parent->red )
+	{
+		bench_rb_node_t *grandparent = node->parent->parent;
+		int dir = node->parent == grandparent->child[1];
+		bench_rb_node_t *uncle = grandparent->child[!dir];
+
+		if( uncle->red )
+		{
+			node->parent->red = 0;
+			uncle->red = 0;
+			grandparent->red = 1;
+			node = grandparent;
+		}
+		else
+		{
+			if( node == node->parent->child[!dir] )
+			{
+				node = node->parent;
+				bench_rbtree_rotate( tree, node, dir );
+			}
+			node->parent->red = 0;
+			grandparent->red = 1;
+			bench_rbtree_rotate( tree, grandparent, !dir );
+		}
+	}
+	tree->root->red = 0;
+
+	return 0;
+}
+
+static bench_rb_node_t *bench_rbtree_find( const bench_rbtree_t *tree, uintptr_t value )
+{
+	bench_rb_node_t *cur = tree->root;
+
+	while( cur != &tree->nil && cur->value != value )
+	{
+		cur = cur->child[value > cur->value];
+	}
+
+	return cur;
+}
+
+static int bench_rbtree_contains( const void *container, uintptr_t value )
+{
+	const bench_rbtree_t *tree = container;
+
+	return bench_rbtree_find( tree, value ) != &tree->nil;
+}
+
+/**
+ * @brief Put @p with in the place of @p node in @p node's parent.
+ */
+static void bench_rbtree_transplant( bench_rbtree_t *tree, bench_rb_node_t *node, bench_rb_node_t *with )
+{
+	if( node->parent == &tree->nil )
+		tree->root = with;
+	else
+		node->parent->child[node == node->parent->child[1]] = with;
+
+	with->parent = node->parent;
+}
+
+static int bench_rbtree_remove( void *container, uintptr_t value )
+{
+	bench_rbtree_t *tree = container;
+	bench_rb_node_t *node;
+	bench_rb_node_t *removed;
+	bench_rb_node_t *fix;
+	bench_rb_node_t *cur;
+	int removed_red;
+
+	node = bench_rbtree_find( tree, value );
+	if( node == &tree->nil )
+		return 0;
+
+	/* The node that leaves its position in the tree is either node itself or its successor. */
+	removed = node;
+	if( node->child[0] != &tree->nil && node->child[1] != &tree->nil )
+	{
+		for( removed = node->child[1]; removed->child[0] != &tree->nil; removed = removed->child[0] )
+		{
+		}
+	}
+
+	for( cur = removed->parent; cur != &tree->nil; cur = cur->parent )
+	{
+		--cur->size;
+	}
+
+	removed_red = removed->red;
+	if( removed != node )
+	{
+		fix = removed->child[1];
+		if( removed->parent == node )
+		{
+			fix->parent = removed;
+		}
+		else
+		{
+			bench_rbtree_transplant( tree, removed, removed->child[1] );
+			removed->child[1] = node->child[1];
+			removed->child[1]->parent = removed;
+		}
+		bench_rbtree_transplant( tree, node, removed );
+		removed->child[0] = node->child[0];
+		removed->child[0]->parent = removed;
+		removed->red = node->red;
+		removed->size = node->size;
+	}
+	else
+	{
+		fix = node->child[node->child[0] == &tree->nil];
+		bench_rbtree_transplant( tree, node, fix );
+	}
+	free( node );
+
+	if( !removed_red )
+	{
+		while( fix != tree->root && !fix->red )
+		{
+			int dir = fix == fix->parent->child[1];
+			bench_rb_node_t *sibling = fix->parent->child[!dir];
+
+			if( sibling->red )
+			{
+				sibling->red = 0;
+				fix->parent->red = 1;
+				bench_rbtree_rotate( tree, fix->parent, dir );
+				sibling = fix->parent->child[!dir];
+			}
+
+			if( !sibling->child[0]->red && !sibling->child[1]->red )
+			{
+				sibling->red = 1;
+				fix = fix->parent;
+			}
+			else
+			{
+				if( !sibling->child[!dir]->red )
+				{
+					sibling->child[dir]->red = 0;
+					sibling->red = 1;
+					bench_rbtree_rotate( tree, sibling, !dir );
+					sibling = fix->parent->child[!dir];
+				}
+				sibling->red = fix->parent->red;
+				fix->parent->red = 0;
+				sibling->child[!dir]->red = 0;
+				bench_rbtree_rotate( tree, fix->parent, dir );
+				fix = tree->root;
+			}
+		}
+		fix->red = 0;
+	}
+
+	/* The fix up may have written to the sentinel's parent, put it back. */
+	tree->nil.parent = &tree->nil;
+
+	return 1;
+}
+
+static unsigned long bench_rbtree_size( const void *container )
+{
+	return ((const bench_rbtree_t *) container)->root->size;
+}
+
+static uintptr_t bench_rbtree_at_index( const void *container, unsigned long index )
+{
+	const bench_rbtree_t *tree = container;
+	const bench_rb_node_t *cur = tree->root;
+
+	for( ;; )
+	{
+		unsigned long left = cur->child[0]->size;
+
+		if( index == left )
+			return cur->value;
+
+		if( index < left )
+		{
+			cur = cur->child[0];
+		}
+		else
+		{
+			index -= left + 1;
+			cur = cur->child[1];
+		}
+	}
+}
+
+static uintptr_t bench_rbtree_scan( const void *container, unsigned long count )
+{
+	const bench_rbtree_t *tree = container;
+	const bench_rb_node_t *cur = tree->root;
+	uintptr_t sum = 0;
+	unsigned long i;
+
+	if( cur == &tree->nil )
+		return 0;
+
+	while( cur->child[0] != &tree->nil )
+	{
+		cur = cur->child[0];
+	}
+
+	for( i = 0; i < count && cur != &tree->nil; ++i )
+	{
+		sum += cur->value;
+
+		/* In order successor using the parent pointers. */
+		if( cur->child[1] != &tree->nil )
+		{
+			for( cur = cur->child[1]; cur->child[0] != &tree->nil; cur = cur->child[0] )
+			{
+			}
+		}
+		else
+		{
+			while( cur->parent != &tree->nil && cur == cur->parent->child[1] )
+			{
+				cur = cur->parent;
+			}
+			cur = cur->parent;
+		}
+	}
+
+	return sum;
+}
+
+static size_t bench_rbtree_memory( const void *container )
+{
+	const bench_rbtree_t *tree = container;
+
+	return sizeof( *tree ) + sizeof( bench_rb_node_t ) * tree->root->size;
+}
+
+const bench_container_ops_t bench_rbtree_ops =
+{
+	"rbtree",
+	bench_rbtree_create,
+	bench_rbtree_destroy,
+	bench_rbtree_insert,
+	bench_rbtree_contains,
+	bench_rbtree_remove,
+	bench_rbtree_size,
+	bench_rbtree_at_index,
+	bench_rbtree_scan,
+	bench_rbtree_memory
+};
+
+/** The minimum degree of the B-tree, every node but the root holds between T - 1 and 2T - 1 values. */
+#define BENCH_BTREE_T (16)
+
+/** The most values a B-tree node holds. */
+#define BENCH_BTREE_MAX (2 * BENCH_BTREE_T - 1)
+
+/**
+ * @brief A node in a counted B-tree.
+ *
+ * Most nodes are leaves, so the children array is allocated separately for internal nodes only.
+ */
+typedef struct bench_btree_node_t
+{
+	/** The number of values in this node. */
+	unsigned int num_values;
+
+	/** Non-zero if the node has no children. */
+	unsigned int leaf;
+
+	/** The number of values in the subtree rooted here. */
+	unsigned long count;
+
+	/** The node's values in ascending order. */
+	uintptr_t values[BENCH_BTREE_MAX];
+
+	/** BENCH_BTREE_MAX + 1 slots for the node's children, NULL for leaves. */
+	struct bench_btree_node_t **children;
+} bench_btree_node_t;
+
+/**
+ * @brief A B-tree with subtree counts, after Cormen et al. "Introduction to Algorithms".
+ */
+typedef struct bench_btree_t
+{
+	/** The root node, always present. */
+	bench_btree_node_t *root;
+
+	/** The number of bytes allocated for nodes. */
+	size_t bytes;
+} bench_btree_t;
+
+static size_t bench_btree_node_size( unsigned int leaf )
+{
+	return sizeof( bench_btree_node_t ) + (leaf ? 0 : sizeof( bench_btree_node_t * ) * (BENCH_BTREE_MAX + 1));
+}
+
+static bench_btree_node_t *bench_btree_node_create( bench_btree_t *tree, unsigned int leaf )
+{
+	bench_btree_node_t *node = malloc( sizeof( *node ) );
+
+	if( node )
+	{
+		node->num_values = 0;
+		node->leaf = leaf;
+		node->count = 0;
+		node->children = NULL;
+		if( !leaf )
+		{
+			node->children = malloc( sizeof( *node->children ) * (BENCH_BTREE_MAX + 1) );
+			if( !node->children )
+			{
+				free( node );
+				return NULL;
+			}
+		}
+		tree->bytes += bench_btree_node_size( leaf );
+	}
+
+	return node;
+}
+
+static void bench_btree_node_destroy( bench_btree_t *tree, bench_btree_node_t *node )
+{
+	tree->bytes -= bench_btree_node_size( node->leaf );
+	free( node->children );
+	free( node );
+}
+
+static void *bench_btree_create( const bench_container_params_t *params )
+{
+	bench_btree_t *tree;
+
+	(void) params;
+
+	tree = malloc( sizeof( *tree ) );
+	if( tree )
+	{
+		tree->bytes = 0;
+		tree->root = bench_btree_node_create( tree, 1 );
+		if( !tree->root )
+		{
+			free( tree );
+			tree = NULL;
+		}
+	}
+
+	return tree;
+}
+
+static void bench_btree_free( bench_btree_t *tree, bench_btree_node_t *node )
+{
+	unsigned int i;
+
+	if( !node->leaf )
+	{
+		for( i = 0; i <= node->num_values; ++i )
+		{
+			bench_btree_free( tree, node->children[i] );
+		}
+	}
+
+	bench_btree_node_destroy( tree, node );
+}
+
+static void bench_btree_destroy( void *container )
+{
+	bench_btree_t *tree = container;
+
+	bench_btree_free( tree, tree->root );
+	free( tree );
+}
+
+/**
+ * @brief Recompute the count of @p node from its values and children.
+ */
+static void bench_btree_recount( bench_btree_node_t *node )
+{
+	unsigned int i;
+
+	node->count = node->num_values;
+	if( !node->leaf )
+	{
+		for( i = 0; i <= node->num_values; ++i )
+		{
+			node->count += node->children[i]->count;
+		}
+	}
+}
+
+/**
+ * @brief Split the full child @p index of @p parent around its median value.
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+static int bench_btree_split( bench_btree_t *tree, bench_btree_node_t *parent, unsigned int index )
+{
+	bench_btree_node_t *left = parent->children[index];
+	bench_btree_node_t *right;
+
+	right = bench_btree_node_create( tree, left->leaf );
+	if( !right )
+		return -1;
+
+	right->num_values = BENCH_BTREE_T - 1;
+	memcpy( right->values, &left->values[BENCH_BTREE_T], sizeof( uintptr_t ) * (BENCH_BTREE_T - 1) );
+	if( !left->leaf )
+	{
+		memcpy( right->children, &left->children[BENCH_BTREE_T], sizeof( right->children[0] ) * BENCH_BTREE_T );
+	}
+	left->num_values = BENCH_BTREE_T - 1;
+	bench_btree_recount( right );
+	left->count -= right->count + 1;
+
+	memmove( &parent->children[index + 2], &parent->children[index + 1],
+	         sizeof( parent->children[0] ) * (parent->num_values - index) );
+	memmove( &parent->values[index + 1], &parent->values[index],
+	         sizeof( uintptr_t ) * (parent->num_values - index) );
+	parent->children[index + 1] = right;
+	parent->values[index] = left->values[BENCH_BTREE_T - 1];
+	++parent->num_values;
+
+	return 0;
+}
+
+static int bench_btree_insert( void *container, uintptr_t value )
+{
+	bench_btree_t *tree = container;
+	bench_btree_node_t *node;
+	unsigned int i;
+
+	if( BENCH_BTREE_MAX == tree->root->num_values )
+	{
+		node = bench_btree_node_create( tree, 0 );
+		if( !node )
+			return -1;
+
+		node->children[0] = tree->root;
+		node->count = tree->root->count;
+		if( bench_btree_split( tree, node, 0 ) )
+		{
+			bench_btree_node_destroy( tree, node );
+			return -1;
+		}
+		tree->root = node;
+	}
+
+	/* Full nodes are split on the way down so there's always room for the value, or a median from below. */
+	node = tree->root;
+	for( ;; )
+	{
+		for( i = node->num_values; i > 0 && value < node->values[i - 1]; --i )
+		{
+		}
+
+		if( node->leaf )
+			break;
+
+		if( BENCH_BTREE_MAX == node->children[i]->num_values )
+		{
+			if( bench_btree_split( tree, node, i ) )
+				return -1;
+			if( value >= node->values[i] )
+				++i;
+		}
+
+		++node->count;
+		node = node->children[i];
+	}
+
+	memmove( &node->values[i + 1], &node->values[i], sizeof( uintptr_t ) * (node->num_values - i) );
+	node->values[i] = value;
+	++node->num_values;
+	++node->count;
+
+	return 0;
+}
+
+/**
+ * @brief Returns the index of the first value in @p node that is not less than @p value.
+ */
+static unsigned int bench_btree_lower_bound( const bench_btree_node_t *node, uintptr_t value )
+{
+	unsigned int i;
+
+	for( i = 0; i < node->num_values && node->values[i] < value; ++i )
+	{
+	}
+
+	return i;
+}
+
+static int bench_btree_contains( const void *container, uintptr_t value )
+{
+	const bench_btree_t *tree = container;
+	const bench_btree_node_t *node = tree->root;
+
+	for( ;; )
+	{
+		unsigned int i = bench_btree_lower_bound( node, value );
+
+		if( i < node->num_values && node->values[i] == value )
+			return 1;
+		if( node->leaf )
+			return 0;
+		node = node->children[i];
+	}
+}
+
+/**
+ * @brief Merge child @p index + 1 of @p parent and the value between them into child @p index.
+ */
+static void bench_btree_merge( bench_btree_t *tree, bench_btree_node_t *parent, unsigned int index )
+{
+	bench_btree_node_t *left = parent->children[index];
+	bench_btree_node_t *right = parent->children[index + 1];
+
+	left->values[left->num_values] = parent->values[index];
+	memcpy( &left->values[left->num_values + 1], right->values, sizeof( uintptr_t ) * right->num_values );
+	if( !left->leaf )
+	{
+		memcpy( &left->children[left->num_values + 1], right->children,
+		        sizeof( right->children[0] ) * (right->num_values + 1) );
+	}
+	left->num_values += right->num_values + 1;
+	left->count += right->count + 1;
+
+	memmove( &parent->values[index], &parent->values[index + 1],
+	         sizeof( uintptr_t ) * (parent->num_values - index - 1) );
+	memmove( &parent->children[index + 1], &parent->children[index + 2],
+	         sizeof( parent->children[0] ) * (parent->num_values - index - 1) );
+	--parent->num_values;
+
+	bench_btree_node_destroy( tree, right );
+}
+
+/**
+ * @brief Make sure child @p index of @p parent has at least T values before descending into it.
+ *
+ * @return The index of the child to descend into, which moves left if it was merged with its left sibling.
+ */
+static unsigned int bench_btree_fill( bench_btree_t *tree, bench_btree_node_t *parent, unsigned int index )
+{
+	bench_btree_node_t *child = parent->children[index];
+	bench_btree_node_t *sibling;
+
+	if( child->num_values >= BENCH_BTREE_T )
+		return index;
+
+	if( index > 0 && parent->children[index - 1]->num_values >= BENCH_BTREE_T )
+	{
+		/* Rotate the largest value of the left sibling through the parent. */
+		sibling = parent->children[index - 1];
+		memmove( &child->values[1], child->values, sizeof( uintptr_t ) * child->num_values );
+		child->values[0] = parent->values[index - 1];
+		parent->values[index - 1] = sibling->values[sibling->num_values - 1];
+		if( !child->leaf )
+		{
+			memmove( &child->children[1], child->children, sizeof( child->children[0] ) * (child->num_values + 1) );
+			child->children[0] = sibling->children[sibling->num_values];
+		}
+		++child->num_values;
+		--sibling->num_values;
+		bench_btree_recount( child );
+		bench_btree_recount( sibling );
+		return index;
+	}
+
+	if( index < parent->num_values && parent->children[index + 1]->num_values >= BENCH_BTREE_T )
+	{
+		/* Rotate the smallest value of the right sibling through the parent. */
+		sibling = parent->children[index + 1];
+		child->values[child->num_values] = parent->values[index];
+		parent->values[index] = sibling->values[0];
+		memmove( sibling->values, &sibling->values[1], sizeof( uintptr_t ) * (sibling->num_values - 1) );
+		if( !child->leaf )
+		{
+			child->children[child->num_values + 1] = sibling->children[0];
+			memmove( sibling->children, &sibling->children[1], sizeof( sibling->children[0] ) * sibling->num_values );
+		}
+		++child->num_values;
+		--sibling->num_values;
+		bench_btree_recount( child );
+		bench_btree_recount( sibling );
+		return index;
+	}
+
+	if( index < parent->num_values )
+	{
+		bench_btree_merge( tree, parent, index );
+		return index;
+	}
+
+	bench_btree_merge( tree, parent, index - 1 );
+	return index - 1;
+}
+
+static int bench_btree_remove( void *container, uintptr_t value )
+{
+	bench_btree_t *tree = container;
+	bench_btree_node_t *path[64];
+	bench_btree_node_t *node = tree->root;
+	bench_btree_node_t *child;
+	unsigned int depth = 0;
+	unsigned int i;
+
+	/* Every node below the root is topped up to T values before descending into it,
+	   so a value can always be taken from the node it is found in. */
+	for( ;; )
+	{
+		path[depth++] = node;
+		i = bench_btree_lower_bound( node, value );
+
+		if( i < node->num_values && node->values[i] == value )
+		{
+			if( node->leaf )
+			{
+				memmove( &node->values[i], &node->values[i + 1], sizeof( uintptr_t ) * (node->num_values - i - 1) );
+				--node->num_values;
+				break;
+			}
+
+			if( node->children[i]->num_values >= BENCH_BTREE_T )
+			{
+				/* Replace the value with its predecessor and remove that from the left subtree instead. */
+				for( child = node->children[i]; !child->leaf; child = child->children[child->num_values] )
+				{
+				}
+				value = node->values[i] = child->values[child->num_values - 1];
+			}
+			else if( node->children[i + 1]->num_values >= BENCH_BTREE_T )
+			{
+				for( child = node->children[i + 1]; !child->leaf; child = child->children[0] )
+				{
+				}
+				value = node->values[i] = child->values[0];
+				++i;
+			}
+			else
+			{
+				/* Both neighbours are minimal, merge them around the value and remove it from the result. */
+				bench_btree_merge( tree, node, i );
+			}
+		}
+		else
+		{
+			if( node->leaf )
+				return 0;
+
+			i = bench_btree_fill( tree, node, i );
+		}
+
+		child = node->children[i];
+		if( 0 == node->num_values )
+		{
+			/* Only the root can be emptied by a merge, its one remaining child takes over. */
+			tree->root = child;
+			bench_btree_node_destroy( tree, node );
+			--depth;
+		}
+		node = child;
+	}
+
+	/* Restructuring on the way down leaves the counts of the nodes on the path unchanged. */
+	while( depth )
+	{
+		--path[--depth]->count;
+	}
+
+	return 1;
+}
+
+static unsigned long bench_btree_size( const void *container )
+{
+	return ((const bench_btree_t *) container)->root->count;
+}
+
+static uintptr_t bench_btree_at_index( const void *container, unsigned long index )
+{
+	const bench_btree_t *tree = container;
+	const bench_btree_node_t *node = tree->root;
+	unsigned int i;
+
+	for( ;; )
+	{
+		if( node->leaf )
+			return node->values[index];
+
+		for( i = 0; index >= node->children[i]->count; ++i )
+		{
+			index -= node->children[i]->count;
+			if( 0 == index )
+				return node->values[i];
+			--index;
+		}
+		node = node->children[i];
+	}
+}
+
+/**
+ * @brief Add up to @p *remaining values from the subtree rooted at @p node in order to @p sum.
+ */
+static void bench_btree_scan_node( const bench_btree_node_t *node, unsigned long *remaining, uintptr_t *sum )
+{
+	unsigned int i;
+
+	for( i = 0; i <= node->num_values && *remaining; ++i )
+	{
+		if( !node->leaf )
+			bench_btree_scan_node( node->children[i], remaining, sum );
+
+		if( i < node->num_values && *remaining )
+		{
+			*sum += node->values[i];
+			--*remaining;
+		}
+	}
+}
+
+static uintptr_t bench_btree_scan( const void *container, unsigned long count )
+{
+	const bench_btree_t *tree = container;
+	uintptr_t sum = 0;
+
+	bench_btree_scan_node( tree->root, &count, &sum );
+
+	return sum;
+}
+
+static size_t bench_btree_memory( const void *container )
+{
+	const bench_btree_t *tree = container;
+
+	return sizeof( *tree ) + tree->bytes;
+}
+
+const bench_container_ops_t bench_btree_ops =
+{
+	"btree",
+	bench_btree_create,
+	bench_btree_destroy,
+	bench_btree_insert,
+	bench_btree_contains,
+	bench_btree_remove,
+	bench_btree_size,
+	bench_btree_at_index,
+	bench_btree_scan,
+	bench_btree_memory
+};
+
+int bench_heap_init( bench_heap_t *heap, unsigned long capacity )
+{
+	heap->entries = malloc( sizeof( *heap->entries ) * (capacity ? capacity : 1) );
+	heap->positions = malloc( sizeof( *heap->positions ) * (capacity ? capacity : 1) );
+	heap->size = 0;
+
+	if( !heap->entries || !heap->positions )
+	{
+		bench_heap_free( heap );
+		return -1;
+	}
+
+	return 0;
+}
+
+void bench_heap_free( bench_heap_t *heap )
+{
+	free( heap->entries );
+	free( heap->positions );
+	heap->entries = NULL;
+	heap->positions = NULL;
+}
+
+/**
+ * @brief Place @p entry at @p index, or above it while its parent has a larger priority.
+ */
+static void bench_heap_sift_up( bench_heap_t *heap, unsigned long index, bench_heap_entry_t entry )
+{
+	while( index > 0 )
+	{
+		unsigned long parent = (index - 1) / 2;
+
+		if( heap->entries[parent].priority <= entry.priority )
+			break;
+
+		heap->entries[index] = heap->entries[parent];
+		heap->positions[heap->entries[index].id] = index;
+		index = parent;
+	}
+
+	heap->entries[index] = entry;
+	heap->positions[entry.id] = index;
+}
+
+/**
+ * @brief Place @p entry at @p index, or below it while a child has a smaller priority.
+ */
+static void bench_heap_sift_down( bench_heap_t *heap, unsigned long index, bench_heap_entry_t entry )
+{
+	for( ;; )
+	{
+		unsigned long child = 2 * index + 1;
+
+		if( child >= heap->size )
+			break;
+		if( child + 1 < heap->size && heap->entries[child + 1].priority < heap->entries[child].priority )
+			++child;
+		if( entry.priority <= heap->entries[child].priority )
+			break;
+
+		heap->entries[index] = heap->entries[child];
+		heap->positions[heap->entries[index].id] = index;
+		index = child;
+	}
+
+	heap->entries[index] = entry;
+	heap->positions[entry.id] = index;
+}
+
+void bench_heap_push( bench_heap_t *heap, unsigned long id, uintptr_t priority )
+{
+	bench_heap_entry_t entry;
+
+	entry.priority = priority;
+	entry.id = id;
+	bench_heap_sift_up( heap, heap->size++, entry );
+}
+
+bench_heap_entry_t bench_heap_pop_min( bench_heap_t *heap )
+{
+	bench_heap_entry_t min = heap->entries[0];
+
+	if( --heap->size > 0 )
+		bench_heap_sift_down( heap, 0, heap->entries[heap->size] );
+
+	return min;
+}
+
+void bench_heap_update( bench_heap_t *heap, unsigned long id, uintptr_t priority )
+{
+	unsigned long index = heap->positions[id];
+	bench_heap_entry_t entry;
+
+	entry.priority = priority;
+	entry.id = id;
+
+	if( priority < heap->entries[index].priority )
+		bench_heap_sift_up( heap, index, entry );
+	else
+		bench_heap_sift_down( heap, index, entry );
+}
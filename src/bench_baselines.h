@@ -0,0 +1,130 @@
+#ifndef BENCH_BASELINES_H
+#define BENCH_BASELINES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Tuning passed to a container when it's created.
+ *
+ * Only the skiplist uses these, the baselines ignore them.
+ */
+typedef struct bench_container_params_t
+{
+	/** The number of links in each skiplist node. */
+	unsigned int links;
+
+	/** Non-zero to carve skiplist nodes from huge page backed memory. */
+	unsigned int huge_pages;
+} bench_container_params_t;
+
+/**
+ * @brief An ordered multiset of uintptr_t values the benchmark can run workloads against.
+ *
+ * Every container allows duplicate values so the same workload leaves every
+ * container holding the same values.
+ */
+typedef struct bench_container_ops_t
+{
+	/** The name used to select the container with --container. */
+	const char *name;
+
+	/** Create an empty container, NULL if out of memory. */
+	void *(*create)( const bench_container_params_t *params );
+
+	/** Release the container and everything in it. */
+	void (*destroy)( void *container );
+
+	/** Add @p value, returns 0 on success or -1 if out of memory. */
+	int (*insert)( void *container, uintptr_t value );
+
+	/** Returns non-zero if @p value is in the container. */
+	int (*contains)( const void *container, uintptr_t value );
+
+	/** Remove one occurrence of @p value, returns non-zero if one was removed. */
+	int (*remove)( void *container, uintptr_t value );
+
+	/** Returns the number of values in the container. */
+	unsigned long (*size)( const void *container );
+
+	/** Returns the value at position @p index in sorted order, @p index must be less than the size. */
+	uintptr_t (*at_index)( const void *container, unsigned long index );
+
+	/** Visit the @p count smallest values in order and return their sum. */
+	uintptr_t (*scan)( const void *container, unsigned long count );
+
+	/** Returns the number of bytes the container has requested from malloc(). */
+	size_t (*memory)( const void *container );
+} bench_container_ops_t;
+
+/** A sorted array searched with binary search. */
+extern const bench_container_ops_t bench_sorted_array_ops;
+
+/** A red-black tree with subtree sizes in every node for indexing. */
+extern const bench_container_ops_t bench_rbtree_ops;
+
+/** A B-tree with subtree sizes in every node for indexing. */
+extern const bench_container_ops_t bench_btree_ops;
+
+
+/**
+ * @brief An entry of a bench_heap_t.
+ */
+typedef struct bench_heap_entry_t
+{
+	/** The entry's priority, smallest first. */
+	uintptr_t priority;
+
+	/** The caller's number for the entry. */
+	unsigned long id;
+} bench_heap_entry_t;
+
+/**
+ * @brief An indexed binary min-heap, the baseline for a skiplist used as a priority queue.
+ *
+ * Entries are numbered by the caller from 0 to capacity - 1. The heap keeps
+ * each entry's position so its priority can be changed in O(log N), the way
+ * a scheduler would change a task's priority through a handle.
+ */
+typedef struct bench_heap_t
+{
+	/** The entries in heap order. */
+	bench_heap_entry_t *entries;
+
+	/** The position of each entry in entries, indexed by id. */
+	unsigned long *positions;
+
+	/** The number of entries in the heap. */
+	unsigned long size;
+} bench_heap_t;
+
+/**
+ * @brief Allocate an empty heap for entries numbered below @p capacity.
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+int bench_heap_init( bench_heap_t *heap, unsigned long capacity );
+
+/**
+ * @brief Release the memory held by @p heap.
+ */
+void bench_heap_free( bench_heap_t *heap );
+
+/**
+ * @brief Add the entry @p id, which mustn't be in the heap, with @p priority.
+ */
+void bench_heap_push( bench_heap_t *heap, unsigned long id, uintptr_t priority );
+
+/**
+ * @brief Remove the entry with the smallest priority, the heap mustn't be empty.
+ *
+ * @return The removed entry.
+ */
+bench_heap_entry_t bench_heap_pop_min( bench_heap_t *heap );
+
+/**
+ * @brief Change the priority of the entry @p id, which must be in the heap.
+ */
+void bench_heap_update( bench_heap_t *heap, unsigned long id, uintptr_t priority );
+
+#endif
@@ -0,0 +1,132 @@
+#include <string.h>
+
+#include "bench_histogram.h"
+
+/**
+ * @brief Returns the index of the bucket @p value is recorded in.
+ */
+static unsigned int bench_histogram_index( unsigned long long value )
+{
+	unsigned int magnitude;
+	unsigned int shift;
+
+	if( value < 2 * BENCH_HISTOGRAM_SUB_COUNT )
+	{
+		return (unsigned int) value;
+	}
+
+	magnitude = 63 - __builtin_clzll( value );
+	shift = magnitude - BENCH_HISTOGRAM_SUB_BITS;
+
+	return (shift + 1) * BENCH_HISTOGRAM_SUB_COUNT + (unsigned int) (value >> shift) - BENCH_HISTOGRAM_SUB_COUNT;
+}
+
+/**
+ * @brief Returns the highest value that is recorded in bucket @p index.
+ */
+static unsigned long long bench_histogram_highest( unsigned int index )
+{
+	unsigned int shift;
+	unsigned long long lowest;
+
+	if( index < 2 * BENCH_HISTOGRAM_SUB_COUNT )
+	{
+		return index;
+	}
+
+	shift = index / BENCH_HISTOGRAM_SUB_COUNT - 1;
+	lowest = (unsigned long long) (index % BENCH_HISTOGRAM_SUB_COUNT + BENCH_HISTOGRAM_SUB_COUNT) << shift;
+
+	return lowest + ((1ULL << shift) - 1);
+}
+
+void bench_histogram_reset( bench_histogram_t *histogram )
+{
+	memset( histogram, 0, sizeof( *histogram ) );
+}
+
+void bench_histogram_record( bench_histogram_t *histogram, unsigned long long value, unsigned long long count )
+{
+	if( 0 == count )
+	{
+		return;
+	}
+
+	if( 0 == histogram->total || value < histogram->min )
+	{
+		histogram->min = value;
+	}
+
+	if( value > histogram->max )
+	{
+		histogram->max = value;
+	}
+
+	histogram->counts[bench_histogram_index( value )] += count;
+	histogram->total += count;
+	histogram->sum += (double) value * count;
+}
+
+void bench_histogram_merge( bench_histogram_t *to, const bench_histogram_t *from )
+{
+	unsigned int i;
+
+	if( 0 == from->total )
+	{
+		return;
+	}
+
+	if( 0 == to->total || from->min < to->min )
+	{
+		to->min = from->min;
+	}
+
+	if( from->max > to->max )
+	{
+		to->max = from->max;
+	}
+
+	for( i = 0; i < BENCH_HISTOGRAM_BUCKETS; ++i )
+	{
+		to->counts[i] += from->counts[i];
+	}
+
+	to->total += from->total;
+	to->sum += from->sum;
+}
+
+unsigned long long bench_histogram_percentile( const bench_histogram_t *histogram, double percentile )
+{
+	unsigned long long target;
+	unsigned long long seen;
+	unsigned int i;
+
+	if( 0 == histogram->total )
+	{
+		return 0;
+	}
+
+	/* The rank of the value we're looking for, counting from 1. */
+	target = (unsigned long long) (percentile / 100.0 * histogram->total + 0.5);
+	if( target < 1 )
+	{
+		target = 1;
+	}
+
+	for( i = 0, seen = 0; i < BENCH_HISTOGRAM_BUCKETS; ++i )
+	{
+		seen += histogram->counts[i];
+		if( seen >= target )
+		{
+			/* Never report more than was actually recorded. */
+			return bench_histogram_highest( i ) < histogram->max ? bench_histogram_highest( i ) : histogram->max;
+		}
+	}
+
+	return histogram->max;
+}
+
+double bench_histogram_mean( const bench_histogram_t *histogram )
+{
+	return histogram->total ? histogram->sum / histogram->total : 0.0;
+}
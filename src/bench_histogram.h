@@ -0,0 +1,69 @@
+#ifndef BENCH_HISTOGRAM_H
+#define BENCH_HISTOGRAM_H
+
+/**
+ * log2() of the number of sub-buckets each power of 2 is split into. Values are
+ * recorded with a relative error of at most 1 / 2^BENCH_HISTOGRAM_SUB_BITS.
+ */
+#define BENCH_HISTOGRAM_SUB_BITS (5)
+
+/** The number of sub-buckets each power of 2 is split into. */
+#define BENCH_HISTOGRAM_SUB_COUNT (1 << BENCH_HISTOGRAM_SUB_BITS)
+
+/** The number of buckets needed to cover every 64 bit value. */
+#define BENCH_HISTOGRAM_BUCKETS ((64 - BENCH_HISTOGRAM_SUB_BITS + 1) * BENCH_HISTOGRAM_SUB_COUNT)
+
+/**
+ * @brief A log bucketed histogram in the style of HdrHistogram.
+ *
+ * Values below 2 * BENCH_HISTOGRAM_SUB_COUNT are counted exactly, above that each
+ * power of 2 range is split into BENCH_HISTOGRAM_SUB_COUNT linear buckets. The
+ * histogram has a fixed size and recording a value never allocates.
+ */
+typedef struct bench_histogram_t
+{
+	/** The number of values recorded in each bucket. */
+	unsigned long long counts[BENCH_HISTOGRAM_BUCKETS];
+
+	/** The total number of values recorded. */
+	unsigned long long total;
+
+	/** The sum of every value recorded, for the mean. */
+	double sum;
+
+	/** The smallest value recorded. */
+	unsigned long long min;
+
+	/** The largest value recorded. */
+	unsigned long long max;
+} bench_histogram_t;
+
+/**
+ * @brief Empty a histogram.
+ */
+void bench_histogram_reset( bench_histogram_t *histogram );
+
+/**
+ * @brief Record @p count occurrences of @p value.
+ */
+void bench_histogram_record( bench_histogram_t *histogram, unsigned long long value, unsigned long long count );
+
+/**
+ * @brief Add every value recorded in @p from to @p to.
+ */
+void bench_histogram_merge( bench_histogram_t *to, const bench_histogram_t *from );
+
+/**
+ * @brief Returns the value below which @p percentile percent of the recorded values fall.
+ *
+ * The result is the highest value that would be recorded in the same bucket, so it
+ * overestimates by at most the bucket's relative error. 0 if nothing was recorded.
+ */
+unsigned long long bench_histogram_percentile( const bench_histogram_t *histogram, double percentile );
+
+/**
+ * @brief Returns the mean of the recorded values, 0 if nothing was recorded.
+ */
+double bench_histogram_mean( const bench_histogram_t *histogram );
+
+#endif
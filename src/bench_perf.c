@@ -0,0 +1,192 @@
+/* syscall() is not part of C89. */
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#include "bench_perf.h"
+
+const char *bench_perf_names[BENCH_PERF_COUNT] =
+{
+	"cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses", "dtlb_misses"
+};
+
+#if defined( __linux__ ) && defined( SYS_perf_event_open )
+
+/**
+ * @brief The value read from a counter opened with PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING.
+ */
+typedef struct bench_perf_read_t
+{
+	unsigned long long value;
+	unsigned long long time_enabled;
+	unsigned long long time_running;
+} bench_perf_read_t;
+
+/**
+ * @brief Fill in the type and config of @p event.
+ */
+static void bench_perf_attr( struct perf_event_attr *attr, bench_perf_event_t event )
+{
+	switch( event )
+	{
+	case BENCH_PERF_CYCLES:
+		attr->type = PERF_TYPE_HARDWARE;
+		attr->config = PERF_COUNT_HW_CPU_CYCLES;
+		break;
+	case BENCH_PERF_INSTRUCTIONS:
+		attr->type = PERF_TYPE_HARDWARE;
+		attr->config = PERF_COUNT_HW_INSTRUCTIONS;
+		break;
+	case BENCH_PERF_L1D_MISSES:
+		attr->type = PERF_TYPE_HW_CACHE;
+		attr->config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+		               (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+		break;
+	case BENCH_PERF_LLC_MISSES:
+		attr->type = PERF_TYPE_HARDWARE;
+		attr->config = PERF_COUNT_HW_CACHE_MISSES;
+		break;
+	case BENCH_PERF_BRANCH_MISSES:
+		attr->type = PERF_TYPE_HARDWARE;
+		attr->config = PERF_COUNT_HW_BRANCH_MISSES;
+		break;
+	case BENCH_PERF_DTLB_MISSES:
+	default:
+		attr->type = PERF_TYPE_HW_CACHE;
+		attr->config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+		               (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+		break;
+	}
+}
+
+unsigned int bench_perf_open( bench_perf_t *perf )
+{
+	struct perf_event_attr attr;
+	unsigned int opened = 0;
+	unsigned int i;
+
+	for( i = 0; i < BENCH_PERF_COUNT; ++i )
+	{
+		memset( &attr, 0, sizeof( attr ) );
+		attr.size = sizeof( attr );
+		bench_perf_attr( &attr, (bench_perf_event_t) i );
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+		/* This thread, any CPU. */
+		perf->fd[i] = (int) syscall( SYS_perf_event_open, &attr, 0, -1, -1, 0UL );
+		if( perf->fd[i] >= 0 )
+		{
+			++opened;
+		}
+		else
+		{
+			perf->fd[i] = -1;
+		}
+	}
+
+	return opened;
+}
+
+void bench_perf_close( bench_perf_t *perf )
+{
+	unsigned int i;
+
+	for( i = 0; i < BENCH_PERF_COUNT; ++i )
+	{
+		if( perf->fd[i] >= 0 )
+		{
+			close( perf->fd[i] );
+			perf->fd[i] = -1;
+		}
+	}
+}
+
+void bench_perf_start( bench_perf_t *perf )
+{
+	unsigned int i;
+
+	for( i = 0; i < BENCH_PERF_COUNT; ++i )
+	{
+		if( perf->fd[i] >= 0 )
+		{
+			ioctl( perf->fd[i], PERF_EVENT_IOC_RESET, 0 );
+			ioctl( perf->fd[i], PERF_EVENT_IOC_ENABLE, 0 );
+		}
+	}
+}
+
+void bench_perf_stop( bench_perf_t *perf, bench_perf_counts_t *counts )
+{
+	bench_perf_read_t data;
+	unsigned int i;
+
+	/* Disable everything first so reading one counter isn't counted by the others. */
+	for( i = 0; i < BENCH_PERF_COUNT; ++i )
+	{
+		if( perf->fd[i] >= 0 )
+		{
+			ioctl( perf->fd[i], PERF_EVENT_IOC_DISABLE, 0 );
+		}
+	}
+
+	for( i = 0; i < BENCH_PERF_COUNT; ++i )
+	{
+		if( perf->fd[i] < 0 || read( perf->fd[i], &data, sizeof( data ) ) != (ssize_t) sizeof( data ) )
+		{
+			continue;
+		}
+
+		/* More events than hardware counters makes the kernel time slice them, extrapolate to the whole interval. */
+		counts->value[i] += data.time_running && data.time_running < data.time_enabled
+		                    ? (double) data.value * data.time_enabled / data.time_running
+		                    : (double) data.value;
+		counts->valid[i] |= data.time_running > 0;
+	}
+}
+
+#else
+
+unsigned int bench_perf_open( bench_perf_t *perf )
+{
+	unsigned int i;
+
+	for( i = 0; i < BENCH_PERF_COUNT; ++i )
+	{
+		perf->fd[i] = -1;
+	}
+
+	return 0;
+}
+
+void bench_perf_close( bench_perf_t *perf )
+{
+	(void) perf;
+}
+
+void bench_perf_start( bench_perf_t *perf )
+{
+	(void) perf;
+}
+
+void bench_perf_stop( bench_perf_t *perf, bench_perf_counts_t *counts )
+{
+	(void) perf;
+	(void) counts;
+}
+
+#endif
+
+void bench_perf_reset( bench_perf_counts_t *counts )
+{
+	memset( counts, 0, sizeof( *counts ) );
+}
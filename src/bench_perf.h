@@ -0,0 +1,90 @@
+#ifndef BENCH_PERF_H
+#define BENCH_PERF_H
+
+/**
+ * @brief The hardware events counted around each measured phase.
+ */
+typedef enum bench_perf_event_t
+{
+	/** CPU cycles. */
+	BENCH_PERF_CYCLES = 0,
+
+	/** Instructions retired. */
+	BENCH_PERF_INSTRUCTIONS,
+
+	/** Level 1 data cache read misses. */
+	BENCH_PERF_L1D_MISSES,
+
+	/** Last level cache misses. */
+	BENCH_PERF_LLC_MISSES,
+
+	/** Mispredicted branches. */
+	BENCH_PERF_BRANCH_MISSES,
+
+	/** Data TLB read misses. */
+	BENCH_PERF_DTLB_MISSES,
+
+	/** The number of events. */
+	BENCH_PERF_COUNT
+} bench_perf_event_t;
+
+/** Short names of the events, indexed by bench_perf_event_t. */
+extern const char *bench_perf_names[BENCH_PERF_COUNT];
+
+/**
+ * @brief The open counters of the calling thread.
+ *
+ * Each event is opened on its own rather than as a group so that a kernel or
+ * CPU lacking one event still reports the others.
+ */
+typedef struct bench_perf_t
+{
+	/** The file descriptor of each counter, -1 if it couldn't be opened. */
+	int fd[BENCH_PERF_COUNT];
+} bench_perf_t;
+
+/**
+ * @brief Event counts accumulated over one or more measured intervals.
+ */
+typedef struct bench_perf_counts_t
+{
+	/** The count of each event, scaled up if the kernel multiplexed the counter. */
+	double value[BENCH_PERF_COUNT];
+
+	/** Non-zero for each event that was counted. */
+	int valid[BENCH_PERF_COUNT];
+} bench_perf_counts_t;
+
+/**
+ * @brief Open counters for every event on the calling thread, user space only.
+ *
+ * Events which aren't supported or aren't permitted (see
+ * /proc/sys/kernel/perf_event_paranoid) are skipped.
+ *
+ * @param [out] perf  Receives the counters.
+ *
+ * @return The number of events that could be opened.
+ */
+unsigned int bench_perf_open( bench_perf_t *perf );
+
+/**
+ * @brief Close every counter opened by bench_perf_open().
+ */
+void bench_perf_close( bench_perf_t *perf );
+
+/**
+ * @brief Zero every counter and start counting.
+ */
+void bench_perf_start( bench_perf_t *perf );
+
+/**
+ * @brief Stop counting and add the counts since bench_perf_start() to @p counts.
+ */
+void bench_perf_stop( bench_perf_t *perf, bench_perf_counts_t *counts );
+
+/**
+ * @brief Empty @p counts, marking every event as not counted.
+ */
+void bench_perf_reset( bench_perf_counts_t *counts );
+
+#endif
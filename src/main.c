@@ -1,52 +1,35 @@
 #include <assert.h>
 #include <stdio.h>
+#include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 #include <limits.h>
-#include <time.h>
-
-#ifdef __MACH__
-#include <mach/clock.h>
-#include <mach/mach.h>
-#endif
+#include <signal.h>
+#include <unistd.h>
+#include <sys/resource.h>
 
 #include "skiplist.h"
+#include "skiplist_file.h"
+#include "skiplist_persistent.h"
+#include "skiplist_wal.h"
+#include "timestamp.h"
 
 #define NELEMS(_array) (sizeof((_array)) / sizeof((_array)[0]))
 
 /**
- * @brief Acquire a current timestamp
- */
-static void time_stamp( struct timespec *stamp )
-{
-#ifdef __MACH__
-	clock_serv_t cclock;
-	mach_timespec_t mts;
-	host_get_clock_service( mach_host_self(), CALENDAR_CLOCK, &cclock );
-	clock_get_time( cclock, &mts );
-	mach_port_deallocate( mach_task_self(), cclock );
-	stamp->tv_sec = mts.tv_sec;
-	stamp->tv_nsec = mts.tv_nsec;
-#else
-	clock_gettime( CLOCK_MONOTONIC, stamp );
-#endif
-}
-
-/**
- * @brief Return the difference between two timestamps in nanoseconds
+ * @brief Compares two integers.
  */
-static unsigned long long time_diff_ns( const struct timespec *start, const struct timespec *end )
+static int int_compare( const uintptr_t a, const uintptr_t b )
 {
-	unsigned long long seconds = end->tv_sec - start->tv_sec;
-	unsigned long long nano_seconds = end->tv_nsec - start->tv_nsec;
-	return seconds * 1000000000ULL + nano_seconds;
+	return (int)a - (int)b;
 }
 
 /**
- * @brief Compares two integers.
+ * @brief Compares two values as unsigned integers of full pointer width.
  */
-static int int_compare( const uintptr_t a, const uintptr_t b )
+static int uintptr_compare( const uintptr_t a, const uintptr_t b )
 {
-	return (int)a - (int)b;
+	return a < b ? -1 : a > b;
 }
 
 /**
@@ -307,217 +290,3722 @@ static int duplicate_entries_disallowed( void )
 }
 
 /**
- * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for skiplist_create.
+ * @brief TEST_CASE - Sanity test of a skiplist whose nodes are carved from huge page backed regions.
  */
-static int abuse_skiplist_create( void )
+static int huge_pages( void )
 {
 	unsigned int i;
+	skiplist_node_t *iter;
 	skiplist_t *skiplist;
-	const unsigned int bad_sizes[] = {0, SKIPLIST_MAX_LINKS + 1, UINT_MAX};
+	skiplist_options_t options;
 
-	/* Bad property */
-	skiplist = skiplist_create( 0xffff, 5, int_compare, int_fprintf, NULL );
-	if( skiplist )
+	if( skiplist_options_init( &options ) )
 		return -1;
+	options.size_estimate_log2 = 16;
+	options.compare = int_compare;
+	options.print = int_fprintf;
+	options.memory_backend = SKIPLIST_MEMORY_HUGE_PAGES;
+	options.numa_node = 0;
 
-	/* Bad size estimates */
-	for( i = 0; i < NELEMS( bad_sizes ); ++i )
-	{
-		skiplist = skiplist_create( SKIPLIST_PROPERTY_NONE, bad_sizes[i],
-		                            int_compare, int_fprintf, NULL );
-		if( skiplist )
+	skiplist = skiplist_create_with_options( &options, NULL );
+	if( !skiplist )
+		return -1;
+
+	for( i = 0; i < 10000; ++i )
+		if( skiplist_insert( skiplist, i ) )
 			return -1;
-	}
 
-	/* Bad compare */
-	skiplist = skiplist_create( SKIPLIST_PROPERTY_NONE, SKIPLIST_MAX_LINKS,
-	                            NULL, int_fprintf, NULL );
-	if( skiplist )
+	/* Removing and reinserting should reuse freed nodes rather than growing the arena. */
+	for( i = 0; i < 10000; i += 2 )
+		if( skiplist_remove( skiplist, i ) )
+			return -1;
+	for( i = 0; i < 10000; i += 2 )
+		if( skiplist_insert( skiplist, i ) )
+			return -1;
+
+	for( i = 0, iter = skiplist_begin( skiplist ); iter != skiplist_end(); iter = skiplist_next( iter ), ++i )
+		if( skiplist_node_value( iter, NULL ) != i )
+			return -1;
+
+	if( i != 10000 || skiplist_size( skiplist, NULL ) != 10000 )
 		return -1;
 
-	/* Bad print */
-	skiplist = skiplist_create( SKIPLIST_PROPERTY_NONE, SKIPLIST_MAX_LINKS,
-	                            int_compare, NULL, NULL );
-	if( skiplist )
+	if( skiplist_memory_held( skiplist, NULL ) < 10000 * sizeof( skiplist_node_t ) )
 		return -1;
 
-	return 0;
-}
+	if( skiplist_destroy( skiplist ) )
+		return -1;
 
-/**
- * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for skiplist_destroy.
- */
-static int abuse_skiplist_destroy( void )
-{
-	/* Can't do much but check NULL doesn't cause a crash. */
-	skiplist_destroy( NULL );
 	return 0;
 }
 
 /**
- * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for skiplist_contains.
+ * @brief Checks @p loaded holds the same values as @p original, and the same levels if @p same_levels.
  */
-static int abuse_skiplist_contains( void )
+static int same_skiplist( skiplist_t *original, skiplist_t *loaded, unsigned int same_levels )
 {
-	if( skiplist_contains( NULL, 0, NULL ) )
-		return -1;
-	return 0;
-}
+	unsigned int i;
+	unsigned int size;
+	skiplist_node_t *a;
+	skiplist_node_t *b;
 
-/**
- * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for skiplist_insert.
- */
-static int abuse_skiplist_insert( void )
-{
-	if( !skiplist_insert( NULL, 0 ) )
+	size = skiplist_size( original, NULL );
+	if( skiplist_size( loaded, NULL ) != size )
 		return -1;
-	return 0;
-}
 
-/**
- * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for skiplist_remove.
- */
-static int abuse_skiplist_remove( void )
-{
-	if( !skiplist_remove( NULL, 0 ) )
+	for( a = skiplist_begin( original ), b = skiplist_begin( loaded );
+	     a != skiplist_end() && b != skiplist_end();
+	     a = skiplist_next( a ), b = skiplist_next( b ) )
+	{
+		if( skiplist_node_value( a, NULL ) != skiplist_node_value( b, NULL ) )
+			return -1;
+		if( same_levels && a->levels != b->levels )
+			return -1;
+	}
+	if( a != b )
 		return -1;
-	return 0;
-}
 
-/**
- * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for skiplist_printf.
- */
-static int abuse_skiplist_printf( void )
-{
-	skiplist_printf( NULL );
+	/* Indexing depends on every link width being rebuilt correctly. */
+	for( i = 0; i < size; ++i )
+		if( skiplist_at_index( loaded, i, NULL ) != skiplist_at_index( original, i, NULL ) )
+			return -1;
+
 	return 0;
 }
 
 /**
- * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for skiplist_fprintf.
+ * @brief TEST_CASE - Checks skiplists survive being saved and loaded, with and without their levels.
  */
-static int abuse_skiplist_fprintf( void )
+static int save_load( void )
 {
+	unsigned int i;
+	unsigned int flags;
+	FILE *fp;
 	skiplist_t *skiplist;
+	skiplist_t *loaded;
+	skiplist_options_t options;
+	skiplist_error_t err;
 
-	skiplist = skiplist_create( SKIPLIST_PROPERTY_NONE, 5, int_compare, int_fprintf, NULL );
+	skiplist = skiplist_create( SKIPLIST_PROPERTY_NONE, 12, int_compare, int_fprintf, NULL );
 	if( !skiplist )
 		return -1;
 
-	skiplist_fprintf( NULL, skiplist );
-	skiplist_fprintf( stdout, NULL );
+	/* Plenty of duplicates. */
+	for( i = 0; i < 20000; ++i )
+		if( skiplist_insert( skiplist, (i * 7919) % 5000 ) )
+			return -1;
 
-	skiplist_destroy( skiplist );
-	return 0;
-}
+	if( skiplist_options_init( &options ) )
+		return -1;
+	options.size_estimate_log2 = 3;
+	options.compare = int_compare;
+	options.print = int_fprintf;
 
-/**
- * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for skiplist_fprintf_filename.
- */
-static int abuse_skiplist_fprintf_filename( void )
-{
-	skiplist_t *skiplist;
+	for( flags = SKIPLIST_SAVE_VALUES; flags <= SKIPLIST_SAVE_LEVELS; ++flags )
+	{
+		fp = tmpfile();
+		if( !fp )
+			return -1;
 
-	skiplist = skiplist_create( SKIPLIST_PROPERTY_NONE, 5, int_compare, int_fprintf, NULL );
+		if( skiplist_save( skiplist, fileno( fp ), flags ) )
+			return -1;
+		if( lseek( fileno( fp ), 0, SEEK_SET ) )
+			return -1;
+
+		options.memory_backend = flags ? SKIPLIST_MEMORY_HUGE_PAGES : SKIPLIST_MEMORY_MALLOC;
+		loaded = skiplist_load( fileno( fp ), &options, &err );
+		fclose( fp );
+		if( !loaded || err )
+			return -1;
+
+		if( same_skiplist( skiplist, loaded, flags & SKIPLIST_SAVE_LEVELS ) )
+			return -1;
+
+		/* The loaded list is a normal list. */
+		if( skiplist_insert( loaded, 2500 ) || skiplist_remove( loaded, 0 ) || skiplist_remove( loaded, 4999 ) )
+			return -1;
+		if( skiplist_at_index( loaded, 0, NULL ) != 0 || skiplist_size( loaded, NULL ) != 19999 )
+			return -1;
+		for( i = 1; i < 19999; ++i )
+			if( skiplist_at_index( loaded, i - 1, NULL ) > skiplist_at_index( loaded, i, NULL ) )
+				return -1;
+
+		skiplist_destroy( loaded );
+	}
+	skiplist_destroy( skiplist );
+
+	/* Properties and an empty list come back too. */
+	skiplist = skiplist_create( SKIPLIST_PROPERTY_UNIQUE, 7, int_compare, int_fprintf, NULL );
 	if( !skiplist )
 		return -1;
 
-	if( !skiplist_fprintf_filename( NULL, skiplist ) )
+	fp = tmpfile();
+	if( !fp )
+		return -1;
+	if( skiplist_save( skiplist, fileno( fp ), SKIPLIST_SAVE_LEVELS ) )
+		return -1;
+	if( lseek( fileno( fp ), 0, SEEK_SET ) )
+		return -1;
+	options.memory_backend = SKIPLIST_MEMORY_MALLOC;
+	loaded = skiplist_load( fileno( fp ), &options, NULL );
+	fclose( fp );
+	if( !loaded || skiplist_size( loaded, NULL ) )
 		return -1;
 
-	if( !skiplist_fprintf_filename( "valid_filname.txt", NULL ) )
+	if( skiplist_insert( loaded, 1 ) || skiplist_insert( loaded, 1 ) || skiplist_size( loaded, NULL ) != 1 )
+		return -1;
+	if( loaded->head.levels != 7 )
 		return -1;
 
+	skiplist_destroy( loaded );
 	skiplist_destroy( skiplist );
+
 	return 0;
 }
 
 /**
- * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for skiplist_at_index.
+ * @brief TEST_CASE - Checks the width of sizes and indices, and that a full skiplist refuses new nodes.
  */
-static int abuse_skiplist_at_index( void )
+static int size_limits( void )
 {
+	unsigned int i;
+	FILE *fp;
 	skiplist_t *skiplist;
+	skiplist_snapshot_t *snapshot;
+	skiplist_node_t *iter;
+	skiplist_options_t options;
+	unsigned char header[40];
+	skiplist_error_t err;
 
-	skiplist = skiplist_create( SKIPLIST_PROPERTY_NONE, 5, int_compare, int_fprintf, NULL );
-	if( !skiplist )
+#ifdef SKIPLIST_64BIT
+	if( sizeof( skiplist_size_t ) != 8 )
+		return -1;
+#else
+	if( sizeof( skiplist_size_t ) != sizeof( unsigned int ) )
 		return -1;
+#endif
 
-	if( skiplist_at_index( skiplist, 0, NULL ) )
+	/* Nodes drawn for a list with the most levels this build allows never exceed them. */
+	skiplist = skiplist_create( SKIPLIST_PROPERTY_NONE, SKIPLIST_MAX_LINKS, uintptr_compare, int_fprintf, NULL );
+	if( !skiplist )
+		return -1;
+	for( i = 0; i < 10000; ++i )
+	{
+		if( skiplist_insert( skiplist, i ) )
+			return -1;
+	}
+	for( iter = skiplist_begin( skiplist ); iter != skiplist_end(); iter = skiplist_next( iter ) )
+	{
+		if( iter->levels < 1 || iter->levels > SKIPLIST_MAX_LINKS )
+			return -1;
+	}
+	if( skiplist_at_index( skiplist, skiplist_size( skiplist, NULL ) - 1, NULL ) != 9999 )
 		return -1;
+	skiplist_destroy( skiplist );
 
+	/* Pretend the list is full rather than filling it. */
+	if( skiplist_options_init( &options ) )
+		return -1;
+	options.properties = SKIPLIST_PROPERTY_UNIQUE;
+	options.size_estimate_log2 = 5;
+	options.compare = uintptr_compare;
+	options.print = int_fprintf;
+	options.payload_size = sizeof( unsigned int );
+	skiplist = skiplist_create_with_options( &options, NULL );
+	if( !skiplist )
+		return -1;
 	if( skiplist_insert( skiplist, 1 ) )
 		return -1;
+	skiplist->num_nodes = SKIPLIST_MAX_SIZE;
+	if( skiplist_insert( skiplist, 2 ) != SKIPLIST_ERROR_FULL || skiplist_put( skiplist, 2, &i ) != SKIPLIST_ERROR_FULL )
+		return -1;
 
-	if( skiplist_at_index( NULL, 0, NULL ) )
+	/* Values already there don't need a new node. */
+	if( skiplist_insert( skiplist, 1 ) || skiplist_put( skiplist, 1, &i ) )
 		return -1;
+	skiplist->num_nodes = 1;
+	skiplist_destroy( skiplist );
 
-	if( skiplist_at_index( skiplist, 1, NULL ) )
+	/* Unless a snapshot needs to keep seeing the old payload. */
+	options.properties = SKIPLIST_PROPERTY_UNIQUE | SKIPLIST_PROPERTY_VERSIONED;
+	skiplist = skiplist_create_with_options( &options, NULL );
+	if( !skiplist )
+		return -1;
+	if( skiplist_put( skiplist, 1, &i ) )
+		return -1;
+	snapshot = skiplist_snapshot_create( skiplist, NULL );
+	if( !snapshot )
+		return -1;
+	skiplist->num_nodes = SKIPLIST_MAX_SIZE;
+	if( skiplist_put( skiplist, 1, &i ) != SKIPLIST_ERROR_FULL )
+		return -1;
+	skiplist->num_nodes = 1;
+	if( skiplist_put( skiplist, 1, &i ) || skiplist_size( skiplist, NULL ) != 1 )
+		return -1;
+
+	/* Moving a node a snapshot can see needs a new one too. */
+	skiplist->num_nodes = SKIPLIST_MAX_SIZE;
+	if( skiplist_update_node( skiplist, skiplist_begin( skiplist ), 3, &err ) || err != SKIPLIST_ERROR_FULL )
+		return -1;
+	skiplist->num_nodes = 1;
+	if( skiplist_node_value( skiplist_begin( skiplist ), NULL ) != 1 )
 		return -1;
+	if( skiplist_snapshot_release( snapshot ) )
+		return -1;
+
+	/* A snapshot with more nodes than a list can hold is refused before reading them. */
+	fp = tmpfile();
+	if( !fp )
+		return -1;
+	if( skiplist_save( skiplist, fileno( fp ), SKIPLIST_SAVE_VALUES ) || lseek( fileno( fp ), 0, SEEK_SET ) )
+		return -1;
+	if( read( fileno( fp ), header, sizeof( header ) ) != sizeof( header ) )
+		return -1;
+	for( i = 0; i < 8; ++i )
+		header[32 + i] = 0xff;
+	if( lseek( fileno( fp ), 0, SEEK_SET ) || write( fileno( fp ), header, sizeof( header ) ) != sizeof( header ) ||
+	    lseek( fileno( fp ), 0, SEEK_SET ) )
+		return -1;
+	options.payload_size = 0;
+	if( skiplist_load( fileno( fp ), &options, &err ) || err != SKIPLIST_ERROR_FULL )
+		return -1;
+	fclose( fp );
 
 	skiplist_destroy( skiplist );
+
 	return 0;
 }
 
 /**
- * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for skiplist_begin.
+ * @brief TEST_CASE - Checks a file backed skiplist survives being closed and reopened, read only and writable.
  */
-static int abuse_skiplist_begin( void )
+static int file_backed( void )
 {
-	skiplist_t *skiplist;
+	const char *filename = "file_backed.skl";
+	unsigned int i;
+	unsigned int count;
+	uintptr_t previous;
+	skiplist_file_t *skiplist;
+	skiplist_file_offset_t offset;
+	skiplist_error_t err;
 
-	skiplist = skiplist_create( SKIPLIST_PROPERTY_NONE, 5, int_compare, int_fprintf, NULL );
-	if( !skiplist )
+	skiplist = skiplist_file_create( filename, SKIPLIST_PROPERTY_NONE, 12, int_compare, &err );
+	if( !skiplist || err )
 		return -1;
 
-	if( skiplist_insert( skiplist, 1 ) )
+	/* Enough nodes to grow the file several times. */
+	for( i = 0; i < 20000; ++i )
+		if( skiplist_file_insert( skiplist, (i * 7919) % 10000 ) )
+			return -1;
+
+	if( skiplist_file_sync( skiplist ) || skiplist_file_close( skiplist ) )
 		return -1;
 
-	if( skiplist_begin( NULL ) )
+	skiplist = skiplist_file_open( filename, 0, int_compare, &err );
+	if( !skiplist || err )
 		return -1;
 
-	skiplist_destroy( skiplist );
-	return 0;
-}
+	if( skiplist_file_size( skiplist, NULL ) != 20000 )
+		return -1;
+	for( i = 0; i < 10000; ++i )
+		if( !skiplist_file_contains( skiplist, i, NULL ) )
+			return -1;
+	if( skiplist_file_contains( skiplist, 10000, NULL ) )
+		return -1;
+	for( i = 0; i < 20000; ++i )
+		if( skiplist_file_at_index( skiplist, i, NULL ) != i / 2 )
+			return -1;
 
-/**
- * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for skiplist_next.
- */
-static int abuse_skiplist_next( void )
-{
-	skiplist_t *skiplist;
+	count = 0;
+	previous = 0;
+	for( offset = skiplist_file_begin( skiplist ); offset != skiplist_file_end();
+	     offset = skiplist_file_next( skiplist, offset ) )
+	{
+		uintptr_t value = skiplist_file_node_value( skiplist, offset, &err );
+		if( err || value < previous )
+			return -1;
+		previous = value;
+		++count;
+	}
+	if( count != 20000 )
+		return -1;
 
-	skiplist = skiplist_create( SKIPLIST_PROPERTY_NONE, 5, int_compare, int_fprintf, NULL );
-	if( !skiplist )
+	/* Read only lists can't be changed. */
+	if( skiplist_file_insert( skiplist, 1 ) != SKIPLIST_ERROR_NOT_SUPPORTED )
+		return -1;
+	if( skiplist_file_close( skiplist ) )
 		return -1;
 
-	if( skiplist_insert( skiplist, 1 ) )
+	/* Writable lists carry on where they left off. */
+	skiplist = skiplist_file_open( filename, 1, int_compare, NULL );
+	if( !skiplist )
+		return -1;
+	for( i = 10000; i < 30000; ++i )
+		if( skiplist_file_insert( skiplist, i ) )
+			return -1;
+	if( skiplist_file_size( skiplist, NULL ) != 40000 )
+		return -1;
+	for( i = 0; i < 40000; ++i )
+		if( skiplist_file_at_index( skiplist, i, NULL ) != (i < 20000 ? i / 2 : i - 10000) )
+			return -1;
+	if( skiplist_file_close( skiplist ) )
 		return -1;
 
-	if( skiplist_next( NULL ) )
+	/* Sets keep one copy of each value. */
+	skiplist = skiplist_file_create( filename, SKIPLIST_PROPERTY_UNIQUE, 4, int_compare, NULL );
+	if( !skiplist )
+		return -1;
+	for( i = 0; i < 100; ++i )
+		if( skiplist_file_insert( skiplist, i % 10 ) )
+			return -1;
+	if( skiplist_file_size( skiplist, NULL ) != 10 )
+		return -1;
+	if( skiplist_file_close( skiplist ) )
 		return -1;
 
-	skiplist_destroy( skiplist );
+	remove( filename );
+
 	return 0;
 }
 
 /**
- * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for skiplist_node_value.
+ * @brief A payload for the map test.
  */
-static int abuse_skiplist_node_value( void )
+typedef struct map_payload_t
 {
-	if( skiplist_node_value( NULL, NULL ) )
-		return -1;
-	return 0;
-}
+	unsigned int squared;
+	char name[12];
+} map_payload_t;
 
 /**
- * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for skiplist_size.
+ * @brief TEST_CASE - Sanity test of a skiplist used as a map with an inline payload.
  */
-static int abuse_skiplist_size( void )
+static int map( void )
 {
-	if( skiplist_size( NULL, NULL ) )
+	unsigned int i;
+	FILE *fp;
+	skiplist_t *skiplist;
+	skiplist_t *loaded;
+	skiplist_node_t *iter;
+	skiplist_options_t options;
+	skiplist_memory_usage_t usage;
+	map_payload_t payload;
+	map_payload_t *found;
+	skiplist_error_t err;
+
+	if( skiplist_options_init( &options ) )
+		return -1;
+	options.properties = SKIPLIST_PROPERTY_UNIQUE;
+	options.size_estimate_log2 = 10;
+	options.compare = int_compare;
+	options.print = int_fprintf;
+	options.payload_size = sizeof( map_payload_t );
+
+	skiplist = skiplist_create_with_options( &options, NULL );
+	if( !skiplist )
+		return -1;
+
+	for( i = 0; i < 1000; ++i )
+	{
+		unsigned int key = (i * 7919) % 1000;
+		payload.squared = key * key;
+		sprintf( payload.name, "key %u", key );
+		if( skiplist_put( skiplist, key, &payload ) )
+			return -1;
+	}
+	if( skiplist_size( skiplist, NULL ) != 1000 )
+		return -1;
+
+	for( i = 0; i < 1000; ++i )
+	{
+		char name[12];
+		found = skiplist_get( skiplist, i, &err );
+		sprintf( name, "key %u", i );
+		if( !found || err || found->squared != i * i || strcmp( found->name, name ) )
+			return -1;
+	}
+	if( skiplist_get( skiplist, 1000, &err ) || err )
 		return -1;
+
+	/* Put updates the payload in place. */
+	payload.squared = 7;
+	if( skiplist_put( skiplist, 500, &payload ) || skiplist_size( skiplist, NULL ) != 1000 )
+		return -1;
+	found = skiplist_get( skiplist, 500, NULL );
+	if( !found || found->squared != 7 )
+		return -1;
+
+	/* Plain inserts get a zeroed payload. */
+	if( skiplist_insert( skiplist, 2000 ) )
+		return -1;
+	found = skiplist_get( skiplist, 2000, NULL );
+	if( !found || found->squared || found->name[0] )
+		return -1;
+
+	if( skiplist_erase( skiplist, 500, &payload ) || payload.squared != 7 )
+		return -1;
+	if( skiplist_erase( skiplist, 500, NULL ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_erase( skiplist, 2000, NULL ) || skiplist_get( skiplist, 500, NULL ) )
+		return -1;
+
+	/* Iteration yields keys and payloads in order. */
+	i = 0;
+	for( iter = skiplist_begin( skiplist ); iter != skiplist_end(); iter = skiplist_next( iter ) )
+	{
+		uintptr_t key = skiplist_node_value( iter, NULL );
+		found = skiplist_node_payload( iter, &err );
+		if( err || found->squared != key * key || (i != 0 && key <= i - 1) )
+			return -1;
+		i = key + 1;
+	}
+
+	if( skiplist_memory_usage( skiplist, &usage ) || usage.payloads != 999 * sizeof( map_payload_t ) ||
+	    usage.total != usage.header + usage.node_headers + usage.links + usage.payloads + usage.slack )
+		return -1;
+
+	/* Payloads are part of snapshots. */
+	fp = tmpfile();
+	if( !fp )
+		return -1;
+	if( skiplist_save( skiplist, fileno( fp ), SKIPLIST_SAVE_VALUES ) || lseek( fileno( fp ), 0, SEEK_SET ) )
+		return -1;
+	options.payload_size = 0;
+	loaded = skiplist_load( fileno( fp ), &options, NULL );
+	fclose( fp );
+	if( !loaded || same_skiplist( skiplist, loaded, 0 ) )
+		return -1;
+	for( i = 0; i < 1000; ++i )
+	{
+		found = skiplist_get( loaded, i, NULL );
+		if( 500 == i ? NULL != found : !found || found->squared != i * i )
+			return -1;
+	}
+
+	skiplist_destroy( loaded );
+	skiplist_destroy( skiplist );
+
+	return 0;
+}
+
+/** A byte string key for the byte_keys test. */
+typedef struct byte_key_t
+{
+	const char *bytes;
+	size_t length;
+} byte_key_t;
+
+/**
+ * @brief Orders byte_key_t as by memcmp(), with a key that is a prefix of another first.
+ */
+static int byte_key_compare( const void *a, const void *b )
+{
+	const byte_key_t *ka = (const byte_key_t *) a;
+	const byte_key_t *kb = (const byte_key_t *) b;
+	size_t shorter = ka->length < kb->length ? ka->length : kb->length;
+	int comparison = memcmp( ka->bytes, kb->bytes, shorter );
+
+	if( 0 == comparison )
+	{
+		comparison = (ka->length > kb->length) - (ka->length < kb->length);
+	}
+
+	return comparison;
+}
+
+/**
+ * @brief TEST_CASE - Sanity test of a skiplist ordered by inline byte string keys.
+ */
+static int byte_keys( void )
+{
+	/* Keys sharing long prefixes, differing only past the cached prefix, by length or by embedded zeros. */
+	static const byte_key_t keys[] =
+	{
+		{ "", 0 },
+		{ "\0", 1 },
+		{ "ab", 2 },
+		{ "ab\0", 3 },
+		{ "ab\0\0\0\0\0\0\0\0", 10 },
+		{ "abc", 3 },
+		{ "a common prefix longer than a word, then 1", 42 },
+		{ "a common prefix longer than a word, then 2", 42 },
+		{ "a common prefix longer than a word, then", 40 },
+		{ "abcdefgh", 8 },
+		{ "abcdefghi", 9 },
+		{ "abcdefgg", 8 },
+		{ "\xff\xff", 2 },
+		{ "\x7f", 1 },
+		{ "zebra", 5 }
+	};
+	const unsigned int count = sizeof( keys ) / sizeof( keys[0] );
+	byte_key_t sorted[sizeof( keys ) / sizeof( keys[0] )];
+	unsigned int i;
+	skiplist_t *skiplist;
+	skiplist_node_t *iter;
+	skiplist_options_t options;
+	skiplist_memory_usage_t usage;
+	size_t key_bytes = 0;
+	skiplist_error_t err;
+
+	if( skiplist_options_init( &options ) )
+		return -1;
+	options.properties = SKIPLIST_PROPERTY_UNIQUE;
+	options.size_estimate_log2 = 5;
+	options.print = int_fprintf;
+	options.key_type = SKIPLIST_KEY_BYTES;
+
+	skiplist = skiplist_create_with_options( &options, NULL );
+	if( !skiplist )
+		return -1;
+
+	/* Insert in reverse so the list has to reorder them, and again to check uniqueness. */
+	for( i = count; i-- != 0; )
+	{
+		if( skiplist_insert_bytes( skiplist, keys[i].bytes, keys[i].length ) ||
+		    skiplist_insert_bytes( skiplist, keys[i].bytes, keys[i].length ) )
+			return -1;
+		key_bytes += keys[i].length + sizeof( size_t );
+	}
+	if( skiplist_size( skiplist, NULL ) != count )
+		return -1;
+
+	for( i = 0; i < count; ++i )
+	{
+		if( !skiplist_contains_bytes( skiplist, keys[i].bytes, keys[i].length, &err ) || err )
+			return -1;
+	}
+	if( skiplist_contains_bytes( skiplist, "ab\0\0", 4, &err ) || err ||
+	    skiplist_contains_bytes( skiplist, "a common prefix longer than a word, then 3", 42, NULL ) )
+		return -1;
+
+	/* Iteration visits the keys in memcmp() order. */
+	memcpy( sorted, keys, sizeof( keys ) );
+	qsort( sorted, count, sizeof( sorted[0] ), byte_key_compare );
+	i = 0;
+	for( iter = skiplist_begin( skiplist ); iter != skiplist_end(); iter = skiplist_next( iter ), ++i )
+	{
+		byte_key_t key;
+		key.bytes = skiplist_node_key( skiplist, iter, &key.length, &err );
+		if( err || i >= count || byte_key_compare( &key, &sorted[i] ) )
+			return -1;
+	}
+	if( i != count )
+		return -1;
+
+	if( skiplist_memory_usage( skiplist, &usage ) || usage.keys != key_bytes ||
+	    usage.total != usage.header + usage.node_headers + usage.links + usage.payloads + usage.keys + usage.slack )
+		return -1;
+
+	/* Removing one key leaves the keys it shares a prefix with. */
+	if( skiplist_remove_bytes( skiplist, "a common prefix longer than a word, then 1", 42 ) ||
+	    skiplist_remove_bytes( skiplist, "a common prefix longer than a word, then 1", 42 ) != SKIPLIST_ERROR_INVALID_INPUT ||
+	    skiplist_remove_bytes( skiplist, NULL, 0 ) ||
+	    !skiplist_contains_bytes( skiplist, "a common prefix longer than a word, then 2", 42, NULL ) ||
+	    !skiplist_contains_bytes( skiplist, "a common prefix longer than a word, then", 40, NULL ) ||
+	    skiplist_contains_bytes( skiplist, "", 0, NULL ) ||
+	    skiplist_size( skiplist, NULL ) != count - 2 )
+		return -1;
+
+	skiplist_destroy( skiplist );
+
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Checks a lazily deleted skiplist matches an eagerly deleted one through removes and compaction.
+ */
+static int lazy_delete( void )
+{
+	unsigned int i;
+	unsigned int properties;
+	FILE *fp;
+	skiplist_t *lazy;
+	skiplist_t *eager;
+	skiplist_t *loaded;
+	skiplist_node_t *iter;
+	skiplist_options_t options;
+	unsigned int payload;
+	skiplist_error_t err;
+
+	if( skiplist_options_init( &options ) )
+		return -1;
+	options.size_estimate_log2 = 10;
+	options.compare = int_compare;
+	options.print = int_fprintf;
+
+	for( properties = 0; properties < 2; ++properties )
+	{
+		options.properties = properties | SKIPLIST_PROPERTY_LAZY_DELETE;
+		options.compact_percent = 0;
+		lazy = skiplist_create_with_options( &options, NULL );
+		eager = skiplist_create( properties, 10, int_compare, int_fprintf, NULL );
+		if( !lazy || !eager )
+			return -1;
+
+		/* Values 0 to 99 ten times over, or once each for a set. */
+		for( i = 0; i < 1000; ++i )
+		{
+			if( skiplist_insert( lazy, (i * 7) % 100 ) || skiplist_insert( eager, (i * 7) % 100 ) )
+				return -1;
+		}
+
+		/* Remove every value below 50 once, then put some of them back. */
+		for( i = 0; i < 50; ++i )
+		{
+			if( skiplist_remove( lazy, i ) || skiplist_remove( eager, i ) )
+				return -1;
+		}
+		if( lazy->tombstones != 50 || same_skiplist( eager, lazy, 0 ) )
+			return -1;
+		for( i = 0; i < 50; i += 5 )
+		{
+			if( skiplist_insert( lazy, i ) || skiplist_insert( eager, i ) )
+				return -1;
+		}
+		if( same_skiplist( eager, lazy, 0 ) )
+			return -1;
+
+		/* Lookups and removes see past the tombstones. */
+		for( i = 0; i < 100; ++i )
+		{
+			if( skiplist_contains( lazy, i, NULL ) != skiplist_contains( eager, i, NULL ) )
+				return -1;
+			if( skiplist_remove( lazy, i ) != skiplist_remove( eager, i ) )
+				return -1;
+		}
+		if( same_skiplist( eager, lazy, 0 ) )
+			return -1;
+
+		if( skiplist_compact( lazy ) || lazy->tombstones || same_skiplist( eager, lazy, 0 ) )
+			return -1;
+		for( iter = lazy->head.link[0].next; NULL != iter; iter = iter->link[0].next )
+		{
+			if( iter->flags & SKIPLIST_NODE_TOMBSTONE )
+				return -1;
+		}
+
+		skiplist_destroy( eager );
+		skiplist_destroy( lazy );
+	}
+
+	/* Removing a tall copy of a value leaves a tombstone after shorter live copies, lookups still find them. */
+	options.properties = SKIPLIST_PROPERTY_LAZY_DELETE;
+	options.compact_percent = 0;
+	lazy = skiplist_create_with_options( &options, NULL );
+	if( !lazy )
+		return -1;
+	for( i = 0; i < 200; ++i )
+	{
+		skiplist_node_t *copies[3];
+		unsigned int tallest = 0;
+		unsigned int j;
+
+		for( j = 0; j < 3; ++j )
+		{
+			copies[j] = skiplist_push( lazy, i, NULL );
+			if( !copies[j] )
+				return -1;
+			if( copies[j]->levels >= copies[tallest]->levels )
+				tallest = j;
+		}
+		if( skiplist_remove_node( lazy, copies[tallest] ) || skiplist_contains( lazy, i, NULL ) != 1 )
+			return -1;
+		for( j = 0; j < 3; ++j )
+			if( j != tallest && skiplist_remove_node( lazy, copies[j] ) )
+				return -1;
+		if( skiplist_contains( lazy, i, NULL ) != 0 || skiplist_insert( lazy, i ) || skiplist_contains( lazy, i, NULL ) != 1 )
+			return -1;
+	}
+	if( skiplist_size( lazy, NULL ) != 200 )
+		return -1;
+	skiplist_destroy( lazy );
+
+	/* Compaction runs by itself once tombstones outnumber the live nodes. */
+	options.properties = SKIPLIST_PROPERTY_UNIQUE | SKIPLIST_PROPERTY_LAZY_DELETE;
+	options.compact_percent = 100;
+	options.payload_size = sizeof( payload );
+	lazy = skiplist_create_with_options( &options, NULL );
+	if( !lazy )
+		return -1;
+	for( i = 0; i < 100; ++i )
+	{
+		payload = i;
+		if( skiplist_put( lazy, i, &payload ) )
+			return -1;
+	}
+	for( i = 0; i < 50; ++i )
+	{
+		if( skiplist_erase( lazy, i, &payload ) || payload != i )
+			return -1;
+	}
+	if( lazy->tombstones != 50 )
+		return -1;
+	if( skiplist_remove( lazy, 50 ) || lazy->tombstones || skiplist_size( lazy, NULL ) != 49 )
+		return -1;
+
+	/* A removed key can be put again, and gets a fresh payload. */
+	if( skiplist_erase( lazy, 99, NULL ) || skiplist_get( lazy, 99, &err ) || err )
+		return -1;
+	if( skiplist_insert( lazy, 99 ) || !skiplist_get( lazy, 99, NULL ) || *(unsigned int *) skiplist_get( lazy, 99, NULL ) )
+		return -1;
+	payload = 7;
+	if( skiplist_put( lazy, 99, &payload ) || *(unsigned int *) skiplist_get( lazy, 99, NULL ) != 7 ||
+	    skiplist_size( lazy, NULL ) != 49 )
+		return -1;
+
+	/* Snapshots leave the tombstones behind. */
+	fp = tmpfile();
+	if( !fp )
+		return -1;
+	if( skiplist_save( lazy, fileno( fp ), SKIPLIST_SAVE_LEVELS ) || lseek( fileno( fp ), 0, SEEK_SET ) )
+		return -1;
+	loaded = skiplist_load( fileno( fp ), &options, NULL );
+	fclose( fp );
+	if( !loaded || same_skiplist( lazy, loaded, 1 ) || !(loaded->properties & SKIPLIST_PROPERTY_LAZY_DELETE) )
+		return -1;
+
+	skiplist_destroy( loaded );
+	skiplist_destroy( lazy );
+
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Checks copying ranges of indices and values into a buffer matches indexing one at a time.
+ */
+static int copy_values( void )
+{
+	uintptr_t out[600];
+	skiplist_size_t copied;
+	skiplist_size_t i;
+	skiplist_t *skiplist;
+	skiplist_options_t options;
+	skiplist_error_t err;
+
+	if( skiplist_options_init( &options ) )
+		return -1;
+	options.size_estimate_log2 = 10;
+	options.compare = int_compare;
+	options.print = int_fprintf;
+	options.properties = SKIPLIST_PROPERTY_LAZY_DELETE;
+	options.compact_percent = 0;
+	skiplist = skiplist_create_with_options( &options, NULL );
+	if( !skiplist )
+		return -1;
+
+	/* Even values 0 to 998 twice, with tombstones left by removing every multiple of 10 once. */
+	for( i = 0; i < 1000; ++i )
+	{
+		if( skiplist_insert( skiplist, (i * 2) % 1000 ) )
+			return -1;
+	}
+	for( i = 0; i < 1000; i += 10 )
+	{
+		if( skiplist_remove( skiplist, i ) )
+			return -1;
+	}
+
+	copied = skiplist_copy_range( skiplist, 300, 600, out, &err );
+	if( copied != 600 || err )
+		return -1;
+	for( i = 0; i < copied; ++i )
+	{
+		if( out[i] != skiplist_at_index( skiplist, 300 + i, NULL ) )
+			return -1;
+	}
+
+	/* The copy stops at the end of the list. */
+	if( skiplist_copy_range( skiplist, 850, 600, out, NULL ) != 50 || out[49] != 998 )
+		return -1;
+	if( skiplist_copy_range( skiplist, 900, 600, out, &err ) || err )
+		return -1;
+
+	/* Both bounds are included, and the copy stops at the cap. 100, 110 and 120 are only left once. */
+	copied = skiplist_copy_values_between( skiplist, 100, 120, out, 600, &err );
+	if( copied != 19 || err || out[0] != 100 || out[1] != 102 || out[2] != 102 || out[18] != 120 )
+		return -1;
+	if( skiplist_copy_values_between( skiplist, 101, 103, out, 600, NULL ) != 2 || out[0] != 102 )
+		return -1;
+	if( skiplist_copy_values_between( skiplist, 0, 1000, out, 5, NULL ) != 5 || out[0] != 0 || out[1] != 2 )
+		return -1;
+	if( skiplist_copy_values_between( skiplist, 999, 2000, out, 600, NULL ) )
+		return -1;
+
+	skiplist_destroy( skiplist );
+
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Checks selecting many indices and quantiles at once matches indexing them one at a time.
+ */
+static int select_many( void )
+{
+	static const double quantiles[] = { 0.0, 0.001, 0.01, 0.25, 0.5, 0.5, 0.9, 0.99, 0.999, 1.0 };
+	skiplist_size_t ranks[200];
+	uintptr_t out[200];
+	skiplist_size_t size;
+	skiplist_size_t i;
+	skiplist_t *skiplist;
+	skiplist_options_t options;
+	skiplist_error_t err;
+
+	if( skiplist_options_init( &options ) )
+		return -1;
+	options.size_estimate_log2 = 10;
+	options.compare = int_compare;
+	options.print = int_fprintf;
+	options.properties = SKIPLIST_PROPERTY_LAZY_DELETE;
+	options.compact_percent = 0;
+	skiplist = skiplist_create_with_options( &options, NULL );
+	if( !skiplist )
+		return -1;
+
+	if( skiplist_median( skiplist, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+
+	/* Duplicates, and tombstones from removing every third value once. */
+	for( i = 0; i < 3000; ++i )
+	{
+		if( skiplist_insert( skiplist, rand() % 2000 ) )
+			return -1;
+	}
+	for( i = 0; i < 2000; i += 3 )
+	{
+		if( skiplist_remove( skiplist, i ) && skiplist_contains( skiplist, i, NULL ) )
+			return -1;
+	}
+	size = skiplist_size( skiplist, NULL );
+
+	/* Random sorted indices with repeats, dense at the front and sparse after. */
+	ranks[0] = 0;
+	for( i = 1; i < 200; ++i )
+	{
+		if( i < 100 )
+			ranks[i] = ranks[i - 1] + rand() % 3;
+		else
+			ranks[i] = ranks[i - 1] + (skiplist_size_t) rand() % ( ( size - 1 - ranks[i - 1] ) / ( 200 - i ) + 1 );
+	}
+	ranks[199] = size - 1;
+	if( skiplist_select_many( skiplist, ranks, 200, out ) )
+		return -1;
+	for( i = 0; i < 200; ++i )
+	{
+		if( out[i] != skiplist_at_index( skiplist, ranks[i], NULL ) )
+			return -1;
+	}
+
+	if( skiplist_quantiles( skiplist, quantiles, sizeof( quantiles ) / sizeof( quantiles[0] ), out ) )
+		return -1;
+	if( out[0] != skiplist_at_index( skiplist, 0, NULL ) ||
+	    out[2] != skiplist_at_index( skiplist, ( size + 99 ) / 100 - 1, NULL ) ||
+	    out[4] != skiplist_at_index( skiplist, ( size + 1 ) / 2 - 1, NULL ) || out[4] != out[5] ||
+	    out[9] != skiplist_at_index( skiplist, size - 1, NULL ) )
+		return -1;
+	if( skiplist_quantile( skiplist, 0.9, &err ) != out[6] || err )
+		return -1;
+	skiplist_destroy( skiplist );
+
+	/* The median of an even number of values is the lower middle one. */
+	skiplist = skiplist_create( SKIPLIST_PROPERTY_NONE, 5, int_compare, int_fprintf, NULL );
+	if( !skiplist )
+		return -1;
+	for( i = 1; i <= 4; ++i )
+	{
+		if( skiplist_insert( skiplist, i ) )
+			return -1;
+	}
+	if( skiplist_median( skiplist, NULL ) != 2 || skiplist_quantile( skiplist, 0.75, NULL ) != 3 )
+		return -1;
+	if( skiplist_insert( skiplist, 5 ) || skiplist_median( skiplist, NULL ) != 3 )
+		return -1;
+	skiplist_destroy( skiplist );
+
+	return 0;
+}
+
+/**
+ * @brief Returns 0 if @p k sampled values are in list order, in @p skiplist, and distinct without @p replacement.
+ *
+ * Counts how many fell in each tenth of 0 to 1000 into @p tenths.
+ */
+static int valid_sample( skiplist_t *skiplist, const uintptr_t *out, skiplist_size_t k, unsigned int replacement,
+                         unsigned int *tenths )
+{
+	skiplist_size_t i;
+
+	for( i = 0; i < k; ++i )
+	{
+		if( !skiplist_contains( skiplist, out[i], NULL ) || out[i] >= 1000 )
+			return -1;
+		if( i > 0 && ( out[i] < out[i - 1] || ( !replacement && out[i] == out[i - 1] ) ) )
+			return -1;
+		++tenths[out[i] / 100];
+	}
+
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Checks samples are drawn from the whole list evenly, with and without replacement.
+ */
+static int sample( void )
+{
+	static uintptr_t out[5000];
+	static uintptr_t again[5000];
+	unsigned int tenths[10];
+	skiplist_size_t i;
+	skiplist_size_t j;
+	skiplist_t *skiplist;
+	skiplist_t *twin;
+	skiplist_rng_t rng;
+	skiplist_options_t options;
+
+	if( skiplist_options_init( &options ) )
+		return -1;
+	options.size_estimate_log2 = 10;
+	options.compare = int_compare;
+	options.print = int_fprintf;
+	options.properties = SKIPLIST_PROPERTY_UNIQUE | SKIPLIST_PROPERTY_LAZY_DELETE;
+	options.compact_percent = 0;
+	skiplist = skiplist_create_with_options( &options, NULL );
+	twin = skiplist_create_with_options( &options, NULL );
+	if( !skiplist || !twin )
+		return -1;
+
+	/* The values 0 to 999, with tombstones for 1000 to 1999 that mustn't be drawn. */
+	for( i = 0; i < 2000; ++i )
+	{
+		if( skiplist_insert( skiplist, i ) || skiplist_insert( twin, i ) )
+			return -1;
+	}
+	for( i = 1000; i < 2000; ++i )
+	{
+		if( skiplist_remove( skiplist, i ) || skiplist_remove( twin, i ) )
+			return -1;
+	}
+
+	/* Each tenth of the list should get about a tenth of a large sample. */
+	if( skiplist_rng_seed( &rng, 1 ) )
+		return -1;
+	memset( tenths, 0, sizeof( tenths ) );
+	if( skiplist_sample( skiplist, 5000, &rng, 1, out ) || valid_sample( skiplist, out, 5000, 1, tenths ) )
+		return -1;
+	for( i = 0; i < 10; ++i )
+	{
+		if( tenths[i] < 400 || tenths[i] > 600 )
+			return -1;
+	}
+
+	/* Without replacement, sparse samples are drawn and redrawn, dense ones picked in one pass. */
+	memset( tenths, 0, sizeof( tenths ) );
+	for( j = 0; j < 1000; ++j )
+	{
+		if( skiplist_sample( skiplist, 10, &rng, 0, out ) || valid_sample( skiplist, out, 10, 0, tenths ) )
+			return -1;
+	}
+	for( i = 0; i < 10; ++i )
+	{
+		if( tenths[i] < 850 || tenths[i] > 1150 )
+			return -1;
+	}
+	memset( tenths, 0, sizeof( tenths ) );
+	for( j = 0; j < 20; ++j )
+	{
+		if( skiplist_sample( skiplist, 600, &rng, 0, out ) || valid_sample( skiplist, out, 600, 0, tenths ) )
+			return -1;
+	}
+	for( i = 0; i < 10; ++i )
+	{
+		if( tenths[i] < 1050 || tenths[i] > 1350 )
+			return -1;
+	}
+	if( skiplist_sample( skiplist, 1000, &rng, 0, out ) || valid_sample( skiplist, out, 1000, 0, tenths ) )
+		return -1;
+	for( i = 0; i < 1000; ++i )
+	{
+		if( out[i] != i )
+			return -1;
+	}
+
+	/* The same seed gives the same sample, and so does the same list with its own generator. */
+	if( skiplist_rng_seed( &rng, 42 ) || skiplist_sample( skiplist, 100, &rng, 0, out ) )
+		return -1;
+	if( skiplist_rng_seed( &rng, 42 ) || skiplist_sample( skiplist, 100, &rng, 0, again ) )
+		return -1;
+	if( memcmp( out, again, sizeof( out[0] ) * 100 ) )
+		return -1;
+	if( skiplist_sample( skiplist, 100, NULL, 1, out ) || skiplist_sample( twin, 100, NULL, 1, again ) )
+		return -1;
+	if( memcmp( out, again, sizeof( out[0] ) * 100 ) )
+		return -1;
+	if( skiplist_sample( skiplist, 100, NULL, 1, again ) || !memcmp( out, again, sizeof( out[0] ) * 100 ) )
+		return -1;
+
+	skiplist_destroy( twin );
+	skiplist_destroy( skiplist );
+
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Checks searching for a sorted batch of values matches searching for each one.
+ */
+static int contains_sorted( void )
+{
+	uintptr_t keys[500];
+	unsigned int results[500];
+	skiplist_node_t *nodes[500];
+	skiplist_node_t *node;
+	unsigned int i;
+	skiplist_t *skiplist;
+	skiplist_options_t options;
+
+	if( skiplist_options_init( &options ) )
+		return -1;
+	options.size_estimate_log2 = 10;
+	options.compare = int_compare;
+	options.print = int_fprintf;
+	options.properties = SKIPLIST_PROPERTY_LAZY_DELETE;
+	options.compact_percent = 0;
+	skiplist = skiplist_create_with_options( &options, NULL );
+	if( !skiplist )
+		return -1;
+
+	/* Duplicates, and tombstones from removing every third value once. */
+	for( i = 0; i < 1500; ++i )
+	{
+		if( skiplist_insert( skiplist, rand() % 1000 ) )
+			return -1;
+	}
+	for( i = 0; i < 1000; i += 3 )
+	{
+		if( skiplist_remove( skiplist, i ) && skiplist_contains( skiplist, i, NULL ) )
+			return -1;
+	}
+
+	/* A dense run with repeats, then sparse values past the end of the list. */
+	keys[0] = 0;
+	for( i = 1; i < 500; ++i )
+	{
+		keys[i] = keys[i - 1] + ( i < 400 ? rand() % 3 : rand() % 30 );
+	}
+	if( skiplist_contains_sorted( skiplist, keys, 500, results ) || skiplist_find_sorted( skiplist, keys, 500, nodes ) )
+		return -1;
+	for( i = 0; i < 500; ++i )
+	{
+		if( results[i] != skiplist_contains( skiplist, keys[i], NULL ) || results[i] != ( NULL != nodes[i] ) )
+			return -1;
+		if( nodes[i] && skiplist_node_value( nodes[i], NULL ) != keys[i] )
+			return -1;
+	}
+
+	/* The node found is the first live one holding the value. */
+	for( i = 0; i < 500 && !results[i]; ++i )
+		;
+	if( 500 == i )
+		return -1;
+	for( node = skiplist_begin( skiplist ); node != nodes[i]; node = skiplist_next( node ) )
+	{
+		if( skiplist_node_value( node, NULL ) == keys[i] )
+			return -1;
+	}
+
+	if( skiplist_contains_sorted( skiplist, NULL, 0, NULL ) )
+		return -1;
+	skiplist_destroy( skiplist );
+
+	return 0;
+}
+
+/**
+ * @brief Returns 0 if iterating @p skiplist backwards visits the same nodes as forwards, in reverse.
+ */
+static int same_backwards( skiplist_t *skiplist )
+{
+	skiplist_node_t *forward;
+	skiplist_node_t *backward;
+	skiplist_size_t count = 0;
+
+	for( forward = skiplist_begin( skiplist ); forward != skiplist_end(); forward = skiplist_next( forward ) )
+	{
+		++count;
+	}
+
+	for( backward = skiplist_rbegin( skiplist ); backward != skiplist_end(); backward = skiplist_prev( skiplist, backward ) )
+	{
+		if( 0 == count-- || skiplist_node_value( backward, NULL ) != skiplist_at_index( skiplist, count, NULL ) )
+			return -1;
+	}
+
+	return 0 == count ? 0 : -1;
+}
+
+/**
+ * @brief TEST_CASE - Checks back links iterate lists backwards and nodes can be removed by handle.
+ */
+static int back_links( void )
+{
+	static const skiplist_properties_t properties[] = {
+		SKIPLIST_PROPERTY_NONE,
+		SKIPLIST_PROPERTY_LAZY_DELETE,
+		SKIPLIST_PROPERTY_VERSIONED
+	};
+	unsigned int i;
+	unsigned int p;
+	FILE *fp;
+	skiplist_t *skiplist;
+	skiplist_t *loaded;
+	skiplist_node_t *node;
+	skiplist_options_t options;
+	unsigned int payload;
+	skiplist_error_t err;
+
+	if( skiplist_options_init( &options ) )
+		return -1;
+	options.size_estimate_log2 = 8;
+	options.compare = int_compare;
+	options.print = int_fprintf;
+
+	for( p = 0; p < sizeof( properties ) / sizeof( properties[0] ); ++p )
+	{
+		options.properties = properties[p] | SKIPLIST_PROPERTY_BACK_LINKS;
+		options.compact_percent = 0;
+		skiplist = skiplist_create_with_options( &options, NULL );
+		if( !skiplist )
+			return -1;
+
+		if( skiplist_rbegin( skiplist ) != skiplist_end() || skiplist_last( skiplist, &err ) ||
+		    err != SKIPLIST_ERROR_INVALID_INPUT )
+			return -1;
+
+		/* Each of 0 to 49 four times, then remove the largest values and some from the middle. */
+		for( i = 0; i < 200; ++i )
+		{
+			if( skiplist_insert( skiplist, (i * 7) % 50 ) )
+				return -1;
+		}
+		for( i = 0; i < 4; ++i )
+		{
+			if( skiplist_remove( skiplist, 49 ) || skiplist_remove( skiplist, 20 + i ) )
+				return -1;
+		}
+		if( same_backwards( skiplist ) || skiplist_last( skiplist, &err ) != 48 || err )
+			return -1;
+
+		/* Removing a node by handle takes exactly that node, even among duplicates. */
+		node = skiplist_prev( skiplist, skiplist_rbegin( skiplist ) );
+		if( skiplist_node_value( node, NULL ) != 48 || skiplist_remove_node( skiplist, node ) )
+			return -1;
+		if( skiplist_size( skiplist, NULL ) != 191 || same_backwards( skiplist ) )
+			return -1;
+		if( skiplist_node_value( skiplist_prev( skiplist, skiplist_rbegin( skiplist ) ), NULL ) != 48 )
+			return -1;
+		while( skiplist_size( skiplist, NULL ) > 100 )
+		{
+			if( skiplist_remove_node( skiplist, skiplist_rbegin( skiplist ) ) )
+				return -1;
+		}
+		if( same_backwards( skiplist ) || skiplist_compact( skiplist ) || same_backwards( skiplist ) )
+			return -1;
+		if( skiplist_remove_node( skiplist, skiplist_begin( skiplist ) ) || same_backwards( skiplist ) )
+			return -1;
+
+		/* Loading rebuilds the back links. */
+		fp = tmpfile();
+		if( !fp )
+			return -1;
+		if( skiplist_save( skiplist, fileno( fp ), SKIPLIST_SAVE_LEVELS ) || lseek( fileno( fp ), 0, SEEK_SET ) )
+			return -1;
+		loaded = skiplist_load( fileno( fp ), &options, NULL );
+		fclose( fp );
+		if( !loaded || same_skiplist( skiplist, loaded, 1 ) || same_backwards( loaded ) )
+			return -1;
+		if( skiplist_last( loaded, NULL ) != skiplist_last( skiplist, NULL ) )
+			return -1;
+
+		skiplist_destroy( loaded );
+		skiplist_destroy( skiplist );
+	}
+
+	/* Back links are stored after a map's payload. */
+	options.properties = SKIPLIST_PROPERTY_UNIQUE | SKIPLIST_PROPERTY_BACK_LINKS;
+	options.payload_size = sizeof( payload );
+	skiplist = skiplist_create_with_options( &options, NULL );
+	if( !skiplist )
+		return -1;
+	for( i = 0; i < 100; ++i )
+	{
+		payload = ~i;
+		if( skiplist_put( skiplist, (i * 13) % 100, &payload ) )
+			return -1;
+	}
+	if( same_backwards( skiplist ) || skiplist_erase( skiplist, 99, NULL ) || same_backwards( skiplist ) )
+		return -1;
+	skiplist_destroy( skiplist );
+
+	/* Byte string keys are found from the node's own key. */
+	options.properties = SKIPLIST_PROPERTY_BACK_LINKS;
+	options.payload_size = 0;
+	options.key_type = SKIPLIST_KEY_BYTES;
+	skiplist = skiplist_create_with_options( &options, NULL );
+	if( !skiplist )
+		return -1;
+	if( skiplist_insert_bytes( skiplist, "a", 1 ) || skiplist_insert_bytes( skiplist, "b", 1 ) ||
+	    skiplist_insert_bytes( skiplist, "b", 1 ) || skiplist_insert_bytes( skiplist, "c", 1 ) )
+		return -1;
+	node = skiplist_prev( skiplist, skiplist_rbegin( skiplist ) );
+	if( skiplist_remove_node( skiplist, node ) || skiplist_size( skiplist, NULL ) != 3 )
+		return -1;
+	node = skiplist_prev( skiplist, skiplist_rbegin( skiplist ) );
+	if( !node || memcmp( skiplist_node_key( skiplist, node, NULL, NULL ), "b", 1 ) )
+		return -1;
+	skiplist_destroy( skiplist );
+
+	return 0;
+}
+
+/**
+ * @brief Returns 0 if the values of @p skiplist are in order and it holds @p count of them.
+ */
+static int in_order( skiplist_t *skiplist, skiplist_size_t count )
+{
+	skiplist_size_t i;
+
+	if( skiplist_size( skiplist, NULL ) != count )
+		return -1;
+
+	for( i = 1; i < count; ++i )
+	{
+		if( skiplist_at_index( skiplist, i - 1, NULL ) > skiplist_at_index( skiplist, i, NULL ) )
+			return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Checks a list used as a priority queue through node handles against a model of it.
+ */
+static int priority_queue( void )
+{
+	static const skiplist_properties_t properties[] = {
+		SKIPLIST_PROPERTY_NONE,
+		SKIPLIST_PROPERTY_LAZY_DELETE,
+		SKIPLIST_PROPERTY_VERSIONED,
+		SKIPLIST_PROPERTY_BACK_LINKS,
+		SKIPLIST_PROPERTY_LAZY_DELETE | SKIPLIST_PROPERTY_BACK_LINKS
+	};
+	enum { NUM_IDS = 300 };
+	skiplist_node_t *handles[NUM_IDS];
+	uintptr_t priorities[NUM_IDS];
+	uintptr_t min;
+	uintptr_t value;
+	unsigned int id;
+	unsigned int i;
+	unsigned int p;
+	skiplist_t *skiplist;
+	skiplist_snapshot_t *snapshot;
+	skiplist_node_t *node;
+	skiplist_options_t options;
+	skiplist_error_t err;
+
+	if( skiplist_options_init( &options ) )
+		return -1;
+	options.size_estimate_log2 = 9;
+	options.compare = int_compare;
+	options.print = int_fprintf;
+	options.payload_size = sizeof( id );
+	options.compact_percent = 0;
+
+	for( p = 0; p < sizeof( properties ) / sizeof( properties[0] ); ++p )
+	{
+		options.properties = properties[p];
+		skiplist = skiplist_create_with_options( &options, NULL );
+		if( !skiplist )
+			return -1;
+
+		/* Leave tombstones at the front of the lazy lists for the first pop to step over. */
+		for( i = 0; i < 10; ++i )
+		{
+			if( skiplist_insert( skiplist, 0 ) )
+				return -1;
+		}
+		for( i = 0; i < 10; ++i )
+		{
+			if( skiplist_remove( skiplist, 0 ) )
+				return -1;
+		}
+
+		for( id = 0; id < NUM_IDS; ++id )
+		{
+			priorities[id] = 1 + rand() % 1000;
+			handles[id] = skiplist_push( skiplist, priorities[id], &err );
+			if( !handles[id] || err )
+				return -1;
+			memcpy( skiplist_node_payload( handles[id], NULL ), &id, sizeof( id ) );
+		}
+
+		for( i = 0; i < 3000; ++i )
+		{
+			if( rand() % 2 )
+			{
+				/* Moving a node keeps its handle, whether it moves back, forward or not at all. */
+				id = rand() % NUM_IDS;
+				priorities[id] = 1 + rand() % 1000;
+				if( skiplist_update_node( skiplist, handles[id], priorities[id], &err ) != handles[id] || err )
+					return -1;
+			}
+			else
+			{
+				/* Pop the smallest and push it back later, like a scheduler. */
+				for( min = priorities[0], id = 1; id < NUM_IDS; ++id )
+				{
+					if( priorities[id] < min )
+						min = priorities[id];
+				}
+				value = skiplist_pop_min( skiplist, &id, &err );
+				if( value != min || err || id >= NUM_IDS || priorities[id] != value )
+					return -1;
+
+				priorities[id] += 1 + rand() % 1000;
+				handles[id] = skiplist_push( skiplist, priorities[id], &err );
+				if( !handles[id] || err )
+					return -1;
+				memcpy( skiplist_node_payload( handles[id], NULL ), &id, sizeof( id ) );
+			}
+
+			if( 0 == i % 500 && in_order( skiplist, NUM_IDS ) )
+				return -1;
+		}
+		if( in_order( skiplist, NUM_IDS ) )
+			return -1;
+		if( ( options.properties & SKIPLIST_PROPERTY_BACK_LINKS ) && same_backwards( skiplist ) )
+			return -1;
+
+		/* Snapshots keep seeing a node's old value, so updating gives a new node. */
+		if( options.properties & SKIPLIST_PROPERTY_VERSIONED )
+		{
+			snapshot = skiplist_snapshot_create( skiplist, NULL );
+			if( !snapshot )
+				return -1;
+			value = priorities[0];
+			node = skiplist_update_node( skiplist, handles[0], 5000, &err );
+			if( !node || node == handles[0] || err || skiplist_node_value( node, NULL ) != 5000 )
+				return -1;
+			memcpy( &id, skiplist_node_payload( node, NULL ), sizeof( id ) );
+			if( 0 != id )
+				return -1;
+			if( !skiplist_snapshot_find( snapshot, value, NULL ) || skiplist_snapshot_find( snapshot, 5000, NULL ) )
+				return -1;
+			value = skiplist_snapshot_begin( snapshot )->value;
+			if( skiplist_pop_min( skiplist, NULL, NULL ) != value ||
+			    skiplist_snapshot_begin( snapshot )->value != value )
+				return -1;
+			if( skiplist_snapshot_release( snapshot ) || in_order( skiplist, NUM_IDS - 1 ) )
+				return -1;
+		}
+
+		/* Popping everything gives the values in order. */
+		for( min = 0; skiplist_size( skiplist, NULL ); min = value )
+		{
+			value = skiplist_pop_min( skiplist, NULL, &err );
+			if( value < min || err )
+				return -1;
+		}
+		skiplist_destroy( skiplist );
+	}
+
+	return 0;
+}
+
+static uintptr_t sum_aggregate( const uintptr_t a, const uintptr_t b )
+{
+	return a + b;
+}
+
+static uintptr_t min_aggregate( const uintptr_t a, const uintptr_t b )
+{
+	return a < b ? a : b;
+}
+
+static uintptr_t square_lift( const uintptr_t value )
+{
+	return value * value;
+}
+
+/**
+ * @brief Returns 0 if skiplist_range_aggregate() agrees with combining every value of @p skiplist in range one by one.
+ */
+static int same_aggregates( skiplist_t *skiplist, const skiplist_options_t *options )
+{
+	skiplist_node_t *iter;
+	uintptr_t expected;
+	uintptr_t value;
+	uintptr_t low;
+	uintptr_t high;
+	unsigned int i;
+	skiplist_error_t err;
+
+	for( i = 0; i < 50; ++i )
+	{
+		low = 10 + rand() % 1100;
+		high = 0 == i % 10 ? low - 1 - rand() % 10 : low + rand() % 1100;
+		if( 0 == i )
+		{
+			low = 0;
+			high = 2000;
+		}
+
+		expected = options->aggregate_identity;
+		for( iter = skiplist_begin( skiplist ); iter != skiplist_end(); iter = skiplist_next( iter ) )
+		{
+			value = skiplist_node_value( iter, NULL );
+			if( value >= low && value <= high )
+				expected = options->aggregate( expected, options->aggregate_lift ? options->aggregate_lift( value ) : value );
+		}
+
+		if( skiplist_range_aggregate( skiplist, low, high, &err ) != expected || err )
+			return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Checks range aggregates against a scan while the list changes in every way it can.
+ */
+static int range_aggregate( void )
+{
+	static const skiplist_properties_t properties[] = {
+		SKIPLIST_PROPERTY_NONE,
+		SKIPLIST_PROPERTY_UNIQUE,
+		SKIPLIST_PROPERTY_LAZY_DELETE,
+		SKIPLIST_PROPERTY_VERSIONED,
+		SKIPLIST_PROPERTY_LAZY_DELETE | SKIPLIST_PROPERTY_BACK_LINKS
+	};
+	skiplist_node_t *handles[100];
+	unsigned int i;
+	unsigned int p;
+	unsigned int m;
+	skiplist_t *skiplist;
+	skiplist_t *loaded;
+	skiplist_snapshot_t *snapshot;
+	skiplist_options_t options;
+	FILE *fp;
+
+	if( skiplist_options_init( &options ) )
+		return -1;
+	options.size_estimate_log2 = 10;
+	options.compare = int_compare;
+	options.print = int_fprintf;
+
+	for( m = 0; m < 3; ++m )
+	{
+		/* Sums, sums of squares and minimums. */
+		options.aggregate = 2 == m ? min_aggregate : sum_aggregate;
+		options.aggregate_lift = 1 == m ? square_lift : NULL;
+		options.aggregate_identity = 2 == m ? UINTPTR_MAX : 0;
+		options.payload_size = m;
+
+		for( p = 0; p < sizeof( properties ) / sizeof( properties[0] ); ++p )
+		{
+			options.properties = properties[p];
+			skiplist = skiplist_create_with_options( &options, NULL );
+			if( !skiplist )
+				return -1;
+			if( same_aggregates( skiplist, &options ) )
+				return -1;
+
+			for( i = 0; i < 100; ++i )
+			{
+				handles[i] = skiplist_push( skiplist, 2000 + i * 1000 + rand() % 1000, NULL );
+				if( !handles[i] )
+					return -1;
+			}
+			for( i = 0; i < 2000; ++i )
+			{
+				if( rand() % 3 )
+					skiplist_insert( skiplist, rand() % 1000 );
+				else
+					skiplist_remove( skiplist, rand() % 1000 );
+
+				if( 0 == i % 250 && same_aggregates( skiplist, &options ) )
+					return -1;
+			}
+
+			/* Handles move nodes in place and relink them, to values nothing else holds. */
+			for( i = 0; i < 100; ++i )
+			{
+				if( skiplist_update_node( skiplist, handles[i], 1000 + i * 10 + rand() % 10, NULL ) != handles[i] )
+					return -1;
+			}
+			if( same_aggregates( skiplist, &options ) )
+				return -1;
+
+			for( i = 0; i < 100; ++i )
+			{
+				skiplist_pop_min( skiplist, NULL, NULL );
+			}
+			if( same_aggregates( skiplist, &options ) || skiplist_compact( skiplist ) ||
+			    same_aggregates( skiplist, &options ) )
+				return -1;
+
+			/* Removes under a snapshot leave tombstones until it's released. */
+			if( options.properties & SKIPLIST_PROPERTY_VERSIONED )
+			{
+				snapshot = skiplist_snapshot_create( skiplist, NULL );
+				if( !snapshot )
+					return -1;
+				for( i = 0; i < 300; ++i )
+				{
+					skiplist_remove( skiplist, rand() % 1000 );
+				}
+				skiplist_pop_min( skiplist, NULL, NULL );
+				skiplist_update_node( skiplist, skiplist_begin( skiplist ), 1500, NULL );
+				if( same_aggregates( skiplist, &options ) || skiplist_snapshot_release( snapshot ) ||
+				    skiplist_compact( skiplist ) || same_aggregates( skiplist, &options ) )
+					return -1;
+			}
+
+			/* Loading rebuilds the aggregates. */
+			fp = tmpfile();
+			if( !fp )
+				return -1;
+			if( skiplist_save( skiplist, fileno( fp ), p % 2 ? SKIPLIST_SAVE_LEVELS : SKIPLIST_SAVE_VALUES ) ||
+			    lseek( fileno( fp ), 0, SEEK_SET ) )
+				return -1;
+			loaded = skiplist_load( fileno( fp ), &options, NULL );
+			fclose( fp );
+			if( !loaded || same_aggregates( loaded, &options ) )
+				return -1;
+
+			skiplist_destroy( loaded );
+			skiplist_destroy( skiplist );
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Checks snapshots of a versioned list keep seeing it as it was while it changes.
+ */
+static int mvcc_snapshots( void )
+{
+	unsigned int i;
+	uintptr_t expected;
+	skiplist_t *skiplist;
+	skiplist_snapshot_t *before;
+	skiplist_snapshot_t *after;
+	skiplist_node_t *iter;
+	skiplist_options_t options;
+	unsigned int payload;
+	skiplist_error_t err;
+
+	if( skiplist_options_init( &options ) )
+		return -1;
+	options.size_estimate_log2 = 10;
+	options.compare = int_compare;
+	options.print = int_fprintf;
+	options.properties = SKIPLIST_PROPERTY_VERSIONED;
+	skiplist = skiplist_create_with_options( &options, NULL );
+	if( !skiplist )
+		return -1;
+
+	for( i = 0; i < 100; ++i )
+	{
+		if( skiplist_insert( skiplist, i ) )
+			return -1;
+	}
+
+	/* Remove the even values and add 100 to 149 between the two snapshots, then remove everything below 50. */
+	before = skiplist_snapshot_create( skiplist, &err );
+	if( !before || err )
+		return -1;
+	for( i = 0; i < 100; i += 2 )
+	{
+		if( skiplist_remove( skiplist, i ) )
+			return -1;
+	}
+	for( i = 100; i < 150; ++i )
+	{
+		if( skiplist_insert( skiplist, i ) )
+			return -1;
+	}
+	after = skiplist_snapshot_create( skiplist, NULL );
+	if( !after )
+		return -1;
+	for( i = 1; i < 50; i += 2 )
+	{
+		if( skiplist_remove( skiplist, i ) )
+			return -1;
+	}
+
+	/* Compacting keeps every tombstone a snapshot can still see. */
+	if( skiplist_compact( skiplist ) || skiplist->tombstones != 75 || skiplist_size( skiplist, NULL ) != 75 )
+		return -1;
+
+	expected = 0;
+	for( iter = skiplist_snapshot_begin( before ); iter != skiplist_end(); iter = skiplist_snapshot_next( before, iter ) )
+	{
+		if( skiplist_node_value( iter, NULL ) != expected++ )
+			return -1;
+	}
+	if( expected != 100 || skiplist_snapshot_size( before, NULL ) != 100 )
+		return -1;
+
+	expected = 1;
+	for( iter = skiplist_snapshot_begin( after ); iter != skiplist_end(); iter = skiplist_snapshot_next( after, iter ) )
+	{
+		if( skiplist_node_value( iter, NULL ) != expected )
+			return -1;
+		expected += expected < 99 ? 2 : 1;
+	}
+	if( expected != 150 || skiplist_snapshot_size( after, NULL ) != 100 )
+		return -1;
+
+	if( !skiplist_snapshot_find( before, 2, &err ) || err || skiplist_snapshot_find( after, 2, NULL ) )
+		return -1;
+	if( skiplist_snapshot_find( before, 101, NULL ) || !skiplist_snapshot_find( after, 101, NULL ) )
+		return -1;
+	if( skiplist_node_value( skiplist_snapshot_find( after, 3, NULL ), NULL ) != 3 || skiplist_contains( skiplist, 3, NULL ) )
+		return -1;
+
+	/* A value removed and inserted again is seen once by each. */
+	if( skiplist_insert( skiplist, 3 ) || !skiplist_contains( skiplist, 3, NULL ) ||
+	    skiplist_snapshot_find( before, 3, NULL ) != skiplist_snapshot_find( after, 3, NULL ) )
+		return -1;
+
+	/* Only the values removed after the remaining snapshot was taken are still needed. */
+	if( skiplist_snapshot_release( before ) || skiplist_compact( skiplist ) || skiplist->tombstones != 25 )
+		return -1;
+	if( skiplist_snapshot_release( after ) || skiplist_compact( skiplist ) || skiplist->tombstones )
+		return -1;
+	skiplist_destroy( skiplist );
+
+	/* Updating a map keeps the old payload for a snapshot taken before. */
+	options.properties = SKIPLIST_PROPERTY_UNIQUE | SKIPLIST_PROPERTY_VERSIONED;
+	options.payload_size = sizeof( payload );
+	skiplist = skiplist_create_with_options( &options, NULL );
+	if( !skiplist )
+		return -1;
+	payload = 1;
+	if( skiplist_put( skiplist, 10, &payload ) )
+		return -1;
+	before = skiplist_snapshot_create( skiplist, NULL );
+	if( !before )
+		return -1;
+	payload = 2;
+	if( skiplist_put( skiplist, 10, &payload ) || skiplist_size( skiplist, NULL ) != 1 ||
+	    *(unsigned int *) skiplist_get( skiplist, 10, NULL ) != 2 )
+		return -1;
+	iter = skiplist_snapshot_find( before, 10, NULL );
+	if( !iter || *(unsigned int *) skiplist_node_payload( iter, NULL ) != 1 )
+		return -1;
+
+	/* Snapshots outliving their list can only be released. */
+	skiplist_destroy( skiplist );
+	if( skiplist_snapshot_begin( before ) != skiplist_end() || skiplist_snapshot_size( before, &err ) ||
+	    err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_snapshot_release( before ) )
+		return -1;
+
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Checks every version of a persistent list keeps its contents as later versions are made and released.
+ */
+static int persistent_versions( void )
+{
+	enum { VERSIONS = 200 };
+	unsigned int i;
+	skiplist_size_t j;
+	uintptr_t value;
+	uintptr_t *expected;
+	skiplist_size_t sizes[VERSIONS + 1];
+	skiplist_persistent_t *versions[VERSIONS + 1];
+	skiplist_persistent_t *same;
+	skiplist_t *reference;
+	skiplist_error_t err;
+
+	expected = (uintptr_t *) malloc( sizeof( uintptr_t ) * VERSIONS * (VERSIONS + 1) );
+	reference = skiplist_create( SKIPLIST_PROPERTY_NONE, 8, int_compare, int_fprintf, NULL );
+	versions[0] = skiplist_persistent_create( SKIPLIST_PROPERTY_NONE, 8, int_compare, &err );
+	if( !expected || !reference || !versions[0] || err )
+		return -1;
+	sizes[0] = 0;
+
+	/* Insert values with some duplicates, removing one every third version, and record each version's contents. */
+	for( i = 0; i < VERSIONS; ++i )
+	{
+		if( 2 == i % 3 )
+		{
+			value = skiplist_at_index( reference, (i * 7) % skiplist_size( reference, NULL ), NULL );
+			versions[i + 1] = skiplist_persistent_remove( versions[i], value, &err );
+			if( skiplist_remove( reference, value ) )
+				return -1;
+		}
+		else
+		{
+			value = (i * 37) % 101;
+			versions[i + 1] = skiplist_persistent_insert( versions[i], value, &err );
+			if( skiplist_insert( reference, value ) )
+				return -1;
+		}
+		if( !versions[i + 1] || err )
+			return -1;
+
+		sizes[i + 1] = skiplist_size( reference, NULL );
+		for( j = 0; j < sizes[i + 1]; ++j )
+		{
+			expected[(i + 1) * VERSIONS + j] = skiplist_at_index( reference, j, NULL );
+		}
+	}
+
+	/* Release every other version, the rest still read back as they were made. */
+	for( i = 0; i <= VERSIONS; ++i )
+	{
+		if( 0 == i % 2 && skiplist_persistent_release( versions[i] ) )
+			return -1;
+	}
+	for( i = 1; i <= VERSIONS; i += 2 )
+	{
+		if( skiplist_persistent_size( versions[i], NULL ) != sizes[i] )
+			return -1;
+		for( j = 0; j < sizes[i]; ++j )
+		{
+			value = expected[i * VERSIONS + j];
+			if( skiplist_persistent_at_index( versions[i], j, &err ) != value || err )
+				return -1;
+			if( !skiplist_persistent_contains( versions[i], value, NULL ) )
+				return -1;
+		}
+		if( skiplist_persistent_contains( versions[i], 101, NULL ) )
+			return -1;
+	}
+	for( i = 1; i <= VERSIONS; i += 2 )
+	{
+		if( skiplist_persistent_release( versions[i] ) )
+			return -1;
+	}
+
+	/* A set gets an identical version for a value it already holds. */
+	versions[0] = skiplist_persistent_create( SKIPLIST_PROPERTY_UNIQUE, 4, int_compare, NULL );
+	if( !versions[0] )
+		return -1;
+	versions[1] = skiplist_persistent_insert( versions[0], 5, NULL );
+	same = skiplist_persistent_insert( versions[1], 5, &err );
+	if( !versions[1] || !same || err || same->head != versions[1]->head || skiplist_persistent_size( same, NULL ) != 1 )
+		return -1;
+	if( skiplist_persistent_release( versions[1] ) || skiplist_persistent_release( versions[0] ) )
+		return -1;
+	if( !skiplist_persistent_contains( same, 5, NULL ) || skiplist_persistent_release( same ) )
+		return -1;
+
+	skiplist_destroy( reference );
+	free( expected );
+
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Checks a snapshot plus its write-ahead log recovers a list, including after a torn write.
+ */
+static int write_ahead_log( void )
+{
+	unsigned int i;
+	unsigned int policy;
+	unsigned long records;
+	FILE *snapshot;
+	FILE *log;
+	skiplist_t *skiplist;
+	skiplist_t *recovered;
+	skiplist_wal_t *wal;
+	skiplist_wal_options_t wal_options;
+	skiplist_options_t options;
+	skiplist_error_t err;
+	off_t size;
+
+	if( skiplist_options_init( &options ) )
+		return -1;
+	options.size_estimate_log2 = 12;
+	options.compare = uintptr_compare;
+	options.print = int_fprintf;
+
+	for( policy = SKIPLIST_WAL_SYNC_MANUAL; policy <= SKIPLIST_WAL_SYNC_INTERVAL; ++policy )
+	{
+		skiplist = skiplist_create_with_options( &options, NULL );
+		if( !skiplist )
+			return -1;
+		for( i = 0; i < 1000; ++i )
+			if( skiplist_insert( skiplist, i ) )
+				return -1;
+
+		snapshot = tmpfile();
+		log = tmpfile();
+		if( !snapshot || !log )
+			return -1;
+		if( skiplist_save( skiplist, fileno( snapshot ), SKIPLIST_SAVE_VALUES ) )
+			return -1;
+
+		/* A small buffer so records span many batches. */
+		if( skiplist_wal_options_init( &wal_options ) )
+			return -1;
+		wal_options.sync = (skiplist_wal_sync_t) policy;
+		wal_options.sync_records = 100;
+		wal_options.sync_interval_ms = 1;
+		wal_options.buffer_size = 64;
+		wal = skiplist_wal_open( fileno( log ), &wal_options, &err );
+		if( !wal || err )
+			return -1;
+		if( skiplist_wal_attach( skiplist, wal ) )
+			return -1;
+
+		/* Values needing every length of encoding, and removes that fail and aren't logged. */
+		for( i = 0; i < 2000; ++i )
+			if( skiplist_insert( skiplist, ((uintptr_t) i * 2654435761u) << (i % 32) ) )
+				return -1;
+		for( i = 0; i < 1000; i += 3 )
+			if( skiplist_remove( skiplist, i ) )
+				return -1;
+		if( skiplist_remove( skiplist, 3 ) != SKIPLIST_ERROR_INVALID_INPUT )
+			return -1;
+
+		if( skiplist_wal_attach( skiplist, NULL ) || skiplist_wal_close( wal ) )
+			return -1;
+
+		/* A crash part way through writing a batch. */
+		size = lseek( fileno( log ), 0, SEEK_END );
+		if( write( fileno( log ), "\x20\x00\x00\x00\x01\x02", 6 ) != 6 )
+			return -1;
+
+		if( lseek( fileno( snapshot ), 0, SEEK_SET ) || lseek( fileno( log ), 0, SEEK_SET ) )
+			return -1;
+		recovered = skiplist_load( fileno( snapshot ), &options, NULL );
+		if( !recovered )
+			return -1;
+		if( skiplist_wal_replay( recovered, fileno( log ), &records ) || records != 2000 + 334 )
+			return -1;
+		if( same_skiplist( skiplist, recovered, 0 ) )
+			return -1;
+
+		/* The torn tail is gone and new records follow the last complete batch. */
+		if( lseek( fileno( log ), 0, SEEK_END ) != size )
+			return -1;
+		wal = skiplist_wal_open( fileno( log ), &wal_options, NULL );
+		if( !wal || skiplist_wal_attach( recovered, wal ) )
+			return -1;
+		if( skiplist_insert( recovered, 5000 ) || skiplist_wal_sync( wal ) )
+			return -1;
+		if( skiplist_wal_attach( recovered, NULL ) || skiplist_wal_close( wal ) )
+			return -1;
+		skiplist_destroy( recovered );
+
+		if( skiplist_insert( skiplist, 5000 ) )
+			return -1;
+		if( lseek( fileno( snapshot ), 0, SEEK_SET ) || lseek( fileno( log ), 0, SEEK_SET ) )
+			return -1;
+		recovered = skiplist_load( fileno( snapshot ), &options, NULL );
+		if( !recovered )
+			return -1;
+		if( skiplist_wal_replay( recovered, fileno( log ), &records ) || records != 2000 + 334 + 1 )
+			return -1;
+		if( same_skiplist( skiplist, recovered, 0 ) )
+			return -1;
+
+		skiplist_destroy( recovered );
+		skiplist_destroy( skiplist );
+		fclose( snapshot );
+		fclose( log );
+	}
+
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Checks a batch that was only partly written is cut off and retried whole.
+ */
+static int write_ahead_log_short_write( void )
+{
+	unsigned int i;
+	unsigned long records;
+	FILE *log;
+	skiplist_t *skiplist;
+	skiplist_t *recovered;
+	skiplist_wal_t *wal;
+	skiplist_wal_options_t wal_options;
+	struct rlimit limit;
+	struct rlimit full;
+	off_t size;
+
+	skiplist = skiplist_create( SKIPLIST_PROPERTY_NONE, 10, uintptr_compare, int_fprintf, NULL );
+	recovered = skiplist_create( SKIPLIST_PROPERTY_NONE, 10, uintptr_compare, int_fprintf, NULL );
+	log = tmpfile();
+	if( !skiplist || !recovered || !log )
+		return -1;
+
+	if( skiplist_wal_options_init( &wal_options ) )
+		return -1;
+	wal_options.sync = SKIPLIST_WAL_SYNC_MANUAL;
+	wal = skiplist_wal_open( fileno( log ), &wal_options, NULL );
+	if( !wal || skiplist_wal_attach( skiplist, wal ) )
+		return -1;
+
+	for( i = 0; i < 100; ++i )
+		if( skiplist_insert( skiplist, i ) )
+			return -1;
+	if( skiplist_wal_sync( wal ) )
+		return -1;
+
+	/* Let the next batch only get a few bytes into the file, like a full disk. */
+	size = lseek( fileno( log ), 0, SEEK_CUR );
+	if( getrlimit( RLIMIT_FSIZE, &full ) )
+		return -1;
+	limit = full;
+	limit.rlim_cur = (rlim_t) size + 5;
+	signal( SIGXFSZ, SIG_IGN );
+	if( setrlimit( RLIMIT_FSIZE, &limit ) )
+		return -1;
+	for( i = 100; i < 200; ++i )
+		if( skiplist_insert( skiplist, i ) )
+			return -1;
+	if( skiplist_wal_sync( wal ) != SKIPLIST_ERROR_IO )
+		return -1;
+	if( setrlimit( RLIMIT_FSIZE, &full ) )
+		return -1;
+	signal( SIGXFSZ, SIG_DFL );
+	if( lseek( fileno( log ), 0, SEEK_END ) != size )
+		return -1;
+
+	/* The batch is retried whole, and later batches follow it. */
+	if( skiplist_wal_sync( wal ) )
+		return -1;
+	for( i = 200; i < 300; ++i )
+		if( skiplist_insert( skiplist, i ) )
+			return -1;
+	if( skiplist_wal_attach( skiplist, NULL ) || skiplist_wal_close( wal ) )
+		return -1;
+
+	if( lseek( fileno( log ), 0, SEEK_SET ) )
+		return -1;
+	if( skiplist_wal_replay( recovered, fileno( log ), &records ) || records != 300 )
+		return -1;
+	if( same_skiplist( skiplist, recovered, 0 ) )
+		return -1;
+
+	skiplist_destroy( recovered );
+	skiplist_destroy( skiplist );
+	fclose( log );
+
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Checks a record is kept when the append that fills the buffer can't write it.
+ */
+static int write_ahead_log_full_buffer( void )
+{
+	unsigned int i;
+	unsigned long records;
+	FILE *log;
+	skiplist_t *skiplist;
+	skiplist_t *recovered;
+	skiplist_wal_t *wal;
+	skiplist_wal_options_t wal_options;
+	struct rlimit limit;
+	struct rlimit full;
+	off_t size;
+
+	skiplist = skiplist_create( SKIPLIST_PROPERTY_NONE, 10, uintptr_compare, int_fprintf, NULL );
+	recovered = skiplist_create( SKIPLIST_PROPERTY_NONE, 10, uintptr_compare, int_fprintf, NULL );
+	log = tmpfile();
+	if( !skiplist || !recovered || !log )
+		return -1;
+
+	if( skiplist_wal_options_init( &wal_options ) )
+		return -1;
+	wal_options.sync = SKIPLIST_WAL_SYNC_MANUAL;
+	wal_options.buffer_size = SKIPLIST_WAL_MIN_BUFFER_SIZE;
+	wal = skiplist_wal_open( fileno( log ), &wal_options, NULL );
+	if( !wal || skiplist_wal_attach( skiplist, wal ) )
+		return -1;
+
+	for( i = 0; i < 10; ++i )
+		if( skiplist_insert( skiplist, i ) )
+			return -1;
+	if( skiplist_wal_sync( wal ) )
+		return -1;
+
+	size = lseek( fileno( log ), 0, SEEK_CUR );
+	if( getrlimit( RLIMIT_FSIZE, &full ) )
+		return -1;
+	limit = full;
+	limit.rlim_cur = (rlim_t) size + 5;
+	signal( SIGXFSZ, SIG_IGN );
+	if( setrlimit( RLIMIT_FSIZE, &limit ) )
+		return -1;
+
+	/* Two byte records, so the fourth finds the buffer full and fails to write it. */
+	for( i = 100; i < 103; ++i )
+		if( skiplist_insert( skiplist, i ) )
+			return -1;
+	if( skiplist_insert( skiplist, 103 ) != SKIPLIST_ERROR_IO )
+		return -1;
+	if( setrlimit( RLIMIT_FSIZE, &full ) )
+		return -1;
+
+	/* The failed insert's record is written with the retried batch, ahead of the remove. */
+	if( skiplist_remove( skiplist, 103 ) || skiplist_wal_sync( wal ) )
+		return -1;
+	if( lseek( fileno( log ), 0, SEEK_SET ) )
+		return -1;
+	if( skiplist_wal_replay( recovered, fileno( log ), &records ) || records != 15 )
+		return -1;
+	if( same_skiplist( skiplist, recovered, 0 ) )
+		return -1;
+
+	/* Once a second record finds the buffer full the log can't be replayed any more, so it stops. */
+	if( setrlimit( RLIMIT_FSIZE, &limit ) )
+		return -1;
+	for( i = 200; i < 210; ++i )
+		(void) skiplist_insert( skiplist, i );
+	if( setrlimit( RLIMIT_FSIZE, &full ) )
+		return -1;
+	signal( SIGXFSZ, SIG_DFL );
+	if( !wal->failed || skiplist_wal_sync( wal ) != SKIPLIST_ERROR_IO )
+		return -1;
+	if( skiplist_insert( skiplist, 300 ) != SKIPLIST_ERROR_IO )
+		return -1;
+
+	if( skiplist_wal_attach( skiplist, NULL ) || skiplist_wal_close( wal ) != SKIPLIST_ERROR_IO )
+		return -1;
+
+	skiplist_destroy( recovered );
+	skiplist_destroy( skiplist );
+	fclose( log );
+
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Checks a log appended to the file holding its snapshot replays from where loading stops.
+ */
+static int write_ahead_log_after_snapshot( void )
+{
+	unsigned int i;
+	unsigned long records;
+	FILE *file;
+	skiplist_t *skiplist;
+	skiplist_t *recovered;
+	skiplist_wal_t *wal;
+	skiplist_wal_options_t wal_options;
+	skiplist_options_t options;
+	off_t size;
+
+	if( skiplist_options_init( &options ) )
+		return -1;
+	options.size_estimate_log2 = 12;
+	options.compare = uintptr_compare;
+	options.print = int_fprintf;
+
+	skiplist = skiplist_create_with_options( &options, NULL );
+	file = tmpfile();
+	if( !skiplist || !file )
+		return -1;
+	for( i = 0; i < 1000; ++i )
+		if( skiplist_insert( skiplist, i ) )
+			return -1;
+	if( skiplist_save( skiplist, fileno( file ), SKIPLIST_SAVE_VALUES ) )
+		return -1;
+	size = lseek( fileno( file ), 0, SEEK_CUR );
+
+	if( skiplist_wal_options_init( &wal_options ) )
+		return -1;
+	wal = skiplist_wal_open( fileno( file ), &wal_options, NULL );
+	if( !wal || skiplist_wal_attach( skiplist, wal ) )
+		return -1;
+	for( i = 1000; i < 1100; ++i )
+		if( skiplist_insert( skiplist, i ) )
+			return -1;
+	if( skiplist_wal_attach( skiplist, NULL ) || skiplist_wal_close( wal ) )
+		return -1;
+
+	/* Loading reads ahead into the log, and must leave the offset at its start. */
+	if( lseek( fileno( file ), 0, SEEK_SET ) )
+		return -1;
+	recovered = skiplist_load( fileno( file ), &options, NULL );
+	if( !recovered || lseek( fileno( file ), 0, SEEK_CUR ) != size )
+		return -1;
+	if( skiplist_wal_replay( recovered, fileno( file ), &records ) || records != 100 )
+		return -1;
+	if( same_skiplist( skiplist, recovered, 0 ) )
+		return -1;
+
+	skiplist_destroy( recovered );
+	skiplist_destroy( skiplist );
+	fclose( file );
+
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Checks the memory usage breakdown adds up for both memory backends.
+ */
+static int memory_usage( void )
+{
+	unsigned int i;
+	unsigned int backend;
+	skiplist_t *skiplist;
+	skiplist_options_t options;
+	skiplist_memory_usage_t usage;
+
+	for( backend = SKIPLIST_MEMORY_MALLOC; backend <= SKIPLIST_MEMORY_HUGE_PAGES; ++backend )
+	{
+		if( skiplist_options_init( &options ) )
+			return -1;
+		options.size_estimate_log2 = 12;
+		options.compare = int_compare;
+		options.print = int_fprintf;
+		options.memory_backend = (skiplist_memory_backend_t) backend;
+
+		skiplist = skiplist_create_with_options( &options, NULL );
+		if( !skiplist )
+			return -1;
+
+		if( skiplist_memory_usage( skiplist, &usage ) )
+			return -1;
+		if( usage.node_headers || usage.links || usage.header < sizeof( skiplist_t ) )
+			return -1;
+
+		for( i = 0; i < 1000; ++i )
+			if( skiplist_insert( skiplist, i ) )
+				return -1;
+
+		if( skiplist_memory_usage( skiplist, &usage ) )
+			return -1;
+
+		/* Every node has at least one link and half of them are expected to have more. */
+		if( usage.node_headers != 1000 * offsetof( skiplist_node_t, link ) )
+			return -1;
+		if( usage.links < 1000 * sizeof( skiplist_link_t ) || usage.links > 12 * 1000 * sizeof( skiplist_link_t ) )
+			return -1;
+		if( usage.total != usage.header + usage.node_headers + usage.links + usage.slack )
+			return -1;
+		if( SKIPLIST_MEMORY_HUGE_PAGES == backend && usage.total != skiplist_memory_held( skiplist, NULL ) )
+			return -1;
+		if( SKIPLIST_MEMORY_MALLOC == backend && usage.total < skiplist_memory_held( skiplist, NULL ) )
+			return -1;
+
+		if( skiplist_destroy( skiplist ) )
+			return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Checks the operation counters are gathered when they're compiled in.
+ */
+static int stats( void )
+{
+	unsigned int i;
+	unsigned long nodes;
+	skiplist_t *skiplist;
+	skiplist_options_t options;
+	skiplist_snapshot_t *snapshot;
+	skiplist_node_t *node;
+	skiplist_stats_t stats;
+	skiplist_error_t err;
+
+	skiplist = skiplist_create( SKIPLIST_PROPERTY_NONE, 8, int_compare, int_fprintf, NULL );
+	if( !skiplist )
+		return -1;
+
+	for( i = 0; i < 100; ++i )
+		if( skiplist_insert( skiplist, i ) )
+			return -1;
+	for( i = 0; i < 50; ++i )
+		if( !skiplist_contains( skiplist, i, NULL ) )
+			return -1;
+	for( i = 0; i < 10; ++i )
+		if( skiplist_remove( skiplist, i ) )
+			return -1;
+	skiplist_at_index( skiplist, 0, NULL );
+
+	err = skiplist_get_stats( skiplist, &stats );
+#ifdef SKIPLIST_STATS
+	if( err )
+		return -1;
+
+	if( stats.inserts != 100 || stats.lookups != 50 || stats.removes != 10 || stats.index_lookups != 1 )
+		return -1;
+
+	if( !stats.insert_comparisons || !stats.lookup_comparisons || !stats.remove_comparisons )
+		return -1;
+
+	if( stats.bytes_allocated <= stats.bytes_freed )
+		return -1;
+
+	for( i = 0, nodes = 0; i < SKIPLIST_MAX_LINKS; ++i )
+		nodes += stats.level_histogram[i];
+	if( nodes != 90 )
+		return -1;
+
+	if( skiplist_reset_stats( skiplist ) || skiplist_get_stats( skiplist, &stats ) )
+		return -1;
+
+	if( stats.inserts || stats.lookup_comparisons || stats.nodes_visited[0] || !stats.level_histogram[0] )
+		return -1;
+	skiplist_destroy( skiplist );
+
+	/* Every operation counts the links it follows, not the one it stops in front of. On a
+	   single level list that's the number of nodes before where it stops. */
+	skiplist = skiplist_create( SKIPLIST_PROPERTY_NONE, 1, int_compare, int_fprintf, NULL );
+	if( !skiplist )
+		return -1;
+	for( i = 0; i < 10; ++i )
+		if( skiplist_insert( skiplist, i ) )
+			return -1;
+	if( skiplist_reset_stats( skiplist ) || !skiplist_contains( skiplist, 5, NULL ) ||
+	    skiplist_get_stats( skiplist, &stats ) || stats.nodes_visited[0] != 5 )
+		return -1;
+	if( skiplist_reset_stats( skiplist ) || skiplist_at_index( skiplist, 5, NULL ) != 5 ||
+	    skiplist_get_stats( skiplist, &stats ) || stats.nodes_visited[0] != 5 )
+		return -1;
+	if( skiplist_reset_stats( skiplist ) || skiplist_remove( skiplist, 5 ) ||
+	    skiplist_get_stats( skiplist, &stats ) || stats.nodes_visited[0] != 5 )
+		return -1;
+	if( skiplist_reset_stats( skiplist ) || skiplist_insert( skiplist, 5 ) ||
+	    skiplist_get_stats( skiplist, &stats ) || stats.nodes_visited[0] != 5 )
+		return -1;
+	skiplist_destroy( skiplist );
+
+	/* Replacing a payload or moving a node is an update, even when a snapshot has it replaced
+	   by a new node, and a removal under a snapshot is still one remove. */
+	if( skiplist_options_init( &options ) )
+		return -1;
+	options.properties = SKIPLIST_PROPERTY_UNIQUE | SKIPLIST_PROPERTY_VERSIONED;
+	options.size_estimate_log2 = 4;
+	options.compare = int_compare;
+	options.print = int_fprintf;
+	options.payload_size = sizeof( i );
+	skiplist = skiplist_create_with_options( &options, NULL );
+	if( !skiplist )
+		return -1;
+	snapshot = skiplist_snapshot_create( skiplist, NULL );
+	if( !snapshot )
+		return -1;
+	if( skiplist_put( skiplist, 1, &i ) || skiplist_put( skiplist, 1, &i ) )
+		return -1;
+	node = skiplist_push( skiplist, 2, NULL );
+	if( !node || !skiplist_update_node( skiplist, node, 3, NULL ) )
+		return -1;
+	if( skiplist_pop_min( skiplist, NULL, NULL ) != 1 || skiplist_erase( skiplist, 3, NULL ) )
+		return -1;
+	if( skiplist_put( skiplist, 4, &i ) || skiplist_remove_node( skiplist, skiplist_begin( skiplist ) ) )
+		return -1;
+	if( skiplist_get_stats( skiplist, &stats ) || stats.inserts != 3 || stats.removes != 3 || stats.updates != 2 )
+		return -1;
+	if( skiplist_snapshot_release( snapshot ) )
+		return -1;
+#else
+	(void) nodes;
+	(void) options;
+	(void) snapshot;
+	(void) node;
+	if( SKIPLIST_ERROR_NOT_SUPPORTED != err )
+		return -1;
+
+	if( SKIPLIST_ERROR_NOT_SUPPORTED != skiplist_reset_stats( skiplist ) )
+		return -1;
+#endif
+
+	if( SKIPLIST_ERROR_INVALID_INPUT != skiplist_get_stats( NULL, &stats ) )
+		return -1;
+
+	if( SKIPLIST_ERROR_INVALID_INPUT != skiplist_get_stats( skiplist, NULL ) )
+		return -1;
+
+	if( SKIPLIST_ERROR_INVALID_INPUT != skiplist_reset_stats( NULL ) )
+		return -1;
+
+	skiplist_destroy( skiplist );
+
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Sanity test of the shape analysis and windowed DOT output.
+ */
+static int analyze( void )
+{
+	unsigned int i;
+	skiplist_t *skiplist;
+	skiplist_options_t options;
+	FILE *fp;
+	char line[4096];
+
+	/* Deliberately use too few levels, the analysis is for diagnosing lists like this. */
+	skiplist = skiplist_create( SKIPLIST_PROPERTY_NONE, 3, int_compare, int_fprintf, NULL );
+	if( !skiplist )
+		return -1;
+
+	for( i = 0; i < 1000; ++i )
+		if( skiplist_insert( skiplist, i ) )
+			return -1;
+
+	fp = fopen( "analyze.json", "w+" );
+	if( !fp )
+		return -1;
+
+	if( skiplist_analyze( fp, skiplist ) )
+		return -1;
+
+	rewind( fp );
+	if( !fgets( line, sizeof( line ), fp ) )
+		return -1;
+	fclose( fp );
+
+	if( strncmp( line, "{\"num_nodes\":1000,\"tombstones\":0,\"levels\":3,",
+	             strlen( "{\"num_nodes\":1000,\"tombstones\":0,\"levels\":3," ) ) )
+		return -1;
+
+	if( skiplist_fprintf_window( stdout, skiplist, 10, 5, 0 ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+
+	fp = fopen( "analyze_window.dot", "w" );
+	if( !fp )
+		return -1;
+
+	if( skiplist_fprintf_window( fp, skiplist, 100, 200, 10 ) )
+		return -1;
+	fclose( fp );
+
+	skiplist_destroy( skiplist );
+
+	/* Tombstones are reported apart from num_nodes, and the bottom level holds both. */
+	if( skiplist_options_init( &options ) )
+		return -1;
+	options.properties = SKIPLIST_PROPERTY_LAZY_DELETE;
+	options.size_estimate_log2 = 10;
+	options.compare = int_compare;
+	options.print = int_fprintf;
+	options.compact_percent = 0;
+	skiplist = skiplist_create_with_options( &options, NULL );
+	if( !skiplist )
+		return -1;
+	for( i = 0; i < 1000; ++i )
+		if( skiplist_insert( skiplist, i ) )
+			return -1;
+	for( i = 0; i < 1000; i += 2 )
+		if( skiplist_remove( skiplist, i ) )
+			return -1;
+
+	fp = fopen( "analyze.json", "w+" );
+	if( !fp )
+		return -1;
+	if( skiplist_analyze( fp, skiplist ) )
+		return -1;
+	rewind( fp );
+	if( !fgets( line, sizeof( line ), fp ) )
+		return -1;
+	fclose( fp );
+
+	if( strncmp( line, "{\"num_nodes\":500,\"tombstones\":500,", strlen( "{\"num_nodes\":500,\"tombstones\":500," ) ) ||
+	    !strstr( line, "{\"level\":0,\"nodes\":1000,\"expected_nodes\":1000.000," ) )
+		return -1;
+
+	skiplist_destroy( skiplist );
+
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for skiplist_create.
+ */
+static int abuse_skiplist_create( void )
+{
+	unsigned int i;
+	skiplist_t *skiplist;
+	const unsigned int bad_sizes[] = {0, SKIPLIST_MAX_LINKS + 1, UINT_MAX};
+
+	/* Bad property */
+	skiplist = skiplist_create( 0xffff, 5, int_compare, int_fprintf, NULL );
+	if( skiplist )
+		return -1;
+
+	/* Bad size estimates */
+	for( i = 0; i < NELEMS( bad_sizes ); ++i )
+	{
+		skiplist = skiplist_create( SKIPLIST_PROPERTY_NONE, bad_sizes[i],
+		                            int_compare, int_fprintf, NULL );
+		if( skiplist )
+			return -1;
+	}
+
+	/* Bad compare */
+	skiplist = skiplist_create( SKIPLIST_PROPERTY_NONE, SKIPLIST_MAX_LINKS,
+	                            NULL, int_fprintf, NULL );
+	if( skiplist )
+		return -1;
+
+	/* Bad print */
+	skiplist = skiplist_create( SKIPLIST_PROPERTY_NONE, SKIPLIST_MAX_LINKS,
+	                            int_compare, NULL, NULL );
+	if( skiplist )
+		return -1;
+
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for skiplist_create_with_options.
+ */
+static int abuse_skiplist_create_with_options( void )
+{
+	skiplist_options_t options;
+
+	if( !skiplist_options_init( NULL ) )
+		return -1;
+
+	if( skiplist_create_with_options( NULL, NULL ) )
+		return -1;
+
+	/* Bad memory backend */
+	if( skiplist_options_init( &options ) )
+		return -1;
+	options.compare = int_compare;
+	options.print = int_fprintf;
+	options.memory_backend = (skiplist_memory_backend_t) 0xffff;
+	if( skiplist_create_with_options( &options, NULL ) )
+		return -1;
+
+	/* Bad NUMA node */
+	options.memory_backend = SKIPLIST_MEMORY_HUGE_PAGES;
+	options.numa_node = -2;
+	if( skiplist_create_with_options( &options, NULL ) )
+		return -1;
+
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for skiplist_destroy.
+ */
+static int abuse_skiplist_destroy( void )
+{
+	/* Can't do much but check NULL doesn't cause a crash. */
+	skiplist_destroy( NULL );
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for skiplist_contains.
+ */
+static int abuse_skiplist_contains( void )
+{
+	if( skiplist_contains( NULL, 0, NULL ) )
+		return -1;
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for skiplist_insert.
+ */
+static int abuse_skiplist_insert( void )
+{
+	if( !skiplist_insert( NULL, 0 ) )
+		return -1;
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for skiplist_remove.
+ */
+static int abuse_skiplist_remove( void )
+{
+	if( !skiplist_remove( NULL, 0 ) )
+		return -1;
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for skiplist_compact and lazy deletion.
+ */
+static int abuse_skiplist_compact( void )
+{
+	skiplist_t *skiplist;
+	skiplist_options_t options;
+	skiplist_error_t err;
+
+	if( skiplist_compact( NULL ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+
+	if( skiplist_options_init( &options ) )
+		return -1;
+	options.size_estimate_log2 = 5;
+	options.compare = int_compare;
+	options.print = int_fprintf;
+	options.properties = SKIPLIST_PROPERTY_BACK_LINKS << 1;
+	if( skiplist_create_with_options( &options, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+
+	/* Compacting a list without tombstones does nothing. */
+	options.properties = SKIPLIST_PROPERTY_NONE;
+	skiplist = skiplist_create_with_options( &options, NULL );
+	if( !skiplist )
+		return -1;
+	if( skiplist_insert( skiplist, 1 ) || skiplist_compact( skiplist ) || skiplist_size( skiplist, NULL ) != 1 )
+		return -1;
+	skiplist_destroy( skiplist );
+
+	/* Removing a value twice fails the second time, the tombstone doesn't count. */
+	options.properties = SKIPLIST_PROPERTY_LAZY_DELETE;
+	options.compact_percent = 0;
+	skiplist = skiplist_create_with_options( &options, NULL );
+	if( !skiplist )
+		return -1;
+	if( skiplist_insert( skiplist, 1 ) || skiplist_remove( skiplist, 1 ) )
+		return -1;
+	if( skiplist_remove( skiplist, 1 ) != SKIPLIST_ERROR_INVALID_INPUT || skiplist_contains( skiplist, 1, NULL ) )
+		return -1;
+	if( skiplist_begin( skiplist ) != skiplist_end() || skiplist_at_index( skiplist, 0, &err ) ||
+	    err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	skiplist_destroy( skiplist );
+
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Confirms backwards iteration and removing by handle fail gracefully.
+ */
+static int abuse_skiplist_back_links( void )
+{
+	skiplist_t *skiplist;
+	skiplist_t *other;
+	skiplist_node_t *node;
+	skiplist_error_t err;
+
+	if( skiplist_rbegin( NULL ) != skiplist_end() || skiplist_last( NULL, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_remove_node( NULL, NULL ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+
+	/* Lists without back links can't go backwards, but can still remove by handle. */
+	skiplist = skiplist_create( SKIPLIST_PROPERTY_NONE, 5, int_compare, int_fprintf, NULL );
+	other = skiplist_create( SKIPLIST_PROPERTY_BACK_LINKS, 5, int_compare, int_fprintf, NULL );
+	if( !skiplist || !other )
+		return -1;
+	if( skiplist_insert( skiplist, 1 ) || skiplist_insert( other, 1 ) || skiplist_insert( other, 2 ) )
+		return -1;
+	if( skiplist_rbegin( skiplist ) != skiplist_end() || skiplist_last( skiplist, &err ) ||
+	    err != SKIPLIST_ERROR_NOT_SUPPORTED )
+		return -1;
+	if( skiplist_prev( skiplist, skiplist_begin( skiplist ) ) != skiplist_end() || skiplist_prev( other, NULL ) )
+		return -1;
+	if( skiplist_remove_node( skiplist, NULL ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+
+	/* A node from another list isn't found. */
+	node = skiplist_rbegin( other );
+	if( skiplist_remove_node( skiplist, node ) != SKIPLIST_ERROR_INVALID_INPUT || skiplist_size( skiplist, NULL ) != 1 )
+		return -1;
+	node = skiplist_begin( skiplist );
+	if( skiplist_remove_node( skiplist, node ) || skiplist_size( skiplist, NULL ) )
+		return -1;
+
+	skiplist_destroy( other );
+	skiplist_destroy( skiplist );
+
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Confirms snapshots fail gracefully on invalid input and unversioned lists.
+ */
+static int abuse_skiplist_snapshot( void )
+{
+	skiplist_t *skiplist;
+	skiplist_snapshot_t *snapshot;
+	skiplist_error_t err;
+
+	if( skiplist_snapshot_create( NULL, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_snapshot_release( NULL ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_snapshot_find( NULL, 0, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_snapshot_begin( NULL ) != skiplist_end() || skiplist_snapshot_size( NULL, &err ) ||
+	    err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+
+	skiplist = skiplist_create( SKIPLIST_PROPERTY_LAZY_DELETE, 5, int_compare, int_fprintf, NULL );
+	if( !skiplist )
+		return -1;
+	if( skiplist_snapshot_create( skiplist, &err ) || err != SKIPLIST_ERROR_NOT_SUPPORTED )
+		return -1;
+	skiplist_destroy( skiplist );
+
+	skiplist = skiplist_create( SKIPLIST_PROPERTY_VERSIONED, 5, int_compare, int_fprintf, NULL );
+	if( !skiplist )
+		return -1;
+	snapshot = skiplist_snapshot_create( skiplist, NULL );
+	if( !snapshot || skiplist_snapshot_next( snapshot, NULL ) != skiplist_end() ||
+	    skiplist_snapshot_next( NULL, &skiplist->head ) != skiplist_end() )
+		return -1;
+	if( skiplist_snapshot_release( snapshot ) )
+		return -1;
+	skiplist_destroy( skiplist );
+
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for skiplist_printf.
+ */
+static int abuse_skiplist_printf( void )
+{
+	skiplist_printf( NULL );
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for skiplist_fprintf.
+ */
+static int abuse_skiplist_fprintf( void )
+{
+	skiplist_t *skiplist;
+
+	skiplist = skiplist_create( SKIPLIST_PROPERTY_NONE, 5, int_compare, int_fprintf, NULL );
+	if( !skiplist )
+		return -1;
+
+	skiplist_fprintf( NULL, skiplist );
+	skiplist_fprintf( stdout, NULL );
+
+	skiplist_destroy( skiplist );
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for skiplist_fprintf_filename.
+ */
+static int abuse_skiplist_fprintf_filename( void )
+{
+	skiplist_t *skiplist;
+
+	skiplist = skiplist_create( SKIPLIST_PROPERTY_NONE, 5, int_compare, int_fprintf, NULL );
+	if( !skiplist )
+		return -1;
+
+	if( !skiplist_fprintf_filename( NULL, skiplist ) )
+		return -1;
+
+	if( !skiplist_fprintf_filename( "valid_filname.txt", NULL ) )
+		return -1;
+
+	skiplist_destroy( skiplist );
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for skiplist_analyze.
+ */
+static int abuse_skiplist_analyze( void )
+{
+	skiplist_t *skiplist;
+
+	skiplist = skiplist_create( SKIPLIST_PROPERTY_NONE, 5, int_compare, int_fprintf, NULL );
+	if( !skiplist )
+		return -1;
+
+	if( !skiplist_analyze( NULL, skiplist ) )
+		return -1;
+
+	if( !skiplist_analyze( stdout, NULL ) )
+		return -1;
+
+	if( !skiplist_fprintf_window( NULL, skiplist, 0, 0, 0 ) )
+		return -1;
+
+	if( !skiplist_fprintf_window( stdout, NULL, 0, 0, 0 ) )
+		return -1;
+
+	skiplist_destroy( skiplist );
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Confirms incorrect inputs and damaged snapshots are handled gracefully for skiplist_save and skiplist_load.
+ */
+static int abuse_skiplist_save_load( void )
+{
+	unsigned int i;
+	skiplist_t *skiplist;
+	skiplist_options_t options;
+	skiplist_error_t err;
+	FILE *fp;
+	FILE *truncated;
+	char bytes[256];
+	size_t length;
+
+	skiplist = skiplist_create( SKIPLIST_PROPERTY_NONE, 5, int_compare, int_fprintf, NULL );
+	if( !skiplist )
+		return -1;
+	for( i = 0; i < 10; ++i )
+		if( skiplist_insert( skiplist, i ) )
+			return -1;
+
+	if( skiplist_options_init( &options ) )
+		return -1;
+	options.compare = int_compare;
+	options.print = int_fprintf;
+
+	if( skiplist_save( NULL, 1, SKIPLIST_SAVE_VALUES ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_save( skiplist, -1, SKIPLIST_SAVE_VALUES ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_save( skiplist, 1, 0x80 ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+
+	if( skiplist_load( -1, &options, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_load( 0, NULL, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+
+	fp = tmpfile();
+	truncated = tmpfile();
+	if( !fp || !truncated )
+		return -1;
+
+	/* An empty file isn't a snapshot. */
+	if( skiplist_load( fileno( fp ), &options, &err ) || err != SKIPLIST_ERROR_INVALID_SNAPSHOT )
+		return -1;
+
+	if( skiplist_save( skiplist, fileno( fp ), SKIPLIST_SAVE_LEVELS ) )
+		return -1;
+	if( lseek( fileno( fp ), 0, SEEK_SET ) )
+		return -1;
+	length = (size_t) read( fileno( fp ), bytes, sizeof( bytes ) );
+
+	/* A snapshot missing its last record. */
+	if( write( fileno( truncated ), bytes, length - 1 ) != (ssize_t) (length - 1) )
+		return -1;
+	if( lseek( fileno( truncated ), 0, SEEK_SET ) )
+		return -1;
+	if( skiplist_load( fileno( truncated ), &options, &err ) || err != SKIPLIST_ERROR_INVALID_SNAPSHOT )
+		return -1;
+
+	/* Options still need to be valid. */
+	if( lseek( fileno( fp ), 0, SEEK_SET ) )
+		return -1;
+	options.compare = NULL;
+	if( skiplist_load( fileno( fp ), &options, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	options.compare = int_compare;
+
+	/* A damaged magic number. */
+	bytes[0] = 'X';
+	if( lseek( fileno( truncated ), 0, SEEK_SET ) )
+		return -1;
+	if( write( fileno( truncated ), bytes, length ) != (ssize_t) length )
+		return -1;
+	if( lseek( fileno( truncated ), 0, SEEK_SET ) )
+		return -1;
+	if( skiplist_load( fileno( truncated ), &options, &err ) || err != SKIPLIST_ERROR_INVALID_SNAPSHOT )
+		return -1;
+
+	fclose( truncated );
+	fclose( fp );
+	skiplist_destroy( skiplist );
+
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for skiplist_at_index.
+ */
+static int abuse_skiplist_at_index( void )
+{
+	skiplist_t *skiplist;
+
+	skiplist = skiplist_create( SKIPLIST_PROPERTY_NONE, 5, int_compare, int_fprintf, NULL );
+	if( !skiplist )
+		return -1;
+
+	if( skiplist_at_index( skiplist, 0, NULL ) )
+		return -1;
+
+	if( skiplist_insert( skiplist, 1 ) )
+		return -1;
+
+	if( skiplist_at_index( NULL, 0, NULL ) )
+		return -1;
+
+	if( skiplist_at_index( skiplist, 1, NULL ) )
+		return -1;
+
+	skiplist_destroy( skiplist );
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for copying values into a buffer.
+ */
+static int abuse_skiplist_copy( void )
+{
+	uintptr_t out[4];
+	skiplist_t *skiplist;
+	skiplist_options_t options;
+	skiplist_error_t err;
+
+	skiplist = skiplist_create( SKIPLIST_PROPERTY_NONE, 5, int_compare, int_fprintf, NULL );
+	if( !skiplist )
+		return -1;
+	if( skiplist_insert( skiplist, 1 ) )
+		return -1;
+
+	if( skiplist_copy_range( NULL, 0, 1, out, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_copy_range( skiplist, 0, 1, NULL, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_copy_range( skiplist, 2, 1, out, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_copy_values_between( NULL, 0, 1, out, 4, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_copy_values_between( skiplist, 0, 1, NULL, 4, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+
+	/* Nothing is copied for an empty range or a zero count. */
+	if( skiplist_copy_values_between( skiplist, 2, 0, out, 4, &err ) || err )
+		return -1;
+	if( skiplist_copy_range( skiplist, 0, 0, out, &err ) || err )
+		return -1;
+	skiplist_destroy( skiplist );
+
+	if( skiplist_options_init( &options ) )
+		return -1;
+	options.size_estimate_log2 = 5;
+	options.print = int_fprintf;
+	options.key_type = SKIPLIST_KEY_BYTES;
+	skiplist = skiplist_create_with_options( &options, NULL );
+	if( !skiplist )
+		return -1;
+	if( skiplist_copy_values_between( skiplist, 0, 1, out, 4, &err ) || err != SKIPLIST_ERROR_NOT_SUPPORTED )
+		return -1;
+	skiplist_destroy( skiplist );
+
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for selecting many indices or quantiles.
+ */
+static int abuse_skiplist_select_many( void )
+{
+	skiplist_size_t ranks[3];
+	double quantiles[2];
+	uintptr_t out[3];
+	skiplist_t *skiplist;
+	skiplist_error_t err;
+
+	skiplist = skiplist_create( SKIPLIST_PROPERTY_NONE, 5, int_compare, int_fprintf, NULL );
+	if( !skiplist )
+		return -1;
+	if( skiplist_insert( skiplist, 1 ) || skiplist_insert( skiplist, 2 ) )
+		return -1;
+
+	ranks[0] = 0;
+	ranks[1] = 1;
+	ranks[2] = 1;
+	if( skiplist_select_many( NULL, ranks, 3, out ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_select_many( skiplist, NULL, 3, out ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_select_many( skiplist, ranks, 3, NULL ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_select_many( skiplist, NULL, 0, NULL ) != SKIPLIST_ERROR_SUCCESS )
+		return -1;
+
+	/* Out of range and out of order. */
+	ranks[2] = 2;
+	if( skiplist_select_many( skiplist, ranks, 3, out ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	ranks[0] = 1;
+	ranks[1] = 0;
+	if( skiplist_select_many( skiplist, ranks, 2, out ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+
+	quantiles[0] = 0.5;
+	quantiles[1] = 0.25;
+	if( skiplist_quantiles( skiplist, quantiles, 2, out ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_quantiles( skiplist, NULL, 2, out ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_quantile( skiplist, -0.1, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_quantile( skiplist, 1.1, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_median( NULL, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	skiplist_destroy( skiplist );
+
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for range aggregates.
+ */
+static int abuse_skiplist_range_aggregate( void )
+{
+	skiplist_t *skiplist;
+	skiplist_options_t options;
+	skiplist_error_t err;
+
+	/* Not keeping aggregates. */
+	skiplist = skiplist_create( SKIPLIST_PROPERTY_NONE, 5, int_compare, int_fprintf, NULL );
+	if( !skiplist )
+		return -1;
+	if( skiplist_range_aggregate( NULL, 0, 1, &err ) != 0 || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_range_aggregate( skiplist, 0, 1, &err ) != 0 || err != SKIPLIST_ERROR_NOT_SUPPORTED )
+		return -1;
+	skiplist_destroy( skiplist );
+
+	/* Byte string keys have no values to aggregate. */
+	if( skiplist_options_init( &options ) )
+		return -1;
+	options.size_estimate_log2 = 5;
+	options.print = int_fprintf;
+	options.key_type = SKIPLIST_KEY_BYTES;
+	options.aggregate = sum_aggregate;
+	if( skiplist_create_with_options( &options, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+
+	/* An empty range or list gives the identity. */
+	options.key_type = SKIPLIST_KEY_VALUE;
+	options.compare = int_compare;
+	options.aggregate = min_aggregate;
+	options.aggregate_identity = 12345;
+	skiplist = skiplist_create_with_options( &options, NULL );
+	if( !skiplist )
+		return -1;
+	if( skiplist_range_aggregate( skiplist, 0, 100, NULL ) != 12345 )
+		return -1;
+	if( skiplist_insert( skiplist, 7 ) || skiplist_insert( skiplist, 9 ) )
+		return -1;
+	if( skiplist_range_aggregate( skiplist, 9, 8, NULL ) != 12345 || skiplist_range_aggregate( skiplist, 10, 20, NULL ) != 12345 )
+		return -1;
+	if( skiplist_range_aggregate( skiplist, 8, 9, NULL ) != 9 || skiplist_range_aggregate( skiplist, 0, 9, NULL ) != 7 )
+		return -1;
+	skiplist_destroy( skiplist );
+
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for sampling.
+ */
+static int abuse_skiplist_sample( void )
+{
+	uintptr_t out[4];
+	skiplist_t *skiplist;
+	skiplist_rng_t rng;
+
+	if( skiplist_rng_seed( NULL, 1 ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+
+	skiplist = skiplist_create( SKIPLIST_PROPERTY_NONE, 5, int_compare, int_fprintf, NULL );
+	if( !skiplist )
+		return -1;
+
+	if( skiplist_sample( NULL, 1, NULL, 1, out ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_sample( skiplist, 0, NULL, 0, NULL ) )
+		return -1;
+
+	/* Nothing to draw from. */
+	if( skiplist_sample( skiplist, 1, NULL, 1, out ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+
+	if( skiplist_insert( skiplist, 1 ) || skiplist_insert( skiplist, 2 ) || skiplist_insert( skiplist, 3 ) )
+		return -1;
+	if( skiplist_sample( skiplist, 1, NULL, 1, NULL ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+
+	/* More than the list holds only works with replacement. */
+	if( skiplist_sample( skiplist, 4, NULL, 0, out ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_rng_seed( &rng, 0 ) || skiplist_sample( skiplist, 4, &rng, 1, out ) )
+		return -1;
+	if( skiplist_sample( skiplist, 3, &rng, 0, out ) || out[0] != 1 || out[1] != 2 || out[2] != 3 )
+		return -1;
+	skiplist_destroy( skiplist );
+
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for searching for a sorted batch of values.
+ */
+static int abuse_skiplist_contains_sorted( void )
+{
+	uintptr_t keys[2];
+	unsigned int results[2];
+	skiplist_node_t *nodes[2];
+	skiplist_t *skiplist;
+	skiplist_options_t options;
+
+	skiplist = skiplist_create( SKIPLIST_PROPERTY_NONE, 5, int_compare, int_fprintf, NULL );
+	if( !skiplist )
+		return -1;
+
+	keys[0] = 1;
+	keys[1] = 2;
+	if( skiplist_contains_sorted( NULL, keys, 2, results ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_contains_sorted( skiplist, NULL, 2, results ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_contains_sorted( skiplist, keys, 2, NULL ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_find_sorted( NULL, keys, 2, nodes ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_find_sorted( skiplist, keys, 2, NULL ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+
+	/* Out of order. */
+	keys[0] = 3;
+	if( skiplist_contains_sorted( skiplist, keys, 2, results ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_find_sorted( skiplist, keys, 2, nodes ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	skiplist_destroy( skiplist );
+
+	if( skiplist_options_init( &options ) )
+		return -1;
+	options.size_estimate_log2 = 5;
+	options.print = int_fprintf;
+	options.key_type = SKIPLIST_KEY_BYTES;
+	skiplist = skiplist_create_with_options( &options, NULL );
+	if( !skiplist )
+		return -1;
+	if( skiplist_contains_sorted( skiplist, keys, 1, results ) != SKIPLIST_ERROR_NOT_SUPPORTED )
+		return -1;
+	skiplist_destroy( skiplist );
+
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for using a list as a priority queue.
+ */
+static int abuse_skiplist_priority_queue( void )
+{
+	unsigned int i;
+	skiplist_t *skiplist;
+	skiplist_node_t *one;
+	skiplist_node_t *two;
+	skiplist_options_t options;
+	skiplist_error_t err;
+
+	skiplist = skiplist_create( SKIPLIST_PROPERTY_UNIQUE, 5, int_compare, int_fprintf, NULL );
+	if( !skiplist )
+		return -1;
+
+	if( skiplist_push( NULL, 1, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_pop_min( NULL, NULL, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_pop_min( skiplist, NULL, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+
+	/* Pushing a value already in a set gives back its node. */
+	one = skiplist_push( skiplist, 1, NULL );
+	two = skiplist_push( skiplist, 2, NULL );
+	if( !one || !two || skiplist_push( skiplist, 1, &err ) != one || err )
+		return -1;
+
+	if( skiplist_update_node( NULL, one, 3, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_update_node( skiplist, NULL, 3, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+
+	/* A set can't be given a value it already has, and is left unchanged. */
+	if( skiplist_update_node( skiplist, one, 2, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_node_value( one, NULL ) != 1 || skiplist_update_node( skiplist, one, 1, &err ) != one || err )
+		return -1;
+	if( skiplist_update_node( skiplist, one, 3, &err ) != one || err || skiplist_pop_min( skiplist, NULL, NULL ) != 2 )
+		return -1;
+	skiplist_destroy( skiplist );
+
+	if( skiplist_options_init( &options ) )
+		return -1;
+	options.size_estimate_log2 = 5;
+	options.compare = int_compare;
+	options.print = int_fprintf;
+	options.compact_percent = 0;
+
+	/* Moving onto the value of a tombstone in a set must leave the live node after it, where
+	   inserting the value again finds it. */
+	for( i = 0; i < 3; ++i )
+	{
+		options.properties = SKIPLIST_PROPERTY_UNIQUE | ( 0 == i ? SKIPLIST_PROPERTY_LAZY_DELETE :
+		                     1 == i ? SKIPLIST_PROPERTY_VERSIONED :
+		                     SKIPLIST_PROPERTY_LAZY_DELETE | SKIPLIST_PROPERTY_BACK_LINKS );
+		skiplist = skiplist_create_with_options( &options, NULL );
+		if( !skiplist )
+			return -1;
+		one = skiplist_push( skiplist, 5, NULL );
+		two = skiplist_push( skiplist, 10, NULL );
+		if( !one || !two || skiplist_insert( skiplist, 8 ) || skiplist_remove( skiplist, 8 ) )
+			return -1;
+		if( skiplist_update_node( skiplist, one, 8, &err ) != one || err || skiplist_insert( skiplist, 8 ) )
+			return -1;
+		if( skiplist_size( skiplist, NULL ) != 2 || in_order( skiplist, 2 ) )
+			return -1;
+
+		/* And moving back down onto one. */
+		if( skiplist_insert( skiplist, 9 ) || skiplist_remove( skiplist, 9 ) )
+			return -1;
+		if( skiplist_update_node( skiplist, two, 9, &err ) != two || err || skiplist_insert( skiplist, 9 ) )
+			return -1;
+		if( skiplist_size( skiplist, NULL ) != 2 || skiplist_at_index( skiplist, 1, NULL ) != 9 )
+			return -1;
+		skiplist_destroy( skiplist );
+	}
+
+	/* In a multiset, moving the tallest of several copies away, or onto a tombstoned value,
+	   leaves every value still found. Under a snapshot the old node stays as a tombstone. */
+	for( i = 0; i < 3; ++i )
+	{
+		skiplist_snapshot_t *snapshot = NULL;
+		unsigned int value;
+
+		options.properties = 0 == i ? SKIPLIST_PROPERTY_LAZY_DELETE :
+		                     1 == i ? SKIPLIST_PROPERTY_LAZY_DELETE | SKIPLIST_PROPERTY_BACK_LINKS :
+		                     SKIPLIST_PROPERTY_VERSIONED;
+		skiplist = skiplist_create_with_options( &options, NULL );
+		if( !skiplist )
+			return -1;
+		if( 2 == i && !( snapshot = skiplist_snapshot_create( skiplist, NULL ) ) )
+			return -1;
+
+		for( value = 0; value < 400; value += 4 )
+		{
+			skiplist_node_t *copies[3];
+			unsigned int tallest = 0;
+			unsigned int j;
+
+			for( j = 0; j < 3; ++j )
+			{
+				copies[j] = skiplist_push( skiplist, value, NULL );
+				if( !copies[j] )
+					return -1;
+				if( copies[j]->levels >= copies[tallest]->levels )
+					tallest = j;
+			}
+			if( skiplist_insert( skiplist, value + 1 ) || skiplist_remove( skiplist, value + 1 ) )
+				return -1;
+
+			one = skiplist_update_node( skiplist, copies[tallest], value + 2, &err );
+			if( !one || err || skiplist_update_node( skiplist, one, value + 1, &err ) == NULL || err )
+				return -1;
+			if( skiplist_contains( skiplist, value, NULL ) != 1 || skiplist_contains( skiplist, value + 1, NULL ) != 1 ||
+			    skiplist_contains( skiplist, value + 2, NULL ) != 0 )
+				return -1;
+		}
+		if( in_order( skiplist, 300 ) )
+			return -1;
+		for( value = 0; value < 400; value += 4 )
+			if( skiplist_remove( skiplist, value + 1 ) || skiplist_contains( skiplist, value + 1, NULL ) )
+				return -1;
+
+		if( snapshot && skiplist_snapshot_release( snapshot ) )
+			return -1;
+		skiplist_destroy( skiplist );
+	}
+
+	options.properties = SKIPLIST_PROPERTY_NONE;
+	options.key_type = SKIPLIST_KEY_BYTES;
+	skiplist = skiplist_create_with_options( &options, NULL );
+	if( !skiplist )
+		return -1;
+	if( skiplist_push( skiplist, 1, &err ) || err != SKIPLIST_ERROR_NOT_SUPPORTED )
+		return -1;
+	if( skiplist_insert_bytes( skiplist, "a", 1 ) )
+		return -1;
+	if( skiplist_update_node( skiplist, skiplist_begin( skiplist ), 1, &err ) || err != SKIPLIST_ERROR_NOT_SUPPORTED )
+		return -1;
+	skiplist_destroy( skiplist );
+
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for skiplist_begin.
+ */
+static int abuse_skiplist_begin( void )
+{
+	skiplist_t *skiplist;
+
+	skiplist = skiplist_create( SKIPLIST_PROPERTY_NONE, 5, int_compare, int_fprintf, NULL );
+	if( !skiplist )
+		return -1;
+
+	if( skiplist_insert( skiplist, 1 ) )
+		return -1;
+
+	if( skiplist_begin( NULL ) )
+		return -1;
+
+	skiplist_destroy( skiplist );
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for skiplist_next.
+ */
+static int abuse_skiplist_next( void )
+{
+	skiplist_t *skiplist;
+
+	skiplist = skiplist_create( SKIPLIST_PROPERTY_NONE, 5, int_compare, int_fprintf, NULL );
+	if( !skiplist )
+		return -1;
+
+	if( skiplist_insert( skiplist, 1 ) )
+		return -1;
+
+	if( skiplist_next( NULL ) )
+		return -1;
+
+	skiplist_destroy( skiplist );
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for skiplist_node_value.
+ */
+static int abuse_skiplist_node_value( void )
+{
+	if( skiplist_node_value( NULL, NULL ) )
+		return -1;
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for skiplist_size.
+ */
+static int abuse_skiplist_size( void )
+{
+	if( skiplist_size( NULL, NULL ) )
+		return -1;
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for skiplist_memory_held.
+ */
+static int abuse_skiplist_memory_held( void )
+{
+	if( skiplist_memory_held( NULL, NULL ) )
+		return -1;
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for skiplist_memory_usage.
+ */
+static int abuse_skiplist_memory_usage( void )
+{
+	skiplist_t *skiplist;
+	skiplist_memory_usage_t usage;
+
+	if( skiplist_memory_usage( NULL, &usage ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+
+	skiplist = skiplist_create( SKIPLIST_PROPERTY_NONE, 5, int_compare, int_fprintf, NULL );
+	if( !skiplist )
+		return -1;
+
+	if( skiplist_memory_usage( skiplist, NULL ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+
+	skiplist_destroy( skiplist );
+
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Confirms incorrect inputs and damaged files are handled gracefully for the file backed skiplist.
+ */
+static int abuse_skiplist_file( void )
+{
+	const char *filename = "abuse_file.skl";
+	skiplist_file_t *skiplist;
+	skiplist_error_t err;
+	FILE *fp;
+
+	if( skiplist_file_create( NULL, SKIPLIST_PROPERTY_NONE, 4, int_compare, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_file_create( filename, 2, 4, int_compare, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_file_create( filename, SKIPLIST_PROPERTY_NONE, 0, int_compare, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_file_create( filename, SKIPLIST_PROPERTY_NONE, SKIPLIST_FILE_MAX_LINKS + 1, int_compare, &err ) ||
+	    err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_file_create( filename, SKIPLIST_PROPERTY_NONE, 4, NULL, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_file_create( "no_such_directory/file.skl", SKIPLIST_PROPERTY_NONE, 4, int_compare, &err ) ||
+	    err != SKIPLIST_ERROR_OPENING_FILE )
+		return -1;
+
+	if( skiplist_file_open( NULL, 0, int_compare, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_file_open( filename, 0, NULL, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_file_open( "no_such_file.skl", 0, int_compare, &err ) || err != SKIPLIST_ERROR_OPENING_FILE )
+		return -1;
+
+	/* Files that aren't skiplists are rejected. */
+	fp = fopen( filename, "wb" );
+	if( !fp )
+		return -1;
+	fprintf( fp, "not a skiplist" );
+	fclose( fp );
+	if( skiplist_file_open( filename, 0, int_compare, &err ) || err != SKIPLIST_ERROR_INVALID_SNAPSHOT )
+		return -1;
+
+	if( skiplist_file_sync( NULL ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_file_close( NULL ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_file_insert( NULL, 0 ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_file_contains( NULL, 0, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_file_size( NULL, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_file_begin( NULL ) != skiplist_file_end() )
+		return -1;
+
+	skiplist = skiplist_file_create( filename, SKIPLIST_PROPERTY_NONE, 4, int_compare, NULL );
+	if( !skiplist )
+		return -1;
+	if( skiplist_file_at_index( skiplist, 0, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_file_insert( skiplist, 7 ) )
+		return -1;
+	if( skiplist_file_at_index( skiplist, 1, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_file_next( skiplist, 1 ) != skiplist_file_end() )
+		return -1;
+	if( skiplist_file_node_value( skiplist, 1, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_file_node_value( skiplist, (skiplist_file_offset_t) 1 << 40, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_file_node_value( NULL, skiplist_file_begin( skiplist ), &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_file_node_value( skiplist, skiplist_file_begin( skiplist ), &err ) != 7 || err )
+		return -1;
+
+	/* Pretend the file is full rather than filling it. */
+	((skiplist_file_header_t *) skiplist->base)->num_nodes = SKIPLIST_FILE_MAX_SIZE;
+	if( skiplist_file_insert( skiplist, 8 ) != SKIPLIST_ERROR_FULL || skiplist_file_insert( skiplist, 7 ) != SKIPLIST_ERROR_FULL )
+		return -1;
+	((skiplist_file_header_t *) skiplist->base)->num_nodes = 1;
+	if( skiplist_file_size( skiplist, NULL ) != 1 )
+		return -1;
+	if( skiplist_file_close( skiplist ) )
+		return -1;
+
+	remove( filename );
+
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for the map functions.
+ */
+static int abuse_skiplist_map( void )
+{
+	unsigned int payload = 0;
+	skiplist_t *skiplist;
+	skiplist_options_t options;
+	skiplist_error_t err;
+
+	if( skiplist_get( NULL, 0, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_put( NULL, 0, &payload ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_erase( NULL, 0, &payload ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_node_payload( NULL, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+
+	if( skiplist_options_init( &options ) )
+		return -1;
+	options.size_estimate_log2 = 5;
+	options.compare = int_compare;
+	options.print = int_fprintf;
+	options.payload_size = SKIPLIST_MAX_PAYLOAD_SIZE + 1;
+	if( skiplist_create_with_options( &options, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+
+	/* Lists that allow duplicates aren't maps. */
+	options.payload_size = sizeof( payload );
+	skiplist = skiplist_create_with_options( &options, NULL );
+	if( !skiplist )
+		return -1;
+	if( skiplist_put( skiplist, 0, &payload ) != SKIPLIST_ERROR_NOT_SUPPORTED )
+		return -1;
+	if( skiplist_wal_attach( skiplist, NULL ) != SKIPLIST_ERROR_NOT_SUPPORTED )
+		return -1;
+	skiplist_destroy( skiplist );
+
+	/* Neither are lists without a payload. */
+	skiplist = skiplist_create( SKIPLIST_PROPERTY_UNIQUE, 5, int_compare, int_fprintf, NULL );
+	if( !skiplist )
+		return -1;
+	if( skiplist_get( skiplist, 0, &err ) || err != SKIPLIST_ERROR_NOT_SUPPORTED )
+		return -1;
+	if( skiplist_erase( skiplist, 0, NULL ) != SKIPLIST_ERROR_NOT_SUPPORTED )
+		return -1;
+	skiplist_destroy( skiplist );
+
+	options.properties = SKIPLIST_PROPERTY_UNIQUE;
+	skiplist = skiplist_create_with_options( &options, NULL );
+	if( !skiplist )
+		return -1;
+	if( skiplist_put( skiplist, 0, NULL ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	skiplist_destroy( skiplist );
+
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for byte string keys.
+ */
+static int abuse_skiplist_bytes( void )
+{
+	FILE *fp;
+	skiplist_t *skiplist;
+	skiplist_node_t *node;
+	skiplist_options_t options;
+	size_t length;
+	unsigned int payload = 0;
+	skiplist_error_t err;
+
+	if( skiplist_insert_bytes( NULL, "a", 1 ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_contains_bytes( NULL, "a", 1, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_remove_bytes( NULL, "a", 1 ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+
+	if( skiplist_options_init( &options ) )
+		return -1;
+	options.size_estimate_log2 = 5;
+	options.print = int_fprintf;
+
+	/* Value keyed lists still need a compare function, byte keyed ones don't. */
+	if( skiplist_create_with_options( &options, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	options.key_type = (skiplist_key_type_t) 2;
+	if( skiplist_create_with_options( &options, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	options.key_type = SKIPLIST_KEY_BYTES;
+	skiplist = skiplist_create_with_options( &options, NULL );
+	if( !skiplist )
+		return -1;
+
+	if( skiplist_insert_bytes( skiplist, NULL, 1 ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_insert_bytes( skiplist, "a", SKIPLIST_MAX_KEY_SIZE + 1 ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_contains_bytes( skiplist, NULL, 1, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_remove_bytes( skiplist, NULL, 1 ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_remove_bytes( skiplist, "a", 1 ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+
+	/* Functions taking a value alone can't be used with byte string keys. */
+	if( skiplist_insert( skiplist, 0 ) != SKIPLIST_ERROR_NOT_SUPPORTED )
+		return -1;
+	if( skiplist_contains( skiplist, 0, &err ) || err != SKIPLIST_ERROR_NOT_SUPPORTED )
+		return -1;
+	if( skiplist_remove( skiplist, 0 ) != SKIPLIST_ERROR_NOT_SUPPORTED )
+		return -1;
+	if( skiplist_put( skiplist, 0, &payload ) != SKIPLIST_ERROR_NOT_SUPPORTED )
+		return -1;
+	if( skiplist_wal_attach( skiplist, NULL ) != SKIPLIST_ERROR_NOT_SUPPORTED )
+		return -1;
+	fp = tmpfile();
+	if( !fp )
+		return -1;
+	if( skiplist_save( skiplist, fileno( fp ), SKIPLIST_SAVE_VALUES ) != SKIPLIST_ERROR_NOT_SUPPORTED )
+		return -1;
+	fclose( fp );
+
+	if( skiplist_insert_bytes( skiplist, "a", 1 ) )
+		return -1;
+	node = skiplist_begin( skiplist );
+	if( skiplist_node_key( NULL, node, &length, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT || length )
+		return -1;
+	if( skiplist_node_key( skiplist, NULL, NULL, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	skiplist_destroy( skiplist );
+
+	/* Nor can the byte string functions be used with value keys. */
+	skiplist = skiplist_create( SKIPLIST_PROPERTY_UNIQUE, 5, int_compare, int_fprintf, NULL );
+	if( !skiplist )
+		return -1;
+	if( skiplist_insert_bytes( skiplist, "a", 1 ) != SKIPLIST_ERROR_NOT_SUPPORTED )
+		return -1;
+	if( skiplist_contains_bytes( skiplist, "a", 1, &err ) || err != SKIPLIST_ERROR_NOT_SUPPORTED )
+		return -1;
+	if( skiplist_remove_bytes( skiplist, "a", 1 ) != SKIPLIST_ERROR_NOT_SUPPORTED )
+		return -1;
+	if( skiplist_insert( skiplist, 1 ) )
+		return -1;
+	if( skiplist_node_key( skiplist, skiplist_begin( skiplist ), NULL, &err ) || err != SKIPLIST_ERROR_NOT_SUPPORTED )
+		return -1;
+	skiplist_destroy( skiplist );
+
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Confirms incorrect inputs and mismatched logs are handled gracefully for the write-ahead log.
+ */
+static int abuse_skiplist_wal( void )
+{
+	unsigned long records;
+	FILE *log;
+	skiplist_t *skiplist;
+	skiplist_wal_t *wal;
+	skiplist_wal_options_t options;
+	skiplist_error_t err;
+
+	if( skiplist_wal_options_init( NULL ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_wal_options_init( &options ) )
+		return -1;
+
+	log = tmpfile();
+	if( !log )
+		return -1;
+
+	if( skiplist_wal_open( -1, &options, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_wal_open( fileno( log ), NULL, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	options.sync = (skiplist_wal_sync_t) 3;
+	if( skiplist_wal_open( fileno( log ), &options, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	options.sync = SKIPLIST_WAL_SYNC_RECORDS;
+	options.sync_records = 0;
+	if( skiplist_wal_open( fileno( log ), &options, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	options.sync_records = 1;
+	options.buffer_size = SKIPLIST_WAL_MIN_BUFFER_SIZE - 1;
+	if( skiplist_wal_open( fileno( log ), &options, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	options.buffer_size = SKIPLIST_WAL_MAX_BUFFER_SIZE + 1;
+	if( skiplist_wal_open( fileno( log ), &options, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+
+	if( skiplist_wal_attach( NULL, NULL ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_wal_append( NULL, 0, 0 ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_wal_sync( NULL ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_wal_close( NULL ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+
+	skiplist = skiplist_create( SKIPLIST_PROPERTY_NONE, 5, int_compare, int_fprintf, NULL );
+	if( !skiplist )
+		return -1;
+	if( skiplist_wal_replay( NULL, fileno( log ), &records ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_wal_replay( skiplist, -1, &records ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+
+	/* An empty log replays nothing. */
+	if( skiplist_wal_replay( skiplist, fileno( log ), &records ) || records != 0 )
+		return -1;
+
+	/* A log removing a value the list doesn't hold belongs to another snapshot. */
+	if( skiplist_wal_options_init( &options ) )
+		return -1;
+	wal = skiplist_wal_open( fileno( log ), &options, NULL );
+	if( !wal )
+		return -1;
+	if( skiplist_wal_append( wal, 0, 7 ) || skiplist_wal_append( wal, 1, 8 ) || skiplist_wal_close( wal ) )
+		return -1;
+	if( lseek( fileno( log ), 0, SEEK_SET ) )
+		return -1;
+	if( skiplist_wal_replay( skiplist, fileno( log ), &records ) != SKIPLIST_ERROR_INVALID_SNAPSHOT || records != 1 )
+		return -1;
+
+	skiplist_destroy( skiplist );
+	fclose( log );
+
+	return 0;
+}
+
+/**
+ * @brief TEST_CASE - Confirms incorrect inputs are handled gracefully for persistent lists.
+ */
+static int abuse_skiplist_persistent( void )
+{
+	skiplist_persistent_t *version;
+	skiplist_error_t err;
+
+	if( skiplist_persistent_create( SKIPLIST_PROPERTY_LAZY_DELETE, 5, int_compare, &err ) ||
+	    err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_persistent_create( SKIPLIST_PROPERTY_NONE, 0, int_compare, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_persistent_create( SKIPLIST_PROPERTY_NONE, SKIPLIST_MAX_LINKS + 1, int_compare, &err ) ||
+	    err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_persistent_create( SKIPLIST_PROPERTY_NONE, 5, NULL, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+
+	if( skiplist_persistent_insert( NULL, 0, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_persistent_remove( NULL, 0, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_persistent_release( NULL ) != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_persistent_contains( NULL, 0, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_persistent_at_index( NULL, 0, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_persistent_size( NULL, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+
+	/* Removing a value that isn't there and indexing past the end both fail. */
+	version = skiplist_persistent_create( SKIPLIST_PROPERTY_NONE, 5, int_compare, NULL );
+	if( !version )
+		return -1;
+	if( skiplist_persistent_remove( version, 1, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_persistent_at_index( version, 0, &err ) || err != SKIPLIST_ERROR_INVALID_INPUT )
+		return -1;
+	if( skiplist_persistent_release( version ) )
+		return -1;
+
 	return 0;
 }
 
@@ -710,19 +4198,61 @@ int main( int argc, char *argv[] )
 		TEST_CASE( pointers ),
 		TEST_CASE( duplicate_entries_allowed ),
 		TEST_CASE( duplicate_entries_disallowed ),
+		TEST_CASE( huge_pages ),
+		TEST_CASE( save_load ),
+		TEST_CASE( size_limits ),
+		TEST_CASE( file_backed ),
+		TEST_CASE( map ),
+		TEST_CASE( byte_keys ),
+		TEST_CASE( lazy_delete ),
+		TEST_CASE( copy_values ),
+		TEST_CASE( select_many ),
+		TEST_CASE( sample ),
+		TEST_CASE( contains_sorted ),
+		TEST_CASE( back_links ),
+		TEST_CASE( priority_queue ),
+		TEST_CASE( range_aggregate ),
+		TEST_CASE( mvcc_snapshots ),
+		TEST_CASE( persistent_versions ),
+		TEST_CASE( write_ahead_log ),
+		TEST_CASE( write_ahead_log_short_write ),
+		TEST_CASE( write_ahead_log_full_buffer ),
+		TEST_CASE( write_ahead_log_after_snapshot ),
+		TEST_CASE( memory_usage ),
+		TEST_CASE( stats ),
+		TEST_CASE( analyze ),
 		TEST_CASE( abuse_skiplist_create ),
+		TEST_CASE( abuse_skiplist_create_with_options ),
 		TEST_CASE( abuse_skiplist_destroy ),
 		TEST_CASE( abuse_skiplist_contains ),
 		TEST_CASE( abuse_skiplist_insert ),
 		TEST_CASE( abuse_skiplist_remove ),
+		TEST_CASE( abuse_skiplist_compact ),
+		TEST_CASE( abuse_skiplist_back_links ),
+		TEST_CASE( abuse_skiplist_priority_queue ),
+		TEST_CASE( abuse_skiplist_snapshot ),
 		TEST_CASE( abuse_skiplist_printf ),
 		TEST_CASE( abuse_skiplist_fprintf ),
 		TEST_CASE( abuse_skiplist_fprintf_filename ),
+		TEST_CASE( abuse_skiplist_analyze ),
+		TEST_CASE( abuse_skiplist_save_load ),
 		TEST_CASE( abuse_skiplist_at_index ),
+		TEST_CASE( abuse_skiplist_copy ),
+		TEST_CASE( abuse_skiplist_select_many ),
+		TEST_CASE( abuse_skiplist_sample ),
+		TEST_CASE( abuse_skiplist_contains_sorted ),
+		TEST_CASE( abuse_skiplist_range_aggregate ),
 		TEST_CASE( abuse_skiplist_begin ),
 		TEST_CASE( abuse_skiplist_next ),
 		TEST_CASE( abuse_skiplist_node_value ),
 		TEST_CASE( abuse_skiplist_size ),
+		TEST_CASE( abuse_skiplist_memory_held ),
+		TEST_CASE( abuse_skiplist_memory_usage ),
+		TEST_CASE( abuse_skiplist_file ),
+		TEST_CASE( abuse_skiplist_map ),
+		TEST_CASE( abuse_skiplist_bytes ),
+		TEST_CASE( abuse_skiplist_wal ),
+		TEST_CASE( abuse_skiplist_persistent ),
 		TEST_CASE( link_trade_off_lookup ),
 		TEST_CASE( link_trade_off_insert )
 	};
@@ -1,14 +1,37 @@
 #include <stdio.h>
 #include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "skiplist.h"
+#include "skiplist_wal.h"
+
+#ifdef SKIPLIST_STATS
+/**
+ * @brief Add @p _amount to one of a skiplist's operation counters.
+ *
+ * Counters are updated from functions taking a const skiplist as they
+ * aren't part of the skiplist's logical state.
+ */
+#define SKIPLIST_STAT_ADD( _skiplist, _counter, _amount ) \
+	(((skiplist_t *) (_skiplist))->stats._counter += (_amount))
+#else
+#define SKIPLIST_STAT_ADD( _skiplist, _counter, _amount ) ((void) 0)
+#endif
+
+/** Every property a skiplist can be created with. */
+#define SKIPLIST_PROPERTY_ALL                                                                                  \
+	(SKIPLIST_PROPERTY_UNIQUE | SKIPLIST_PROPERTY_LAZY_DELETE | SKIPLIST_PROPERTY_VERSIONED |                  \
+	 SKIPLIST_PROPERTY_BACK_LINKS)
 
 /**
  * @brief Count the number of leading zeros in the given number.
  *
- * @param [in] n  The number to count the leading zeros for.
+ * @param [in] n  The number to count the leading zeros for, which must not be 0.
  *
  * @return The number of leading zeros in 'n'.
  */
@@ -54,600 +77,4083 @@ static unsigned int skiplist_rng_gen_u32( skiplist_rng_t *rng )
 	return (rng->m_z << 16) + rng->m_w;
 }
 
-static skiplist_node_t *skiplist_node_allocate( unsigned int levels )
+/**
+ * @brief Returns the number of bytes of version stamps in every node of @p skiplist.
+ */
+static size_t skiplist_node_versions_size( const skiplist_t *skiplist )
 {
-	skiplist_node_t *node;
-
-	/* Allocate a node with space at the end for each level link.
-	   levels - 1 is used as one link is included in the size of skiplist_node_t. */
-	node = malloc( sizeof( skiplist_node_t ) + sizeof( skiplist_link_t ) * (levels - 1) );
-
-	return node;
+	return (skiplist->properties & SKIPLIST_PROPERTY_VERSIONED) ? sizeof( skiplist_node_versions_t ) : 0;
 }
 
-static void skiplist_node_deallocate( skiplist_node_t *node )
+/**
+ * @brief Returns the number of bytes of back link in every node of @p skiplist.
+ */
+static size_t skiplist_node_back_link_size( const skiplist_t *skiplist )
 {
-	assert( node );
-
-	free( node );
+	return (skiplist->properties & SKIPLIST_PROPERTY_BACK_LINKS) ? sizeof( skiplist_node_t * ) : 0;
 }
 
-static void skiplist_node_init( skiplist_node_t *node, unsigned int levels, uintptr_t value )
+/**
+ * @brief Returns the number of bytes of link aggregates in a node of @p skiplist with @p levels links.
+ */
+static size_t skiplist_node_aggregates_size( const skiplist_t *skiplist, unsigned int levels )
 {
-	assert( node );
-	assert( levels > 0 && levels <= SKIPLIST_MAX_LINKS );
-
-	node->levels = levels;
-	node->value = value;
+	return NULL != skiplist->aggregate ? sizeof( uintptr_t ) * levels : 0;
 }
 
-static skiplist_node_t *skiplist_node_create( unsigned int levels, uintptr_t value )
+/**
+ * @brief Returns the number of bytes needed for a node of @p skiplist with @p levels links.
+ */
+static size_t skiplist_node_size( const skiplist_t *skiplist, unsigned int levels )
 {
-	skiplist_node_t *node;
-
-	node = skiplist_node_allocate( levels );
-
-	if( NULL != node )
-	{
-		skiplist_node_init( node, levels, value );
-	}
-
-	return node;
+	/* Allocate a node with space at the end for each level link, followed by the payload, the
+	   version stamps, the back link and the link aggregates. levels - 1 is used as one link is
+	   included in the size of skiplist_node_t. */
+	return sizeof( skiplist_node_t ) + sizeof( skiplist_link_t ) * (levels - 1) + skiplist->payload_size +
+	       skiplist_node_versions_size( skiplist ) + skiplist_node_back_link_size( skiplist ) +
+	       skiplist_node_aggregates_size( skiplist, levels );
 }
 
-static skiplist_t *skiplist_allocate( unsigned int size_estimate_log2 )
+/**
+ * @brief Returns the payload of @p node, which directly follows its last link.
+ */
+static unsigned char *skiplist_node_payload_bytes( const skiplist_node_t *node )
 {
-	skiplist_t *skiplist;
+	return (unsigned char *) node + offsetof( skiplist_node_t, link ) + sizeof( skiplist_link_t ) * node->levels;
+}
 
-	/* number of links - 1 to take into account the 1 sized array at the end. */
-	skiplist = malloc( sizeof( skiplist_t ) + sizeof( skiplist_link_t ) * (size_estimate_log2 - 1) );
+/**
+ * @brief A byte string key being searched for in a SKIPLIST_KEY_BYTES skiplist.
+ */
+typedef struct skiplist_bytes_t
+{
+	const unsigned char *bytes;
+	size_t length;
+} skiplist_bytes_t;
 
-	return skiplist;
+/**
+ * @brief Returns the number of bytes a node needs to hold a byte string key of @p length bytes.
+ *
+ * Keys are stored after the payload as their length followed by their bytes.
+ */
+static size_t skiplist_node_key_size( const skiplist_t *skiplist, size_t length )
+{
+	return SKIPLIST_KEY_BYTES == skiplist->key_type ? sizeof( size_t ) + length : 0;
 }
 
-static void skiplist_deallocate( skiplist_t *skiplist )
+/**
+ * @brief Returns where a node's byte string key is stored.
+ */
+static unsigned char *skiplist_node_key_bytes( const skiplist_t *skiplist, const skiplist_node_t *node )
 {
-	assert( skiplist );
-
-	free( skiplist );
+	return skiplist_node_payload_bytes( node ) + skiplist->payload_size + skiplist_node_versions_size( skiplist ) +
+	       skiplist_node_back_link_size( skiplist ) + skiplist_node_aggregates_size( skiplist, node->levels );
 }
 
-void skiplist_init( skiplist_t *skiplist,
-                    skiplist_properties_t properties, unsigned int size_estimate_log2,
-                    skiplist_compare_pfn compare, skiplist_fprintf_pfn print )
+/**
+ * @brief Returns the version stamps of a node of a SKIPLIST_PROPERTY_VERSIONED skiplist.
+ */
+static skiplist_node_versions_t skiplist_node_get_versions( const skiplist_t *skiplist, const skiplist_node_t *node )
 {
-	assert( skiplist );
+	skiplist_node_versions_t versions;
 
-	skiplist_rng_init( &skiplist->rng );
-	skiplist->properties = properties;
-	skiplist->compare = compare;
-	skiplist->print = print;
-	skiplist->num_nodes = 0;
-	skiplist->head.levels = size_estimate_log2;
-	memset( skiplist->head.link, 0, sizeof( skiplist_link_t ) * size_estimate_log2 );
+	/* The payload before them can leave the stamps unaligned. */
+	memcpy( &versions, skiplist_node_payload_bytes( node ) + skiplist->payload_size, sizeof( versions ) );
+
+	return versions;
 }
 
-static skiplist_t *skiplist_create_clean( skiplist_properties_t properties, unsigned int size_estimate_log2,
-                                          skiplist_compare_pfn compare, skiplist_fprintf_pfn print )
+/**
+ * @brief Sets the version stamps of a node of a SKIPLIST_PROPERTY_VERSIONED skiplist.
+ */
+static void skiplist_node_set_versions( const skiplist_t *skiplist, skiplist_node_t *node,
+                                        const skiplist_node_versions_t *versions )
 {
-	skiplist_t *skiplist;
+	memcpy( skiplist_node_payload_bytes( node ) + skiplist->payload_size, versions, sizeof( *versions ) );
+}
 
-	skiplist = skiplist_allocate( size_estimate_log2 );
+/**
+ * @brief Returns the node before @p node on the bottom level of a SKIPLIST_PROPERTY_BACK_LINKS skiplist, NULL for the first.
+ */
+static skiplist_node_t *skiplist_node_get_prev( const skiplist_t *skiplist, const skiplist_node_t *node )
+{
+	skiplist_node_t *prev;
 
-	if( NULL != skiplist )
-	{
-		skiplist_init( skiplist, properties, size_estimate_log2, compare, print );
-	}
+	memcpy( &prev, skiplist_node_payload_bytes( node ) + skiplist->payload_size + skiplist_node_versions_size( skiplist ),
+	        sizeof( prev ) );
 
-	return skiplist;
+	return prev;
 }
 
-static skiplist_error_t skiplist_create_check_clean( skiplist_properties_t properties, unsigned int size_estimate_log2,
-                                                     skiplist_compare_pfn compare, skiplist_fprintf_pfn print,
-                                                     skiplist_error_t * const error )
+/**
+ * @brief Record @p prev as the node before @p node on the bottom level, or as the tail when @p node is NULL.
+ *
+ * The head is recorded as NULL, it isn't a node callers can see.
+ */
+static void skiplist_set_prev( skiplist_t *skiplist, skiplist_node_t *node, skiplist_node_t *prev )
 {
-	if( size_estimate_log2 <= 0 )
+	if( prev == &skiplist->head )
 	{
-		return SKIPLIST_ERROR_INVALID_INPUT;
+		prev = NULL;
 	}
 
-	if( size_estimate_log2 > SKIPLIST_MAX_LINKS )
+	if( NULL == node )
 	{
-		return SKIPLIST_ERROR_INVALID_INPUT;
+		skiplist->tail = prev;
 	}
-
-	if( NULL == compare )
+	else if( skiplist->properties & SKIPLIST_PROPERTY_BACK_LINKS )
 	{
-		return SKIPLIST_ERROR_INVALID_INPUT;
+		memcpy( skiplist_node_payload_bytes( node ) + skiplist->payload_size + skiplist_node_versions_size( skiplist ),
+		        &prev, sizeof( prev ) );
 	}
+}
 
-	if( NULL == print )
+/**
+ * @brief Returns where the link aggregates of @p node are stored.
+ *
+ * The head has no payload, versions or back link, its aggregates directly
+ * follow its links at the end of the skiplist_t allocation.
+ */
+static unsigned char *skiplist_node_aggregates_bytes( const skiplist_t *skiplist, const skiplist_node_t *node )
+{
+	if( node == &skiplist->head )
 	{
-		return SKIPLIST_ERROR_INVALID_INPUT;
+		return skiplist_node_payload_bytes( node );
 	}
 
-	if( SKIPLIST_PROPERTY_NONE != properties && SKIPLIST_PROPERTY_UNIQUE != properties )
-	{
-		return SKIPLIST_ERROR_INVALID_INPUT;
-	}
+	return skiplist_node_payload_bytes( node ) + skiplist->payload_size + skiplist_node_versions_size( skiplist ) +
+	       skiplist_node_back_link_size( skiplist );
+}
 
-	(void) error;
+/**
+ * @brief Returns the aggregate of the nodes skipped by the link of @p node on @p level.
+ */
+static uintptr_t skiplist_node_get_aggregate( const skiplist_t *skiplist, const skiplist_node_t *node,
+                                              unsigned int level )
+{
+	uintptr_t aggregate;
 
-	return SKIPLIST_ERROR_SUCCESS;
+	/* The payload before them can leave the aggregates unaligned. */
+	memcpy( &aggregate, skiplist_node_aggregates_bytes( skiplist, node ) + sizeof( uintptr_t ) * level,
+	        sizeof( aggregate ) );
+
+	return aggregate;
 }
 
-skiplist_t *skiplist_create( skiplist_properties_t properties, unsigned int size_estimate_log2,
-                             skiplist_compare_pfn compare, skiplist_fprintf_pfn print,
-                             skiplist_error_t * const error )
+/**
+ * @brief Sets the aggregate of the nodes skipped by the link of @p node on @p level.
+ */
+static void skiplist_node_set_aggregate( const skiplist_t *skiplist, skiplist_node_t *node, unsigned int level,
+                                         uintptr_t aggregate )
 {
-	skiplist_t *skiplist = NULL;
-	skiplist_error_t err;
+	memcpy( skiplist_node_aggregates_bytes( skiplist, node ) + sizeof( uintptr_t ) * level, &aggregate,
+	        sizeof( aggregate ) );
+}
 
-	err = skiplist_create_check_clean( properties, size_estimate_log2, compare, print, error );
+/**
+ * @brief Returns the length of a node's byte string key.
+ */
+static size_t skiplist_node_key_length( const skiplist_t *skiplist, const skiplist_node_t *node )
+{
+	size_t length;
 
-	if( SKIPLIST_ERROR_SUCCESS == err )
-	{
-		skiplist = skiplist_create_clean( properties, size_estimate_log2, compare, print );
+	/* The payload before it can leave the length unaligned. */
+	memcpy( &length, skiplist_node_key_bytes( skiplist, node ), sizeof( length ) );
 
-		if( NULL == skiplist )
-		{
-			err = SKIPLIST_ERROR_OUT_OF_MEMORY;
-		}
-	}
+	return length;
+}
 
-	if( NULL != error )
+/**
+ * @brief Returns the first bytes of a key packed big endian, so comparing prefixes as integers orders them like memcmp().
+ */
+static uintptr_t skiplist_bytes_prefix( const skiplist_bytes_t *key )
+{
+	uintptr_t prefix = 0;
+	size_t i;
+
+	for( i = 0; i < sizeof( uintptr_t ); ++i )
 	{
-		*error = err;
+		prefix = (prefix << 8) | (i < key->length ? key->bytes[i] : 0);
 	}
 
-	return skiplist;
+	return prefix;
 }
 
-static skiplist_error_t skiplist_destroy_check_clean( skiplist_t *skiplist )
+/**
+ * @brief The compare function of SKIPLIST_KEY_BYTES skiplists, which orders the key prefixes held in the values.
+ */
+static int skiplist_prefix_compare( const uintptr_t a, const uintptr_t b )
 {
-	if( NULL == skiplist )
+	return a < b ? -1 : a > b;
+}
+
+/**
+ * @brief Compare the value of @p node with @p value, and then its byte string key with @p key if the values are equal.
+ *
+ * @p key is NULL for SKIPLIST_KEY_VALUE skiplists. For SKIPLIST_KEY_BYTES
+ * skiplists @p value is the prefix of @p key, so the bytes only need to be
+ * compared when the prefixes are equal.
+ */
+static int skiplist_node_compare( const skiplist_t *skiplist, const skiplist_node_t *node, uintptr_t value,
+                                  const skiplist_bytes_t *key )
+{
+	int comparison = skiplist->compare( node->value, value );
+
+	if( 0 == comparison && NULL != key )
 	{
-		return SKIPLIST_ERROR_INVALID_INPUT;
+		const unsigned char *bytes = skiplist_node_key_bytes( skiplist, node ) + sizeof( size_t );
+		size_t length = skiplist_node_key_length( skiplist, node );
+		size_t shorter = length < key->length ? length : key->length;
+		size_t skip = shorter < sizeof( uintptr_t ) ? shorter : sizeof( uintptr_t );
+
+		/* Equal prefixes mean the bytes they hold are equal too. */
+		if( shorter > skip )
+		{
+			comparison = memcmp( bytes + skip, key->bytes + skip, shorter - skip );
+		}
+		if( 0 == comparison )
+		{
+			comparison = (length > key->length) - (length < key->length);
+		}
 	}
 
-	return SKIPLIST_ERROR_SUCCESS;
+	return comparison;
 }
 
-static void skiplist_destroy_clean( skiplist_t *skiplist )
+static skiplist_node_t *skiplist_node_allocate( skiplist_t *skiplist, unsigned int levels, size_t key_length )
 {
-	skiplist_node_t *cur;
-	skiplist_node_t *next;
+	skiplist_node_t *node;
+	size_t size;
 
-	for( cur = skiplist->head.link[0].next; NULL != cur; cur = next )
+	size = skiplist_node_size( skiplist, levels ) + skiplist_node_key_size( skiplist, key_length );
+
+	if( NULL != skiplist->arena )
 	{
-		next = cur->link[0].next;
-		skiplist_node_deallocate( cur );
+		node = skiplist_arena_allocate( skiplist->arena, size );
+	}
+	else
+	{
+		node = malloc( size );
+		if( NULL != node )
+		{
+			skiplist->malloc_bytes += size;
+		}
 	}
 
-	skiplist_deallocate( skiplist );
+	if( NULL != node )
+	{
+		SKIPLIST_STAT_ADD( skiplist, bytes_allocated, size );
+		SKIPLIST_STAT_ADD( skiplist, level_histogram[levels - 1], 1 );
+	}
+
+	return node;
 }
 
-skiplist_error_t skiplist_destroy( skiplist_t *skiplist )
+static void skiplist_node_deallocate( skiplist_t *skiplist, skiplist_node_t *node )
 {
-	skiplist_error_t err;
+	size_t size;
 
-	err = skiplist_destroy_check_clean( skiplist );
+	assert( node );
 
-	if( SKIPLIST_ERROR_SUCCESS == err )
+	size = skiplist_node_size( skiplist, node->levels );
+	if( SKIPLIST_KEY_BYTES == skiplist->key_type )
 	{
-		skiplist_destroy_clean( skiplist );
+		size += skiplist_node_key_size( skiplist, skiplist_node_key_length( skiplist, node ) );
 	}
 
-	return err;
-}
+	SKIPLIST_STAT_ADD( skiplist, bytes_freed, size );
+	SKIPLIST_STAT_ADD( skiplist, level_histogram[node->levels - 1], -1 );
 
-static skiplist_error_t skiplist_contains_check_clean( const skiplist_t *skiplist, uintptr_t value )
-{
-	if( NULL == skiplist )
+	if( NULL != skiplist->arena )
 	{
-		return SKIPLIST_ERROR_INVALID_INPUT;
+		skiplist_arena_deallocate( skiplist->arena, node, size );
+	}
+	else
+	{
+		skiplist->malloc_bytes -= size;
+		free( node );
 	}
+}
 
-	(void) value;
+static void skiplist_node_init( skiplist_node_t *node, unsigned int levels, uintptr_t value )
+{
+	assert( node );
+	assert( levels > 0 && levels <= SKIPLIST_MAX_LINKS );
 
-	return SKIPLIST_ERROR_SUCCESS;
+	node->levels = levels;
+	node->flags = 0;
+	node->value = value;
 }
 
-static unsigned int skiplist_contains_clean( const skiplist_t *skiplist, uintptr_t value )
+/**
+ * @brief Returns non-zero if @p node has been removed from a SKIPLIST_PROPERTY_LAZY_DELETE skiplist.
+ */
+static int skiplist_node_is_tombstone( const skiplist_node_t *node )
 {
-	unsigned int i;
-	const skiplist_node_t *cur;
+	return 0 != (node->flags & SKIPLIST_NODE_TOMBSTONE);
+}
 
-	cur = &skiplist->head;
+/**
+ * @brief Returns non-zero if a snapshot of @p skiplist at @p version sees @p node.
+ *
+ * That's if it was inserted at or before @p version and not removed by then.
+ */
+static int skiplist_node_is_visible( const skiplist_t *skiplist, const skiplist_node_t *node, skiplist_version_t version )
+{
+	skiplist_node_versions_t versions = skiplist_node_get_versions( skiplist, node );
 
-	assert( cur->levels > 0 );
+	return versions.inserted <= version && (!skiplist_node_is_tombstone( node ) || versions.removed > version);
+}
 
-	for( i = cur->levels; i-- != 0; )
+/**
+ * @brief Recomputes the aggregate of the link of @p node on @p level from the level below.
+ *
+ * A link's aggregate covers the same nodes as its width, those after @p node up to and
+ * including the one it points at, leaving out tombstones. The links below must be up to date.
+ */
+static void skiplist_aggregate_fix( skiplist_t *skiplist, skiplist_node_t *node, unsigned int level )
+{
+	skiplist_node_t *end = node->link[level].next;
+	skiplist_node_t *cur;
+	uintptr_t aggregate = skiplist->aggregate_identity;
+
+	if( 0 == level )
 	{
-		for( ; NULL != cur->link[i].next; cur = cur->link[i].next )
+		if( NULL != end && !skiplist_node_is_tombstone( end ) )
 		{
-			int comparison = skiplist->compare( cur->link[i].next->value, value );
-			if( comparison > 0 )
-			{
-				break;
-			}
-			else if( 0 == comparison )
-			{
-				return 1;
-			}
+			aggregate = NULL != skiplist->aggregate_lift ? skiplist->aggregate_lift( end->value ) : end->value;
+		}
+	}
+	else
+	{
+		for( cur = node; cur != end; cur = cur->link[level - 1].next )
+		{
+			aggregate = skiplist->aggregate( aggregate, skiplist_node_get_aggregate( skiplist, cur, level - 1 ) );
 		}
 	}
 
-	return 0;
+	skiplist_node_set_aggregate( skiplist, node, level, aggregate );
 }
 
-unsigned int skiplist_contains( const skiplist_t *skiplist, uintptr_t value, skiplist_error_t * const error )
+/**
+ * @brief Recomputes the aggregates of the links on a search path after a node on it changed.
+ *
+ * @param [in] skiplist  The skiplist to update.
+ * @param [in] update    The last node before the changed one on each level, as filled in by a search.
+ * @param [in] node      The changed node if it's still linked, so its own links are recomputed too,
+ *                       or NULL if it was unlinked.
+ */
+static void skiplist_aggregate_fix_path( skiplist_t *skiplist, skiplist_node_t *update[], skiplist_node_t *node )
 {
-	unsigned int contains = 0;
-	skiplist_error_t err;
-
-	err = skiplist_contains_check_clean( skiplist, value );
+	unsigned int i;
 
-	if( SKIPLIST_ERROR_SUCCESS == err )
+	if( NULL == skiplist->aggregate )
 	{
-		contains = skiplist_contains_clean( skiplist, value );
+		return;
 	}
 
-	if( NULL != error )
+	/* Bottom up, as each level is recomputed from the one below. */
+	for( i = 0; i < skiplist->head.levels; ++i )
 	{
-		*error = err;
+		if( NULL != node && i < node->levels )
+		{
+			skiplist_aggregate_fix( skiplist, node, i );
+		}
+		skiplist_aggregate_fix( skiplist, update[i], i );
 	}
-
-	return contains;
 }
 
-static unsigned int skiplist_compute_node_level( skiplist_t *skiplist )
+/**
+ * @brief Recomputes every link aggregate of @p skiplist, in O(N).
+ */
+static void skiplist_aggregate_rebuild( skiplist_t *skiplist )
 {
-	unsigned int node_levels;
-
-	/* The number of levels that we insert the node into is
-	   calculated using the number of leading zeros in a random number.
+	skiplist_node_t *cur;
+	unsigned int i;
 
-	   Assuming each bit is equally likely to be a 0 or a 1 then
-	   each successive level will have half the probability of being
-	   chosen than the previous one. This gives us the correct
-	   distribution for O(log(n)) insertion. */
-	node_levels = clz( skiplist_rng_gen_u32( &skiplist->rng ) ) + 1;
-	if( node_levels > skiplist->head.levels )
+	if( NULL == skiplist->aggregate )
 	{
-		node_levels = skiplist->head.levels;
+		return;
 	}
 
-	return node_levels;
+	for( i = 0; i < skiplist->head.levels; ++i )
+	{
+		for( cur = &skiplist->head; NULL != cur; cur = cur->link[i].next )
+		{
+			skiplist_aggregate_fix( skiplist, cur, i );
+		}
+	}
 }
 
-static void skiplist_find_insert_path( skiplist_t *skiplist, uintptr_t value,
-                                       skiplist_node_t *path[], unsigned int distances[] )
+/**
+ * @brief Allocate and initialize a node, copying in @p key for SKIPLIST_KEY_BYTES skiplists.
+ */
+static skiplist_node_t *skiplist_node_create( skiplist_t *skiplist, unsigned int levels, uintptr_t value,
+                                              const skiplist_bytes_t *key )
 {
-	unsigned int i;
-	skiplist_node_t *cur;
+	skiplist_node_t *node;
 
-	/* 'value' will be positioned before the first node that is greater than 'value'.
-	   Start searching from the highest level, this level spans the most number of
-	   nodes per next pointer. */
-	cur = &skiplist->head;
-
-	assert( cur->levels > 0 );
+	node = skiplist_node_allocate( skiplist, levels, NULL != key ? key->length : 0 );
 
-	for( i = cur->levels; i-- != 0; )
+	if( NULL != node )
 	{
-		assert( i < cur->levels );
-		distances[i] = 1;
+		skiplist_node_init( node, levels, value );
+		memset( skiplist_node_payload_bytes( node ), 0,
+		        skiplist->payload_size + skiplist_node_versions_size( skiplist ) + skiplist_node_back_link_size( skiplist ) +
+		        skiplist_node_aggregates_size( skiplist, levels ) );
 
-		/* Search through the current level in the skiplist... */
-		while( NULL != cur->link[i].next )
+		if( NULL != key )
 		{
-			unsigned int j;
-			assert( i < cur->levels );
-
-			/* ... until we find a value greater
-			   than our input value... */
-			if( skiplist->compare( cur->link[i].next->value, value ) > 0 )
+			unsigned char *key_bytes = skiplist_node_key_bytes( skiplist, node );
+			memcpy( key_bytes, &key->length, sizeof( size_t ) );
+			if( 0 != key->length )
 			{
-				/* ... then move on to the lower levels. */
-				break;
+				memcpy( key_bytes + sizeof( size_t ), key->bytes, key->length );
 			}
+		}
+	}
 
-			/* Increment the distance from previous nodes... */
-			for( j = i + 1; j < skiplist->head.levels; ++j )
-			{
-				distances[j] += cur->link[i].width;
-			}
+	return node;
+}
 
-			/* ... and advance the next pointer. */
-			cur = cur->link[i].next;
+static skiplist_t *skiplist_allocate( const skiplist_options_t *options )
+{
+	skiplist_t *skiplist;
+	skiplist_arena_t arena;
+	skiplist_arena_t *arena_copy;
+	size_t size;
+
+	/* number of links - 1 to take into account the 1 sized array at the end. */
+	size = sizeof( skiplist_t ) + sizeof( skiplist_link_t ) * (options->size_estimate_log2 - 1);
+	if( NULL != options->aggregate )
+	{
+		/* The head's link aggregates follow its links. */
+		size += sizeof( uintptr_t ) * options->size_estimate_log2;
+	}
+
+	if( SKIPLIST_MEMORY_HUGE_PAGES == options->memory_backend )
+	{
+		/* The arena and the skiplist header are both carved from the arena's first region,
+		   so the whole skiplist can be released by destroying the arena. */
+		skiplist_arena_init( &arena, options->region_size, options->numa_node );
+
+		skiplist = NULL;
+		arena_copy = skiplist_arena_allocate( &arena, sizeof( arena ) );
+		if( NULL != arena_copy )
+		{
+			skiplist = skiplist_arena_allocate( &arena, size );
 		}
 
-		/* Store the path to the insertion point, so we can update all list
-		   entries if the value needs to be inserted. */
-		path[i] = cur;
+		if( NULL == skiplist )
+		{
+			skiplist_arena_destroy( &arena );
+		}
+		else
+		{
+			*arena_copy = arena;
+			skiplist->arena = arena_copy;
+			skiplist->malloc_bytes = 0;
+		}
+	}
+	else
+	{
+		skiplist = malloc( size );
+
+		if( NULL != skiplist )
+		{
+			skiplist->arena = NULL;
+			skiplist->malloc_bytes = size;
+		}
 	}
+
+	return skiplist;
 }
 
-static skiplist_error_t skiplist_insert_check_clean( skiplist_t *skiplist, uintptr_t value )
+static void skiplist_deallocate( skiplist_t *skiplist )
 {
-	if( NULL == skiplist )
+	assert( skiplist );
+
+	if( NULL != skiplist->arena )
 	{
-		return SKIPLIST_ERROR_INVALID_INPUT;
+		skiplist_arena_destroy( skiplist->arena );
+	}
+	else
+	{
+		free( skiplist );
 	}
+}
 
-	(void) value;
+void skiplist_init( skiplist_t *skiplist, const skiplist_options_t *options )
+{
+	assert( skiplist );
+	assert( options );
 
-	return SKIPLIST_ERROR_SUCCESS;
+	skiplist_rng_init( &skiplist->rng );
+	skiplist->properties = options->properties;
+	skiplist->compare = options->compare;
+	skiplist->print = options->print;
+	skiplist->num_nodes = 0;
+	skiplist->tombstones = 0;
+	skiplist->compact_percent = options->compact_percent;
+	skiplist->version = 0;
+	skiplist->snapshots = NULL;
+	skiplist->tail = NULL;
+	skiplist->payload_size = options->payload_size;
+	skiplist->key_type = options->key_type;
+	if( SKIPLIST_KEY_BYTES == options->key_type )
+	{
+		skiplist->compare = skiplist_prefix_compare;
+	}
+	skiplist->wal = NULL;
+	skiplist->aggregate = options->aggregate;
+	skiplist->aggregate_lift = options->aggregate_lift;
+	skiplist->aggregate_identity = options->aggregate_identity;
+	skiplist->head.levels = options->size_estimate_log2;
+	skiplist->head.flags = 0;
+#ifdef SKIPLIST_STATS
+	memset( &skiplist->stats, 0, sizeof( skiplist->stats ) );
+#endif
+	memset( skiplist->head.link, 0, sizeof( skiplist_link_t ) * options->size_estimate_log2 );
+	skiplist_aggregate_rebuild( skiplist );
 }
 
-static skiplist_error_t skiplist_insert_clean( skiplist_t *skiplist, uintptr_t value )
+static skiplist_t *skiplist_create_clean( const skiplist_options_t *options )
 {
-	skiplist_node_t *update[SKIPLIST_MAX_LINKS];
-	unsigned int distances[SKIPLIST_MAX_LINKS];
-	skiplist_error_t err = SKIPLIST_ERROR_SUCCESS;
+	skiplist_t *skiplist;
 
-	skiplist_find_insert_path( skiplist, value, update, distances );
+	skiplist = skiplist_allocate( options );
 
-	/* Insert the new value, unless this is a skiplist set that already contains it. */
-	if( SKIPLIST_PROPERTY_NONE == skiplist->properties ||
-	    update[0] == &skiplist->head || skiplist->compare( update[0]->value, value ) )
+	if( NULL != skiplist )
 	{
-		unsigned int node_levels;
-		skiplist_node_t *new_node;
+		skiplist_init( skiplist, options );
+	}
 
-		node_levels = skiplist_compute_node_level( skiplist );
-		new_node = skiplist_node_create( node_levels, value );
+	return skiplist;
+}
 
-		if( NULL == new_node )
-		{
-			err = SKIPLIST_ERROR_OUT_OF_MEMORY;
-		}
-		else
-		{
-			unsigned int i;
+static skiplist_error_t skiplist_create_check_clean( const skiplist_options_t *options,
+                                                     skiplist_error_t * const error )
+{
+	if( NULL == options )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
 
-			/* Increment the width of each link that jumps over this node. */
-			for( i = skiplist->head.levels; i-- != node_levels; )
-			{
-				++update[i]->link[i].width;
-			}
+	if( options->size_estimate_log2 <= 0 )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
 
-			/* Insert the node into each level of the skiplist. */
-			for( i = node_levels; i-- != 0; )
-			{
-				skiplist_link_t *update_link = &update[i]->link[i];
-				skiplist_link_t *new_link = &new_node->link[i];
+	if( options->size_estimate_log2 > SKIPLIST_MAX_LINKS )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
 
-				/* Update the link widths using the distance we are from the previous level. */
-				new_link->width = 1 + update_link->width - distances[i];
-				update_link->width = distances[i];
+	if( SKIPLIST_KEY_VALUE != options->key_type && SKIPLIST_KEY_BYTES != options->key_type )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
 
-				/* Update the next pointers. */
-				new_link->next = update_link->next;
-				update_link->next = new_node;
-			}
+	if( NULL == options->compare && SKIPLIST_KEY_VALUE == options->key_type )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
 
-			/* Increment node counter. */
-			++skiplist->num_nodes;
-		}
+	if( NULL == options->print )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
 	}
 
-	return err;
+	if( options->properties & ~(skiplist_properties_t) SKIPLIST_PROPERTY_ALL )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( SKIPLIST_MEMORY_MALLOC != options->memory_backend &&
+	    SKIPLIST_MEMORY_HUGE_PAGES != options->memory_backend )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( options->numa_node < -1 )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( options->payload_size > SKIPLIST_MAX_PAYLOAD_SIZE )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( NULL != options->aggregate && SKIPLIST_KEY_BYTES == options->key_type )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	(void) error;
+
+	return SKIPLIST_ERROR_SUCCESS;
 }
 
-skiplist_error_t skiplist_insert( skiplist_t *skiplist, uintptr_t value )
+skiplist_error_t skiplist_options_init( skiplist_options_t *options )
+{
+	if( NULL == options )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	memset( options, 0, sizeof( *options ) );
+	options->properties = SKIPLIST_PROPERTY_NONE;
+	options->size_estimate_log2 = SKIPLIST_MAX_LINKS;
+	options->compare = NULL;
+	options->print = NULL;
+	options->memory_backend = SKIPLIST_MEMORY_MALLOC;
+	options->numa_node = -1;
+	options->region_size = 0;
+	options->payload_size = 0;
+	options->key_type = SKIPLIST_KEY_VALUE;
+	options->compact_percent = 100;
+	options->aggregate = NULL;
+	options->aggregate_lift = NULL;
+	options->aggregate_identity = 0;
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+skiplist_t *skiplist_create_with_options( const skiplist_options_t *options, skiplist_error_t * const error )
 {
+	skiplist_t *skiplist = NULL;
 	skiplist_error_t err;
 
-	err = skiplist_insert_check_clean( skiplist, value );
+	err = skiplist_create_check_clean( options, error );
 
 	if( SKIPLIST_ERROR_SUCCESS == err )
 	{
-		err = skiplist_insert_clean( skiplist, value );
+		skiplist = skiplist_create_clean( options );
+
+		if( NULL == skiplist )
+		{
+			err = SKIPLIST_ERROR_OUT_OF_MEMORY;
+		}
 	}
 
-	return err;
+	if( NULL != error )
+	{
+		*error = err;
+	}
+
+	return skiplist;
 }
 
-static void skiplist_find_remove_path( skiplist_t *skiplist, uintptr_t value, skiplist_node_t *path[] )
+skiplist_t *skiplist_create( skiplist_properties_t properties, unsigned int size_estimate_log2,
+                             skiplist_compare_pfn compare, skiplist_fprintf_pfn print,
+                             skiplist_error_t * const error )
 {
-	unsigned int i;
-	skiplist_node_t *cur;
+	skiplist_options_t options;
 
-	/* Find the path to a node that contains 'value'. */
-	cur = &skiplist->head;
+	skiplist_options_init( &options );
+	options.properties = properties;
+	options.size_estimate_log2 = size_estimate_log2;
+	options.compare = compare;
+	options.print = print;
 
-	assert( cur->levels > 0 );
+	return skiplist_create_with_options( &options, error );
+}
 
-	for( i = cur->levels; i-- != 0; )
+static skiplist_error_t skiplist_destroy_check_clean( skiplist_t *skiplist )
+{
+	if( NULL == skiplist )
 	{
-		assert( i < cur->levels );
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
 
-		/* Search through the current level in the skiplist... */
-		while( NULL != cur->link[i].next )
-		{
-			assert( i < cur->levels );
+	return SKIPLIST_ERROR_SUCCESS;
+}
 
-			/* ... until we find a value greater
-			   than or equal to our input value... */
-			if( skiplist->compare( cur->link[i].next->value, value ) >= 0 )
-			{
-				/* ... then move on to the lower levels. */
-				break;
-			}
+static void skiplist_destroy_clean( skiplist_t *skiplist )
+{
+	skiplist_node_t *cur;
+	skiplist_node_t *next;
+	skiplist_snapshot_t *snapshot;
 
-			/* ... and advance the next pointer. */
-			cur = cur->link[i].next;
+	/* Snapshots still open can only be released now. */
+	for( snapshot = skiplist->snapshots; NULL != snapshot; snapshot = snapshot->older )
+	{
+		snapshot->skiplist = NULL;
+	}
+
+	/* Nodes carved from an arena are released along with the arena. */
+	if( NULL == skiplist->arena )
+	{
+		for( cur = skiplist->head.link[0].next; NULL != cur; cur = next )
+		{
+			next = cur->link[0].next;
+			skiplist_node_deallocate( skiplist, cur );
 		}
+	}
 
-		/* Store the path to the node before the node we need to remove.
-		   These pointers need updating to point to the node after the one being removed. */
-		path[i] = cur;
+	skiplist_deallocate( skiplist );
+}
+
+skiplist_error_t skiplist_destroy( skiplist_t *skiplist )
+{
+	skiplist_error_t err;
+
+	err = skiplist_destroy_check_clean( skiplist );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		skiplist_destroy_clean( skiplist );
 	}
+
+	return err;
 }
 
-static skiplist_error_t skiplist_remove_check_clean( skiplist_t *skiplist, uintptr_t value )
+static skiplist_error_t skiplist_contains_check_clean( const skiplist_t *skiplist, uintptr_t value )
 {
 	if( NULL == skiplist )
 	{
 		return SKIPLIST_ERROR_INVALID_INPUT;
 	}
 
+	/* Byte string keys can't be found from a value alone. */
+	if( SKIPLIST_KEY_VALUE != skiplist->key_type )
+	{
+		return SKIPLIST_ERROR_NOT_SUPPORTED;
+	}
+
 	(void) value;
 
 	return SKIPLIST_ERROR_SUCCESS;
 }
 
-static skiplist_error_t skiplist_remove_clean( skiplist_t *skiplist, uintptr_t value )
+/**
+ * @brief Search for @p value, and also @p key if it isn't NULL.
+ */
+static unsigned int skiplist_contains_clean( const skiplist_t *skiplist, uintptr_t value, const skiplist_bytes_t *key )
 {
-	skiplist_node_t *update[SKIPLIST_MAX_LINKS];
-	skiplist_node_t *remove;
-	skiplist_error_t err = SKIPLIST_ERROR_SUCCESS;
+	unsigned int i;
+	const skiplist_node_t *cur;
 
-	assert( skiplist );
+	cur = &skiplist->head;
 
-	/* Find all levels that span over the node to remove. */
-	skiplist_find_remove_path( skiplist, value, update );
+	assert( cur->levels > 0 );
 
-	remove = update[0]->link[0].next;
-	if( NULL == remove || skiplist->compare( remove->value, value ) )
+	SKIPLIST_STAT_ADD( skiplist, lookups, 1 );
+
+	for( i = cur->levels; i-- != 0; )
 	{
-		err = SKIPLIST_ERROR_INVALID_INPUT;
+		for( ; NULL != cur->link[i].next; cur = cur->link[i].next )
+		{
+			int comparison = skiplist_node_compare( skiplist, cur->link[i].next, value, key );
+			SKIPLIST_STAT_ADD( skiplist, lookup_comparisons, 1 );
+			if( 0 == comparison && !skiplist_node_is_tombstone( cur->link[i].next ) )
+			{
+				return 1;
+			}
+			/* Stop in front of tombstones too, a taller one can follow shorter live nodes. */
+			if( comparison >= 0 )
+			{
+				break;
+			}
+			SKIPLIST_STAT_ADD( skiplist, nodes_visited[i], 1 );
+		}
 	}
-	else
+
+	/* Step over the tombstones holding the value to a live node holding it, if there's one. */
+	for( cur = cur->link[0].next; NULL != cur && skiplist_node_is_tombstone( cur ); cur = cur->link[0].next )
 	{
-		unsigned int i;
+		SKIPLIST_STAT_ADD( skiplist, lookup_comparisons, 1 );
+		if( 0 != skiplist_node_compare( skiplist, cur, value, key ) )
+		{
+			return 0;
+		}
+	}
 
-		for( i = skiplist->head.levels; i-- != 0; )
+	SKIPLIST_STAT_ADD( skiplist, lookup_comparisons, NULL != cur );
+	return NULL != cur && 0 == skiplist_node_compare( skiplist, cur, value, key );
+}
+
+unsigned int skiplist_contains( const skiplist_t *skiplist, uintptr_t value, skiplist_error_t * const error )
+{
+	unsigned int contains = 0;
+	skiplist_error_t err;
+
+	err = skiplist_contains_check_clean( skiplist, value );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		contains = skiplist_contains_clean( skiplist, value, NULL );
+	}
+
+	if( NULL != error )
+	{
+		*error = err;
+	}
+
+	return contains;
+}
+
+static skiplist_error_t skiplist_contains_sorted_check_clean( const skiplist_t *skiplist, const uintptr_t *keys,
+                                                              skiplist_size_t n, const void *out )
+{
+	skiplist_size_t j;
+
+	if( NULL == skiplist )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( n > 0 && ( NULL == keys || NULL == out ) )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	/* Byte string keys can't be found from a value alone. */
+	if( SKIPLIST_KEY_VALUE != skiplist->key_type )
+	{
+		return SKIPLIST_ERROR_NOT_SUPPORTED;
+	}
+
+	for( j = 1; j < n; ++j )
+	{
+		if( skiplist->compare( keys[j - 1], keys[j] ) > 0 )
+		{
+			return SKIPLIST_ERROR_INVALID_INPUT;
+		}
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+/**
+ * @brief Search for @p n ascending @p keys, writing whether each was found to @p results and the
+ *        first live node holding it, or NULL, to @p nodes. Either may be NULL.
+ */
+static void skiplist_contains_sorted_clean( const skiplist_t *skiplist, const uintptr_t *keys, skiplist_size_t n,
+                                            unsigned int *results, skiplist_node_t **nodes )
+{
+	const skiplist_node_t *path[SKIPLIST_MAX_LINKS];
+	const skiplist_node_t *cur;
+	const skiplist_node_t *found;
+	skiplist_size_t j;
+	unsigned int i;
+	unsigned int start;
+
+	/* Keep the last node less than the previous key on every level. */
+	for( i = 0; i < skiplist->head.levels; ++i )
+	{
+		path[i] = &skiplist->head;
+	}
+
+	for( j = 0; j < n; ++j )
+	{
+		SKIPLIST_STAT_ADD( skiplist, lookups, 1 );
+
+		/* Climb the path until its next node isn't less than the key, which is as far up as
+		   the gap from the previous key reaches. The path is unchanged from there up. */
+		for( start = 0; start < skiplist->head.levels; ++start )
+		{
+			SKIPLIST_STAT_ADD( skiplist, lookup_comparisons, 1 );
+			if( NULL == path[start]->link[start].next ||
+			    skiplist->compare( path[start]->link[start].next->value, keys[j] ) >= 0 )
+			{
+				break;
+			}
+		}
+
+		/* Every level falls short only when the top one does, carry on along it. */
+		cur = path[start < skiplist->head.levels ? start : start - 1];
+
+		for( i = start; i-- != 0; )
+		{
+			while( NULL != cur->link[i].next )
+			{
+				SKIPLIST_STAT_ADD( skiplist, lookup_comparisons, 1 );
+				if( skiplist->compare( cur->link[i].next->value, keys[j] ) >= 0 )
+				{
+					break;
+				}
+				SKIPLIST_STAT_ADD( skiplist, nodes_visited[i], 1 );
+				cur = cur->link[i].next;
+			}
+
+			path[i] = cur;
+		}
+
+		/* Any nodes holding the key come next, step over those that are tombstones. */
+		found = NULL;
+		for( cur = path[0]->link[0].next; NULL != cur && 0 == skiplist->compare( cur->value, keys[j] );
+		     cur = cur->link[0].next )
+		{
+			if( !skiplist_node_is_tombstone( cur ) )
+			{
+				found = cur;
+				break;
+			}
+		}
+
+		if( NULL != results )
+		{
+			results[j] = NULL != found;
+		}
+		if( NULL != nodes )
+		{
+			/* The nodes belong to the caller's list, it's only const here so both
+			   wrappers can share the search. */
+			nodes[j] = (skiplist_node_t *) found;
+		}
+	}
+}
+
+skiplist_error_t skiplist_contains_sorted( const skiplist_t *skiplist, const uintptr_t *keys, skiplist_size_t n,
+                                           unsigned int *results )
+{
+	skiplist_error_t err;
+
+	err = skiplist_contains_sorted_check_clean( skiplist, keys, n, results );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		skiplist_contains_sorted_clean( skiplist, keys, n, results, NULL );
+	}
+
+	return err;
+}
+
+skiplist_error_t skiplist_find_sorted( skiplist_t *skiplist, const uintptr_t *keys, skiplist_size_t n,
+                                       skiplist_node_t **nodes )
+{
+	skiplist_error_t err;
+
+	err = skiplist_contains_sorted_check_clean( skiplist, keys, n, nodes );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		skiplist_contains_sorted_clean( skiplist, keys, n, NULL, nodes );
+	}
+
+	return err;
+}
+
+static unsigned int skiplist_compute_node_level( skiplist_t *skiplist )
+{
+	unsigned int node_levels;
+	unsigned int bits;
+
+	/* The number of levels that we insert the node into is
+	   calculated using the number of leading zeros in a random number.
+
+	   Assuming each bit is equally likely to be a 0 or a 1 then
+	   each successive level will have half the probability of being
+	   chosen than the previous one. This gives us the correct
+	   distribution for O(log(n)) insertion.
+
+	   Each random number only holds 32 levels worth of bits, so while they're
+	   all zero keep drawing more for lists with more levels than that. */
+	node_levels = 1;
+	do
+	{
+		bits = skiplist_rng_gen_u32( &skiplist->rng );
+		node_levels += 0 == bits ? 32 : clz( bits );
+	} while( 0 == bits && node_levels <= skiplist->head.levels );
+
+	if( node_levels > skiplist->head.levels )
+	{
+		node_levels = skiplist->head.levels;
+	}
+
+	return node_levels;
+}
+
+static void skiplist_find_insert_path( skiplist_t *skiplist, uintptr_t value, const skiplist_bytes_t *key,
+                                       skiplist_node_t *path[], skiplist_size_t distances[] )
+{
+	unsigned int i;
+	skiplist_node_t *cur;
+
+	/* 'value' will be positioned before the first node that is greater than 'value'.
+	   Start searching from the highest level, this level spans the most number of
+	   nodes per next pointer. */
+	cur = &skiplist->head;
+
+	assert( cur->levels > 0 );
+
+	for( i = cur->levels; i-- != 0; )
+	{
+		assert( i < cur->levels );
+		distances[i] = 1;
+
+		/* Search through the current level in the skiplist... */
+		while( NULL != cur->link[i].next )
+		{
+			unsigned int j;
+			assert( i < cur->levels );
+
+			/* ... until we find a value greater
+			   than our input value... */
+			SKIPLIST_STAT_ADD( skiplist, insert_comparisons, 1 );
+			if( skiplist_node_compare( skiplist, cur->link[i].next, value, key ) > 0 )
+			{
+				/* ... then move on to the lower levels. */
+				break;
+			}
+			SKIPLIST_STAT_ADD( skiplist, nodes_visited[i], 1 );
+
+			/* Increment the distance from previous nodes... */
+			for( j = i + 1; j < skiplist->head.levels; ++j )
+			{
+				distances[j] += cur->link[i].width;
+			}
+
+			/* ... and advance the next pointer. */
+			cur = cur->link[i].next;
+		}
+
+		/* Store the path to the insertion point, so we can update all list
+		   entries if the value needs to be inserted. */
+		path[i] = cur;
+	}
+}
+
+static skiplist_error_t skiplist_insert_check_clean( skiplist_t *skiplist, uintptr_t value )
+{
+	if( NULL == skiplist )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( SKIPLIST_KEY_VALUE != skiplist->key_type )
+	{
+		return SKIPLIST_ERROR_NOT_SUPPORTED;
+	}
+
+	(void) value;
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+/**
+ * @brief Link @p new_node in after the nodes found by skiplist_find_insert_path().
+ */
+static void skiplist_link_node( skiplist_t *skiplist, skiplist_node_t *new_node, skiplist_node_t *update[],
+                                const skiplist_size_t distances[] )
+{
+	unsigned int i;
+
+	/* Increment the width of each link that jumps over this node. */
+	for( i = skiplist->head.levels; i-- != new_node->levels; )
+	{
+		++update[i]->link[i].width;
+	}
+
+	/* Insert the node into each level of the skiplist. */
+	for( i = new_node->levels; i-- != 0; )
+	{
+		skiplist_link_t *update_link = &update[i]->link[i];
+		skiplist_link_t *new_link = &new_node->link[i];
+
+		/* Update the link widths using the distance we are from the previous level. */
+		new_link->width = 1 + update_link->width - distances[i];
+		update_link->width = distances[i];
+
+		/* Update the next pointers. */
+		new_link->next = update_link->next;
+		update_link->next = new_node;
+	}
+	skiplist_set_prev( skiplist, new_node, update[0] );
+	skiplist_set_prev( skiplist, new_node->link[0].next, new_node );
+	skiplist_aggregate_fix_path( skiplist, update, new_node );
+
+	/* Increment node counter. */
+	++skiplist->num_nodes;
+}
+
+/**
+ * @brief Create a node for @p value and link it in after the nodes found by skiplist_find_insert_path().
+ *
+ * @return The new node, NULL if it couldn't be allocated.
+ */
+static skiplist_node_t *skiplist_insert_node( skiplist_t *skiplist, uintptr_t value, const skiplist_bytes_t *key,
+                                              skiplist_node_t *update[], const skiplist_size_t distances[] )
+{
+	unsigned int node_levels;
+	skiplist_node_t *new_node;
+
+	node_levels = skiplist_compute_node_level( skiplist );
+	new_node = skiplist_node_create( skiplist, node_levels, value, key );
+
+	if( NULL != new_node )
+	{
+		if( skiplist->properties & SKIPLIST_PROPERTY_VERSIONED )
+		{
+			skiplist_node_versions_t versions;
+
+			versions.inserted = ++skiplist->version;
+			versions.removed = 0;
+			skiplist_node_set_versions( skiplist, new_node, &versions );
+		}
+
+		skiplist_link_node( skiplist, new_node, update, distances );
+	}
+
+	return new_node;
+}
+
+/**
+ * @brief Insert @p value, along with @p key if it isn't NULL.
+ *
+ * @p node is set to the new node, or the node already holding the value in a
+ * skiplist set, if it isn't NULL.
+ */
+static skiplist_error_t skiplist_insert_clean( skiplist_t *skiplist, uintptr_t value, const skiplist_bytes_t *key,
+                                               skiplist_node_t **node )
+{
+	skiplist_node_t *update[SKIPLIST_MAX_LINKS];
+	skiplist_size_t distances[SKIPLIST_MAX_LINKS];
+	skiplist_node_t *new_node = NULL;
+	skiplist_error_t err = SKIPLIST_ERROR_SUCCESS;
+
+	SKIPLIST_STAT_ADD( skiplist, inserts, 1 );
+
+	skiplist_find_insert_path( skiplist, value, key, update, distances );
+
+	/* Insert the new value, unless this is a skiplist set that already contains it. */
+	SKIPLIST_STAT_ADD( skiplist, insert_comparisons, update[0] != &skiplist->head );
+	if( !(skiplist->properties & SKIPLIST_PROPERTY_UNIQUE) || update[0] == &skiplist->head ||
+	    skiplist_node_is_tombstone( update[0] ) || skiplist_node_compare( skiplist, update[0], value, key ) )
+	{
+		/* Another node would overflow the widths and the count. */
+		if( skiplist->num_nodes >= SKIPLIST_MAX_SIZE )
+		{
+			err = SKIPLIST_ERROR_FULL;
+		}
+		else if( NULL == (new_node = skiplist_insert_node( skiplist, value, key, update, distances )) )
+		{
+			err = SKIPLIST_ERROR_OUT_OF_MEMORY;
+		}
+		else if( NULL != skiplist->wal )
+		{
+			err = skiplist_wal_append( skiplist->wal, 0, value );
+		}
+	}
+	else
+	{
+		new_node = update[0];
+	}
+
+	if( NULL != node )
+	{
+		*node = new_node;
+	}
+
+	return err;
+}
+
+skiplist_error_t skiplist_insert( skiplist_t *skiplist, uintptr_t value )
+{
+	skiplist_error_t err;
+
+	err = skiplist_insert_check_clean( skiplist, value );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		err = skiplist_insert_clean( skiplist, value, NULL, NULL );
+	}
+
+	return err;
+}
+
+static void skiplist_find_remove_path( skiplist_t *skiplist, uintptr_t value, const skiplist_bytes_t *key,
+                                       skiplist_node_t *path[] )
+{
+	unsigned int i;
+	skiplist_node_t *cur;
+
+	/* Find the path to a node that contains 'value'. */
+	cur = &skiplist->head;
+
+	assert( cur->levels > 0 );
+
+	for( i = cur->levels; i-- != 0; )
+	{
+		assert( i < cur->levels );
+
+		/* Search through the current level in the skiplist... */
+		while( NULL != cur->link[i].next )
+		{
+			assert( i < cur->levels );
+
+			/* ... until we find a value greater
+			   than or equal to our input value... */
+			SKIPLIST_STAT_ADD( skiplist, remove_comparisons, 1 );
+			if( skiplist_node_compare( skiplist, cur->link[i].next, value, key ) >= 0 )
+			{
+				/* ... then move on to the lower levels. */
+				break;
+			}
+			SKIPLIST_STAT_ADD( skiplist, nodes_visited[i], 1 );
+
+			/* ... and advance the next pointer. */
+			cur = cur->link[i].next;
+		}
+
+		/* Store the path to the node before the node we need to remove.
+		   These pointers need updating to point to the node after the one being removed. */
+		path[i] = cur;
+	}
+}
+
+static skiplist_error_t skiplist_remove_check_clean( skiplist_t *skiplist, uintptr_t value )
+{
+	if( NULL == skiplist )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( SKIPLIST_KEY_VALUE != skiplist->key_type )
+	{
+		return SKIPLIST_ERROR_NOT_SUPPORTED;
+	}
+
+	(void) value;
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+/**
+ * @brief Find the node to remove for @p value, and @p key if it isn't NULL.
+ *
+ * Tombstones holding the value are stepped over, update[] is moved past them
+ * so it still holds the last node before the returned node on every level.
+ *
+ * @return The first live node holding the value, NULL if there isn't one.
+ */
+static skiplist_node_t *skiplist_find_remove_node( skiplist_t *skiplist, uintptr_t value,
+                                                   const skiplist_bytes_t *key, skiplist_node_t *update[] )
+{
+	skiplist_node_t *remove;
+	unsigned int i;
+
+	/* Find all levels that span over the node to remove. */
+	skiplist_find_remove_path( skiplist, value, key, update );
+
+	remove = update[0]->link[0].next;
+	while( NULL != remove && skiplist_node_is_tombstone( remove ) &&
+	       0 == skiplist_node_compare( skiplist, remove, value, key ) )
+	{
+		for( i = 0; i < remove->levels; ++i )
+		{
+			update[i] = remove;
+		}
+		remove = remove->link[0].next;
+	}
+
+	SKIPLIST_STAT_ADD( skiplist, remove_comparisons, NULL != remove );
+	if( NULL != remove && skiplist_node_compare( skiplist, remove, value, key ) )
+	{
+		remove = NULL;
+	}
+
+	return remove;
+}
+
+/**
+ * @brief Returns non-zero if no open snapshot of @p skiplist can see the tombstone @p node.
+ */
+static int skiplist_tombstone_is_unreachable( const skiplist_t *skiplist, const skiplist_node_t *node,
+                                              const skiplist_snapshot_t *oldest )
+{
+	/* Snapshots only see tombstones removed after their version. */
+	return NULL == oldest || skiplist_node_get_versions( skiplist, node ).removed <= oldest->version;
+}
+
+/**
+ * @brief Unlink and free every tombstone no open snapshot can see in a single pass over the bottom level.
+ *
+ * Link widths already leave tombstones out, so the link replacing a pair of
+ * links around a tombstone is as wide as the two added together.
+ */
+static void skiplist_compact_clean( skiplist_t *skiplist )
+{
+	skiplist_node_t *last[SKIPLIST_MAX_LINKS];
+	skiplist_node_t *cur;
+	skiplist_node_t *next;
+	const skiplist_snapshot_t *oldest;
+	unsigned int i;
+
+	for( i = 0; i < skiplist->head.levels; ++i )
+	{
+		last[i] = &skiplist->head;
+	}
+
+	for( oldest = skiplist->snapshots; NULL != oldest && NULL != oldest->older; oldest = oldest->older )
+	{
+	}
+
+	for( cur = skiplist->head.link[0].next; NULL != cur && 0 != skiplist->tombstones; cur = next )
+	{
+		next = cur->link[0].next;
+
+		if( skiplist_node_is_tombstone( cur ) && skiplist_tombstone_is_unreachable( skiplist, cur, oldest ) )
+		{
+			for( i = 0; i < cur->levels; ++i )
+			{
+				last[i]->link[i].next = cur->link[i].next;
+				last[i]->link[i].width += cur->link[i].width;
+				if( NULL != skiplist->aggregate )
+				{
+					skiplist_node_set_aggregate( skiplist, last[i], i,
+					                             skiplist->aggregate( skiplist_node_get_aggregate( skiplist, last[i], i ),
+					                                                  skiplist_node_get_aggregate( skiplist, cur, i ) ) );
+				}
+			}
+			skiplist_set_prev( skiplist, next, last[0] );
+
+			skiplist_node_deallocate( skiplist, cur );
+			--skiplist->tombstones;
+		}
+		else
+		{
+			for( i = 0; i < cur->levels; ++i )
+			{
+				last[i] = cur;
+			}
+		}
+	}
+}
+
+/**
+ * @brief Unlink the live node @p remove, the node after the nodes in update[], without freeing it.
+ */
+static void skiplist_unlink_node( skiplist_t *skiplist, skiplist_node_t *update[], skiplist_node_t *remove )
+{
+	unsigned int i;
+
+	for( i = skiplist->head.levels; i-- != 0; )
+	{
+		skiplist_link_t *update_link = &update[i]->link[i];
+		skiplist_link_t *remove_link = &remove->link[i];
+
+		/* This level will either connect to the node after the removed node or span over it.
+		   If it spans over the removed node just decrement the width of the link, if it
+		   connects then update the next pointer and sum the link widths. */
+		--update_link->width;
+		if( update_link->next == remove )
+		{
+			update_link->next = remove_link->next;
+			update_link->width += remove_link->width;
+		}
+	}
+	skiplist_set_prev( skiplist, remove->link[0].next, update[0] );
+	skiplist_aggregate_fix_path( skiplist, update, NULL );
+
+	/* Decrement node counter. */
+	--skiplist->num_nodes;
+}
+
+/**
+ * @brief Delete @p remove, the node after the nodes found by skiplist_find_remove_node().
+ *
+ * SKIPLIST_PROPERTY_LAZY_DELETE and SKIPLIST_PROPERTY_VERSIONED skiplists only
+ * mark the node as a tombstone, compacting the list once the tombstones pass
+ * compact_percent, otherwise the node is unlinked and freed. Versioned lists
+ * with open snapshots wait for them to be released instead of compacting.
+ */
+static void skiplist_delete_node( skiplist_t *skiplist, skiplist_node_t *update[], skiplist_node_t *remove )
+{
+	unsigned int i;
+
+	if( skiplist->properties & (SKIPLIST_PROPERTY_LAZY_DELETE | SKIPLIST_PROPERTY_VERSIONED) )
+	{
+		/* Every link on the path spans over or onto the node, so each loses it from its width. */
+		for( i = skiplist->head.levels; i-- != 0; )
+		{
+			--update[i]->link[i].width;
+		}
+
+		if( skiplist->properties & SKIPLIST_PROPERTY_VERSIONED )
+		{
+			skiplist_node_versions_t versions = skiplist_node_get_versions( skiplist, remove );
+
+			versions.removed = ++skiplist->version;
+			skiplist_node_set_versions( skiplist, remove, &versions );
+		}
+
+		remove->flags |= SKIPLIST_NODE_TOMBSTONE;
+		++skiplist->tombstones;
+		--skiplist->num_nodes;
+		skiplist_aggregate_fix_path( skiplist, update, NULL );
+
+		if( 0 != skiplist->compact_percent && NULL == skiplist->snapshots &&
+		    (double) skiplist->tombstones * 100.0 > (double) skiplist->compact_percent * skiplist->num_nodes )
+		{
+			skiplist_compact_clean( skiplist );
+		}
+
+		return;
+	}
+
+	skiplist_unlink_node( skiplist, update, remove );
+
+	/* Deallocate the memory for the removed node. */
+	skiplist_node_deallocate( skiplist, remove );
+}
+
+/**
+ * @brief Remove @p value, matching @p key as well if it isn't NULL.
+ */
+static skiplist_error_t skiplist_remove_clean( skiplist_t *skiplist, uintptr_t value, const skiplist_bytes_t *key )
+{
+	skiplist_node_t *update[SKIPLIST_MAX_LINKS];
+	skiplist_node_t *remove;
+	skiplist_error_t err = SKIPLIST_ERROR_SUCCESS;
+
+	assert( skiplist );
+
+	SKIPLIST_STAT_ADD( skiplist, removes, 1 );
+
+	remove = skiplist_find_remove_node( skiplist, value, key, update );
+	if( NULL == remove )
+	{
+		err = SKIPLIST_ERROR_INVALID_INPUT;
+	}
+	else
+	{
+		skiplist_delete_node( skiplist, update, remove );
+
+		if( NULL != skiplist->wal )
+		{
+			err = skiplist_wal_append( skiplist->wal, 1, value );
+		}
+	}
+
+	return err;
+}
+
+skiplist_error_t skiplist_remove( skiplist_t *skiplist, uintptr_t value )
+{
+	skiplist_error_t err;
+
+	err = skiplist_remove_check_clean( skiplist, value );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		err = skiplist_remove_clean( skiplist, value, NULL );
+	}
+
+	return err;
+}
+
+/**
+ * @brief Check @p skiplist can be used with the map functions, skiplist_get(), skiplist_put() and skiplist_erase().
+ */
+static skiplist_error_t skiplist_map_check_clean( const skiplist_t *skiplist )
+{
+	if( NULL == skiplist )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	/* Maps need somewhere to put the payload and one entry per key. */
+	if( 0 == skiplist->payload_size || !(skiplist->properties & SKIPLIST_PROPERTY_UNIQUE) ||
+	    SKIPLIST_KEY_VALUE != skiplist->key_type )
+	{
+		return SKIPLIST_ERROR_NOT_SUPPORTED;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+static void *skiplist_get_clean( const skiplist_t *skiplist, uintptr_t key )
+{
+	unsigned int i;
+	const skiplist_node_t *cur;
+
+	cur = &skiplist->head;
+
+	SKIPLIST_STAT_ADD( skiplist, lookups, 1 );
+
+	for( i = cur->levels; i-- != 0; )
+	{
+		for( ; NULL != cur->link[i].next; cur = cur->link[i].next )
+		{
+			int comparison = skiplist->compare( cur->link[i].next->value, key );
+			SKIPLIST_STAT_ADD( skiplist, lookup_comparisons, 1 );
+			if( comparison > 0 )
+			{
+				break;
+			}
+			else if( 0 == comparison && !skiplist_node_is_tombstone( cur->link[i].next ) )
+			{
+				return skiplist_node_payload_bytes( cur->link[i].next );
+			}
+			SKIPLIST_STAT_ADD( skiplist, nodes_visited[i], 1 );
+		}
+	}
+
+	return NULL;
+}
+
+void *skiplist_get( const skiplist_t *skiplist, uintptr_t key, skiplist_error_t * const error )
+{
+	void *payload = NULL;
+	skiplist_error_t err;
+
+	err = skiplist_map_check_clean( skiplist );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		payload = skiplist_get_clean( skiplist, key );
+	}
+
+	if( NULL != error )
+	{
+		*error = err;
+	}
+
+	return payload;
+}
+
+static skiplist_error_t skiplist_put_check_clean( const skiplist_t *skiplist, const void *payload )
+{
+	if( NULL == payload )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	return skiplist_map_check_clean( skiplist );
+}
+
+static skiplist_error_t skiplist_put_clean( skiplist_t *skiplist, uintptr_t key, const void *payload )
+{
+	skiplist_node_t *update[SKIPLIST_MAX_LINKS];
+	skiplist_size_t distances[SKIPLIST_MAX_LINKS];
+	skiplist_node_t *node;
+
+	skiplist_find_insert_path( skiplist, key, NULL, update, distances );
+
+	/* The last node not greater than the key holds it if the key is already in the map.
+	   A tombstone there means it was removed, so the key gets a new node after it. */
+	SKIPLIST_STAT_ADD( skiplist, insert_comparisons, update[0] != &skiplist->head );
+	if( update[0] != &skiplist->head && !skiplist_node_is_tombstone( update[0] ) &&
+	    0 == skiplist->compare( update[0]->value, key ) )
+	{
+		SKIPLIST_STAT_ADD( skiplist, updates, 1 );
+		node = update[0];
+
+		/* Open snapshots must keep seeing the old payload, so it's replaced by a new node
+		   after the old one, which is then removed. */
+		if( NULL != skiplist->snapshots )
+		{
+			/* The new node is counted before the old one is removed. */
+			if( skiplist->num_nodes >= SKIPLIST_MAX_SIZE )
+			{
+				return SKIPLIST_ERROR_FULL;
+			}
+
+			node = skiplist_insert_node( skiplist, key, NULL, update, distances );
+			if( NULL == node )
+			{
+				return SKIPLIST_ERROR_OUT_OF_MEMORY;
+			}
+			skiplist_delete_node( skiplist, update, skiplist_find_remove_node( skiplist, key, NULL, update ) );
+		}
+	}
+	else
+	{
+		SKIPLIST_STAT_ADD( skiplist, inserts, 1 );
+		if( skiplist->num_nodes >= SKIPLIST_MAX_SIZE )
+		{
+			return SKIPLIST_ERROR_FULL;
+		}
+
+		node = skiplist_insert_node( skiplist, key, NULL, update, distances );
+		if( NULL == node )
+		{
+			return SKIPLIST_ERROR_OUT_OF_MEMORY;
+		}
+	}
+
+	memcpy( skiplist_node_payload_bytes( node ), payload, skiplist->payload_size );
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+skiplist_error_t skiplist_put( skiplist_t *skiplist, uintptr_t key, const void *payload )
+{
+	skiplist_error_t err;
+
+	err = skiplist_put_check_clean( skiplist, payload );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		err = skiplist_put_clean( skiplist, key, payload );
+	}
+
+	return err;
+}
+
+static skiplist_error_t skiplist_erase_clean( skiplist_t *skiplist, uintptr_t key, void *payload )
+{
+	skiplist_node_t *update[SKIPLIST_MAX_LINKS];
+	skiplist_node_t *remove;
+
+	SKIPLIST_STAT_ADD( skiplist, removes, 1 );
+
+	remove = skiplist_find_remove_node( skiplist, key, NULL, update );
+	if( NULL == remove )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( NULL != payload )
+	{
+		memcpy( payload, skiplist_node_payload_bytes( remove ), skiplist->payload_size );
+	}
+
+	skiplist_delete_node( skiplist, update, remove );
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+skiplist_error_t skiplist_erase( skiplist_t *skiplist, uintptr_t key, void *payload )
+{
+	skiplist_error_t err;
+
+	err = skiplist_map_check_clean( skiplist );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		err = skiplist_erase_clean( skiplist, key, payload );
+	}
+
+	return err;
+}
+
+static skiplist_error_t skiplist_compact_check_clean( const skiplist_t *skiplist )
+{
+	if( NULL == skiplist )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+skiplist_error_t skiplist_compact( skiplist_t *skiplist )
+{
+	skiplist_error_t err;
+
+	err = skiplist_compact_check_clean( skiplist );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		skiplist_compact_clean( skiplist );
+	}
+
+	return err;
+}
+
+static skiplist_error_t skiplist_snapshot_create_check_clean( const skiplist_t *skiplist )
+{
+	if( NULL == skiplist )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( !(skiplist->properties & SKIPLIST_PROPERTY_VERSIONED) )
+	{
+		return SKIPLIST_ERROR_NOT_SUPPORTED;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+static skiplist_snapshot_t *skiplist_snapshot_create_clean( skiplist_t *skiplist )
+{
+	skiplist_snapshot_t *snapshot;
+
+	snapshot = (skiplist_snapshot_t *) malloc( sizeof( skiplist_snapshot_t ) );
+	if( NULL != snapshot )
+	{
+		snapshot->skiplist = skiplist;
+		snapshot->version = skiplist->version;
+		snapshot->size = skiplist->num_nodes;
+		snapshot->newer = NULL;
+		snapshot->older = skiplist->snapshots;
+		if( NULL != snapshot->older )
+		{
+			snapshot->older->newer = snapshot;
+		}
+		skiplist->snapshots = snapshot;
+	}
+
+	return snapshot;
+}
+
+skiplist_snapshot_t *skiplist_snapshot_create( skiplist_t *skiplist, skiplist_error_t * const error )
+{
+	skiplist_snapshot_t *snapshot = NULL;
+	skiplist_error_t err;
+
+	err = skiplist_snapshot_create_check_clean( skiplist );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		snapshot = skiplist_snapshot_create_clean( skiplist );
+		if( NULL == snapshot )
+		{
+			err = SKIPLIST_ERROR_OUT_OF_MEMORY;
+		}
+	}
+
+	if( NULL != error )
+	{
+		*error = err;
+	}
+
+	return snapshot;
+}
+
+static skiplist_error_t skiplist_snapshot_check_clean( const skiplist_snapshot_t *snapshot )
+{
+	if( NULL == snapshot || NULL == snapshot->skiplist )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+static skiplist_error_t skiplist_snapshot_release_check_clean( const skiplist_snapshot_t *snapshot )
+{
+	if( NULL == snapshot )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+static void skiplist_snapshot_release_clean( skiplist_snapshot_t *snapshot )
+{
+	skiplist_t *skiplist = snapshot->skiplist;
+	int oldest = NULL == snapshot->older;
+
+	/* The skiplist was destroyed first, it already forgot the snapshot. */
+	if( NULL != skiplist )
+	{
+		if( NULL != snapshot->newer )
+		{
+			snapshot->newer->older = snapshot->older;
+		}
+		else
+		{
+			skiplist->snapshots = snapshot->older;
+		}
+
+		if( NULL != snapshot->older )
+		{
+			snapshot->older->newer = snapshot->newer;
+		}
+	}
+
+	free( snapshot );
+
+	/* Releasing the oldest snapshot lets go of the tombstones only it could see. */
+	if( NULL != skiplist && oldest && 0 != skiplist->compact_percent &&
+	    (double) skiplist->tombstones * 100.0 > (double) skiplist->compact_percent * skiplist->num_nodes )
+	{
+		skiplist_compact_clean( skiplist );
+	}
+}
+
+skiplist_error_t skiplist_snapshot_release( skiplist_snapshot_t *snapshot )
+{
+	skiplist_error_t err;
+
+	err = skiplist_snapshot_release_check_clean( snapshot );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		skiplist_snapshot_release_clean( snapshot );
+	}
+
+	return err;
+}
+
+/**
+ * @brief Returns @p node, or the first node after it visible to @p snapshot.
+ */
+static skiplist_node_t *skiplist_snapshot_skip_invisible( const skiplist_snapshot_t *snapshot, skiplist_node_t *node )
+{
+	while( NULL != node && !skiplist_node_is_visible( snapshot->skiplist, node, snapshot->version ) )
+	{
+		node = node->link[0].next;
+	}
+
+	return node;
+}
+
+static skiplist_error_t skiplist_snapshot_find_check_clean( const skiplist_snapshot_t *snapshot )
+{
+	skiplist_error_t err;
+
+	err = skiplist_snapshot_check_clean( snapshot );
+
+	/* Byte string keys can't be found from a value alone. */
+	if( SKIPLIST_ERROR_SUCCESS == err && SKIPLIST_KEY_VALUE != snapshot->skiplist->key_type )
+	{
+		err = SKIPLIST_ERROR_NOT_SUPPORTED;
+	}
+
+	return err;
+}
+
+static skiplist_node_t *skiplist_snapshot_find_clean( const skiplist_snapshot_t *snapshot, uintptr_t value )
+{
+	skiplist_node_t *update[SKIPLIST_MAX_LINKS];
+	skiplist_node_t *cur;
+
+	/* Every node holding the value follows the last node before it on the bottom level,
+	   live or not, so the first of them the snapshot sees is the one to return. */
+	skiplist_find_remove_path( snapshot->skiplist, value, NULL, update );
+
+	for( cur = update[0]->link[0].next; NULL != cur && 0 == snapshot->skiplist->compare( cur->value, value );
+	     cur = cur->link[0].next )
+	{
+		if( skiplist_node_is_visible( snapshot->skiplist, cur, snapshot->version ) )
+		{
+			return cur;
+		}
+	}
+
+	return NULL;
+}
+
+skiplist_node_t *skiplist_snapshot_find( const skiplist_snapshot_t *snapshot, uintptr_t value,
+                                         skiplist_error_t * const error )
+{
+	skiplist_node_t *node = NULL;
+	skiplist_error_t err;
+
+	err = skiplist_snapshot_find_check_clean( snapshot );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		node = skiplist_snapshot_find_clean( snapshot, value );
+	}
+
+	if( NULL != error )
+	{
+		*error = err;
+	}
+
+	return node;
+}
+
+skiplist_node_t *skiplist_snapshot_begin( const skiplist_snapshot_t *snapshot )
+{
+	skiplist_node_t *begin = NULL;
+	skiplist_error_t err;
+
+	err = skiplist_snapshot_check_clean( snapshot );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		begin = skiplist_snapshot_skip_invisible( snapshot, snapshot->skiplist->head.link[0].next );
+	}
+
+	return begin;
+}
+
+skiplist_node_t *skiplist_snapshot_next( const skiplist_snapshot_t *snapshot, const skiplist_node_t *cur )
+{
+	skiplist_node_t *next = NULL;
+	skiplist_error_t err;
+
+	err = skiplist_snapshot_check_clean( snapshot );
+	if( NULL == cur )
+	{
+		err = SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		next = skiplist_snapshot_skip_invisible( snapshot, cur->link[0].next );
+	}
+
+	return next;
+}
+
+skiplist_size_t skiplist_snapshot_size( const skiplist_snapshot_t *snapshot, skiplist_error_t * const error )
+{
+	skiplist_size_t size = 0;
+	skiplist_error_t err;
+
+	err = skiplist_snapshot_check_clean( snapshot );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		size = snapshot->size;
+	}
+
+	if( NULL != error )
+	{
+		*error = err;
+	}
+
+	return size;
+}
+
+/**
+ * @brief Check @p skiplist holds byte string keys and @p key is a valid key.
+ */
+static skiplist_error_t skiplist_bytes_check_clean( const skiplist_t *skiplist, const void *key, size_t length )
+{
+	if( NULL == skiplist )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( NULL == key && 0 != length )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( length > SKIPLIST_MAX_KEY_SIZE )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( SKIPLIST_KEY_BYTES != skiplist->key_type )
+	{
+		return SKIPLIST_ERROR_NOT_SUPPORTED;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+/**
+ * @brief Wrap @p key and @p length up for the internal search functions.
+ */
+static void skiplist_bytes_init( skiplist_bytes_t *bytes, const void *key, size_t length )
+{
+	bytes->bytes = (const unsigned char *) key;
+	bytes->length = length;
+}
+
+skiplist_error_t skiplist_insert_bytes( skiplist_t *skiplist, const void *key, size_t length )
+{
+	skiplist_bytes_t bytes;
+	skiplist_error_t err;
+
+	err = skiplist_bytes_check_clean( skiplist, key, length );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		skiplist_bytes_init( &bytes, key, length );
+		err = skiplist_insert_clean( skiplist, skiplist_bytes_prefix( &bytes ), &bytes, NULL );
+	}
+
+	return err;
+}
+
+unsigned int skiplist_contains_bytes( const skiplist_t *skiplist, const void *key, size_t length,
+                                      skiplist_error_t * const error )
+{
+	unsigned int contains = 0;
+	skiplist_bytes_t bytes;
+	skiplist_error_t err;
+
+	err = skiplist_bytes_check_clean( skiplist, key, length );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		skiplist_bytes_init( &bytes, key, length );
+		contains = skiplist_contains_clean( skiplist, skiplist_bytes_prefix( &bytes ), &bytes );
+	}
+
+	if( NULL != error )
+	{
+		*error = err;
+	}
+
+	return contains;
+}
+
+skiplist_error_t skiplist_remove_bytes( skiplist_t *skiplist, const void *key, size_t length )
+{
+	skiplist_bytes_t bytes;
+	skiplist_error_t err;
+
+	err = skiplist_bytes_check_clean( skiplist, key, length );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		skiplist_bytes_init( &bytes, key, length );
+		err = skiplist_remove_clean( skiplist, skiplist_bytes_prefix( &bytes ), &bytes );
+	}
+
+	return err;
+}
+
+static skiplist_error_t skiplist_fprintf_check_clean( FILE *stream, const skiplist_t *skiplist )
+{
+	if( NULL == stream )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( NULL == skiplist )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+static void skiplist_fprintf_clean( FILE *stream, const skiplist_t *skiplist )
+{
+	const skiplist_node_t *cur;
+	unsigned int i;
+
+	assert( stream );
+	assert( skiplist );
+
+	fprintf( stream, "digraph {\n" );
+	fprintf( stream, "rankdir=\"LR\"\n" );
+	for( i = skiplist->head.levels; i-- != 0; )
+	{
+		for( cur = &skiplist->head; NULL != cur; cur = cur->link[i].next )
+		{
+			assert( i < cur->levels );
+
+			if( cur == &skiplist->head )
+			{
+				fprintf( stream, "\"HEAD\\lnum_nodes: %llu\"", (unsigned long long) skiplist->num_nodes );
+			}
+			else
+			{
+				fprintf( stream, "\"%p\\lvalue: ", (void *)cur );
+				skiplist->print( stream, cur->value );
+				fprintf( stream, "\"" );
+			}
+
+			fprintf( stream, "->" );
+
+			if( NULL == cur->link[i].next )
+			{
+				fprintf( stream, "TAIL" );
+			}
+			else
+			{
+				fprintf( stream, "\"%p\\lvalue: ", (void *)cur->link[i].next );
+				skiplist->print( stream, cur->link[i].next->value );
+				fprintf( stream, "\"" );
+			}
+
+			fprintf( stream, "[ label=\"%llu\" ];\n", (unsigned long long) cur->link[i].width );
+		}
+	}
+
+	fprintf( stream, "}\n" );
+}
+
+skiplist_error_t skiplist_fprintf( FILE *stream, const skiplist_t *skiplist )
+{
+	skiplist_error_t err;
+
+	err = skiplist_fprintf_check_clean( stream, skiplist );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		skiplist_fprintf_clean( stream, skiplist );
+	}
+
+	return err;
+}
+
+skiplist_error_t skiplist_printf( const skiplist_t *skiplist )
+{
+	return skiplist_fprintf( stdout, skiplist );
+}
+
+static skiplist_error_t skiplist_fprintf_filename_check_clean( const char *filename, const skiplist_t *skiplist )
+{
+	if( NULL == filename )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( NULL == skiplist )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+static skiplist_error_t skiplist_fprintf_filename_clean( const char *filename, const skiplist_t *skiplist )
+{
+	skiplist_error_t err = SKIPLIST_ERROR_SUCCESS;
+	FILE *fp;
+
+	fp = fopen( filename, "w" );
+	if( NULL == fp )
+	{
+		err = SKIPLIST_ERROR_OPENING_FILE;
+	}
+	else
+	{
+		skiplist_fprintf( fp, skiplist );
+		fclose( fp );
+	}
+
+	return err;
+}
+
+skiplist_error_t skiplist_fprintf_filename( const char *filename, const skiplist_t *skiplist )
+{
+	skiplist_error_t err;
+
+	err = skiplist_fprintf_filename_check_clean( filename, skiplist );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		err = skiplist_fprintf_filename_clean( filename, skiplist );
+	}
+
+	return err;
+}
+
+/**
+ * @brief Approximates the mean number of comparisons made by skiplist_contains() for an
+ *        ideal skiplist with p = 1/2, @p num_nodes nodes and a cap of @p levels levels.
+ *
+ * Every level below the top costs one comparison to overshoot plus, on average, one step
+ * for each level the searched for node doesn't reach. The top level is different when the
+ * level cap is too small for the number of nodes, a search then walks through half of the
+ * top level on average and degrades towards O(N).
+ */
+static double skiplist_analyze_expected_comparisons( skiplist_size_t num_nodes, unsigned int levels )
+{
+	unsigned int levels_used;
+	double top_span;
+	double top_nodes;
+	double expected;
+
+	if( 0 == num_nodes )
+	{
+		return 0.0;
+	}
+
+	/* The number of levels an ideal skiplist of this size would use, and the
+	   nodes a link on its top level spans. Doubles as levels may exceed the bits in a long. */
+	levels_used = 1;
+	top_span = 1.0;
+	while( levels_used < levels && top_span * 2.0 < (double) num_nodes )
+	{
+		++levels_used;
+		top_span *= 2.0;
+	}
+
+	top_nodes = num_nodes / top_span;
+	expected = 2.0 * levels_used - 3.0 + top_nodes / 2.0;
+
+	return expected < 1.0 ? 1.0 : expected;
+}
+
+static skiplist_error_t skiplist_analyze_check_clean( FILE *stream, const skiplist_t *skiplist )
+{
+	if( NULL == stream )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( NULL == skiplist )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+static void skiplist_analyze_clean( FILE *stream, const skiplist_t *skiplist )
+{
+	skiplist_size_t nodes[SKIPLIST_MAX_LINKS];
+	skiplist_size_t links[SKIPLIST_MAX_LINKS];
+	skiplist_size_t max_width[SKIPLIST_MAX_LINKS];
+	long max_width_from[SKIPLIST_MAX_LINKS];
+	double width_sum[SKIPLIST_MAX_LINKS];
+	unsigned long run[SKIPLIST_MAX_LINKS];
+	double expected_nodes;
+	double comparisons_sum;
+	long max_comparisons;
+	skiplist_size_t walked;
+	skiplist_size_t tombstones;
+	unsigned int levels_used;
+	unsigned int levels;
+	const skiplist_node_t *cur;
+	const char *separator;
+	unsigned int i;
+	long index;
+
+	assert( stream );
+	assert( skiplist );
+
+	levels = skiplist->head.levels;
+	memset( nodes, 0, sizeof( nodes ) );
+	memset( links, 0, sizeof( links ) );
+	memset( max_width, 0, sizeof( max_width ) );
+	memset( width_sum, 0, sizeof( width_sum ) );
+	memset( run, 0, sizeof( run ) );
+	comparisons_sum = 0.0;
+	max_comparisons = 0;
+	walked = 0;
+	tombstones = 0;
+	levels_used = 0;
+	for( i = 0; i < levels; ++i )
+	{
+		max_width_from[i] = -1;
+	}
+
+	/* Everything is gathered in a single pass over level 0, the head is visited with index -1.
+
+	   run[i] counts the nodes with exactly i + 1 levels seen since the last node with more
+	   levels. A search for a node with h levels steps over the run on each level from h - 1
+	   upwards, then makes one comparison to find the node and one failed comparison on each
+	   occupied level above it. The failed comparisons depend on the number of occupied levels,
+	   which isn't known until the end of the pass, so they're added afterwards.
+
+	   Tombstones are counted like any other node, searches step over them just the same, so
+	   the averages are over the nodes walked rather than num_nodes. */
+	for( cur = &skiplist->head, index = -1; NULL != cur; cur = cur->link[0].next, ++index )
+	{
+		if( cur != &skiplist->head )
+		{
+			long comparisons = 1 - (long) cur->levels;
+
+			++walked;
+			tombstones += skiplist_node_is_tombstone( cur ) ? 1 : 0;
+
+			for( i = cur->levels - 1; i < levels; ++i )
+			{
+				comparisons += run[i];
+			}
+
+			comparisons_sum += comparisons;
+			if( comparisons > max_comparisons || 0 == index )
+			{
+				max_comparisons = comparisons;
+			}
+
+			for( i = 0; i + 1 < cur->levels; ++i )
+			{
+				run[i] = 0;
+			}
+			++run[cur->levels - 1];
+
+			for( i = 0; i < cur->levels; ++i )
+			{
+				++nodes[i];
+			}
+
+			if( cur->levels > levels_used )
+			{
+				levels_used = cur->levels;
+			}
+		}
+
+		/* Links to the tail have no meaningful width. */
+		for( i = 0; i < cur->levels; ++i )
+		{
+			if( NULL != cur->link[i].next )
+			{
+				++links[i];
+				width_sum[i] += cur->link[i].width;
+				if( cur->link[i].width > max_width[i] )
+				{
+					max_width[i] = cur->link[i].width;
+					max_width_from[i] = index;
+				}
+			}
+		}
+	}
+
+	fprintf( stream, "{\"num_nodes\":%llu,\"tombstones\":%llu,\"levels\":%u,\"levels_used\":%u,",
+	         (unsigned long long) skiplist->num_nodes, (unsigned long long) tombstones, levels, levels_used );
+	fprintf( stream, "\"expected_mean_comparisons\":%.3f,", skiplist_analyze_expected_comparisons( walked, levels ) );
+	if( walked )
+	{
+		fprintf( stream, "\"actual_mean_comparisons\":%.3f,\"max_comparisons\":%ld,",
+		         comparisons_sum / walked + levels_used, max_comparisons + (long) levels_used );
+	}
+	else
+	{
+		fprintf( stream, "\"actual_mean_comparisons\":0,\"max_comparisons\":0," );
+	}
+
+	fprintf( stream, "\"per_level\":[" );
+	separator = "";
+	expected_nodes = (double) walked;
+	for( i = 0; i < levels; ++i )
+	{
+		fprintf( stream, "%s{\"level\":%u,\"nodes\":%llu,\"expected_nodes\":%.3f,\"mean_width\":%.3f,"
+		         "\"max_width\":%llu,\"max_width_from\":%ld}",
+		         separator, i, (unsigned long long) nodes[i], expected_nodes,
+		         links[i] ? width_sum[i] / links[i] : 0.0, (unsigned long long) max_width[i], max_width_from[i] );
+		separator = ",";
+		expected_nodes /= 2.0;
+	}
+	fprintf( stream, "]}\n" );
+}
+
+skiplist_error_t skiplist_analyze( FILE *stream, const skiplist_t *skiplist )
+{
+	skiplist_error_t err;
+
+	err = skiplist_analyze_check_clean( stream, skiplist );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		skiplist_analyze_clean( stream, skiplist );
+	}
+
+	return err;
+}
+
+static skiplist_error_t skiplist_fprintf_window_check_clean( FILE *stream, const skiplist_t *skiplist,
+                                                             uintptr_t low, uintptr_t high )
+{
+	if( NULL == stream )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( NULL == skiplist )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( skiplist->compare( low, high ) > 0 )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+/**
+ * @brief Prints the DOT node name of @p node.
+ */
+static void skiplist_fprintf_node_name( FILE *stream, const skiplist_t *skiplist, const skiplist_node_t *node )
+{
+	if( NULL == node )
+	{
+		fprintf( stream, "TAIL" );
+	}
+	else
+	{
+		fprintf( stream, "\"%p\\lvalue: ", (const void *)node );
+		skiplist->print( stream, node->value );
+		fprintf( stream, "\"" );
+	}
+}
+
+static void skiplist_fprintf_window_clean( FILE *stream, const skiplist_t *skiplist,
+                                           uintptr_t low, uintptr_t high, unsigned int max_nodes )
+{
+	const skiplist_node_t *cur;
+	unsigned int printed;
+	unsigned int i;
+
+	/* Find the first node that isn't less than 'low'. */
+	cur = &skiplist->head;
+	for( i = cur->levels; i-- != 0; )
+	{
+		while( NULL != cur->link[i].next && skiplist->compare( cur->link[i].next->value, low ) < 0 )
+		{
+			cur = cur->link[i].next;
+		}
+	}
+
+	fprintf( stream, "digraph {\n" );
+	fprintf( stream, "rankdir=\"LR\"\n" );
+
+	/* Print every link leaving the nodes in the window, links leaving the window
+	   end at the first node outside of it so the gaps they span are still visible. */
+	printed = 0;
+	for( cur = cur->link[0].next;
+	     NULL != cur && (0 == max_nodes || printed < max_nodes) && skiplist->compare( cur->value, high ) <= 0;
+	     cur = cur->link[0].next, ++printed )
+	{
+		for( i = 0; i < cur->levels; ++i )
+		{
+			skiplist_fprintf_node_name( stream, skiplist, cur );
+			fprintf( stream, "->" );
+			skiplist_fprintf_node_name( stream, skiplist, cur->link[i].next );
+			fprintf( stream, "[ label=\"%llu\" ];\n", (unsigned long long) cur->link[i].width );
+		}
+	}
+
+	fprintf( stream, "}\n" );
+}
+
+skiplist_error_t skiplist_fprintf_window( FILE *stream, const skiplist_t *skiplist,
+                                          uintptr_t low, uintptr_t high, unsigned int max_nodes )
+{
+	skiplist_error_t err;
+
+	err = skiplist_fprintf_window_check_clean( stream, skiplist, low, high );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		skiplist_fprintf_window_clean( stream, skiplist, low, high, max_nodes );
+	}
+
+	return err;
+}
+
+static skiplist_error_t skiplist_at_index_check_clean( const skiplist_t *skiplist, skiplist_size_t index )
+{
+	if( NULL == skiplist )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( index >= skiplist->num_nodes )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+/**
+ * @brief Returns the last node, or the head, before the live node at @p index, which must be in range.
+ */
+static const skiplist_node_t *skiplist_find_before_index( const skiplist_t *skiplist, skiplist_size_t index )
+{
+	unsigned int i;
+	skiplist_size_t remaining;
+	const skiplist_node_t *cur;
+
+	/* Indicies in the skiplist start counting from 1 due to the 1 step distance
+	   from head to the first element. So increment the index by 1. */
+	remaining = index + 1;
+	cur = &skiplist->head;
+
+	SKIPLIST_STAT_ADD( skiplist, index_lookups, 1 );
+
+	/* Stop one short of the node, at the last node before it on each level. Widths don't
+	   count tombstones, so landing on the node itself could mean landing on a tombstone
+	   just after it. */
+	for( i = cur->levels; i-- != 0; )
+	{
+		/* If we've reached the tail without finding the index or the next step is too far away
+		   try the next level down. */
+		while( NULL != cur->link[i].next && cur->link[i].width < remaining )
+		{
+			/* Otherwise, decrement the width remaining and move to the next node. */
+			SKIPLIST_STAT_ADD( skiplist, nodes_visited[i], 1 );
+			remaining -= cur->link[i].width;
+			cur = cur->link[i].next;
+		}
+	}
+
+	return cur;
+}
+
+static uintptr_t skiplist_at_index_clean( const skiplist_t *skiplist, skiplist_size_t index )
+{
+	/* Only the node itself is left, it's next on the bottom level. */
+	return skiplist_find_before_index( skiplist, index )->link[0].next->value;
+}
+
+uintptr_t skiplist_at_index( const skiplist_t *skiplist, skiplist_size_t index, skiplist_error_t * const error )
+{
+	uintptr_t value = 0;
+	skiplist_error_t err;
+
+	err = skiplist_at_index_check_clean( skiplist, index );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		value = skiplist_at_index_clean( skiplist, index );
+	}
+
+	if( NULL != error )
+	{
+		*error = err;
+	}
+
+	return value;
+}
+
+/**
+ * @brief Returns the index of quantile @p q, which must be in [0, 1], in a list of @p num_nodes nodes.
+ *
+ * Uses the nearest rank method, the smallest index with at least a fraction @p q of the
+ * nodes at or before it.
+ */
+static skiplist_size_t skiplist_quantile_index( skiplist_size_t num_nodes, double q )
+{
+	double rank = q * (double) num_nodes;
+	skiplist_size_t index = (skiplist_size_t) rank;
+
+	/* Round up, then count from 0. */
+	if( (double) index < rank )
+	{
+		++index;
+	}
+	if( index > 0 )
+	{
+		--index;
+	}
+
+	return index < num_nodes ? index : num_nodes - 1;
+}
+
+/**
+ * @brief Writes the values at @p k ascending indices to @p out, from @p ranks or, if it's NULL,
+ *        the indices of the quantiles in @p quantiles.
+ */
+static void skiplist_select_clean( const skiplist_t *skiplist, const skiplist_size_t *ranks,
+                                   const double *quantiles, skiplist_size_t k, uintptr_t *out )
+{
+	const skiplist_node_t *path[SKIPLIST_MAX_LINKS];
+	skiplist_size_t positions[SKIPLIST_MAX_LINKS];
+	const skiplist_node_t *cur;
+	skiplist_size_t position;
+	skiplist_size_t remaining;
+	skiplist_size_t j;
+	unsigned int i;
+	unsigned int start;
+
+	/* Keep the last node before the previous index on every level, and how many live
+	   nodes are at or before it, the path skiplist_find_before_index() takes to it. */
+	for( i = 0; i < skiplist->head.levels; ++i )
+	{
+		path[i] = &skiplist->head;
+		positions[i] = 0;
+	}
+
+	for( j = 0; j < k; ++j )
+	{
+		/* As in skiplist_find_before_index(), count from 1 for the step from the head. */
+		remaining = 1 + ( NULL != ranks ? ranks[j] : skiplist_quantile_index( skiplist->num_nodes, quantiles[j] ) );
+
+		SKIPLIST_STAT_ADD( skiplist, index_lookups, 1 );
+
+		/* Links further up span further, so climb until a link on the path reaches the
+		   new index. The path is unchanged from there up. */
+		for( start = 0; start < skiplist->head.levels; ++start )
+		{
+			if( NULL == path[start]->link[start].next ||
+			    positions[start] + path[start]->link[start].width >= remaining )
+			{
+				break;
+			}
+		}
+
+		/* Every level falls short only when the top one does, carry on along it. */
+		cur = path[start < skiplist->head.levels ? start : start - 1];
+		position = positions[start < skiplist->head.levels ? start : start - 1];
+
+		for( i = start; i-- != 0; )
+		{
+			while( NULL != cur->link[i].next && position + cur->link[i].width < remaining )
+			{
+				SKIPLIST_STAT_ADD( skiplist, nodes_visited[i], 1 );
+				position += cur->link[i].width;
+				cur = cur->link[i].next;
+			}
+
+			path[i] = cur;
+			positions[i] = position;
+		}
+
+		out[j] = path[0]->link[0].next->value;
+	}
+}
+
+static skiplist_error_t skiplist_select_many_check_clean( const skiplist_t *skiplist, const skiplist_size_t *ranks,
+                                                          skiplist_size_t k, const uintptr_t *out )
+{
+	skiplist_size_t j;
+
+	if( NULL == skiplist )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( k > 0 && ( NULL == ranks || NULL == out ) )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	for( j = 0; j < k; ++j )
+	{
+		if( ranks[j] >= skiplist->num_nodes || ( j > 0 && ranks[j] < ranks[j - 1] ) )
+		{
+			return SKIPLIST_ERROR_INVALID_INPUT;
+		}
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+skiplist_error_t skiplist_select_many( const skiplist_t *skiplist, const skiplist_size_t *ranks, skiplist_size_t k,
+                                       uintptr_t *out )
+{
+	skiplist_error_t err;
+
+	err = skiplist_select_many_check_clean( skiplist, ranks, k, out );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		skiplist_select_clean( skiplist, ranks, NULL, k, out );
+	}
+
+	return err;
+}
+
+static skiplist_error_t skiplist_quantiles_check_clean( const skiplist_t *skiplist, const double *quantiles,
+                                                        skiplist_size_t k, const uintptr_t *out )
+{
+	skiplist_size_t j;
+
+	if( NULL == skiplist )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( k > 0 && ( NULL == quantiles || NULL == out || 0 == skiplist->num_nodes ) )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	for( j = 0; j < k; ++j )
+	{
+		/* Written so NaN fails too. */
+		if( !( quantiles[j] >= 0.0 && quantiles[j] <= 1.0 ) || ( j > 0 && quantiles[j] < quantiles[j - 1] ) )
+		{
+			return SKIPLIST_ERROR_INVALID_INPUT;
+		}
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+skiplist_error_t skiplist_quantiles( const skiplist_t *skiplist, const double *quantiles, skiplist_size_t k,
+                                     uintptr_t *out )
+{
+	skiplist_error_t err;
+
+	err = skiplist_quantiles_check_clean( skiplist, quantiles, k, out );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		skiplist_select_clean( skiplist, NULL, quantiles, k, out );
+	}
+
+	return err;
+}
+
+uintptr_t skiplist_quantile( const skiplist_t *skiplist, double q, skiplist_error_t * const error )
+{
+	uintptr_t value = 0;
+	skiplist_error_t err;
+
+	err = skiplist_quantiles_check_clean( skiplist, &q, 1, &value );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		skiplist_select_clean( skiplist, NULL, &q, 1, &value );
+	}
+
+	if( NULL != error )
+	{
+		*error = err;
+	}
+
+	return value;
+}
+
+uintptr_t skiplist_median( const skiplist_t *skiplist, skiplist_error_t * const error )
+{
+	return skiplist_quantile( skiplist, 0.5, error );
+}
+
+skiplist_error_t skiplist_rng_seed( skiplist_rng_t *rng, unsigned int seed )
+{
+	if( NULL == rng )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	skiplist_rng_init( rng );
+	rng->m_w ^= seed;
+	rng->m_z ^= seed * 0x9e3779b9u;
+
+	/* Either half stuck at 0 stays there. */
+	if( 0 == rng->m_w || 0 == rng->m_z )
+	{
+		skiplist_rng_init( rng );
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+/**
+ * @brief Returns a random number in [0, @p n), @p n must be non-zero.
+ *
+ * Reducing 64 random bits modulo @p n leaves a bias of at most n / 2^64.
+ */
+static skiplist_size_t skiplist_rng_below( skiplist_rng_t *rng, skiplist_size_t n )
+{
+	uint64_t r = (uint64_t) skiplist_rng_gen_u32( rng ) << 32;
+
+	r |= skiplist_rng_gen_u32( rng );
+
+	return (skiplist_size_t) (r % n);
+}
+
+static int skiplist_size_compare( const void *a, const void *b )
+{
+	const skiplist_size_t x = *(const skiplist_size_t *) a;
+	const skiplist_size_t y = *(const skiplist_size_t *) b;
+
+	return x < y ? -1 : x > y;
+}
+
+/**
+ * @brief Draws @p k random ranks in [0, @p n) into @p ranks in ascending order, @p k must be non-zero.
+ *
+ * Without @p replacement the ranks are distinct, and @p k must be at most @p n.
+ */
+static void skiplist_sample_ranks( skiplist_rng_t *rng, skiplist_size_t n, skiplist_size_t k,
+                                   unsigned int replacement, skiplist_size_t *ranks )
+{
+	skiplist_size_t have = 0;
+	skiplist_size_t r;
+	skiplist_size_t j;
+
+	if( !replacement && k > n / 4 )
+	{
+		/* A dense sample picks each rank in turn with the chance that leaves k picked in
+		   the end, which comes out in order and costs O(n), no more than O(k) here. */
+		for( r = 0; have < k; ++r )
+		{
+			if( skiplist_rng_below( rng, n - r ) < k - have )
+			{
+				ranks[have++] = r;
+			}
+		}
+
+		return;
+	}
+
+	/* Otherwise draw, sort, and without replacement drop repeats and draw again for them.
+	   No rank is favoured by that, and a sparse sample rarely repeats, so it's usually
+	   one round. */
+	do
+	{
+		for( j = have; j < k; ++j )
+		{
+			ranks[j] = skiplist_rng_below( rng, n );
+		}
+		qsort( ranks, k, sizeof( *ranks ), skiplist_size_compare );
+
+		have = k;
+		if( !replacement )
+		{
+			for( have = 1, j = 1; j < k; ++j )
+			{
+				if( ranks[j] != ranks[have - 1] )
+				{
+					ranks[have++] = ranks[j];
+				}
+			}
+		}
+	} while( have < k );
+}
+
+static skiplist_error_t skiplist_sample_check_clean( const skiplist_t *skiplist, skiplist_size_t k,
+                                                     unsigned int replacement, const uintptr_t *out )
+{
+	if( NULL == skiplist )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( k > 0 && ( NULL == out || 0 == skiplist->num_nodes ) )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( !replacement && k > skiplist->num_nodes )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+static skiplist_error_t skiplist_sample_clean( skiplist_t *skiplist, skiplist_size_t k, skiplist_rng_t *rng,
+                                               unsigned int replacement, uintptr_t *out )
+{
+	skiplist_size_t *ranks;
+
+	if( 0 == k )
+	{
+		return SKIPLIST_ERROR_SUCCESS;
+	}
+
+	/* out already holds k values, which are at least as wide as ranks, so this can't overflow. */
+	ranks = malloc( sizeof( *ranks ) * k );
+	if( NULL == ranks )
+	{
+		return SKIPLIST_ERROR_OUT_OF_MEMORY;
+	}
+
+	skiplist_sample_ranks( NULL != rng ? rng : &skiplist->rng, skiplist->num_nodes, k, replacement, ranks );
+	skiplist_select_clean( skiplist, ranks, NULL, k, out );
+
+	free( ranks );
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+skiplist_error_t skiplist_sample( skiplist_t *skiplist, skiplist_size_t k, skiplist_rng_t *rng,
+                                  unsigned int replacement, uintptr_t *out )
+{
+	skiplist_error_t err;
+
+	err = skiplist_sample_check_clean( skiplist, k, replacement, out );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		err = skiplist_sample_clean( skiplist, k, rng, replacement, out );
+	}
+
+	return err;
+}
+
+/**
+ * @brief Copy the values of the live nodes from @p node onwards into @p out, stopping after @p high if @p bounded.
+ *
+ * @return The number of values copied, at most @p count.
+ */
+static skiplist_size_t skiplist_copy_values( const skiplist_t *skiplist, const skiplist_node_t *node,
+                                             int bounded, uintptr_t high, uintptr_t *out, skiplist_size_t count )
+{
+	const skiplist_node_t *next;
+	skiplist_size_t copied = 0;
+
+	for( ; NULL != node && copied < count; node = next )
+	{
+		/* Start loading the next node while this one is copied, the walk is otherwise
+		   a chain of dependent cache misses. */
+		next = node->link[0].next;
+		if( NULL != next )
+		{
+			__builtin_prefetch( next );
+		}
+
+		if( bounded && skiplist->compare( node->value, high ) > 0 )
+		{
+			break;
+		}
+
+		if( !skiplist_node_is_tombstone( node ) )
+		{
+			out[copied++] = node->value;
+		}
+	}
+
+	return copied;
+}
+
+static skiplist_error_t skiplist_copy_range_check_clean( const skiplist_t *skiplist, skiplist_size_t start_index,
+                                                         const uintptr_t *out )
+{
+	if( NULL == skiplist )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( start_index > skiplist->num_nodes )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( NULL == out )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+static skiplist_size_t skiplist_copy_range_clean( const skiplist_t *skiplist, skiplist_size_t start_index,
+                                                  skiplist_size_t count, uintptr_t *out )
+{
+	if( start_index == skiplist->num_nodes )
+	{
+		return 0;
+	}
+
+	return skiplist_copy_values( skiplist, skiplist_find_before_index( skiplist, start_index )->link[0].next, 0, 0,
+	                             out, count );
+}
+
+skiplist_size_t skiplist_copy_range( const skiplist_t *skiplist, skiplist_size_t start_index, skiplist_size_t count,
+                                     uintptr_t *out, skiplist_error_t * const error )
+{
+	skiplist_size_t copied = 0;
+	skiplist_error_t err;
+
+	err = skiplist_copy_range_check_clean( skiplist, start_index, out );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		copied = skiplist_copy_range_clean( skiplist, start_index, count, out );
+	}
+
+	if( NULL != error )
+	{
+		*error = err;
+	}
+
+	return copied;
+}
+
+static skiplist_error_t skiplist_copy_values_between_check_clean( const skiplist_t *skiplist, const uintptr_t *out )
+{
+	if( NULL == skiplist )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( NULL == out )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	/* Byte string keys can't be bounded by values alone. */
+	if( SKIPLIST_KEY_VALUE != skiplist->key_type )
+	{
+		return SKIPLIST_ERROR_NOT_SUPPORTED;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+static skiplist_size_t skiplist_copy_values_between_clean( const skiplist_t *skiplist, uintptr_t low, uintptr_t high,
+                                                           uintptr_t *out, skiplist_size_t cap )
+{
+	unsigned int i;
+	const skiplist_node_t *cur;
+
+	SKIPLIST_STAT_ADD( skiplist, lookups, 1 );
+
+	/* Find the last node less than 'low', the values to copy start after it. */
+	cur = &skiplist->head;
+	for( i = cur->levels; i-- != 0; )
+	{
+		while( NULL != cur->link[i].next && skiplist->compare( cur->link[i].next->value, low ) < 0 )
+		{
+			SKIPLIST_STAT_ADD( skiplist, lookup_comparisons, 1 );
+			SKIPLIST_STAT_ADD( skiplist, nodes_visited[i], 1 );
+			cur = cur->link[i].next;
+		}
+	}
+
+	return skiplist_copy_values( skiplist, cur->link[0].next, 1, high, out, cap );
+}
+
+skiplist_size_t skiplist_copy_values_between( const skiplist_t *skiplist, uintptr_t low, uintptr_t high,
+                                              uintptr_t *out, skiplist_size_t cap, skiplist_error_t * const error )
+{
+	skiplist_size_t copied = 0;
+	skiplist_error_t err;
+
+	err = skiplist_copy_values_between_check_clean( skiplist, out );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		copied = skiplist_copy_values_between_clean( skiplist, low, high, out, cap );
+	}
+
+	if( NULL != error )
+	{
+		*error = err;
+	}
+
+	return copied;
+}
+
+static skiplist_error_t skiplist_range_aggregate_check_clean( const skiplist_t *skiplist )
+{
+	if( NULL == skiplist )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( NULL == skiplist->aggregate )
+	{
+		return SKIPLIST_ERROR_NOT_SUPPORTED;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+/**
+ * @brief Combines the aggregates of the live nodes in [@p low, @p high].
+ *
+ * Starting from the last node before the range, each step takes the highest
+ * link that doesn't pass @p high, adding its aggregate. That climbs from the
+ * bottom level and comes back down again, O(log N) links either way.
+ */
+static uintptr_t skiplist_range_aggregate_clean( const skiplist_t *skiplist, uintptr_t low, uintptr_t high )
+{
+	unsigned int i;
+	const skiplist_node_t *cur;
+	uintptr_t aggregate = skiplist->aggregate_identity;
+
+	SKIPLIST_STAT_ADD( skiplist, lookups, 1 );
+
+	/* Find the last node less than 'low', the range starts after it. */
+	cur = &skiplist->head;
+	for( i = cur->levels; i-- != 0; )
+	{
+		while( NULL != cur->link[i].next && skiplist->compare( cur->link[i].next->value, low ) < 0 )
+		{
+			SKIPLIST_STAT_ADD( skiplist, lookup_comparisons, 1 );
+			SKIPLIST_STAT_ADD( skiplist, nodes_visited[i], 1 );
+			cur = cur->link[i].next;
+		}
+	}
+
+	i = 0;
+	for( ;; )
+	{
+		while( i + 1 < cur->levels && NULL != cur->link[i + 1].next &&
+		       skiplist->compare( cur->link[i + 1].next->value, high ) <= 0 )
+		{
+			SKIPLIST_STAT_ADD( skiplist, lookup_comparisons, 1 );
+			++i;
+		}
+
+		if( NULL != cur->link[i].next && skiplist->compare( cur->link[i].next->value, high ) <= 0 )
+		{
+			SKIPLIST_STAT_ADD( skiplist, lookup_comparisons, 1 );
+			SKIPLIST_STAT_ADD( skiplist, nodes_visited[i], 1 );
+			aggregate = skiplist->aggregate( aggregate, skiplist_node_get_aggregate( skiplist, cur, i ) );
+			cur = cur->link[i].next;
+		}
+		else if( 0 == i )
+		{
+			break;
+		}
+		else
+		{
+			--i;
+		}
+	}
+
+	return aggregate;
+}
+
+uintptr_t skiplist_range_aggregate( const skiplist_t *skiplist, uintptr_t low, uintptr_t high,
+                                    skiplist_error_t * const error )
+{
+	uintptr_t aggregate = 0;
+	skiplist_error_t err;
+
+	err = skiplist_range_aggregate_check_clean( skiplist );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		aggregate = skiplist_range_aggregate_clean( skiplist, low, high );
+	}
+
+	if( NULL != error )
+	{
+		*error = err;
+	}
+
+	return aggregate;
+}
+
+static skiplist_error_t skiplist_begin_check_clean( skiplist_t *skiplist )
+{
+	if( NULL == skiplist )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+/**
+ * @brief Returns @p node, or the first node after it that isn't a tombstone.
+ */
+static skiplist_node_t *skiplist_skip_tombstones( skiplist_node_t *node )
+{
+	while( NULL != node && skiplist_node_is_tombstone( node ) )
+	{
+		node = node->link[0].next;
+	}
+
+	return node;
+}
+
+static skiplist_node_t *skiplist_begin_clean( skiplist_t *skiplist )
+{
+	return skiplist_skip_tombstones( skiplist->head.link[0].next );
+}
+
+skiplist_node_t *skiplist_begin( skiplist_t *skiplist )
+{
+	skiplist_node_t *begin = NULL;
+	skiplist_error_t err;
+
+	err = skiplist_begin_check_clean( skiplist );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		begin = skiplist_begin_clean( skiplist );
+	}
+
+	return begin;
+}
+
+skiplist_node_t *skiplist_end( void )
+{
+	return NULL;
+}
+
+static skiplist_error_t skiplist_next_check_clean( const skiplist_node_t *cur )
+{
+	if( NULL == cur )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+static skiplist_node_t *skiplist_next_clean( const skiplist_node_t *cur )
+{
+	return skiplist_skip_tombstones( cur->link[0].next );
+}
+
+skiplist_node_t *skiplist_next( const skiplist_node_t *cur )
+{
+	skiplist_node_t *next = NULL;
+	skiplist_error_t err;
+
+	err = skiplist_next_check_clean( cur );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		next = skiplist_next_clean( cur );
+	}
+
+	return next;
+}
+
+/**
+ * @brief Check @p skiplist has the back links needed to iterate it backwards.
+ */
+static skiplist_error_t skiplist_back_links_check_clean( const skiplist_t *skiplist )
+{
+	if( NULL == skiplist )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( !(skiplist->properties & SKIPLIST_PROPERTY_BACK_LINKS) )
+	{
+		return SKIPLIST_ERROR_NOT_SUPPORTED;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+/**
+ * @brief Returns @p node, or the first node before it that isn't a tombstone.
+ */
+static skiplist_node_t *skiplist_skip_tombstones_back( const skiplist_t *skiplist, skiplist_node_t *node )
+{
+	while( NULL != node && skiplist_node_is_tombstone( node ) )
+	{
+		node = skiplist_node_get_prev( skiplist, node );
+	}
+
+	return node;
+}
+
+skiplist_node_t *skiplist_rbegin( skiplist_t *skiplist )
+{
+	skiplist_node_t *rbegin = NULL;
+	skiplist_error_t err;
+
+	err = skiplist_back_links_check_clean( skiplist );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		rbegin = skiplist_skip_tombstones_back( skiplist, skiplist->tail );
+	}
+
+	return rbegin;
+}
+
+static skiplist_error_t skiplist_prev_check_clean( const skiplist_t *skiplist, const skiplist_node_t *cur )
+{
+	if( NULL == cur )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	return skiplist_back_links_check_clean( skiplist );
+}
+
+skiplist_node_t *skiplist_prev( const skiplist_t *skiplist, const skiplist_node_t *cur )
+{
+	skiplist_node_t *prev = NULL;
+	skiplist_error_t err;
+
+	err = skiplist_prev_check_clean( skiplist, cur );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		prev = skiplist_skip_tombstones_back( skiplist, skiplist_node_get_prev( skiplist, cur ) );
+	}
+
+	return prev;
+}
+
+uintptr_t skiplist_last( const skiplist_t *skiplist, skiplist_error_t * const error )
+{
+	const skiplist_node_t *last = NULL;
+	skiplist_error_t err;
+
+	err = skiplist_back_links_check_clean( skiplist );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		last = skiplist_skip_tombstones_back( skiplist, skiplist->tail );
+		if( NULL == last )
+		{
+			err = SKIPLIST_ERROR_INVALID_INPUT;
+		}
+	}
+
+	if( NULL != error )
+	{
+		*error = err;
+	}
+
+	return NULL != last ? last->value : 0;
+}
+
+static skiplist_error_t skiplist_remove_node_check_clean( const skiplist_t *skiplist, const skiplist_node_t *node )
+{
+	if( NULL == skiplist )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( NULL == node || skiplist_node_is_tombstone( node ) )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+/**
+ * @brief Find the last node before @p node on every level.
+ *
+ * @retval SKIPLIST_ERROR_SUCCESS if successful.
+ * @retval SKIPLIST_ERROR_INVALID_INPUT if @p node isn't in @p skiplist.
+ */
+static skiplist_error_t skiplist_find_node_path( skiplist_t *skiplist, const skiplist_node_t *node,
+                                                 skiplist_node_t *update[] )
+{
+	skiplist_node_t *cur;
+	skiplist_bytes_t bytes;
+	const skiplist_bytes_t *key = NULL;
+	unsigned int i;
+
+	if( SKIPLIST_KEY_BYTES == skiplist->key_type )
+	{
+		skiplist_bytes_init( &bytes, skiplist_node_key_bytes( skiplist, node ) + sizeof( size_t ),
+		                     skiplist_node_key_length( skiplist, node ) );
+		key = &bytes;
+	}
+
+	/* Back links only cover the bottom level, so the links above still need the search.
+	   Nodes with the same value can come first, step over them to the node itself. */
+	skiplist_find_remove_path( skiplist, node->value, key, update );
+	for( cur = update[0]->link[0].next; cur != node; cur = cur->link[0].next )
+	{
+		if( NULL == cur || 0 != skiplist_node_compare( skiplist, cur, node->value, key ) )
+		{
+			return SKIPLIST_ERROR_INVALID_INPUT;
+		}
+
+		for( i = 0; i < cur->levels; ++i )
+		{
+			update[i] = cur;
+		}
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+static skiplist_error_t skiplist_remove_node_clean( skiplist_t *skiplist, skiplist_node_t *node )
+{
+	skiplist_node_t *update[SKIPLIST_MAX_LINKS];
+	uintptr_t value = node->value;
+	skiplist_error_t err;
+
+	SKIPLIST_STAT_ADD( skiplist, removes, 1 );
+
+	err = skiplist_find_node_path( skiplist, node, update );
+	if( SKIPLIST_ERROR_SUCCESS != err )
+	{
+		return err;
+	}
+
+	skiplist_delete_node( skiplist, update, node );
+
+	if( NULL != skiplist->wal )
+	{
+		err = skiplist_wal_append( skiplist->wal, 1, value );
+	}
+
+	return err;
+}
+
+skiplist_error_t skiplist_remove_node( skiplist_t *skiplist, skiplist_node_t *node )
+{
+	skiplist_error_t err;
+
+	err = skiplist_remove_node_check_clean( skiplist, node );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		err = skiplist_remove_node_clean( skiplist, node );
+	}
+
+	return err;
+}
+
+skiplist_node_t *skiplist_push( skiplist_t *skiplist, uintptr_t value, skiplist_error_t * const error )
+{
+	skiplist_node_t *node = NULL;
+	skiplist_error_t err;
+
+	err = skiplist_insert_check_clean( skiplist, value );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		err = skiplist_insert_clean( skiplist, value, NULL, &node );
+	}
+
+	if( NULL != error )
+	{
+		*error = err;
+	}
+
+	return node;
+}
+
+static skiplist_error_t skiplist_pop_min_check_clean( const skiplist_t *skiplist )
+{
+	if( NULL == skiplist )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( 0 == skiplist->num_nodes )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+static uintptr_t skiplist_pop_min_clean( skiplist_t *skiplist, void *payload, skiplist_error_t *err )
+{
+	skiplist_node_t *update[SKIPLIST_MAX_LINKS];
+	skiplist_node_t *first;
+	uintptr_t value;
+	unsigned int i;
+
+	/* Open snapshots may still see the first node, and the tombstones before it, so
+	   it's removed the usual way. */
+	if( NULL != skiplist->snapshots )
+	{
+		for( first = skiplist->head.link[0].next; skiplist_node_is_tombstone( first ); first = first->link[0].next )
+		{
+		}
+
+		value = first->value;
+		if( NULL != payload )
+		{
+			memcpy( payload, skiplist_node_payload_bytes( first ), skiplist->payload_size );
+		}
+		*err = skiplist_remove_node_clean( skiplist, first );
+
+		return value;
+	}
+
+	SKIPLIST_STAT_ADD( skiplist, removes, 1 );
+
+	/* The first node follows the head on every one of its levels, so nothing needs
+	   searching for. Nothing can see the tombstones in front of it either, they're
+	   unlinked on the way like skiplist_compact() would. */
+	for( first = skiplist->head.link[0].next; skiplist_node_is_tombstone( first ); first = skiplist->head.link[0].next )
+	{
+		for( i = 0; i < first->levels; ++i )
+		{
+			skiplist->head.link[i].next = first->link[i].next;
+			skiplist->head.link[i].width += first->link[i].width;
+			if( NULL != skiplist->aggregate )
+			{
+				skiplist_node_set_aggregate( skiplist, &skiplist->head, i,
+				                             skiplist->aggregate( skiplist_node_get_aggregate( skiplist, &skiplist->head, i ),
+				                                                  skiplist_node_get_aggregate( skiplist, first, i ) ) );
+			}
+		}
+		skiplist_set_prev( skiplist, first->link[0].next, &skiplist->head );
+
+		skiplist_node_deallocate( skiplist, first );
+		--skiplist->tombstones;
+	}
+
+	for( i = 0; i < skiplist->head.levels; ++i )
+	{
+		update[i] = &skiplist->head;
+	}
+
+	value = first->value;
+	if( NULL != payload )
+	{
+		memcpy( payload, skiplist_node_payload_bytes( first ), skiplist->payload_size );
+	}
+
+	/* No snapshot can see the node, but the change still counts towards the list's version. */
+	if( skiplist->properties & SKIPLIST_PROPERTY_VERSIONED )
+	{
+		++skiplist->version;
+	}
+
+	skiplist_unlink_node( skiplist, update, first );
+	skiplist_node_deallocate( skiplist, first );
+
+	if( NULL != skiplist->wal )
+	{
+		*err = skiplist_wal_append( skiplist->wal, 1, value );
+	}
+
+	return value;
+}
+
+uintptr_t skiplist_pop_min( skiplist_t *skiplist, void *payload, skiplist_error_t * const error )
+{
+	uintptr_t value = 0;
+	skiplist_error_t err;
+
+	err = skiplist_pop_min_check_clean( skiplist );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		value = skiplist_pop_min_clean( skiplist, payload, &err );
+	}
+
+	if( NULL != error )
+	{
+		*error = err;
+	}
+
+	return value;
+}
+
+static skiplist_error_t skiplist_update_node_check_clean( const skiplist_t *skiplist, const skiplist_node_t *node )
+{
+	if( NULL == skiplist )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( NULL == node || skiplist_node_is_tombstone( node ) )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( SKIPLIST_KEY_VALUE != skiplist->key_type )
+	{
+		return SKIPLIST_ERROR_NOT_SUPPORTED;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+/**
+ * @brief Returns non-zero if @p node can hold @p value without moving, between the nodes either side of it.
+ *
+ * Without back links the node before is unknown, so only values that don't move the node backwards are checked.
+ */
+static int skiplist_update_stays( const skiplist_t *skiplist, const skiplist_node_t *node, uintptr_t value )
+{
+	const skiplist_node_t *prev;
+	const skiplist_node_t *next = node->link[0].next;
+	int comparison = skiplist->compare( value, node->value );
+
+	if( comparison >= 0 )
+	{
+		if( NULL == next )
+		{
+			return 1;
+		}
+
+		/* Inserts go after equal nodes, so a live node must follow any tombstones of its value,
+		   in sets and multisets alike. Otherwise inserting the value into a set would find the
+		   tombstone and add it again. */
+		comparison = skiplist->compare( value, next->value );
+		return comparison < 0 || (0 == comparison && !skiplist_node_is_tombstone( next ));
+	}
+
+	if( skiplist->properties & SKIPLIST_PROPERTY_BACK_LINKS )
+	{
+		prev = skiplist_node_get_prev( skiplist, node );
+		return NULL == prev || skiplist->compare( prev->value, value ) <= 0;
+	}
+
+	return 0;
+}
+
+static skiplist_node_t *skiplist_update_node_clean( skiplist_t *skiplist, skiplist_node_t *node, uintptr_t value,
+                                                    skiplist_error_t *err )
+{
+	skiplist_node_t *update[SKIPLIST_MAX_LINKS];
+	skiplist_size_t distances[SKIPLIST_MAX_LINKS];
+	skiplist_node_t *moved;
+	uintptr_t old_value = node->value;
+
+	SKIPLIST_STAT_ADD( skiplist, updates, 1 );
+
+	if( (skiplist->properties & SKIPLIST_PROPERTY_UNIQUE) && 0 != skiplist->compare( value, old_value ) &&
+	    skiplist_contains_clean( skiplist, value, NULL ) )
+	{
+		*err = SKIPLIST_ERROR_INVALID_INPUT;
+		return NULL;
+	}
+
+	if( NULL != skiplist->snapshots )
+	{
+		/* Open snapshots must keep seeing the old value, so the node is replaced by a new one
+		   carrying its payload, and the old one removed. The new node is counted first. */
+		if( skiplist->num_nodes >= SKIPLIST_MAX_SIZE )
+		{
+			*err = SKIPLIST_ERROR_FULL;
+			return NULL;
+		}
+
+		skiplist_find_insert_path( skiplist, value, NULL, update, distances );
+		moved = skiplist_insert_node( skiplist, value, NULL, update, distances );
+		if( NULL == moved )
+		{
+			*err = SKIPLIST_ERROR_OUT_OF_MEMORY;
+			return NULL;
+		}
+		memcpy( skiplist_node_payload_bytes( moved ), skiplist_node_payload_bytes( node ), skiplist->payload_size );
+
+		*err = skiplist_find_node_path( skiplist, node, update );
+		assert( SKIPLIST_ERROR_SUCCESS == *err );
+		skiplist_delete_node( skiplist, update, node );
+	}
+	else
+	{
+		/* The node keeps its place if the new value still sorts between its neighbours, otherwise
+		   it's unlinked and linked in again at the new value. Either way it keeps its memory and
+		   payload, so the handle stays valid. */
+		moved = node;
+		if( !skiplist_update_stays( skiplist, node, value ) )
+		{
+			*err = skiplist_find_node_path( skiplist, node, update );
+			if( SKIPLIST_ERROR_SUCCESS != *err )
+			{
+				return NULL;
+			}
+			skiplist_unlink_node( skiplist, update, node );
+			node->value = value;
+
+			skiplist_find_insert_path( skiplist, value, NULL, update, distances );
+			skiplist_link_node( skiplist, node, update, distances );
+		}
+		else if( NULL != skiplist->aggregate )
+		{
+			/* The links skipping the node still aggregate its old value. */
+			*err = skiplist_find_node_path( skiplist, node, update );
+			if( SKIPLIST_ERROR_SUCCESS != *err )
+			{
+				return NULL;
+			}
+			node->value = value;
+			skiplist_aggregate_fix_path( skiplist, update, node );
+		}
+		node->value = value;
+
+		if( skiplist->properties & SKIPLIST_PROPERTY_VERSIONED )
+		{
+			++skiplist->version;
+		}
+	}
+
+	if( NULL != skiplist->wal )
+	{
+		*err = skiplist_wal_append( skiplist->wal, 1, old_value );
+		if( SKIPLIST_ERROR_SUCCESS == *err )
+		{
+			*err = skiplist_wal_append( skiplist->wal, 0, value );
+		}
+	}
+
+	return moved;
+}
+
+skiplist_node_t *skiplist_update_node( skiplist_t *skiplist, skiplist_node_t *node, uintptr_t value,
+                                       skiplist_error_t * const error )
+{
+	skiplist_node_t *moved = NULL;
+	skiplist_error_t err;
+
+	err = skiplist_update_node_check_clean( skiplist, node );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		moved = skiplist_update_node_clean( skiplist, node, value, &err );
+	}
+
+	if( NULL != error )
+	{
+		*error = err;
+	}
+
+	return moved;
+}
+
+static skiplist_error_t skiplist_node_value_check_clean( const skiplist_node_t *node )
+{
+	if( NULL == node )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+static uintptr_t skiplist_node_value_clean( const skiplist_node_t *node )
+{
+	return node->value;
+}
+
+uintptr_t skiplist_node_value( const skiplist_node_t *node, skiplist_error_t * const error )
+{
+	uintptr_t value = 0;
+	skiplist_error_t err;
+
+	err = skiplist_node_value_check_clean( node );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		value = skiplist_node_value_clean( node );
+	}
+
+	if( NULL != error )
+	{
+		*error = err;
+	}
+
+	return value;
+}
+
+static skiplist_error_t skiplist_node_payload_check_clean( const skiplist_node_t *node )
+{
+	if( NULL == node )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+void *skiplist_node_payload( const skiplist_node_t *node, skiplist_error_t * const error )
+{
+	void *payload = NULL;
+	skiplist_error_t err;
+
+	err = skiplist_node_payload_check_clean( node );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		payload = skiplist_node_payload_bytes( node );
+	}
+
+	if( NULL != error )
+	{
+		*error = err;
+	}
+
+	return payload;
+}
+
+static skiplist_error_t skiplist_node_key_check_clean( const skiplist_t *skiplist, const skiplist_node_t *node )
+{
+	if( NULL == skiplist || NULL == node )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( SKIPLIST_KEY_BYTES != skiplist->key_type )
+	{
+		return SKIPLIST_ERROR_NOT_SUPPORTED;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+const void *skiplist_node_key( const skiplist_t *skiplist, const skiplist_node_t *node, size_t *length,
+                               skiplist_error_t * const error )
+{
+	const void *key = NULL;
+	size_t key_length = 0;
+	skiplist_error_t err;
+
+	err = skiplist_node_key_check_clean( skiplist, node );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		key = skiplist_node_key_bytes( skiplist, node ) + sizeof( size_t );
+		key_length = skiplist_node_key_length( skiplist, node );
+	}
+
+	if( NULL != length )
+	{
+		*length = key_length;
+	}
+
+	if( NULL != error )
+	{
+		*error = err;
+	}
+
+	return key;
+}
+
+static skiplist_error_t skiplist_size_check_clean( const skiplist_t *skiplist )
+{
+	if( NULL == skiplist )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+static skiplist_size_t skiplist_size_clean( const skiplist_t *skiplist )
+{
+	return skiplist->num_nodes;
+}
+
+skiplist_size_t skiplist_size( const skiplist_t *skiplist, skiplist_error_t * const error )
+{
+	skiplist_size_t size = 0;
+	skiplist_error_t err;
+
+	err = skiplist_size_check_clean( skiplist );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		size = skiplist_size_clean( skiplist );
+	}
+
+	if( NULL != error )
+	{
+		*error = err;
+	}
+
+	return size;
+}
+
+/** Identifies a skiplist snapshot, followed by the format version. */
+static const unsigned char skiplist_snapshot_magic[8] = { 'S', 'K', 'I', 'P', 'L', 'I', 'S', 'T' };
+
+/** The version of the snapshot format written by skiplist_save(). */
+#define SKIPLIST_SNAPSHOT_VERSION (1)
+
+/** The size of the snapshot header: magic, version, flags, properties, levels, value size, payload size and count. */
+#define SKIPLIST_SNAPSHOT_HEADER_SIZE (40)
+
+/** The size of the buffer snapshots are read and written through. */
+#define SKIPLIST_SNAPSHOT_BUFFER_SIZE (1 << 16)
+
+/**
+ * @brief A buffer between a file descriptor and the snapshot encoder or decoder.
+ */
+typedef struct skiplist_stream_t
+{
+	/** The file descriptor being read or written. */
+	int fd;
+
+	/** SKIPLIST_SNAPSHOT_BUFFER_SIZE bytes of buffer. */
+	unsigned char *buffer;
+
+	/** The next byte of the buffer to read or write. */
+	size_t pos;
+
+	/** The number of valid bytes in the buffer when reading. */
+	size_t len;
+} skiplist_stream_t;
+
+/**
+ * @brief Write the buffered bytes to the stream's file descriptor.
+ */
+static skiplist_error_t skiplist_stream_flush( skiplist_stream_t *stream )
+{
+	size_t done = 0;
+
+	while( done < stream->pos )
+	{
+		ssize_t written = write( stream->fd, stream->buffer + done, stream->pos - done );
+
+		if( written < 0 )
+		{
+			if( EINTR == errno )
+			{
+				continue;
+			}
+			return SKIPLIST_ERROR_IO;
+		}
+		done += (size_t) written;
+	}
+
+	stream->pos = 0;
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+/**
+ * @brief Append @p size bytes to the stream, flushing it when the buffer fills.
+ */
+static skiplist_error_t skiplist_stream_write( skiplist_stream_t *stream, const unsigned char *bytes, size_t size )
+{
+	skiplist_error_t err;
+
+	assert( size <= SKIPLIST_SNAPSHOT_BUFFER_SIZE );
+
+	if( SKIPLIST_SNAPSHOT_BUFFER_SIZE - stream->pos < size )
+	{
+		err = skiplist_stream_flush( stream );
+		if( SKIPLIST_ERROR_SUCCESS != err )
+		{
+			return err;
+		}
+	}
+
+	memcpy( stream->buffer + stream->pos, bytes, size );
+	stream->pos += size;
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+/**
+ * @brief Take @p size bytes from the stream, refilling the buffer as needed.
+ *
+ * @retval SKIPLIST_ERROR_INVALID_SNAPSHOT if the file ends first.
+ */
+static skiplist_error_t skiplist_stream_read( skiplist_stream_t *stream, unsigned char *bytes, size_t size )
+{
+	assert( size <= SKIPLIST_SNAPSHOT_BUFFER_SIZE );
+
+	if( stream->len - stream->pos < size )
+	{
+		/* Move the unread tail to the front and top the buffer up behind it. */
+		memmove( stream->buffer, stream->buffer + stream->pos, stream->len - stream->pos );
+		stream->len -= stream->pos;
+		stream->pos = 0;
+
+		while( stream->len < size )
 		{
-			skiplist_link_t *update_link = &update[i]->link[i];
-			skiplist_link_t *remove_link = &remove->link[i];
+			ssize_t got = read( stream->fd, stream->buffer + stream->len, SKIPLIST_SNAPSHOT_BUFFER_SIZE - stream->len );
 
-			/* This level will either connect to the node after the removed node or span over it.
-			   If it spans over the removed node just decrement the width of the link, if it
-			   connects then update the next pointer and sum the link widths. */
-			--update_link->width;
-			if( update_link->next == remove )
+			if( got < 0 )
 			{
-				update_link->next = remove_link->next;
-				update_link->width += remove_link->width;
+				if( EINTR == errno )
+				{
+					continue;
+				}
+				return SKIPLIST_ERROR_IO;
 			}
+			if( 0 == got )
+			{
+				return SKIPLIST_ERROR_INVALID_SNAPSHOT;
+			}
+			stream->len += (size_t) got;
 		}
-
-		/* Deallocate the memory for the removed node. */
-		skiplist_node_deallocate( remove );
-
-		/* Decrement node counter. */
-		--skiplist->num_nodes;
 	}
 
-	return err;
+	memcpy( bytes, stream->buffer + stream->pos, size );
+	stream->pos += size;
+
+	return SKIPLIST_ERROR_SUCCESS;
 }
 
-skiplist_error_t skiplist_remove( skiplist_t *skiplist, uintptr_t value )
+/**
+ * @brief Store @p value as @p size little endian bytes, so snapshots move between machines of the same word size.
+ */
+static void skiplist_encode( unsigned char *bytes, unsigned long long value, size_t size )
 {
-	skiplist_error_t err;
+	size_t i;
 
-	err = skiplist_remove_check_clean( skiplist, value );
+	for( i = 0; i < size; ++i )
+	{
+		bytes[i] = (unsigned char) (value >> (8 * i));
+	}
+}
 
-	if( SKIPLIST_ERROR_SUCCESS == err )
+/**
+ * @brief Returns the value of @p size little endian bytes.
+ */
+static unsigned long long skiplist_decode( const unsigned char *bytes, size_t size )
+{
+	unsigned long long value = 0;
+	size_t i;
+
+	for( i = size; i-- != 0; )
 	{
-		err = skiplist_remove_clean( skiplist, value );
+		value = (value << 8) | bytes[i];
 	}
 
-	return err;
+	return value;
 }
 
-static skiplist_error_t skiplist_fprintf_check_clean( FILE *stream, const skiplist_t *skiplist )
+static skiplist_error_t skiplist_save_check_clean( const skiplist_t *skiplist, int fd, unsigned int flags )
 {
-	if( NULL == stream )
+	if( NULL == skiplist )
 	{
 		return SKIPLIST_ERROR_INVALID_INPUT;
 	}
 
-	if( NULL == skiplist )
+	if( fd < 0 )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( flags & ~(unsigned int) SKIPLIST_SAVE_LEVELS )
 	{
 		return SKIPLIST_ERROR_INVALID_INPUT;
 	}
 
+	/* The snapshot format has no room for byte string keys. */
+	if( SKIPLIST_KEY_VALUE != skiplist->key_type )
+	{
+		return SKIPLIST_ERROR_NOT_SUPPORTED;
+	}
+
 	return SKIPLIST_ERROR_SUCCESS;
 }
 
-static void skiplist_fprintf_clean( FILE *stream, const skiplist_t *skiplist )
+static skiplist_error_t skiplist_save_clean( const skiplist_t *skiplist, int fd, unsigned int flags )
 {
+	unsigned char header[SKIPLIST_SNAPSHOT_HEADER_SIZE];
+	unsigned char record[sizeof( uintptr_t ) + 1];
+	size_t record_size;
+	skiplist_stream_t stream;
 	const skiplist_node_t *cur;
-	unsigned int i;
+	skiplist_error_t err;
 
-	assert( stream );
-	assert( skiplist );
+	stream.fd = fd;
+	stream.pos = 0;
+	stream.len = 0;
+	stream.buffer = malloc( SKIPLIST_SNAPSHOT_BUFFER_SIZE );
+	if( NULL == stream.buffer )
+	{
+		return SKIPLIST_ERROR_OUT_OF_MEMORY;
+	}
 
-	fprintf( stream, "digraph {\n" );
-	fprintf( stream, "rankdir=\"LR\"\n" );
-	for( i = skiplist->head.levels; i-- != 0; )
+	memset( header, 0, sizeof( header ) );
+	memcpy( header, skiplist_snapshot_magic, sizeof( skiplist_snapshot_magic ) );
+	skiplist_encode( header + 8, SKIPLIST_SNAPSHOT_VERSION, 4 );
+	skiplist_encode( header + 12, flags, 4 );
+	skiplist_encode( header + 16, skiplist->properties, 4 );
+	skiplist_encode( header + 20, skiplist->head.levels, 4 );
+	skiplist_encode( header + 24, sizeof( uintptr_t ), 4 );
+	skiplist_encode( header + 28, skiplist->payload_size, 4 );
+	skiplist_encode( header + 32, skiplist->num_nodes, 8 );
+
+	err = skiplist_stream_write( &stream, header, sizeof( header ) );
+
+	/* Each record is the value, followed by the node's level count if requested and the payload of a map.
+	   Payloads are written as they are in memory, they're opaque to the skiplist. */
+	record_size = sizeof( uintptr_t ) + ((flags & SKIPLIST_SAVE_LEVELS) ? 1 : 0);
+	for( cur = skiplist->head.link[0].next; NULL != cur && SKIPLIST_ERROR_SUCCESS == err; cur = cur->link[0].next )
 	{
-		for( cur = &skiplist->head; NULL != cur; cur = cur->link[i].next )
+		if( skiplist_node_is_tombstone( cur ) )
 		{
-			assert( i < cur->levels );
-
-			if( cur == &skiplist->head )
-			{
-				fprintf( stream, "\"HEAD\\lnum_nodes: %u\"", skiplist->num_nodes );
-			}
-			else
-			{
-				fprintf( stream, "\"%p\\lvalue: ", (void *)cur );
-				skiplist->print( stream, cur->value );
-				fprintf( stream, "\"" );
-			}
-
-			fprintf( stream, "->" );
-
-			if( NULL == cur->link[i].next )
-			{
-				fprintf( stream, "TAIL" );
-			}
-			else
-			{
-				fprintf( stream, "\"%p\\lvalue: ", (void *)cur->link[i].next );
-				skiplist->print( stream, cur->link[i].next->value );
-				fprintf( stream, "\"" );
-			}
+			continue;
+		}
 
-			fprintf( stream, "[ label=\"%u\" ];\n", cur->link[i].width );
+		skiplist_encode( record, cur->value, sizeof( uintptr_t ) );
+		record[sizeof( uintptr_t )] = (unsigned char) cur->levels;
+		err = skiplist_stream_write( &stream, record, record_size );
+		if( SKIPLIST_ERROR_SUCCESS == err && 0 != skiplist->payload_size )
+		{
+			err = skiplist_stream_write( &stream, skiplist_node_payload_bytes( cur ), skiplist->payload_size );
 		}
 	}
 
-	fprintf( stream, "}\n" );
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		err = skiplist_stream_flush( &stream );
+	}
+
+	free( stream.buffer );
+
+	return err;
 }
 
-skiplist_error_t skiplist_fprintf( FILE *stream, const skiplist_t *skiplist )
+skiplist_error_t skiplist_save( const skiplist_t *skiplist, int fd, unsigned int flags )
 {
 	skiplist_error_t err;
 
-	err = skiplist_fprintf_check_clean( stream, skiplist );
+	err = skiplist_save_check_clean( skiplist, fd, flags );
 
 	if( SKIPLIST_ERROR_SUCCESS == err )
 	{
-		skiplist_fprintf_clean( stream, skiplist );
+		err = skiplist_save_clean( skiplist, fd, flags );
 	}
 
 	return err;
 }
 
-skiplist_error_t skiplist_printf( const skiplist_t *skiplist )
-{
-	return skiplist_fprintf( stdout, skiplist );
-}
-
-static skiplist_error_t skiplist_fprintf_filename_check_clean( const char *filename, const skiplist_t *skiplist )
+static skiplist_error_t skiplist_load_check_clean( int fd, const skiplist_options_t *options )
 {
-	if( NULL == filename )
+	if( fd < 0 )
 	{
 		return SKIPLIST_ERROR_INVALID_INPUT;
 	}
 
-	if( NULL == skiplist )
+	if( NULL == options )
 	{
 		return SKIPLIST_ERROR_INVALID_INPUT;
 	}
@@ -655,89 +4161,188 @@ static skiplist_error_t skiplist_fprintf_filename_check_clean( const char *filen
 	return SKIPLIST_ERROR_SUCCESS;
 }
 
-static skiplist_error_t skiplist_fprintf_filename_clean( const char *filename, const skiplist_t *skiplist )
+/**
+ * @brief Read the values of a snapshot into the empty skiplist @p skiplist.
+ *
+ * Nodes are appended to every level they appear on, remembering the last node
+ * and its position per level so each link's width is known when it's closed.
+ */
+static skiplist_error_t skiplist_load_nodes( skiplist_t *skiplist, skiplist_stream_t *stream,
+                                             unsigned int flags, skiplist_size_t count )
 {
+	skiplist_node_t *last[SKIPLIST_MAX_LINKS];
+	skiplist_size_t last_pos[SKIPLIST_MAX_LINKS];
+	unsigned char record[sizeof( uintptr_t ) + 1];
+	size_t record_size;
+	skiplist_size_t pos;
+	unsigned int i;
 	skiplist_error_t err = SKIPLIST_ERROR_SUCCESS;
-	FILE *fp;
 
-	fp = fopen( filename, "w" );
-	if( NULL == fp )
+	for( i = 0; i < skiplist->head.levels; ++i )
 	{
-		err = SKIPLIST_ERROR_OPENING_FILE;
+		last[i] = &skiplist->head;
+		last_pos[i] = 0;
 	}
-	else
+
+	record_size = sizeof( uintptr_t ) + ((flags & SKIPLIST_SAVE_LEVELS) ? 1 : 0);
+	for( pos = 1; pos <= count && SKIPLIST_ERROR_SUCCESS == err; ++pos )
 	{
-		skiplist_fprintf( fp, skiplist );
-		fclose( fp );
+		skiplist_node_t *node;
+		unsigned int levels;
+
+		err = skiplist_stream_read( stream, record, record_size );
+		if( SKIPLIST_ERROR_SUCCESS != err )
+		{
+			break;
+		}
+
+		if( flags & SKIPLIST_SAVE_LEVELS )
+		{
+			levels = record[sizeof( uintptr_t )];
+			if( levels < 1 || levels > skiplist->head.levels )
+			{
+				err = SKIPLIST_ERROR_INVALID_SNAPSHOT;
+				break;
+			}
+		}
+		else
+		{
+			levels = skiplist_compute_node_level( skiplist );
+		}
+
+		node = skiplist_node_create( skiplist, levels, (uintptr_t) skiplist_decode( record, sizeof( uintptr_t ) ), NULL );
+		if( NULL == node )
+		{
+			err = SKIPLIST_ERROR_OUT_OF_MEMORY;
+			break;
+		}
+
+		skiplist_set_prev( skiplist, node, last[0] );
+		for( i = 0; i < levels; ++i )
+		{
+			node->link[i].next = NULL;
+			last[i]->link[i].next = node;
+			last[i]->link[i].width = pos - last_pos[i];
+			last[i] = node;
+			last_pos[i] = pos;
+		}
+		skiplist->tail = node;
+		++skiplist->num_nodes;
+
+		if( 0 != skiplist->payload_size )
+		{
+			err = skiplist_stream_read( stream, skiplist_node_payload_bytes( node ), skiplist->payload_size );
+		}
 	}
 
+	/* Links off the end of each level span the nodes after the last one on it. */
+	for( i = 0; i < skiplist->head.levels; ++i )
+	{
+		last[i]->link[i].width = skiplist->num_nodes - last_pos[i];
+	}
+	skiplist_aggregate_rebuild( skiplist );
+
 	return err;
 }
 
-skiplist_error_t skiplist_fprintf_filename( const char *filename, const skiplist_t *skiplist )
+static skiplist_t *skiplist_load_clean( int fd, const skiplist_options_t *options, skiplist_error_t *error )
 {
+	unsigned char header[SKIPLIST_SNAPSHOT_HEADER_SIZE];
+	skiplist_options_t snapshot_options;
+	skiplist_stream_t stream;
+	skiplist_t *skiplist = NULL;
+	unsigned long long count;
+	unsigned int flags;
 	skiplist_error_t err;
 
-	err = skiplist_fprintf_filename_check_clean( filename, skiplist );
-
-	if( SKIPLIST_ERROR_SUCCESS == err )
+	stream.fd = fd;
+	stream.pos = 0;
+	stream.len = 0;
+	stream.buffer = malloc( SKIPLIST_SNAPSHOT_BUFFER_SIZE );
+	if( NULL == stream.buffer )
 	{
-		err = skiplist_fprintf_filename_clean( filename, skiplist );
+		*error = SKIPLIST_ERROR_OUT_OF_MEMORY;
+		return NULL;
 	}
 
-	return err;
-}
+	err = skiplist_stream_read( &stream, header, sizeof( header ) );
 
-static skiplist_error_t skiplist_at_index_check_clean( const skiplist_t *skiplist, unsigned int index )
-{
-	if( NULL == skiplist )
+	if( SKIPLIST_ERROR_SUCCESS == err )
 	{
-		return SKIPLIST_ERROR_INVALID_INPUT;
+		flags = (unsigned int) skiplist_decode( header + 12, 4 );
+		count = skiplist_decode( header + 32, 8 );
+
+		snapshot_options = *options;
+		snapshot_options.properties = (skiplist_properties_t) skiplist_decode( header + 16, 4 );
+		snapshot_options.size_estimate_log2 = (unsigned int) skiplist_decode( header + 20, 4 );
+		snapshot_options.payload_size = (size_t) skiplist_decode( header + 28, 4 );
+		snapshot_options.key_type = SKIPLIST_KEY_VALUE;
+
+		if( memcmp( header, skiplist_snapshot_magic, sizeof( skiplist_snapshot_magic ) ) ||
+		    SKIPLIST_SNAPSHOT_VERSION != skiplist_decode( header + 8, 4 ) ||
+		    (flags & ~(unsigned int) SKIPLIST_SAVE_LEVELS) ||
+		    sizeof( uintptr_t ) != skiplist_decode( header + 24, 4 ) )
+		{
+			err = SKIPLIST_ERROR_INVALID_SNAPSHOT;
+		}
+		else if( count > SKIPLIST_MAX_SIZE )
+		{
+			/* Saved by a SKIPLIST_64BIT build, too many nodes for this one. */
+			err = SKIPLIST_ERROR_FULL;
+		}
 	}
 
-	if( index >= skiplist->num_nodes )
+	if( SKIPLIST_ERROR_SUCCESS == err )
 	{
-		return SKIPLIST_ERROR_INVALID_INPUT;
+		/* A level cap, properties or payload size this build doesn't accept makes the snapshot invalid,
+		   anything else wrong with the options is the caller's. */
+		if( snapshot_options.size_estimate_log2 < 1 || snapshot_options.size_estimate_log2 > SKIPLIST_MAX_LINKS ||
+		    (snapshot_options.properties & ~(skiplist_properties_t) SKIPLIST_PROPERTY_ALL) ||
+		    snapshot_options.payload_size > SKIPLIST_MAX_PAYLOAD_SIZE )
+		{
+			err = SKIPLIST_ERROR_INVALID_SNAPSHOT;
+		}
+		else
+		{
+			skiplist = skiplist_create_with_options( &snapshot_options, &err );
+		}
 	}
 
-	return SKIPLIST_ERROR_SUCCESS;
-}
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		err = skiplist_load_nodes( skiplist, &stream, flags, (skiplist_size_t) count );
 
-static uintptr_t skiplist_at_index_clean( const skiplist_t *skiplist, unsigned int index )
-{
-	unsigned int i;
-	unsigned int remaining;
-	const skiplist_node_t *cur;
+		/* Give back what was read past the snapshot, a log written after it starts there.
+		   A pipe can't seek, whatever followed the snapshot on it is lost. */
+		if( SKIPLIST_ERROR_SUCCESS == err && stream.len > stream.pos &&
+		    lseek( fd, -(off_t) (stream.len - stream.pos), SEEK_CUR ) < 0 && ESPIPE != errno )
+		{
+			err = SKIPLIST_ERROR_IO;
+		}
 
-	/* Indicies in the skiplist start counting from 1 due to the 1 step distance
-	   from head to the first element. So increment the index by 1. */
-	remaining = index + 1;
-	cur = &skiplist->head;
-	for( i = cur->levels; i-- != 0 && remaining > 0; )
-	{
-		/* If we've reached the tail without finding the index or the next step is too far away
-		   try the next level down. */
-		while( NULL != cur->link[i].next && cur->link[i].width <= remaining )
+		if( SKIPLIST_ERROR_SUCCESS != err )
 		{
-			/* Otherwise, decrement the width remaining and move to the next node. */
-			remaining -= cur->link[i].width;
-			cur = cur->link[i].next;
+			skiplist_destroy( skiplist );
+			skiplist = NULL;
 		}
 	}
 
-	return cur->value;
+	free( stream.buffer );
+	*error = err;
+
+	return skiplist;
 }
 
-uintptr_t skiplist_at_index( const skiplist_t *skiplist, unsigned int index, skiplist_error_t * const error )
+skiplist_t *skiplist_load( int fd, const skiplist_options_t *options, skiplist_error_t * const error )
 {
-	uintptr_t value = 0;
+	skiplist_t *skiplist = NULL;
 	skiplist_error_t err;
 
-	err = skiplist_at_index_check_clean( skiplist, index );
+	err = skiplist_load_check_clean( fd, options );
 
 	if( SKIPLIST_ERROR_SUCCESS == err )
 	{
-		value = skiplist_at_index_clean( skiplist, index );
+		skiplist = skiplist_load_clean( fd, options, &err );
 	}
 
 	if( NULL != error )
@@ -745,10 +4350,10 @@ uintptr_t skiplist_at_index( const skiplist_t *skiplist, unsigned int index, ski
 		*error = err;
 	}
 
-	return value;
+	return skiplist;
 }
 
-static skiplist_error_t skiplist_begin_check_clean( skiplist_t *skiplist )
+static skiplist_error_t skiplist_memory_held_check_clean( const skiplist_t *skiplist )
 {
 	if( NULL == skiplist )
 	{
@@ -758,34 +4363,59 @@ static skiplist_error_t skiplist_begin_check_clean( skiplist_t *skiplist )
 	return SKIPLIST_ERROR_SUCCESS;
 }
 
-static skiplist_node_t *skiplist_begin_clean( skiplist_t *skiplist )
+static size_t skiplist_memory_held_clean( const skiplist_t *skiplist )
 {
-	return skiplist->head.link[0].next;
+	if( NULL != skiplist->arena )
+	{
+		return skiplist->arena->mapped;
+	}
+
+	return skiplist->malloc_bytes;
 }
 
-skiplist_node_t *skiplist_begin( skiplist_t *skiplist )
+size_t skiplist_memory_held( const skiplist_t *skiplist, skiplist_error_t * const error )
 {
-	skiplist_node_t *begin = NULL;
+	size_t held = 0;
 	skiplist_error_t err;
 
-	err = skiplist_begin_check_clean( skiplist );
+	err = skiplist_memory_held_check_clean( skiplist );
 
 	if( SKIPLIST_ERROR_SUCCESS == err )
 	{
-		begin = skiplist_begin_clean( skiplist );
+		held = skiplist_memory_held_clean( skiplist );
 	}
 
-	return begin;
+	if( NULL != error )
+	{
+		*error = err;
+	}
+
+	return held;
 }
 
-skiplist_node_t *skiplist_end( void )
+/**
+ * @brief Estimates the bytes malloc() uses to satisfy a request of @p size bytes.
+ *
+ * Models the common dlmalloc derived allocators: a size_t header in front of
+ * each block, rounded up to twice the size of a size_t with a minimum of four.
+ */
+static size_t skiplist_malloc_footprint( size_t size )
 {
-	return NULL;
+	size_t align = 2 * sizeof( size_t );
+	size_t footprint = (size + sizeof( size_t ) + align - 1) & ~(align - 1);
+
+	return footprint < 2 * align ? 2 * align : footprint;
 }
 
-static skiplist_error_t skiplist_next_check_clean( const skiplist_node_t *cur )
+static skiplist_error_t skiplist_memory_usage_check_clean( const skiplist_t *skiplist,
+                                                           const skiplist_memory_usage_t *usage )
 {
-	if( NULL == cur )
+	if( NULL == skiplist )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( NULL == usage )
 	{
 		return SKIPLIST_ERROR_INVALID_INPUT;
 	}
@@ -793,92 +4423,142 @@ static skiplist_error_t skiplist_next_check_clean( const skiplist_node_t *cur )
 	return SKIPLIST_ERROR_SUCCESS;
 }
 
-static skiplist_node_t *skiplist_next_clean( const skiplist_node_t *cur )
+static void skiplist_memory_usage_clean( const skiplist_t *skiplist, skiplist_memory_usage_t *usage )
 {
-	return cur->link[0].next;
+	const skiplist_node_t *cur;
+	size_t header_size;
+	size_t footprint;
+	size_t key_size = 0;
+
+	header_size = sizeof( skiplist_t ) + sizeof( skiplist_link_t ) * (skiplist->head.levels - 1) +
+	              skiplist_node_aggregates_size( skiplist, skiplist->head.levels );
+
+	usage->header = header_size;
+	usage->node_headers = 0;
+	usage->links = 0;
+	usage->payloads = 0;
+	usage->keys = 0;
+	footprint = skiplist_malloc_footprint( header_size );
+
+	for( cur = skiplist->head.link[0].next; NULL != cur; cur = cur->link[0].next )
+	{
+		usage->node_headers += offsetof( skiplist_node_t, link ) + skiplist_node_versions_size( skiplist );
+		usage->links += sizeof( skiplist_link_t ) * cur->levels + skiplist_node_back_link_size( skiplist ) +
+		                skiplist_node_aggregates_size( skiplist, cur->levels );
+		usage->payloads += skiplist->payload_size;
+		if( SKIPLIST_KEY_BYTES == skiplist->key_type )
+		{
+			key_size = skiplist_node_key_size( skiplist, skiplist_node_key_length( skiplist, cur ) );
+		}
+		usage->keys += key_size;
+		footprint += skiplist_malloc_footprint( skiplist_node_size( skiplist, cur->levels ) + key_size );
+	}
+
+	if( NULL != skiplist->arena )
+	{
+		usage->header += sizeof( skiplist_arena_t );
+		footprint = skiplist->arena->mapped;
+	}
+
+	usage->total = footprint;
+	usage->slack = footprint - usage->header - usage->node_headers - usage->links - usage->payloads - usage->keys;
 }
 
-skiplist_node_t *skiplist_next( const skiplist_node_t *cur )
+skiplist_error_t skiplist_memory_usage( const skiplist_t *skiplist, skiplist_memory_usage_t *usage )
 {
-	skiplist_node_t *next = NULL;
 	skiplist_error_t err;
 
-	err = skiplist_next_check_clean( cur );
+	err = skiplist_memory_usage_check_clean( skiplist, usage );
 
 	if( SKIPLIST_ERROR_SUCCESS == err )
 	{
-		next = skiplist_next_clean( cur );
+		skiplist_memory_usage_clean( skiplist, usage );
 	}
 
-	return next;
+	return err;
 }
 
-static skiplist_error_t skiplist_node_value_check_clean( const skiplist_node_t *node )
+static skiplist_error_t skiplist_get_stats_check_clean( const skiplist_t *skiplist, skiplist_stats_t *stats )
 {
-	if( NULL == node )
+	if( NULL == skiplist )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( NULL == stats )
 	{
 		return SKIPLIST_ERROR_INVALID_INPUT;
 	}
 
+#ifndef SKIPLIST_STATS
+	return SKIPLIST_ERROR_NOT_SUPPORTED;
+#else
 	return SKIPLIST_ERROR_SUCCESS;
+#endif
 }
 
-static uintptr_t skiplist_node_value_clean( const skiplist_node_t *node )
+static void skiplist_get_stats_clean( const skiplist_t *skiplist, skiplist_stats_t *stats )
 {
-	return node->value;
+#ifdef SKIPLIST_STATS
+	*stats = skiplist->stats;
+#else
+	(void) skiplist;
+	(void) stats;
+#endif
 }
 
-uintptr_t skiplist_node_value( const skiplist_node_t *node, skiplist_error_t * const error )
+skiplist_error_t skiplist_get_stats( const skiplist_t *skiplist, skiplist_stats_t *stats )
 {
-	uintptr_t value = 0;
 	skiplist_error_t err;
 
-	err = skiplist_node_value_check_clean( node );
+	err = skiplist_get_stats_check_clean( skiplist, stats );
 
 	if( SKIPLIST_ERROR_SUCCESS == err )
 	{
-		value = skiplist_node_value_clean( node );
-	}
-
-	if( NULL != error )
-	{
-		*error = err;
+		skiplist_get_stats_clean( skiplist, stats );
 	}
 
-	return value;
+	return err;
 }
 
-static skiplist_error_t skiplist_size_check_clean( const skiplist_t *skiplist )
+static skiplist_error_t skiplist_reset_stats_check_clean( skiplist_t *skiplist )
 {
 	if( NULL == skiplist )
 	{
 		return SKIPLIST_ERROR_INVALID_INPUT;
 	}
 
+#ifndef SKIPLIST_STATS
+	return SKIPLIST_ERROR_NOT_SUPPORTED;
+#else
 	return SKIPLIST_ERROR_SUCCESS;
+#endif
 }
 
-static unsigned int skiplist_size_clean( const skiplist_t *skiplist )
+static void skiplist_reset_stats_clean( skiplist_t *skiplist )
 {
-	return skiplist->num_nodes;
+#ifdef SKIPLIST_STATS
+	unsigned long level_histogram[SKIPLIST_MAX_LINKS];
+
+	/* The level histogram describes the nodes in the list rather than counting operations. */
+	memcpy( level_histogram, skiplist->stats.level_histogram, sizeof( level_histogram ) );
+	memset( &skiplist->stats, 0, sizeof( skiplist->stats ) );
+	memcpy( skiplist->stats.level_histogram, level_histogram, sizeof( level_histogram ) );
+#else
+	(void) skiplist;
+#endif
 }
 
-unsigned int skiplist_size( const skiplist_t *skiplist, skiplist_error_t * const error )
+skiplist_error_t skiplist_reset_stats( skiplist_t *skiplist )
 {
-	unsigned int size = 0;
 	skiplist_error_t err;
 
-	err = skiplist_size_check_clean( skiplist );
+	err = skiplist_reset_stats_check_clean( skiplist );
 
 	if( SKIPLIST_ERROR_SUCCESS == err )
 	{
-		size = skiplist_size_clean( skiplist );
-	}
-
-	if( NULL != error )
-	{
-		*error = err;
+		skiplist_reset_stats_clean( skiplist );
 	}
 
-	return size;
+	return err;
 }
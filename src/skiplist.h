@@ -34,6 +34,36 @@ skiplist_t *skiplist_create( skiplist_properties_t properties,
                              skiplist_fprintf_pfn print,
                              skiplist_error_t * const error );
 
+/**
+ * @brief Initializes a set of skiplist options to their default values.
+ *
+ * The defaults are a non-unique skiplist with SKIPLIST_MAX_LINKS links whose
+ * memory is allocated with malloc(). The compare and print functions must
+ * be set by the caller.
+ *
+ * @param [out] options  The options to initialize.
+ *
+ * @retval SKIPLIST_ERROR_SUCCESS if successful.
+ * @retval SKIPLIST_ERROR_INVALID_INPUT if @p options was NULL.
+ */
+skiplist_error_t skiplist_options_init( skiplist_options_t *options );
+
+/**
+ * @brief Creates a new skiplist from a set of options.
+ *
+ * @param [in]  options  The options for the new skiplist, see skiplist_options_t.
+ * @param [out] error    Will point to the error status of the function on
+ *                       return. May be set to NULL.
+ *                       SKIPLIST_ERROR_SUCCESS if successful.
+ *                       SKIPLIST_ERROR_INVALID_INPUT if this function was
+ *                       called with invalid input values.
+ *                       SKIPLIST_ERROR_OUT_OF_MEMORY if this function failed
+ *                       to allocate memory.
+ *
+ * @return If successful a new skiplist is returned, otherwise NULL.
+ */
+skiplist_t *skiplist_create_with_options( const skiplist_options_t *options, skiplist_error_t * const error );
+
 /**
  * @brief Destroys a skiplist that was created via skiplist_create().
  *
@@ -61,6 +91,41 @@ skiplist_error_t skiplist_destroy( skiplist_t *skiplist );
  */
 unsigned int skiplist_contains( const skiplist_t *skiplist, uintptr_t value, skiplist_error_t * const error );
 
+/**
+ * @brief Determines whether each of a sorted batch of values exists in the skiplist.
+ *
+ * The batch is searched for in one pass. Each search carries on from the
+ * path of the one before it, only climbing as high as needed to jump the
+ * gap, so a dense batch costs about as much as merging it with the list
+ * and a sparse one about O(n log(N/n)) comparisons.
+ *
+ * @param [in]  skiplist  The skiplist to search.
+ * @param [in]  keys      The values to search for, in ascending order by the skiplist's compare function.
+ * @param [in]  n         The number of values in @p keys.
+ * @param [out] results   Receives 1 for each value in @p keys that exists and 0 for each one that doesn't.
+ *
+ * @retval SKIPLIST_ERROR_SUCCESS if successful.
+ * @retval SKIPLIST_ERROR_INVALID_INPUT if input values were invalid or @p keys wasn't in ascending order.
+ * @retval SKIPLIST_ERROR_NOT_SUPPORTED if @p skiplist has byte string keys.
+ */
+skiplist_error_t skiplist_contains_sorted( const skiplist_t *skiplist, const uintptr_t *keys, skiplist_size_t n,
+                                           unsigned int *results );
+
+/**
+ * @brief Finds the nodes holding each of a sorted batch of values, see skiplist_contains_sorted().
+ *
+ * @param [in]  skiplist  The skiplist to search.
+ * @param [in]  keys      The values to search for, in ascending order by the skiplist's compare function.
+ * @param [in]  n         The number of values in @p keys.
+ * @param [out] nodes     Receives the first node holding each value in @p keys, or NULL if it doesn't exist.
+ *
+ * @retval SKIPLIST_ERROR_SUCCESS if successful.
+ * @retval SKIPLIST_ERROR_INVALID_INPUT if input values were invalid or @p keys wasn't in ascending order.
+ * @retval SKIPLIST_ERROR_NOT_SUPPORTED if @p skiplist has byte string keys.
+ */
+skiplist_error_t skiplist_find_sorted( skiplist_t *skiplist, const uintptr_t *keys, skiplist_size_t n,
+                                       skiplist_node_t **nodes );
+
 /**
  * @brief Insert a value into a skiplist.
  *
@@ -70,12 +135,17 @@ unsigned int skiplist_contains( const skiplist_t *skiplist, uintptr_t value, ski
  * @retval SKIPLIST_ERROR_SUCCESS if successful.
  * @retval SKIPLIST_ERROR_OUT_OF_MEMORY if a memory allocation failed
  * @retval SKIPLIST_ERROR_INVALID_INPUT if input values were invalid.
+ * @retval SKIPLIST_ERROR_IO if @p value was inserted but an attached write-ahead log couldn't record it.
+ * @retval SKIPLIST_ERROR_FULL if @p skiplist already holds SKIPLIST_MAX_SIZE nodes.
  */
 skiplist_error_t skiplist_insert( skiplist_t *skiplist, uintptr_t value );
 
 /**
  * @brief Removes a value from a skiplist.
  *
+ * A SKIPLIST_PROPERTY_LAZY_DELETE or SKIPLIST_PROPERTY_VERSIONED skiplist
+ * only marks the value's node as a tombstone, which skiplist_compact() frees later.
+ *
  * @param [in] skiplist  The skiplist to remove @p value from.
  * @param [in] value     The value to remove from @p skiplist.
  *                       Must exist in the skiplist for this function to
@@ -83,9 +153,207 @@ skiplist_error_t skiplist_insert( skiplist_t *skiplist, uintptr_t value );
  *
  * @retval SKIPLIST_ERROR_SUCCESS if the value was successfully removed.
  * @retval SKIPLIST_ERROR_INVALID_INPUT if input values were invalid.
+ * @retval SKIPLIST_ERROR_IO if @p value was removed but an attached write-ahead log couldn't record it.
  */
 skiplist_error_t skiplist_remove( skiplist_t *skiplist, uintptr_t value );
 
+/**
+ * @brief Returns the payload stored with a key in a map.
+ *
+ * Maps are skiplists created with SKIPLIST_PROPERTY_UNIQUE and a non-zero
+ * skiplist_options_t::payload_size. Each node holds its key as the value and
+ * the payload inline after its links, so a lookup touches a single allocation.
+ *
+ * @param [in]  skiplist  The map to search in.
+ * @param [in]  key       The key to search for.
+ * @param [out] error     Will point to the error status of the function on return. May be set to NULL.
+ *                        SKIPLIST_ERROR_SUCCESS if successful.
+ *                        SKIPLIST_ERROR_INVALID_INPUT if this function was called with invalid input values.
+ *                        SKIPLIST_ERROR_NOT_SUPPORTED if @p skiplist isn't a map.
+ *
+ * @return A pointer to the payload_size bytes of payload, aligned for any
+ *         pointer or integer type, which stays valid until @p key is erased.
+ *         NULL if @p key isn't in @p skiplist or on error.
+ */
+void *skiplist_get( const skiplist_t *skiplist, uintptr_t key, skiplist_error_t * const error );
+
+/**
+ * @brief Inserts a key into a map, or updates its payload if it's already there.
+ *
+ * While a SKIPLIST_PROPERTY_VERSIONED map has open snapshots, an update
+ * stores the new payload in a new node and removes the old one, so the
+ * snapshots keep seeing the old payload.
+ *
+ * @param [in] skiplist  The map to update.
+ * @param [in] key       The key to insert or update.
+ * @param [in] payload   The payload_size bytes to store with @p key.
+ *
+ * @retval SKIPLIST_ERROR_SUCCESS if successful.
+ * @retval SKIPLIST_ERROR_OUT_OF_MEMORY if a memory allocation failed.
+ * @retval SKIPLIST_ERROR_INVALID_INPUT if input values were invalid.
+ * @retval SKIPLIST_ERROR_NOT_SUPPORTED if @p skiplist isn't a map.
+ * @retval SKIPLIST_ERROR_FULL if @p key is new and @p skiplist already holds SKIPLIST_MAX_SIZE nodes.
+ */
+skiplist_error_t skiplist_put( skiplist_t *skiplist, uintptr_t key, const void *payload );
+
+/**
+ * @brief Removes a key and its payload from a map.
+ *
+ * @param [in]  skiplist  The map to remove @p key from.
+ * @param [in]  key       The key to remove.
+ * @param [out] payload   Receives the payload_size bytes of payload that were stored with @p key. May be NULL.
+ *
+ * @retval SKIPLIST_ERROR_SUCCESS if the key was removed.
+ * @retval SKIPLIST_ERROR_INVALID_INPUT if input values were invalid or @p key isn't in @p skiplist.
+ * @retval SKIPLIST_ERROR_NOT_SUPPORTED if @p skiplist isn't a map.
+ */
+skiplist_error_t skiplist_erase( skiplist_t *skiplist, uintptr_t key, void *payload );
+
+/**
+ * @brief Unlinks and frees every tombstone left by removes from a SKIPLIST_PROPERTY_LAZY_DELETE skiplist.
+ *
+ * This takes a single pass over the bottom level of the list, however many
+ * tombstones there are. It does nothing for skiplists without tombstones.
+ * Tombstones an open snapshot can still see are kept.
+ *
+ * @param [in] skiplist  The skiplist to compact.
+ *
+ * @retval SKIPLIST_ERROR_SUCCESS if successful.
+ * @retval SKIPLIST_ERROR_INVALID_INPUT if input values were invalid.
+ */
+skiplist_error_t skiplist_compact( skiplist_t *skiplist );
+
+/**
+ * @brief Takes a snapshot of a SKIPLIST_PROPERTY_VERSIONED skiplist.
+ *
+ * The snapshot sees the list as it is now, whatever is inserted or removed
+ * afterwards. Tombstones it can see, and so the memory of every node it can
+ * reach, are kept until it's released. The skiplist isn't thread safe, a
+ * reader iterating a snapshot must still hold the same lock as writers for
+ * each call, but writers can change the list between the calls without the
+ * reader seeing a torn view.
+ *
+ * @param [in]  skiplist  The skiplist to take a snapshot of.
+ * @param [out] error     Will point to the error status of the function on return. May be set to NULL.
+ *                        SKIPLIST_ERROR_SUCCESS if successful.
+ *                        SKIPLIST_ERROR_INVALID_INPUT if this function was called with invalid input values.
+ *                        SKIPLIST_ERROR_OUT_OF_MEMORY if this function failed to allocate memory.
+ *                        SKIPLIST_ERROR_NOT_SUPPORTED if @p skiplist isn't SKIPLIST_PROPERTY_VERSIONED.
+ *
+ * @return If successful the snapshot, otherwise NULL.
+ */
+skiplist_snapshot_t *skiplist_snapshot_create( skiplist_t *skiplist, skiplist_error_t * const error );
+
+/**
+ * @brief Releases a snapshot, freeing the tombstones only it could still see.
+ *
+ * Snapshots may be released in any order, and after their skiplist is destroyed.
+ *
+ * @param [in] snapshot  The snapshot to release.
+ *
+ * @retval SKIPLIST_ERROR_SUCCESS if successful.
+ * @retval SKIPLIST_ERROR_INVALID_INPUT if input values were invalid.
+ */
+skiplist_error_t skiplist_snapshot_release( skiplist_snapshot_t *snapshot );
+
+/**
+ * @brief Searches for a value as it was when a snapshot was taken.
+ *
+ * @param [in]  snapshot  The snapshot to search in.
+ * @param [in]  value     The value to search for.
+ * @param [out] error     Will point to the error status of the function on return. May be set to NULL.
+ *                        SKIPLIST_ERROR_SUCCESS if successful.
+ *                        SKIPLIST_ERROR_INVALID_INPUT if this function was called with invalid input values
+ *                        or the snapshot's skiplist was destroyed.
+ *                        SKIPLIST_ERROR_NOT_SUPPORTED if the skiplist has byte string keys.
+ *
+ * @return The first node holding @p value that @p snapshot sees, NULL if there isn't one or on error.
+ */
+skiplist_node_t *skiplist_snapshot_find( const skiplist_snapshot_t *snapshot, uintptr_t value,
+                                         skiplist_error_t * const error );
+
+/**
+ * @brief Returns the first node a snapshot sees.
+ *
+ * @param [in] snapshot  The snapshot to iterate.
+ *
+ * @return The first node, skiplist_end() if the snapshot is empty or on invalid input.
+ */
+skiplist_node_t *skiplist_snapshot_begin( const skiplist_snapshot_t *snapshot );
+
+/**
+ * @brief Returns the node a snapshot sees after @p cur.
+ *
+ * @param [in] snapshot  The snapshot being iterated.
+ * @param [in] cur       A node returned by skiplist_snapshot_begin() or skiplist_snapshot_next().
+ *
+ * @return The next node, skiplist_end() at the end of the snapshot or on invalid input.
+ */
+skiplist_node_t *skiplist_snapshot_next( const skiplist_snapshot_t *snapshot, const skiplist_node_t *cur );
+
+/**
+ * @brief Returns the number of nodes a snapshot sees.
+ *
+ * @param [in]  snapshot  The snapshot to count the nodes in.
+ * @param [out] error     Will point to the error status of the function on return. May be set to NULL.
+ *                        SKIPLIST_ERROR_SUCCESS if successful.
+ *                        SKIPLIST_ERROR_INVALID_INPUT if this function was called with invalid input values
+ *                        or the snapshot's skiplist was destroyed.
+ *
+ * @return The number of nodes in @p snapshot. 0 on invalid input.
+ */
+skiplist_size_t skiplist_snapshot_size( const skiplist_snapshot_t *snapshot, skiplist_error_t * const error );
+
+/**
+ * @brief Inserts a byte string key into a skiplist created with SKIPLIST_KEY_BYTES.
+ *
+ * The key is copied into the node, after its links and any payload. Keys are
+ * ordered as by memcmp(), with a key that is a prefix of another ordered first.
+ * The node's value caches the first sizeof( uintptr_t ) bytes of the key, so
+ * most comparisons during a search are made without touching the key bytes.
+ *
+ * @param [in] skiplist  The skiplist to insert @p key into.
+ * @param [in] key       The bytes of the key. May be NULL if @p length is 0.
+ * @param [in] length    The number of bytes in @p key, up to SKIPLIST_MAX_KEY_SIZE.
+ *
+ * @retval SKIPLIST_ERROR_SUCCESS if successful.
+ * @retval SKIPLIST_ERROR_OUT_OF_MEMORY if a memory allocation failed.
+ * @retval SKIPLIST_ERROR_INVALID_INPUT if input values were invalid.
+ * @retval SKIPLIST_ERROR_NOT_SUPPORTED if @p skiplist wasn't created with SKIPLIST_KEY_BYTES.
+ * @retval SKIPLIST_ERROR_FULL if @p skiplist already holds SKIPLIST_MAX_SIZE nodes.
+ */
+skiplist_error_t skiplist_insert_bytes( skiplist_t *skiplist, const void *key, size_t length );
+
+/**
+ * @brief Determines whether a byte string key exists in a skiplist created with SKIPLIST_KEY_BYTES.
+ *
+ * @param [in]  skiplist  The skiplist to search.
+ * @param [in]  key       The bytes of the key. May be NULL if @p length is 0.
+ * @param [in]  length    The number of bytes in @p key.
+ * @param [out] error     Will point to the error status of the function on return. May be set to NULL.
+ *                        SKIPLIST_ERROR_SUCCESS if successful.
+ *                        SKIPLIST_ERROR_INVALID_INPUT if this function was called with invalid input values.
+ *                        SKIPLIST_ERROR_NOT_SUPPORTED if @p skiplist wasn't created with SKIPLIST_KEY_BYTES.
+ *
+ * @retval 1 If the key exists in the skiplist.
+ * @retval 0 If the key doesn't exist in the skiplist, or on error.
+ */
+unsigned int skiplist_contains_bytes( const skiplist_t *skiplist, const void *key, size_t length,
+                                      skiplist_error_t * const error );
+
+/**
+ * @brief Removes a byte string key from a skiplist created with SKIPLIST_KEY_BYTES.
+ *
+ * @param [in] skiplist  The skiplist to remove @p key from.
+ * @param [in] key       The bytes of the key. May be NULL if @p length is 0.
+ * @param [in] length    The number of bytes in @p key.
+ *
+ * @retval SKIPLIST_ERROR_SUCCESS if the key was removed.
+ * @retval SKIPLIST_ERROR_INVALID_INPUT if input values were invalid or @p key isn't in @p skiplist.
+ * @retval SKIPLIST_ERROR_NOT_SUPPORTED if @p skiplist wasn't created with SKIPLIST_KEY_BYTES.
+ */
+skiplist_error_t skiplist_remove_bytes( skiplist_t *skiplist, const void *key, size_t length );
+
 /**
  * @brief Prints the skiplist in DOT format to stdout.
  *
@@ -119,6 +387,54 @@ skiplist_error_t skiplist_fprintf( FILE *stream, const skiplist_t *skiplist );
  */
 skiplist_error_t skiplist_fprintf_filename( const char *filename, const skiplist_t *skiplist );
 
+/**
+ * @brief Writes a summary of the skiplist's shape to @p stream as a single line of JSON.
+ *
+ * Unlike skiplist_fprintf() the output size only depends on the number of levels so this
+ * is suitable for very large skiplists. The summary is gathered in one pass over the
+ * bottom level and contains:
+ * - "num_nodes", "tombstones", "levels" and "levels_used", the number of levels any node
+ *   actually has.
+ * - "expected_mean_comparisons", the mean number of comparisons made by skiplist_contains()
+ *   for an ideal skiplist of the same size and level cap.
+ * - "actual_mean_comparisons" and "max_comparisons" for searching each value in the list.
+ *
+ * Searches step over tombstones like live nodes, so every other figure counts both and
+ * the means are over num_nodes plus tombstones.
+ * - "per_level", one entry per level with the number of "nodes" on the level, the
+ *   "expected_nodes", the "mean_width" and "max_width" of links on the level and the index
+ *   of the node the widest link starts from, "max_width_from", -1 being the head.
+ *
+ * A level cap that's too small for the number of elements shows up as an actual mean
+ * comparison count far larger than log2() of the number of nodes and a very large
+ * number of nodes on the top level.
+ *
+ * @param [in] stream    The filestream to write to.
+ * @param [in] skiplist  The skiplist to analyze.
+ *
+ * @retval SKIPLIST_ERROR_SUCCESS if the analysis was successfully written.
+ * @retval SKIPLIST_ERROR_INVALID_INPUT if the input values were invalid.
+ */
+skiplist_error_t skiplist_analyze( FILE *stream, const skiplist_t *skiplist );
+
+/**
+ * @brief Prints the part of the skiplist between two values in DOT format.
+ *
+ * Every link leaving a node whose value is in [@p low, @p high] is printed, so the
+ * output stays renderable for very large skiplists.
+ *
+ * @param [in] stream     The filestream to print to.
+ * @param [in] skiplist   The skiplist to print.
+ * @param [in] low        The smallest value to print.
+ * @param [in] high       The largest value to print.
+ * @param [in] max_nodes  The maximum number of nodes to print, 0 for no limit.
+ *
+ * @retval SKIPLIST_ERROR_SUCCESS if the skiplist was successfully printed.
+ * @retval SKIPLIST_ERROR_INVALID_INPUT if the input values were invalid.
+ */
+skiplist_error_t skiplist_fprintf_window( FILE *stream, const skiplist_t *skiplist,
+                                          uintptr_t low, uintptr_t high, unsigned int max_nodes );
+
 /**
  * @brief Returns the value of the node at the given index.
  *
@@ -132,9 +448,165 @@ skiplist_error_t skiplist_fprintf_filename( const char *filename, const skiplist
  *                        SKIPLIST_ERROR_INVALID_INPUT if this function was
  *                        called with invalid input values.
  *
- * @return The value at index @p index.
+ * @return The value at index @p index. For SKIPLIST_KEY_BYTES skiplists this is only
+ *         the cached prefix of the key, use skiplist_node_key() for the whole key.
  */
-uintptr_t skiplist_at_index( const skiplist_t *skiplist, unsigned int index, skiplist_error_t * const error );
+uintptr_t skiplist_at_index( const skiplist_t *skiplist, skiplist_size_t index, skiplist_error_t * const error );
+
+/**
+ * @brief Returns the values at many indices in one pass.
+ *
+ * Each index is found by carrying on from the search path of the one before
+ * it, only climbing as high as needed to reach it, rather than starting
+ * again from the head as skiplist_at_index() would.
+ *
+ * @param [in]  skiplist  The skiplist to index.
+ * @param [in]  ranks     The indices to look up, in ascending order. Repeats are allowed.
+ * @param [in]  k         The number of indices in @p ranks.
+ * @param [out] out       Receives the value at each index in @p ranks, room for @p k of them.
+ *
+ * @retval SKIPLIST_ERROR_SUCCESS if successful.
+ * @retval SKIPLIST_ERROR_INVALID_INPUT if input values were invalid, an index was out of range or
+ *                                      @p ranks wasn't in ascending order.
+ */
+skiplist_error_t skiplist_select_many( const skiplist_t *skiplist, const skiplist_size_t *ranks, skiplist_size_t k,
+                                       uintptr_t *out );
+
+/**
+ * @brief Returns the values at many quantiles in one pass, see skiplist_select_many().
+ *
+ * Quantiles use the nearest rank method: quantile q is the value at the
+ * smallest index with at least a fraction q of the list at or before it.
+ *
+ * @param [in]  skiplist   The skiplist to index, which mustn't be empty.
+ * @param [in]  quantiles  The quantiles to look up, each in [0, 1] and in ascending order.
+ * @param [in]  k          The number of quantiles in @p quantiles.
+ * @param [out] out        Receives the value at each quantile, room for @p k of them.
+ *
+ * @retval SKIPLIST_ERROR_SUCCESS if successful.
+ * @retval SKIPLIST_ERROR_INVALID_INPUT if input values were invalid.
+ */
+skiplist_error_t skiplist_quantiles( const skiplist_t *skiplist, const double *quantiles, skiplist_size_t k,
+                                     uintptr_t *out );
+
+/**
+ * @brief Returns the value at a quantile, see skiplist_quantiles().
+ *
+ * @param [in]  skiplist  The skiplist to index, which mustn't be empty.
+ * @param [in]  q         The quantile, in [0, 1].
+ * @param [out] error     Will point to the error status of the function on return. May be set to NULL.
+ *                        SKIPLIST_ERROR_SUCCESS if successful.
+ *                        SKIPLIST_ERROR_INVALID_INPUT if this function was called with invalid input values.
+ *
+ * @return The value at quantile @p q. 0 on invalid input.
+ */
+uintptr_t skiplist_quantile( const skiplist_t *skiplist, double q, skiplist_error_t * const error );
+
+/**
+ * @brief Returns the median value, the lower of the middle two when the size is even.
+ *
+ * @param [in]  skiplist  The skiplist to index, which mustn't be empty.
+ * @param [out] error     Will point to the error status of the function on return. May be set to NULL.
+ *                        SKIPLIST_ERROR_SUCCESS if successful.
+ *                        SKIPLIST_ERROR_INVALID_INPUT if this function was called with invalid input values.
+ *
+ * @return The median value. 0 on invalid input.
+ */
+uintptr_t skiplist_median( const skiplist_t *skiplist, skiplist_error_t * const error );
+
+/**
+ * @brief Seeds a random number generator for skiplist_sample().
+ *
+ * Seed 0 gives the state every skiplist's own generator starts in.
+ *
+ * @param [out] rng   The random number generator state to seed.
+ * @param [in]  seed  The seed, the same seed always gives the same sequence.
+ *
+ * @retval SKIPLIST_ERROR_SUCCESS if successful.
+ * @retval SKIPLIST_ERROR_INVALID_INPUT if input values were invalid.
+ */
+skiplist_error_t skiplist_rng_seed( skiplist_rng_t *rng, unsigned int seed );
+
+/**
+ * @brief Draws a uniform random sample of the values in the skiplist.
+ *
+ * The random indices are drawn and sorted first, then looked up in one pass
+ * as with skiplist_select_many(), so the sample comes out in list order.
+ *
+ * @param [in]     skiplist     The skiplist to sample.
+ * @param [in]     k            The number of values to draw.
+ * @param [in,out] rng          The random number generator to draw with, see skiplist_rng_seed(). NULL uses
+ *                              the skiplist's own, the one node levels are drawn from, so a list built and
+ *                              sampled the same way always gives the same sample.
+ * @param [in]     replacement  Non-zero to allow drawing a node more than once, otherwise every node in the
+ *                              sample is distinct and @p k can't be more than the size of the list.
+ * @param [out]    out          Receives the sampled values, room for @p k of them.
+ *
+ * @retval SKIPLIST_ERROR_SUCCESS if successful.
+ * @retval SKIPLIST_ERROR_INVALID_INPUT if input values were invalid, including sampling an empty list.
+ * @retval SKIPLIST_ERROR_OUT_OF_MEMORY if the indices couldn't be allocated.
+ */
+skiplist_error_t skiplist_sample( skiplist_t *skiplist, skiplist_size_t k, skiplist_rng_t *rng,
+                                  unsigned int replacement, uintptr_t *out );
+
+/**
+ * @brief Copies the values at consecutive indices into a buffer.
+ *
+ * The first index is found with the same descent as skiplist_at_index(),
+ * then the values are copied along the bottom level in one loop. This is
+ * much cheaper per value than skiplist_next() and skiplist_node_value().
+ *
+ * @param [in]  skiplist     The skiplist to copy from.
+ * @param [in]  start_index  The index of the first value to copy, at most skiplist_size().
+ * @param [in]  count        The most values to copy.
+ * @param [out] out          Receives the values, room for @p count of them.
+ * @param [out] error        Will point to the error status of the function on return. May be set to NULL.
+ *                           SKIPLIST_ERROR_SUCCESS if successful.
+ *                           SKIPLIST_ERROR_INVALID_INPUT if this function was called with invalid input values.
+ *
+ * @return The number of values copied, fewer than @p count if the list ends first. 0 on error.
+ */
+skiplist_size_t skiplist_copy_range( const skiplist_t *skiplist, skiplist_size_t start_index, skiplist_size_t count,
+                                     uintptr_t *out, skiplist_error_t * const error );
+
+/**
+ * @brief Copies the values in [@p low, @p high] into a buffer, in order.
+ *
+ * @param [in]  skiplist  The skiplist to copy from.
+ * @param [in]  low       The smallest value to copy.
+ * @param [in]  high      The largest value to copy.
+ * @param [out] out       Receives the values, room for @p cap of them.
+ * @param [in]  cap       The most values to copy.
+ * @param [out] error     Will point to the error status of the function on return. May be set to NULL.
+ *                        SKIPLIST_ERROR_SUCCESS if successful.
+ *                        SKIPLIST_ERROR_INVALID_INPUT if this function was called with invalid input values.
+ *                        SKIPLIST_ERROR_NOT_SUPPORTED if @p skiplist has byte string keys.
+ *
+ * @return The number of values copied. If it's @p cap there may be more in the range.
+ */
+skiplist_size_t skiplist_copy_values_between( const skiplist_t *skiplist, uintptr_t low, uintptr_t high,
+                                              uintptr_t *out, skiplist_size_t cap, skiplist_error_t * const error );
+
+/**
+ * @brief Combines the values in [@p low, @p high] with the skiplist's aggregate function.
+ *
+ * Each link keeps the aggregate of the nodes it skips, see
+ * skiplist_options_t::aggregate, so a range costs O(log N) however many
+ * values it holds. Values are combined in ascending order.
+ *
+ * @param [in]  skiplist  The skiplist to aggregate.
+ * @param [in]  low       The smallest value to include.
+ * @param [in]  high      The largest value to include.
+ * @param [out] error     Will point to the error status of the function on return. May be set to NULL.
+ *                        SKIPLIST_ERROR_SUCCESS if successful.
+ *                        SKIPLIST_ERROR_INVALID_INPUT if this function was called with invalid input values.
+ *                        SKIPLIST_ERROR_NOT_SUPPORTED if @p skiplist wasn't created with an aggregate function.
+ *
+ * @return The aggregate of the values in the range, skiplist_options_t::aggregate_identity if there are none.
+ *         0 on invalid input.
+ */
+uintptr_t skiplist_range_aggregate( const skiplist_t *skiplist, uintptr_t low, uintptr_t high,
+                                    skiplist_error_t * const error );
 
 /**
  * @brief Returns a pointer to the start of the skiplist.
@@ -162,6 +634,126 @@ skiplist_node_t *skiplist_end( void );
  */
 skiplist_node_t *skiplist_next( const skiplist_node_t *cur );
 
+/**
+ * @brief Returns the last node in a SKIPLIST_PROPERTY_BACK_LINKS skiplist, to iterate it backwards with skiplist_prev().
+ *
+ * @param [in] skiplist  The skiplist to iterate.
+ *
+ * @return The last node, skiplist_end() if the list is empty, has no back links or on invalid input.
+ */
+skiplist_node_t *skiplist_rbegin( skiplist_t *skiplist );
+
+/**
+ * @brief Returns the node before @p cur in a SKIPLIST_PROPERTY_BACK_LINKS skiplist.
+ *
+ * @param [in] skiplist  The skiplist being iterated.
+ * @param [in] cur       A node of @p skiplist.
+ *
+ * @return The previous node, skiplist_end() at the start of the list or on invalid input.
+ */
+skiplist_node_t *skiplist_prev( const skiplist_t *skiplist, const skiplist_node_t *cur );
+
+/**
+ * @brief Returns the largest value in a SKIPLIST_PROPERTY_BACK_LINKS skiplist.
+ *
+ * @param [in]  skiplist  The skiplist to search in.
+ * @param [out] error     Will point to the error status of the function on return. May be set to NULL.
+ *                        SKIPLIST_ERROR_SUCCESS if successful.
+ *                        SKIPLIST_ERROR_INVALID_INPUT if this function was called with invalid input values
+ *                        or the list is empty.
+ *                        SKIPLIST_ERROR_NOT_SUPPORTED if @p skiplist has no back links.
+ *
+ * @return The value of the last node. 0 on error.
+ */
+uintptr_t skiplist_last( const skiplist_t *skiplist, skiplist_error_t * const error );
+
+/**
+ * @brief Removes the node @p node from a skiplist.
+ *
+ * Unlike skiplist_remove() this removes exactly @p node when the list holds
+ * several nodes with its value, and works for byte string keys as well. The
+ * search for the links above the node still compares values, then steps
+ * over any nodes with the same value before @p node.
+ *
+ * @param [in] skiplist  The skiplist to remove @p node from.
+ * @param [in] node      A node of @p skiplist, which is freed unless the list leaves tombstones.
+ *
+ * @retval SKIPLIST_ERROR_SUCCESS if the node was removed.
+ * @retval SKIPLIST_ERROR_INVALID_INPUT if input values were invalid or @p node isn't in @p skiplist.
+ * @retval SKIPLIST_ERROR_IO if @p node was removed but an attached write-ahead log couldn't record it.
+ */
+skiplist_error_t skiplist_remove_node( skiplist_t *skiplist, skiplist_node_t *node );
+
+/**
+ * @brief Inserts a value and returns its node, for using the list as a priority queue.
+ *
+ * The node is a handle for skiplist_update_node() and skiplist_remove_node(),
+ * and skiplist_node_payload() gives the place to store what the value is the
+ * priority of.
+ *
+ * @param [in]  skiplist  The skiplist to insert into.
+ * @param [in]  value     The value to insert.
+ * @param [out] error     Will point to the error status of the function on return. May be set to NULL.
+ *                        SKIPLIST_ERROR_SUCCESS if successful.
+ *                        SKIPLIST_ERROR_INVALID_INPUT if this function was called with invalid input values.
+ *                        SKIPLIST_ERROR_OUT_OF_MEMORY if this function failed to allocate memory.
+ *                        SKIPLIST_ERROR_NOT_SUPPORTED if @p skiplist has byte string keys.
+ *                        SKIPLIST_ERROR_FULL if @p skiplist already holds SKIPLIST_MAX_SIZE nodes.
+ *                        SKIPLIST_ERROR_IO if the value was inserted but an attached write-ahead log couldn't
+ *                        record it.
+ *
+ * @return The new node, or the node already holding @p value in a skiplist set. NULL if nothing was inserted.
+ */
+skiplist_node_t *skiplist_push( skiplist_t *skiplist, uintptr_t value, skiplist_error_t * const error );
+
+/**
+ * @brief Removes the smallest value without searching for it.
+ *
+ * The first node follows the head on every level, so it's unlinked in
+ * O(levels). It's freed even in SKIPLIST_PROPERTY_LAZY_DELETE lists, along
+ * with any tombstones in front of it. While snapshots are open the node is
+ * removed as skiplist_remove_node() would.
+ *
+ * @param [in]  skiplist  The skiplist to remove the smallest value from.
+ * @param [out] payload   Receives the payload_size bytes of payload stored with the value. May be NULL.
+ * @param [out] error     Will point to the error status of the function on return. May be set to NULL.
+ *                        SKIPLIST_ERROR_SUCCESS if successful.
+ *                        SKIPLIST_ERROR_INVALID_INPUT if this function was called with invalid input values
+ *                        or the list is empty.
+ *                        SKIPLIST_ERROR_IO if the value was removed but an attached write-ahead log couldn't
+ *                        record it.
+ *
+ * @return The smallest value. 0 on invalid input.
+ */
+uintptr_t skiplist_pop_min( skiplist_t *skiplist, void *payload, skiplist_error_t * const error );
+
+/**
+ * @brief Changes the value of a node, moving it to keep the list in order.
+ *
+ * A node whose new value still sorts between its neighbours is changed in
+ * place in O(1). Telling that a smaller value doesn't move it back needs
+ * SKIPLIST_PROPERTY_BACK_LINKS. Otherwise the node is unlinked and linked in
+ * again at its new position, keeping its memory and payload, so the handle
+ * stays valid. While snapshots are open the node is replaced by a new node
+ * instead, so they keep seeing the old value.
+ *
+ * @param [in]  skiplist  The skiplist holding @p node.
+ * @param [in]  node      A node of @p skiplist.
+ * @param [in]  value     The node's new value.
+ * @param [out] error     Will point to the error status of the function on return. May be set to NULL.
+ *                        SKIPLIST_ERROR_SUCCESS if successful.
+ *                        SKIPLIST_ERROR_INVALID_INPUT if this function was called with invalid input values,
+ *                        @p node isn't in @p skiplist, or @p value is already in a skiplist set.
+ *                        SKIPLIST_ERROR_OUT_OF_MEMORY if a replacement node couldn't be allocated.
+ *                        SKIPLIST_ERROR_NOT_SUPPORTED if @p skiplist has byte string keys.
+ *                        SKIPLIST_ERROR_IO if the node was updated but an attached write-ahead log couldn't
+ *                        record it.
+ *
+ * @return The node now holding @p value, @p node unless snapshots are open. NULL if nothing was changed.
+ */
+skiplist_node_t *skiplist_update_node( skiplist_t *skiplist, skiplist_node_t *node, uintptr_t value,
+                                       skiplist_error_t * const error );
+
 /**
  * @brief Returns the value at the given node.
  *
@@ -175,6 +767,37 @@ skiplist_node_t *skiplist_next( const skiplist_node_t *cur );
  */
 uintptr_t skiplist_node_value( const skiplist_node_t *node, skiplist_error_t * const error );
 
+/**
+ * @brief Returns the payload stored in the given node of a map.
+ *
+ * Together with skiplist_node_value() this iterates a map's keys and payloads in order.
+ * For skiplists without a payload the result points to zero bytes.
+ *
+ * @param [in]  node   The node to return the payload for.
+ * @param [out] error  Will point to the error status of the function on return. May be set to NULL.
+ *                     SKIPLIST_ERROR_SUCCESS if successful.
+ *                     SKIPLIST_ERROR_INVALID_INPUT if this function was called with invalid input values.
+ *
+ * @return A pointer to the node's payload. NULL on invalid input.
+ */
+void *skiplist_node_payload( const skiplist_node_t *node, skiplist_error_t * const error );
+
+/**
+ * @brief Returns the byte string key stored in the given node of a SKIPLIST_KEY_BYTES skiplist.
+ *
+ * @param [in]  skiplist  The skiplist @p node belongs to.
+ * @param [in]  node      The node to return the key for.
+ * @param [out] length    Receives the number of bytes in the key, 0 on error. May be NULL.
+ * @param [out] error     Will point to the error status of the function on return. May be set to NULL.
+ *                        SKIPLIST_ERROR_SUCCESS if successful.
+ *                        SKIPLIST_ERROR_INVALID_INPUT if this function was called with invalid input values.
+ *                        SKIPLIST_ERROR_NOT_SUPPORTED if @p skiplist wasn't created with SKIPLIST_KEY_BYTES.
+ *
+ * @return A pointer to the key bytes, valid until the node is removed. NULL on error.
+ */
+const void *skiplist_node_key( const skiplist_t *skiplist, const skiplist_node_t *node, size_t *length,
+                               skiplist_error_t * const error );
+
 /**
  * @brief Returns the number of nodes in the skiplist.
  *
@@ -186,6 +809,113 @@ uintptr_t skiplist_node_value( const skiplist_node_t *node, skiplist_error_t * c
  *
  * @return The number of nodes in @p skiplist. 0 on invalid input.
  */
-unsigned int skiplist_size( const skiplist_t *skiplist, skiplist_error_t * const error );
+skiplist_size_t skiplist_size( const skiplist_t *skiplist, skiplist_error_t * const error );
+
+/**
+ * @brief Writes a binary snapshot of the skiplist to a file descriptor.
+ *
+ * The snapshot holds the skiplist's properties and level cap followed by every
+ * value in order, and optionally the level count of every node. Values and map
+ * payloads are written as they are stored, so snapshots of skiplists holding
+ * pointers are only meaningful within the same process.
+ *
+ * @param [in] skiplist  The skiplist to save.
+ * @param [in] fd        A file descriptor open for writing, written from its current offset.
+ * @param [in] flags     SKIPLIST_SAVE_VALUES or SKIPLIST_SAVE_LEVELS.
+ *
+ * @retval SKIPLIST_ERROR_SUCCESS if successful.
+ * @retval SKIPLIST_ERROR_INVALID_INPUT if input values were invalid.
+ * @retval SKIPLIST_ERROR_OUT_OF_MEMORY if the write buffer couldn't be allocated.
+ * @retval SKIPLIST_ERROR_IO if writing to @p fd failed.
+ */
+skiplist_error_t skiplist_save( const skiplist_t *skiplist, int fd, unsigned int flags );
+
+/**
+ * @brief Creates a skiplist from a snapshot written by skiplist_save().
+ *
+ * The list is rebuilt in a single pass in the order the values were saved,
+ * without calling the compare function. The properties, level cap and payload
+ * size are taken from the snapshot, the remaining options from @p options. Nodes get
+ * the levels stored in the snapshot, or new random levels if it has none.
+ *
+ * Reading starts at the current offset of @p fd. After a successful load the
+ * offset is left just past the end of the snapshot, where skiplist_wal_replay()
+ * can carry on with a log appended to the same file. After a failed load it's
+ * unspecified. On a pipe, which can't seek, anything following the snapshot may
+ * be consumed.
+ *
+ * @param [in]  fd       A file descriptor open for reading, read from its current offset.
+ * @param [in]  options  Options for the new skiplist, properties, size_estimate_log2 and payload_size are ignored.
+ * @param [out] error    Will point to the error status of the function on return. May be set to NULL.
+ *                       SKIPLIST_ERROR_SUCCESS if successful.
+ *                       SKIPLIST_ERROR_INVALID_INPUT if this function was called with invalid input values.
+ *                       SKIPLIST_ERROR_OUT_OF_MEMORY if this function failed to allocate memory.
+ *                       SKIPLIST_ERROR_IO if reading from @p fd failed.
+ *                       SKIPLIST_ERROR_INVALID_SNAPSHOT if the data isn't a snapshot this
+ *                       build can load, or is truncated.
+ *                       SKIPLIST_ERROR_FULL if the snapshot has more than SKIPLIST_MAX_SIZE nodes.
+ *
+ * @return If successful a new skiplist is returned, otherwise NULL.
+ */
+skiplist_t *skiplist_load( int fd, const skiplist_options_t *options, skiplist_error_t * const error );
+
+/**
+ * @brief Returns the number of bytes of memory the skiplist currently holds.
+ *
+ * For SKIPLIST_MEMORY_HUGE_PAGES skiplists this is the size of every region
+ * mapped by the skiplist, including space that hasn't been handed out yet.
+ * Otherwise it's the number of bytes requested from malloc().
+ *
+ * @param [in]  skiplist  The skiplist to report on.
+ * @param [out] error     Will point to the error status of the function on return.
+ *                        SKIPLIST_ERROR_SUCCESS if successful.
+ *                        SKIPLIST_ERROR_INVALID_INPUT if this function was called
+ *                        with invalid input values.
+ *
+ * @return The number of bytes held by @p skiplist. 0 on invalid input.
+ */
+size_t skiplist_memory_held( const skiplist_t *skiplist, skiplist_error_t * const error );
+
+/**
+ * @brief Breaks down the memory used by the skiplist.
+ *
+ * Every node is visited, so this takes O(n) time.
+ *
+ * @param [in]  skiplist  The skiplist to report on.
+ * @param [out] usage     Receives the breakdown.
+ *
+ * @retval SKIPLIST_ERROR_SUCCESS if successful.
+ * @retval SKIPLIST_ERROR_INVALID_INPUT if input values were invalid.
+ */
+skiplist_error_t skiplist_memory_usage( const skiplist_t *skiplist, skiplist_memory_usage_t *usage );
+
+/**
+ * @brief Copies the skiplist's operation counters into @p stats.
+ *
+ * Counters are only available when the library was compiled with
+ * SKIPLIST_STATS defined.
+ *
+ * @param [in]  skiplist  The skiplist to read the counters of.
+ * @param [out] stats     Receives a copy of the counters.
+ *
+ * @retval SKIPLIST_ERROR_SUCCESS if successful.
+ * @retval SKIPLIST_ERROR_INVALID_INPUT if input values were invalid.
+ * @retval SKIPLIST_ERROR_NOT_SUPPORTED if the counters were compiled out.
+ */
+skiplist_error_t skiplist_get_stats( const skiplist_t *skiplist, skiplist_stats_t *stats );
+
+/**
+ * @brief Resets the skiplist's operation counters to zero.
+ *
+ * The level histogram is left alone as it describes the nodes currently
+ * in the skiplist.
+ *
+ * @param [in] skiplist  The skiplist to reset the counters of.
+ *
+ * @retval SKIPLIST_ERROR_SUCCESS if successful.
+ * @retval SKIPLIST_ERROR_INVALID_INPUT if input values were invalid.
+ * @retval SKIPLIST_ERROR_NOT_SUPPORTED if the counters were compiled out.
+ */
+skiplist_error_t skiplist_reset_stats( skiplist_t *skiplist );
 
 #endif
@@ -0,0 +1,279 @@
+/* mmap(), madvise() flags and syscall() are not part of C89. */
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include "skiplist_arena.h"
+
+#if !defined( MAP_ANONYMOUS ) && defined( MAP_ANON )
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+/** The size of a transparent huge page on x86-64 and most aarch64 kernels. */
+#define SKIPLIST_ARENA_HUGE_PAGE_SIZE ((size_t)2 << 20)
+
+/** The default size of each region when the caller doesn't provide one. */
+#define SKIPLIST_ARENA_DEFAULT_REGION_SIZE (SKIPLIST_ARENA_HUGE_PAGE_SIZE * 8)
+
+/** The number of NUMA nodes that can be expressed in an mbind() node mask. */
+#define SKIPLIST_ARENA_MAX_NUMA_NODES (1024)
+
+/** Value of MPOL_BIND from <linux/mempolicy.h>, which isn't always installed. */
+#define SKIPLIST_ARENA_MPOL_BIND (2)
+
+/** The number of bytes at the start of a region reserved for its header. */
+#define SKIPLIST_ARENA_HEADER_SIZE \
+	((sizeof( skiplist_region_t ) + SKIPLIST_ARENA_GRANULE - 1) & ~(size_t)(SKIPLIST_ARENA_GRANULE - 1))
+
+/**
+ * @brief Round @p size up to the next multiple of @p alignment, which must be a power of 2.
+ */
+static size_t skiplist_arena_round_up( size_t size, size_t alignment )
+{
+	return (size + alignment - 1) & ~(alignment - 1);
+}
+
+/**
+ * @brief Bind a mapping to a single NUMA node.
+ *
+ * Binding is best effort. Kernels without NUMA support reject the call and
+ * the memory is then allocated wherever the default policy puts it.
+ */
+static void skiplist_arena_bind( void *base, size_t size, int numa_node )
+{
+#if defined( __linux__ ) && defined( SYS_mbind )
+	unsigned long mask[SKIPLIST_ARENA_MAX_NUMA_NODES / (8 * sizeof( unsigned long ))];
+
+	if( numa_node < 0 || numa_node >= SKIPLIST_ARENA_MAX_NUMA_NODES )
+	{
+		return;
+	}
+
+	memset( mask, 0, sizeof( mask ) );
+	mask[numa_node / (8 * sizeof( unsigned long ))] |= 1UL << (numa_node % (8 * sizeof( unsigned long )));
+
+	/* The kernel only reads maxnode - 1 bits from the mask. */
+	(void) syscall( SYS_mbind, base, size, SKIPLIST_ARENA_MPOL_BIND, mask,
+	                (unsigned long) SKIPLIST_ARENA_MAX_NUMA_NODES + 1, 0 );
+#else
+	(void) base;
+	(void) size;
+	(void) numa_node;
+#endif
+}
+
+/**
+ * @brief Map a new region of @p size bytes.
+ *
+ * Regions used for carving nodes are aligned to the huge page size so the
+ * kernel is able to back the whole region with huge pages.
+ */
+static skiplist_region_t *skiplist_arena_map( skiplist_arena_t *arena, size_t size, unsigned int align )
+{
+	char *raw;
+	char *base;
+	size_t slop;
+	size_t lead;
+	skiplist_region_t *region;
+
+	slop = align ? SKIPLIST_ARENA_HUGE_PAGE_SIZE : 0;
+
+	raw = mmap( NULL, size + slop, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+	if( MAP_FAILED == (void *) raw )
+	{
+		return NULL;
+	}
+
+	base = raw;
+	if( align )
+	{
+		/* Trim the over allocation from both ends so the region starts on a huge page boundary. */
+		lead = (SKIPLIST_ARENA_HUGE_PAGE_SIZE - ((uintptr_t) raw & (SKIPLIST_ARENA_HUGE_PAGE_SIZE - 1))) &
+		       (SKIPLIST_ARENA_HUGE_PAGE_SIZE - 1);
+		if( lead )
+		{
+			munmap( raw, lead );
+		}
+		if( slop - lead )
+		{
+			munmap( raw + lead + size, slop - lead );
+		}
+		base = raw + lead;
+
+#ifdef MADV_HUGEPAGE
+		(void) madvise( base, size, MADV_HUGEPAGE );
+#endif
+	}
+
+	skiplist_arena_bind( base, size, arena->numa_node );
+
+	region = (skiplist_region_t *) base;
+	region->prev = NULL;
+	region->next = NULL;
+	region->size = size;
+	region->used = SKIPLIST_ARENA_HEADER_SIZE;
+
+	arena->mapped += size;
+
+	return region;
+}
+
+/**
+ * @brief Unmap a region, the region must already be unlinked from the arena.
+ */
+static void skiplist_arena_unmap( skiplist_arena_t *arena, skiplist_region_t *region )
+{
+	arena->mapped -= region->size;
+	munmap( region, region->size );
+}
+
+void skiplist_arena_init( skiplist_arena_t *arena, size_t region_size, int numa_node )
+{
+	assert( arena );
+
+	if( 0 == region_size )
+	{
+		region_size = SKIPLIST_ARENA_DEFAULT_REGION_SIZE;
+	}
+
+	memset( arena, 0, sizeof( *arena ) );
+	arena->region_size = skiplist_arena_round_up( region_size, SKIPLIST_ARENA_HUGE_PAGE_SIZE );
+	arena->numa_node = numa_node;
+}
+
+void skiplist_arena_destroy( skiplist_arena_t *arena )
+{
+	skiplist_region_t *cur;
+	skiplist_region_t *next;
+
+	assert( arena );
+
+	/* The arena may live inside one of its own regions, so don't touch it once unmapping starts. */
+	for( cur = arena->regions; NULL != cur; cur = next )
+	{
+		next = cur->next;
+		munmap( cur, cur->size );
+	}
+}
+
+void *skiplist_arena_allocate( skiplist_arena_t *arena, size_t size )
+{
+	skiplist_region_t *region;
+	size_t size_class;
+	void *ptr;
+
+	assert( arena );
+	assert( size > 0 );
+
+	size = skiplist_arena_round_up( size, SKIPLIST_ARENA_GRANULE );
+	size_class = size / SKIPLIST_ARENA_GRANULE - 1;
+
+	if( size_class >= SKIPLIST_ARENA_CLASSES )
+	{
+		/* Large blocks get a mapping of their own which is released as soon as the block is freed.
+		   Link it behind the current region so the current region keeps being carved from. */
+		region = skiplist_arena_map( arena, skiplist_arena_round_up( SKIPLIST_ARENA_HEADER_SIZE + size, 4096 ), 0 );
+		if( NULL == region )
+		{
+			return NULL;
+		}
+
+		region->used = region->size;
+		if( NULL == arena->regions )
+		{
+			arena->regions = region;
+		}
+		else
+		{
+			region->prev = arena->regions;
+			region->next = arena->regions->next;
+			if( NULL != region->next )
+			{
+				region->next->prev = region;
+			}
+			arena->regions->next = region;
+		}
+
+		arena->in_use += size;
+		return (char *) region + SKIPLIST_ARENA_HEADER_SIZE;
+	}
+
+	if( NULL != arena->free_list[size_class] )
+	{
+		ptr = arena->free_list[size_class];
+		arena->free_list[size_class] = arena->free_list[size_class]->next;
+		arena->in_use += size;
+		return ptr;
+	}
+
+	region = arena->regions;
+	if( NULL == region || region->size - region->used < size )
+	{
+		/* The tail of the previous region is abandoned, it's smaller than the block being allocated. */
+		region = skiplist_arena_map( arena, arena->region_size, 1 );
+		if( NULL == region )
+		{
+			return NULL;
+		}
+
+		region->next = arena->regions;
+		if( NULL != region->next )
+		{
+			region->next->prev = region;
+		}
+		arena->regions = region;
+	}
+
+	ptr = (char *) region + region->used;
+	region->used += size;
+	arena->in_use += size;
+
+	return ptr;
+}
+
+void skiplist_arena_deallocate( skiplist_arena_t *arena, void *ptr, size_t size )
+{
+	skiplist_region_t *region;
+	skiplist_arena_free_t *block;
+	size_t size_class;
+
+	assert( arena );
+	assert( ptr );
+
+	size = skiplist_arena_round_up( size, SKIPLIST_ARENA_GRANULE );
+	size_class = size / SKIPLIST_ARENA_GRANULE - 1;
+	arena->in_use -= size;
+
+	if( size_class >= SKIPLIST_ARENA_CLASSES )
+	{
+		region = (skiplist_region_t *) ((char *) ptr - SKIPLIST_ARENA_HEADER_SIZE);
+
+		if( NULL != region->prev )
+		{
+			region->prev->next = region->next;
+		}
+		else
+		{
+			arena->regions = region->next;
+		}
+		if( NULL != region->next )
+		{
+			region->next->prev = region->prev;
+		}
+
+		skiplist_arena_unmap( arena, region );
+		return;
+	}
+
+	block = (skiplist_arena_free_t *) ptr;
+	block->next = arena->free_list[size_class];
+	arena->free_list[size_class] = block;
+}
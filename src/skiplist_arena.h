@@ -0,0 +1,116 @@
+#ifndef SKIPLIST_ARENA_H
+#define SKIPLIST_ARENA_H
+
+#include <stddef.h>
+
+/**
+ * The number of bytes each arena allocation is rounded up to. This is also
+ * the alignment of every pointer returned by skiplist_arena_allocate().
+ */
+#define SKIPLIST_ARENA_GRANULE (16)
+
+/**
+ * The number of distinct size classes the arena keeps free lists for.
+ * Allocations larger than SKIPLIST_ARENA_CLASSES * SKIPLIST_ARENA_GRANULE
+ * bytes are given a mapping of their own.
+ */
+#define SKIPLIST_ARENA_CLASSES (256)
+
+/**
+ * @brief Header at the start of every memory mapping owned by an arena.
+ */
+typedef struct skiplist_region_t
+{
+	/** The previous region in the arena's region list. */
+	struct skiplist_region_t *prev;
+
+	/** The next region in the arena's region list. */
+	struct skiplist_region_t *next;
+
+	/** The number of bytes mapped for this region, including this header. */
+	size_t size;
+
+	/** The number of bytes handed out from this region, including this header. */
+	size_t used;
+} skiplist_region_t;
+
+/**
+ * @brief An entry on one of the arena's free lists.
+ */
+typedef struct skiplist_arena_free_t
+{
+	/** The next free block of the same size class. */
+	struct skiplist_arena_free_t *next;
+} skiplist_arena_free_t;
+
+/**
+ * @brief A bump allocator carving blocks out of large, huge page backed mappings.
+ *
+ * Freed blocks are kept on per size class free lists and are only returned
+ * to the operating system when the arena is destroyed.
+ */
+typedef struct skiplist_arena_t
+{
+	/** All of the mappings owned by this arena. The head of the list is the
+	    region new blocks are currently carved from. */
+	skiplist_region_t *regions;
+
+	/** Free blocks, indexed by their size in granules minus one. */
+	skiplist_arena_free_t *free_list[SKIPLIST_ARENA_CLASSES];
+
+	/** The size of each new region. */
+	size_t region_size;
+
+	/** The NUMA node to bind new regions to, or -1 for no binding. */
+	int numa_node;
+
+	/** The total number of bytes mapped by this arena. */
+	size_t mapped;
+
+	/** The number of bytes currently allocated from this arena. */
+	size_t in_use;
+} skiplist_arena_t;
+
+/**
+ * @brief Initialize an empty arena.
+ *
+ * No memory is mapped until the first allocation.
+ *
+ * @param [out] arena        The arena to initialize.
+ * @param [in]  region_size  The size of each mapping, 0 for the default. It is
+ *                           rounded up to a multiple of the huge page size.
+ * @param [in]  numa_node    The NUMA node to bind mappings to, -1 for none.
+ */
+void skiplist_arena_init( skiplist_arena_t *arena, size_t region_size, int numa_node );
+
+/**
+ * @brief Release every mapping owned by the arena.
+ *
+ * All blocks allocated from the arena become invalid, including the block
+ * that may be holding @p arena itself, so the caller must not touch @p arena
+ * after this function starts unmapping.
+ *
+ * @param [in] arena  The arena to destroy.
+ */
+void skiplist_arena_destroy( skiplist_arena_t *arena );
+
+/**
+ * @brief Allocate a block of memory from the arena.
+ *
+ * @param [in,out] arena  The arena to allocate from.
+ * @param [in]     size   The number of bytes required.
+ *
+ * @return A block of at least @p size bytes or NULL if out of memory.
+ */
+void *skiplist_arena_allocate( skiplist_arena_t *arena, size_t size );
+
+/**
+ * @brief Return a block to the arena.
+ *
+ * @param [in,out] arena  The arena @p ptr was allocated from.
+ * @param [in]     ptr    The block to release.
+ * @param [in]     size   The size that was passed to skiplist_arena_allocate().
+ */
+void skiplist_arena_deallocate( skiplist_arena_t *arena, void *ptr, size_t size );
+
+#endif
@@ -0,0 +1,833 @@
+#include <assert.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "skiplist_file.h"
+
+/** Identifies a file backed skiplist. */
+static const char skiplist_file_magic[8] = { 'S', 'K', 'I', 'P', 'F', 'I', 'L', 'E' };
+
+/** The version of the file layout written by skiplist_file_create(). */
+#define SKIPLIST_FILE_VERSION (1)
+
+/** Written into every file so a file from a machine of the other byte order is rejected. */
+#define SKIPLIST_FILE_BYTE_ORDER (0x01020304)
+
+/** The smallest file created, new files have room for a few thousand nodes before they first grow. */
+#define SKIPLIST_FILE_INITIAL_SIZE ((size_t)1 << 16)
+
+/** The offset of the head node, the start of every search. */
+#define SKIPLIST_FILE_HEAD_OFFSET ((skiplist_file_offset_t) offsetof( skiplist_file_header_t, head ))
+
+/**
+ * @brief Returns the file's header, at the start of the mapping.
+ */
+static skiplist_file_header_t *skiplist_file_header( const skiplist_file_t *skiplist )
+{
+	return (skiplist_file_header_t *) skiplist->base;
+}
+
+/**
+ * @brief Returns the node at @p offset in the current mapping.
+ *
+ * Pointers returned here are invalidated by anything that grows the file.
+ */
+static skiplist_file_node_t *skiplist_file_node( const skiplist_file_t *skiplist, skiplist_file_offset_t offset )
+{
+	assert( 0 != offset );
+	assert( offset < skiplist->mapped );
+
+	return (skiplist_file_node_t *) (skiplist->base + offset);
+}
+
+/**
+ * @brief Returns the number of bytes a node with @p levels links takes in the file.
+ */
+static size_t skiplist_file_node_size( unsigned int levels )
+{
+	return offsetof( skiplist_file_node_t, link ) + sizeof( skiplist_file_link_t ) * levels;
+}
+
+/**
+ * @brief Generate a random 32 bit number.
+ *
+ * The same multiply-with-carry generator as skiplist.c, with its state kept
+ * in the file header so levels continue the same sequence after a reopen.
+ */
+static unsigned int skiplist_file_rng_gen_u32( skiplist_file_header_t *header )
+{
+	header->rng_z = 36969 * (header->rng_z & 65535) + (header->rng_z >> 16);
+	header->rng_w = 18000 * (header->rng_w & 65535) + (header->rng_w >> 16);
+
+	return (header->rng_z << 16) + header->rng_w;
+}
+
+static unsigned int skiplist_file_compute_node_level( skiplist_file_header_t *header )
+{
+	unsigned int node_levels;
+	unsigned int bits;
+
+	/* See skiplist_compute_node_level(), each level is half as likely as the one below it.
+	   A file node has at most 32 levels, so one random number always has enough bits. */
+	bits = skiplist_file_rng_gen_u32( header );
+	node_levels = 0 == bits ? SKIPLIST_FILE_MAX_LINKS : (unsigned int) __builtin_clz( bits ) + 1;
+	if( node_levels > header->head.levels )
+	{
+		node_levels = header->head.levels;
+	}
+
+	return node_levels;
+}
+
+/**
+ * @brief Map @p size bytes of the skiplist's file.
+ */
+static skiplist_error_t skiplist_file_map( skiplist_file_t *skiplist, size_t size )
+{
+	int prot = skiplist->writable ? PROT_READ | PROT_WRITE : PROT_READ;
+	void *base;
+
+	base = mmap( NULL, size, prot, MAP_SHARED, skiplist->fd, 0 );
+	if( MAP_FAILED == base )
+	{
+		return SKIPLIST_ERROR_IO;
+	}
+
+	skiplist->base = (unsigned char *) base;
+	skiplist->mapped = size;
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+/**
+ * @brief Grow the file until it has room for @p needed bytes and remap it.
+ *
+ * The file doubles each time so the cost of remapping is amortized over
+ * many inserts.
+ */
+static skiplist_error_t skiplist_file_grow( skiplist_file_t *skiplist, size_t needed )
+{
+	size_t size = skiplist->mapped;
+
+	while( size < needed )
+	{
+		size *= 2;
+	}
+
+	if( 0 != ftruncate( skiplist->fd, (off_t) size ) )
+	{
+		return SKIPLIST_ERROR_IO;
+	}
+
+	munmap( skiplist->base, skiplist->mapped );
+	skiplist->base = NULL;
+	skiplist->mapped = 0;
+
+	return skiplist_file_map( skiplist, size );
+}
+
+static skiplist_file_t *skiplist_file_allocate( int fd, unsigned int writable, skiplist_compare_pfn compare )
+{
+	skiplist_file_t *skiplist;
+
+	skiplist = (skiplist_file_t *) malloc( sizeof( skiplist_file_t ) );
+	if( NULL != skiplist )
+	{
+		skiplist->fd = fd;
+		skiplist->writable = writable ? 1 : 0;
+		skiplist->base = NULL;
+		skiplist->mapped = 0;
+		skiplist->compare = compare;
+	}
+
+	return skiplist;
+}
+
+static void skiplist_file_deallocate( skiplist_file_t *skiplist )
+{
+	if( NULL != skiplist->base )
+	{
+		munmap( skiplist->base, skiplist->mapped );
+	}
+	close( skiplist->fd );
+	free( skiplist );
+}
+
+static skiplist_error_t skiplist_file_create_check_clean( const char *filename, skiplist_properties_t properties,
+                                                          unsigned int size_estimate_log2,
+                                                          skiplist_compare_pfn compare )
+{
+	if( NULL == filename )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( SKIPLIST_PROPERTY_NONE != properties && SKIPLIST_PROPERTY_UNIQUE != properties )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( size_estimate_log2 <= 0 || size_estimate_log2 > SKIPLIST_FILE_MAX_LINKS )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( NULL == compare )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+static skiplist_file_t *skiplist_file_create_clean( const char *filename, skiplist_properties_t properties,
+                                                    unsigned int size_estimate_log2, skiplist_compare_pfn compare,
+                                                    skiplist_error_t *error )
+{
+	skiplist_file_t *skiplist;
+	skiplist_file_header_t *header;
+	size_t size;
+	int fd;
+
+	fd = open( filename, O_RDWR | O_CREAT | O_TRUNC, 0644 );
+	if( fd < 0 )
+	{
+		*error = SKIPLIST_ERROR_OPENING_FILE;
+		return NULL;
+	}
+
+	skiplist = skiplist_file_allocate( fd, 1, compare );
+	if( NULL == skiplist )
+	{
+		close( fd );
+		*error = SKIPLIST_ERROR_OUT_OF_MEMORY;
+		return NULL;
+	}
+
+	size = SKIPLIST_FILE_INITIAL_SIZE;
+	while( size < sizeof( skiplist_file_header_t ) )
+	{
+		size *= 2;
+	}
+
+	if( 0 != ftruncate( fd, (off_t) size ) || SKIPLIST_ERROR_SUCCESS != skiplist_file_map( skiplist, size ) )
+	{
+		skiplist_file_deallocate( skiplist );
+		*error = SKIPLIST_ERROR_OPENING_FILE;
+		return NULL;
+	}
+
+	/* The file was just extended with zeros, so only the non-zero fields need setting. */
+	header = skiplist_file_header( skiplist );
+	memcpy( header->magic, skiplist_file_magic, sizeof( header->magic ) );
+	header->version = SKIPLIST_FILE_VERSION;
+	header->byte_order = SKIPLIST_FILE_BYTE_ORDER;
+	header->properties = properties;
+	header->rng_w = 0xcafef00d;
+	header->rng_z = 0xabcd1234;
+	header->num_nodes = 0;
+	header->used = sizeof( skiplist_file_header_t );
+	header->head.levels = size_estimate_log2;
+
+	*error = SKIPLIST_ERROR_SUCCESS;
+
+	return skiplist;
+}
+
+skiplist_file_t *skiplist_file_create( const char *filename, skiplist_properties_t properties,
+                                       unsigned int size_estimate_log2, skiplist_compare_pfn compare,
+                                       skiplist_error_t * const error )
+{
+	skiplist_file_t *skiplist = NULL;
+	skiplist_error_t err;
+
+	err = skiplist_file_create_check_clean( filename, properties, size_estimate_log2, compare );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		skiplist = skiplist_file_create_clean( filename, properties, size_estimate_log2, compare, &err );
+	}
+
+	if( NULL != error )
+	{
+		*error = err;
+	}
+
+	return skiplist;
+}
+
+static skiplist_error_t skiplist_file_open_check_clean( const char *filename, skiplist_compare_pfn compare )
+{
+	if( NULL == filename )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( NULL == compare )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+/**
+ * @brief Check the header of a freshly mapped file describes a list this build can use.
+ *
+ * Only the header is checked, the nodes are trusted so opening stays
+ * independent of the size of the list.
+ */
+static skiplist_error_t skiplist_file_validate( const skiplist_file_t *skiplist )
+{
+	const skiplist_file_header_t *header = skiplist_file_header( skiplist );
+
+	if( 0 != memcmp( header->magic, skiplist_file_magic, sizeof( header->magic ) ) ||
+	    SKIPLIST_FILE_VERSION != header->version ||
+	    SKIPLIST_FILE_BYTE_ORDER != header->byte_order )
+	{
+		return SKIPLIST_ERROR_INVALID_SNAPSHOT;
+	}
+
+	if( SKIPLIST_PROPERTY_NONE != header->properties && SKIPLIST_PROPERTY_UNIQUE != header->properties )
+	{
+		return SKIPLIST_ERROR_INVALID_SNAPSHOT;
+	}
+
+	if( 0 == header->head.levels || header->head.levels > SKIPLIST_FILE_MAX_LINKS )
+	{
+		return SKIPLIST_ERROR_INVALID_SNAPSHOT;
+	}
+
+	if( header->used < sizeof( skiplist_file_header_t ) || header->used > skiplist->mapped )
+	{
+		return SKIPLIST_ERROR_INVALID_SNAPSHOT;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+static skiplist_file_t *skiplist_file_open_clean( const char *filename, unsigned int writable,
+                                                  skiplist_compare_pfn compare, skiplist_error_t *error )
+{
+	skiplist_file_t *skiplist;
+	struct stat st;
+	int fd;
+
+	fd = open( filename, writable ? O_RDWR : O_RDONLY );
+	if( fd < 0 )
+	{
+		*error = SKIPLIST_ERROR_OPENING_FILE;
+		return NULL;
+	}
+
+	skiplist = skiplist_file_allocate( fd, writable, compare );
+	if( NULL == skiplist )
+	{
+		close( fd );
+		*error = SKIPLIST_ERROR_OUT_OF_MEMORY;
+		return NULL;
+	}
+
+	if( 0 != fstat( fd, &st ) )
+	{
+		skiplist_file_deallocate( skiplist );
+		*error = SKIPLIST_ERROR_OPENING_FILE;
+		return NULL;
+	}
+
+	if( (unsigned long long) st.st_size < sizeof( skiplist_file_header_t ) )
+	{
+		skiplist_file_deallocate( skiplist );
+		*error = SKIPLIST_ERROR_INVALID_SNAPSHOT;
+		return NULL;
+	}
+
+	if( SKIPLIST_ERROR_SUCCESS != skiplist_file_map( skiplist, (size_t) st.st_size ) )
+	{
+		skiplist_file_deallocate( skiplist );
+		*error = SKIPLIST_ERROR_OPENING_FILE;
+		return NULL;
+	}
+
+	*error = skiplist_file_validate( skiplist );
+	if( SKIPLIST_ERROR_SUCCESS != *error )
+	{
+		skiplist_file_deallocate( skiplist );
+		return NULL;
+	}
+
+	return skiplist;
+}
+
+skiplist_file_t *skiplist_file_open( const char *filename, unsigned int writable, skiplist_compare_pfn compare,
+                                     skiplist_error_t * const error )
+{
+	skiplist_file_t *skiplist = NULL;
+	skiplist_error_t err;
+
+	err = skiplist_file_open_check_clean( filename, compare );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		skiplist = skiplist_file_open_clean( filename, writable, compare, &err );
+	}
+
+	if( NULL != error )
+	{
+		*error = err;
+	}
+
+	return skiplist;
+}
+
+static skiplist_error_t skiplist_file_sync_check_clean( const skiplist_file_t *skiplist )
+{
+	if( NULL == skiplist )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+static skiplist_error_t skiplist_file_sync_clean( skiplist_file_t *skiplist )
+{
+	if( !skiplist->writable )
+	{
+		return SKIPLIST_ERROR_SUCCESS;
+	}
+
+	if( 0 != msync( skiplist->base, skiplist->mapped, MS_SYNC ) )
+	{
+		return SKIPLIST_ERROR_IO;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+skiplist_error_t skiplist_file_sync( skiplist_file_t *skiplist )
+{
+	skiplist_error_t err;
+
+	err = skiplist_file_sync_check_clean( skiplist );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		err = skiplist_file_sync_clean( skiplist );
+	}
+
+	return err;
+}
+
+static skiplist_error_t skiplist_file_close_check_clean( const skiplist_file_t *skiplist )
+{
+	if( NULL == skiplist )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+skiplist_error_t skiplist_file_close( skiplist_file_t *skiplist )
+{
+	skiplist_error_t err;
+
+	err = skiplist_file_close_check_clean( skiplist );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		skiplist_file_deallocate( skiplist );
+	}
+
+	return err;
+}
+
+static skiplist_error_t skiplist_file_contains_check_clean( const skiplist_file_t *skiplist, uintptr_t value )
+{
+	if( NULL == skiplist )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	(void) value;
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+static unsigned int skiplist_file_contains_clean( const skiplist_file_t *skiplist, uintptr_t value )
+{
+	unsigned int i;
+	const skiplist_file_node_t *cur;
+
+	cur = &skiplist_file_header( skiplist )->head;
+
+	assert( cur->levels > 0 );
+
+	for( i = cur->levels; i-- != 0; )
+	{
+		for( ; 0 != cur->link[i].next; cur = skiplist_file_node( skiplist, cur->link[i].next ) )
+		{
+			int comparison = skiplist->compare( (uintptr_t) skiplist_file_node( skiplist, cur->link[i].next )->value,
+			                                    value );
+			if( comparison > 0 )
+			{
+				break;
+			}
+			else if( 0 == comparison )
+			{
+				return 1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+unsigned int skiplist_file_contains( const skiplist_file_t *skiplist, uintptr_t value, skiplist_error_t * const error )
+{
+	unsigned int contains = 0;
+	skiplist_error_t err;
+
+	err = skiplist_file_contains_check_clean( skiplist, value );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		contains = skiplist_file_contains_clean( skiplist, value );
+	}
+
+	if( NULL != error )
+	{
+		*error = err;
+	}
+
+	return contains;
+}
+
+/**
+ * @brief Find the offset of the last node on each level before where @p value belongs.
+ *
+ * Offsets rather than pointers are recorded so the path survives the file
+ * being grown before the new node is linked in.
+ */
+static void skiplist_file_find_insert_path( const skiplist_file_t *skiplist, uintptr_t value,
+                                            skiplist_file_offset_t path[], unsigned int distances[] )
+{
+	unsigned int i;
+	unsigned int levels;
+	skiplist_file_offset_t cur;
+
+	cur = SKIPLIST_FILE_HEAD_OFFSET;
+	levels = skiplist_file_header( skiplist )->head.levels;
+
+	for( i = levels; i-- != 0; )
+	{
+		distances[i] = 1;
+
+		for( ;; )
+		{
+			const skiplist_file_link_t *link = &skiplist_file_node( skiplist, cur )->link[i];
+			unsigned int j;
+
+			if( 0 == link->next ||
+			    skiplist->compare( (uintptr_t) skiplist_file_node( skiplist, link->next )->value, value ) > 0 )
+			{
+				break;
+			}
+
+			for( j = i + 1; j < levels; ++j )
+			{
+				distances[j] += link->width;
+			}
+
+			cur = link->next;
+		}
+
+		path[i] = cur;
+	}
+}
+
+static skiplist_error_t skiplist_file_insert_check_clean( const skiplist_file_t *skiplist, uintptr_t value )
+{
+	if( NULL == skiplist )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( !skiplist->writable )
+	{
+		return SKIPLIST_ERROR_NOT_SUPPORTED;
+	}
+
+	(void) value;
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+static skiplist_error_t skiplist_file_insert_clean( skiplist_file_t *skiplist, uintptr_t value )
+{
+	skiplist_file_offset_t update[SKIPLIST_FILE_MAX_LINKS];
+	unsigned int distances[SKIPLIST_FILE_MAX_LINKS];
+	skiplist_file_header_t *header;
+	skiplist_file_node_t *new_node;
+	skiplist_file_offset_t new_offset;
+	unsigned int node_levels;
+	unsigned int levels;
+	unsigned int i;
+	size_t size;
+
+	skiplist_file_find_insert_path( skiplist, value, update, distances );
+
+	/* Sets don't take a second copy of a value. */
+	header = skiplist_file_header( skiplist );
+	if( SKIPLIST_PROPERTY_UNIQUE == header->properties && SKIPLIST_FILE_HEAD_OFFSET != update[0] &&
+	    0 == skiplist->compare( (uintptr_t) skiplist_file_node( skiplist, update[0] )->value, value ) )
+	{
+		return SKIPLIST_ERROR_SUCCESS;
+	}
+
+	/* Another node would overflow the widths and the count. */
+	if( header->num_nodes >= SKIPLIST_FILE_MAX_SIZE )
+	{
+		return SKIPLIST_ERROR_FULL;
+	}
+
+	node_levels = skiplist_file_compute_node_level( header );
+	size = skiplist_file_node_size( node_levels );
+
+	if( header->used + size > skiplist->mapped )
+	{
+		skiplist_error_t err = skiplist_file_grow( skiplist, (size_t) header->used + size );
+		if( SKIPLIST_ERROR_SUCCESS != err )
+		{
+			return err;
+		}
+		header = skiplist_file_header( skiplist );
+	}
+
+	/* Append the node to the used part of the file. */
+	new_offset = header->used;
+	header->used += size;
+	new_node = skiplist_file_node( skiplist, new_offset );
+	new_node->value = value;
+	new_node->levels = node_levels;
+	new_node->reserved = 0;
+
+	/* Increment the width of each link that jumps over this node. */
+	levels = header->head.levels;
+	for( i = levels; i-- != node_levels; )
+	{
+		++skiplist_file_node( skiplist, update[i] )->link[i].width;
+	}
+
+	/* Insert the node into each level of the skiplist. */
+	for( i = node_levels; i-- != 0; )
+	{
+		skiplist_file_link_t *update_link = &skiplist_file_node( skiplist, update[i] )->link[i];
+		skiplist_file_link_t *new_link = &new_node->link[i];
+
+		new_link->width = 1 + update_link->width - distances[i];
+		update_link->width = distances[i];
+		new_link->reserved = 0;
+
+		new_link->next = update_link->next;
+		update_link->next = new_offset;
+	}
+
+	++header->num_nodes;
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+skiplist_error_t skiplist_file_insert( skiplist_file_t *skiplist, uintptr_t value )
+{
+	skiplist_error_t err;
+
+	err = skiplist_file_insert_check_clean( skiplist, value );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		err = skiplist_file_insert_clean( skiplist, value );
+	}
+
+	return err;
+}
+
+static skiplist_error_t skiplist_file_at_index_check_clean( const skiplist_file_t *skiplist, unsigned int index )
+{
+	if( NULL == skiplist )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( index >= skiplist_file_header( skiplist )->num_nodes )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+static uintptr_t skiplist_file_at_index_clean( const skiplist_file_t *skiplist, unsigned int index )
+{
+	unsigned int i;
+	unsigned int remaining;
+	const skiplist_file_node_t *cur;
+
+	/* The head is position 0, so the node at 'index' is index + 1 steps away. */
+	remaining = index + 1;
+	cur = &skiplist_file_header( skiplist )->head;
+
+	for( i = cur->levels; i-- != 0 && remaining > 0; )
+	{
+		while( 0 != cur->link[i].next && cur->link[i].width <= remaining )
+		{
+			remaining -= cur->link[i].width;
+			cur = skiplist_file_node( skiplist, cur->link[i].next );
+		}
+	}
+
+	return (uintptr_t) cur->value;
+}
+
+uintptr_t skiplist_file_at_index( const skiplist_file_t *skiplist, unsigned int index, skiplist_error_t * const error )
+{
+	uintptr_t value = 0;
+	skiplist_error_t err;
+
+	err = skiplist_file_at_index_check_clean( skiplist, index );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		value = skiplist_file_at_index_clean( skiplist, index );
+	}
+
+	if( NULL != error )
+	{
+		*error = err;
+	}
+
+	return value;
+}
+
+static skiplist_error_t skiplist_file_size_check_clean( const skiplist_file_t *skiplist )
+{
+	if( NULL == skiplist )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+unsigned int skiplist_file_size( const skiplist_file_t *skiplist, skiplist_error_t * const error )
+{
+	unsigned int size = 0;
+	skiplist_error_t err;
+
+	err = skiplist_file_size_check_clean( skiplist );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		size = skiplist_file_header( skiplist )->num_nodes;
+	}
+
+	if( NULL != error )
+	{
+		*error = err;
+	}
+
+	return size;
+}
+
+static skiplist_error_t skiplist_file_begin_check_clean( const skiplist_file_t *skiplist )
+{
+	if( NULL == skiplist )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+skiplist_file_offset_t skiplist_file_begin( const skiplist_file_t *skiplist )
+{
+	skiplist_file_offset_t begin = skiplist_file_end();
+	skiplist_error_t err;
+
+	err = skiplist_file_begin_check_clean( skiplist );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		begin = skiplist_file_header( skiplist )->head.link[0].next;
+	}
+
+	return begin;
+}
+
+skiplist_file_offset_t skiplist_file_end( void )
+{
+	return 0;
+}
+
+/**
+ * @brief Check @p offset could be a node of @p skiplist.
+ *
+ * Nodes only ever appear between the header and the end of the used bytes.
+ */
+static skiplist_error_t skiplist_file_offset_check_clean( const skiplist_file_t *skiplist,
+                                                          skiplist_file_offset_t offset )
+{
+	if( NULL == skiplist )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( offset < sizeof( skiplist_file_header_t ) || offset >= skiplist_file_header( skiplist )->used )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+skiplist_file_offset_t skiplist_file_next( const skiplist_file_t *skiplist, skiplist_file_offset_t offset )
+{
+	skiplist_file_offset_t next = skiplist_file_end();
+	skiplist_error_t err;
+
+	err = skiplist_file_offset_check_clean( skiplist, offset );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		next = skiplist_file_node( skiplist, offset )->link[0].next;
+	}
+
+	return next;
+}
+
+uintptr_t skiplist_file_node_value( const skiplist_file_t *skiplist, skiplist_file_offset_t offset,
+                                    skiplist_error_t * const error )
+{
+	uintptr_t value = 0;
+	skiplist_error_t err;
+
+	err = skiplist_file_offset_check_clean( skiplist, offset );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		value = (uintptr_t) skiplist_file_node( skiplist, offset )->value;
+	}
+
+	if( NULL != error )
+	{
+		*error = err;
+	}
+
+	return value;
+}
@@ -0,0 +1,285 @@
+#ifndef SKIPLIST_FILE_H
+#define SKIPLIST_FILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "skiplist_types.h"
+
+/**
+ * The most links a node of a file backed skiplist can have. This is part of the
+ * file layout, so unlike SKIPLIST_MAX_LINKS it can't be changed at build time.
+ */
+#define SKIPLIST_FILE_MAX_LINKS (32)
+
+/**
+ * The most nodes a file backed skiplist can hold. The count and link widths are
+ * stored as uint32_t, and the width of a link to the end of the list, one past
+ * the last node, must fit too.
+ */
+#define SKIPLIST_FILE_MAX_SIZE ((uint32_t) -2)
+
+/**
+ * @brief The position of a node in a file backed skiplist, relative to the start of the file.
+ *
+ * Offsets stay valid when the file is remapped at a different address, which
+ * happens when it grows and whenever it's opened again.
+ */
+typedef uint64_t skiplist_file_offset_t;
+
+/**
+ * @brief A link between two nodes in a file backed skiplist.
+ */
+typedef struct skiplist_file_link_t
+{
+	/** The offset of the next node in this link's level, 0 at the end of the level. */
+	skiplist_file_offset_t next;
+
+	/** The number of nodes advanced by following this link. */
+	uint32_t width;
+
+	/** Keeps links 8 byte aligned, always 0. */
+	uint32_t reserved;
+} skiplist_file_link_t;
+
+/**
+ * @brief A node as it's stored in the file.
+ */
+typedef struct skiplist_file_node_t
+{
+	/** The value for this node. */
+	uint64_t value;
+
+	/** The number of links in this node. */
+	uint32_t levels;
+
+	/** Keeps the links 8 byte aligned, always 0. */
+	uint32_t reserved;
+
+	/** An array of links, one entry for each level in the node. */
+	skiplist_file_link_t link[1];
+} skiplist_file_node_t;
+
+/**
+ * @brief The start of every skiplist file.
+ *
+ * Fields are stored in the byte order of the machine that created the file,
+ * opening a file created on a machine of the other byte order fails.
+ */
+typedef struct skiplist_file_header_t
+{
+	/** "SKIPFILE". */
+	char magic[8];
+
+	/** The version of the file layout. */
+	uint32_t version;
+
+	/** Written as 0x01020304 to detect a file from a machine of a different byte order. */
+	uint32_t byte_order;
+
+	/** Properties for this skiplist, i.e. Unique entries or not. */
+	uint32_t properties;
+
+	/** The random number generator state, so levels are drawn deterministically across reopens. */
+	uint32_t rng_w;
+	uint32_t rng_z;
+
+	/** The number of nodes in this skiplist. */
+	uint32_t num_nodes;
+
+	/** The number of bytes of the file in use, new nodes are appended here. */
+	uint64_t used;
+
+	/** The head node, with space for SKIPLIST_FILE_MAX_LINKS links. */
+	skiplist_file_node_t head;
+
+	/** The remaining links of the head node. */
+	skiplist_file_link_t head_links[SKIPLIST_FILE_MAX_LINKS - 1];
+} skiplist_file_header_t;
+
+/**
+ * @brief A skiplist whose nodes live in a memory mapped file.
+ *
+ * The list can be reopened without deserializing and shared read only between
+ * processes, pages are faulted in as they're visited. A file must only be
+ * opened writable by one process at a time, and not while it's open read only
+ * elsewhere, as inserts update links in place and may grow the file past the
+ * end of a reader's mapping. An insert interrupted by a crash can leave the
+ * file inconsistent, so rebuild it from its source after an unclean shutdown.
+ */
+typedef struct skiplist_file_t
+{
+	/** The file descriptor of the backing file. */
+	int fd;
+
+	/** Non-zero if the file was opened for inserting. */
+	int writable;
+
+	/** The start of the mapping. */
+	unsigned char *base;
+
+	/** The number of bytes mapped, the size of the file. */
+	size_t mapped;
+
+	/** Function pointer for comparing nodes. */
+	skiplist_compare_pfn compare;
+} skiplist_file_t;
+
+/**
+ * @brief Creates a new, empty file backed skiplist, replacing @p filename if it exists.
+ *
+ * @param [in]  filename            The file to hold the skiplist.
+ * @param [in]  properties          The properties for this skiplist. i.e. Unique entries or not.
+ * @param [in]  size_estimate_log2  An estimate of log2() of the maximum number of elements that will
+ *                                  appear in the list at the same time.
+ * @param [in]  compare             Function for comparing the values that will be used in this skiplist.
+ * @param [out] error               Will point to the error status of the function on return. May be set to NULL.
+ *                                  SKIPLIST_ERROR_SUCCESS if successful.
+ *                                  SKIPLIST_ERROR_INVALID_INPUT if this function was called with invalid input values.
+ *                                  SKIPLIST_ERROR_OUT_OF_MEMORY if this function failed to allocate memory.
+ *                                  SKIPLIST_ERROR_OPENING_FILE if the file couldn't be created or mapped.
+ *
+ * @return If successful the open skiplist, writable, otherwise NULL.
+ */
+skiplist_file_t *skiplist_file_create( const char *filename, skiplist_properties_t properties,
+                                       unsigned int size_estimate_log2, skiplist_compare_pfn compare,
+                                       skiplist_error_t * const error );
+
+/**
+ * @brief Opens a file backed skiplist created by skiplist_file_create().
+ *
+ * @param [in]  filename  The file holding the skiplist.
+ * @param [in]  writable  Non-zero to allow inserting, otherwise the file is mapped read only.
+ * @param [in]  compare   Function for comparing values, it must order values the same way as the
+ *                        function the file was created with.
+ * @param [out] error     Will point to the error status of the function on return. May be set to NULL.
+ *                        SKIPLIST_ERROR_SUCCESS if successful.
+ *                        SKIPLIST_ERROR_INVALID_INPUT if this function was called with invalid input values.
+ *                        SKIPLIST_ERROR_OUT_OF_MEMORY if this function failed to allocate memory.
+ *                        SKIPLIST_ERROR_OPENING_FILE if the file couldn't be opened or mapped.
+ *                        SKIPLIST_ERROR_INVALID_SNAPSHOT if the file isn't a skiplist file this build can open.
+ *
+ * @return If successful the open skiplist, otherwise NULL.
+ */
+skiplist_file_t *skiplist_file_open( const char *filename, unsigned int writable, skiplist_compare_pfn compare,
+                                     skiplist_error_t * const error );
+
+/**
+ * @brief Writes every change to the file and waits for it to reach the disk.
+ *
+ * @param [in] skiplist  The skiplist to flush.
+ *
+ * @retval SKIPLIST_ERROR_SUCCESS if successful.
+ * @retval SKIPLIST_ERROR_INVALID_INPUT if input values were invalid.
+ * @retval SKIPLIST_ERROR_IO if the file couldn't be written.
+ */
+skiplist_error_t skiplist_file_sync( skiplist_file_t *skiplist );
+
+/**
+ * @brief Unmaps and closes a file backed skiplist.
+ *
+ * Changes reach the file even without calling skiplist_file_sync() first, but
+ * only skiplist_file_sync() guarantees they're on disk.
+ *
+ * @param [in] skiplist  The skiplist to close.
+ *
+ * @retval SKIPLIST_ERROR_SUCCESS if successful.
+ * @retval SKIPLIST_ERROR_INVALID_INPUT if input values were invalid.
+ */
+skiplist_error_t skiplist_file_close( skiplist_file_t *skiplist );
+
+/**
+ * @brief Searches for a value in a file backed skiplist.
+ *
+ * @param [in]  skiplist  The skiplist to search in.
+ * @param [in]  value     The value to search for.
+ * @param [out] error     Will point to the error status of the function on return. May be set to NULL.
+ *                        SKIPLIST_ERROR_SUCCESS if successful.
+ *                        SKIPLIST_ERROR_INVALID_INPUT if this function was called with invalid input values.
+ *
+ * @return 1 if @p value is in @p skiplist, 0 otherwise.
+ */
+unsigned int skiplist_file_contains( const skiplist_file_t *skiplist, uintptr_t value, skiplist_error_t * const error );
+
+/**
+ * @brief Inserts a value into a file backed skiplist, growing the file if needed.
+ *
+ * Growing the file remaps it, so node offsets remain valid but pointers into
+ * the old mapping don't.
+ *
+ * @param [in] skiplist  The skiplist to insert into.
+ * @param [in] value     The value to insert.
+ *
+ * @retval SKIPLIST_ERROR_SUCCESS if successful.
+ * @retval SKIPLIST_ERROR_INVALID_INPUT if input values were invalid.
+ * @retval SKIPLIST_ERROR_NOT_SUPPORTED if the skiplist was opened read only.
+ * @retval SKIPLIST_ERROR_IO if the file couldn't be grown or remapped.
+ * @retval SKIPLIST_ERROR_FULL if @p skiplist already holds SKIPLIST_FILE_MAX_SIZE nodes.
+ */
+skiplist_error_t skiplist_file_insert( skiplist_file_t *skiplist, uintptr_t value );
+
+/**
+ * @brief Returns the value at a given index in a file backed skiplist.
+ *
+ * @param [in]  skiplist  The skiplist to index.
+ * @param [in]  index     The index of the value to return, starting at 0.
+ * @param [out] error     Will point to the error status of the function on return. May be set to NULL.
+ *                        SKIPLIST_ERROR_SUCCESS if successful.
+ *                        SKIPLIST_ERROR_INVALID_INPUT if this function was called with invalid input values.
+ *
+ * @return The value at @p index. 0 on invalid input.
+ */
+uintptr_t skiplist_file_at_index( const skiplist_file_t *skiplist, unsigned int index, skiplist_error_t * const error );
+
+/**
+ * @brief Returns the number of nodes in a file backed skiplist.
+ *
+ * @param [in]  skiplist  The skiplist to count the nodes in.
+ * @param [out] error     Will point to the error status of the function on return. May be set to NULL.
+ *                        SKIPLIST_ERROR_SUCCESS if successful.
+ *                        SKIPLIST_ERROR_INVALID_INPUT if this function was called with invalid input values.
+ *
+ * @return The number of nodes in @p skiplist. 0 on invalid input.
+ */
+unsigned int skiplist_file_size( const skiplist_file_t *skiplist, skiplist_error_t * const error );
+
+/**
+ * @brief Returns the offset of the first node in a file backed skiplist.
+ *
+ * @param [in] skiplist  The skiplist to iterate.
+ *
+ * @return The offset of the first node, skiplist_file_end() if the list is empty or on invalid input.
+ */
+skiplist_file_offset_t skiplist_file_begin( const skiplist_file_t *skiplist );
+
+/**
+ * @brief Returns the offset representing the end of a file backed skiplist.
+ */
+skiplist_file_offset_t skiplist_file_end( void );
+
+/**
+ * @brief Returns the offset of the node after the node at @p offset.
+ *
+ * @param [in] skiplist  The skiplist being iterated.
+ * @param [in] offset    The offset of a node in @p skiplist.
+ *
+ * @return The offset of the next node, skiplist_file_end() at the end of the list or on invalid input.
+ */
+skiplist_file_offset_t skiplist_file_next( const skiplist_file_t *skiplist, skiplist_file_offset_t offset );
+
+/**
+ * @brief Returns the value of the node at @p offset.
+ *
+ * @param [in]  skiplist  The skiplist being iterated.
+ * @param [in]  offset    The offset of a node in @p skiplist.
+ * @param [out] error     Will point to the error status of the function on return. May be set to NULL.
+ *                        SKIPLIST_ERROR_SUCCESS if successful.
+ *                        SKIPLIST_ERROR_INVALID_INPUT if this function was called with invalid input values.
+ *
+ * @return The value of the node. 0 on invalid input.
+ */
+uintptr_t skiplist_file_node_value( const skiplist_file_t *skiplist, skiplist_file_offset_t offset,
+                                    skiplist_error_t * const error );
+
+#endif
@@ -0,0 +1,756 @@
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "skiplist_persistent.h"
+
+/**
+ * @brief Generate a random unsigned 32 bit integer.
+ *
+ * The same multiply with carry generator as skiplist_rng_gen_u32(), each
+ * version carries its own state so the levels of its successors are repeatable.
+ */
+static unsigned int skiplist_persistent_rng_gen_u32( skiplist_rng_t *rng )
+{
+	rng->m_z = 36969 * (rng->m_z & 65535) + (rng->m_z >> 16);
+	rng->m_w = 18000 * (rng->m_w & 65535) + (rng->m_w >> 16);
+
+	return (rng->m_z << 16) + rng->m_w;
+}
+
+static unsigned int skiplist_persistent_compute_node_level( skiplist_persistent_t *version )
+{
+	unsigned int node_levels;
+	unsigned int bits;
+
+	/* See skiplist_compute_node_level(), each level is half as likely as the one below it. */
+	node_levels = 0;
+	do
+	{
+		bits = skiplist_persistent_rng_gen_u32( &version->rng );
+		node_levels += 0 == bits ? 32 : (unsigned int) __builtin_clz( bits ) + 1;
+	} while( 0 == bits && node_levels < version->levels );
+
+	if( node_levels > version->levels )
+	{
+		node_levels = version->levels;
+	}
+
+	return node_levels;
+}
+
+/**
+ * @brief Drop a reference to @p node, freeing it and the cells only it pointed at once unreferenced.
+ */
+static void skiplist_persistent_node_release( skiplist_persistent_node_t *node )
+{
+	skiplist_persistent_node_t *next;
+
+	/* Runs along a level are followed in a loop, only the descent recurses. */
+	while( NULL != node && 0 == --node->refs )
+	{
+		next = node->next;
+		skiplist_persistent_node_release( node->down );
+		free( node );
+		node = next;
+	}
+}
+
+/**
+ * @brief Returns a new cell with the same value and links as @p node, sharing the cells it points at.
+ */
+static skiplist_persistent_node_t *skiplist_persistent_node_copy( const skiplist_persistent_node_t *node )
+{
+	skiplist_persistent_node_t *copy;
+
+	copy = (skiplist_persistent_node_t *) malloc( sizeof( skiplist_persistent_node_t ) );
+	if( NULL != copy )
+	{
+		*copy = *node;
+		copy->refs = 1;
+		if( NULL != copy->next )
+		{
+			++copy->next->refs;
+		}
+		if( NULL != copy->down )
+		{
+			++copy->down->refs;
+		}
+	}
+
+	return copy;
+}
+
+/**
+ * @brief Point the next link of the copy @p node at @p next.
+ *
+ * The cell it pointed at is still referenced by the cell it was copied from,
+ * so dropping the reference never frees it.
+ */
+static void skiplist_persistent_set_next( skiplist_persistent_node_t *node, skiplist_persistent_node_t *next )
+{
+	if( NULL != node->next )
+	{
+		assert( node->next->refs > 1 );
+		--node->next->refs;
+	}
+	node->next = next;
+}
+
+/**
+ * @brief Returns the number of nodes under the run of cells starting at @p first.
+ */
+static skiplist_size_t skiplist_persistent_run_width( const skiplist_persistent_node_t *first )
+{
+	skiplist_size_t width = 0;
+
+	for( ; NULL != first; first = first->next )
+	{
+		width += first->width;
+	}
+
+	return width;
+}
+
+/**
+ * @brief Point the down link of the copy @p node at @p down, and update its width to match.
+ */
+static void skiplist_persistent_set_down( skiplist_persistent_node_t *node, skiplist_persistent_node_t *down )
+{
+	assert( node->down->refs > 1 );
+	--node->down->refs;
+	node->down = down;
+	node->width = skiplist_persistent_run_width( down );
+}
+
+/**
+ * @brief Copy the run of cells from @p first up to and including @p last.
+ *
+ * @param [in]  first      The first cell to copy.
+ * @param [in]  last       The last cell to copy, @p first or a cell after it on the same level.
+ * @param [out] last_copy  The copy of @p last.
+ *
+ * @return The copy of @p first, NULL if out of memory.
+ */
+static skiplist_persistent_node_t *skiplist_persistent_copy_run( const skiplist_persistent_node_t *first,
+                                                                 const skiplist_persistent_node_t *last,
+                                                                 skiplist_persistent_node_t **last_copy )
+{
+	skiplist_persistent_node_t *first_copy = NULL;
+	skiplist_persistent_node_t *prev = NULL;
+	skiplist_persistent_node_t *copy;
+	const skiplist_persistent_node_t *cur;
+
+	for( cur = first;; cur = cur->next )
+	{
+		copy = skiplist_persistent_node_copy( cur );
+		if( NULL == copy )
+		{
+			skiplist_persistent_node_release( first_copy );
+			return NULL;
+		}
+
+		if( NULL == prev )
+		{
+			first_copy = copy;
+		}
+		else
+		{
+			skiplist_persistent_set_next( prev, copy );
+		}
+		prev = copy;
+
+		if( cur == last )
+		{
+			break;
+		}
+	}
+
+	*last_copy = prev;
+
+	return first_copy;
+}
+
+/**
+ * @brief Copy the run starting at @p first on @p level with @p value inserted below it.
+ *
+ * @param [in]  version  The version being inserted into.
+ * @param [in]  first    The first cell of the run, not greater than @p value.
+ * @param [in]  level    The level of the run.
+ * @param [in]  value    The value to insert.
+ * @param [in]  height   The number of levels of the new node.
+ * @param [out] split    The new node's cell on this level when it's below the node's top,
+ *                       which starts a run of its own under the cell above. NULL otherwise.
+ *
+ * @return The copy of @p first, NULL if out of memory.
+ */
+static skiplist_persistent_node_t *skiplist_persistent_insert_run( const skiplist_persistent_t *version,
+                                                                   const skiplist_persistent_node_t *first,
+                                                                   unsigned int level, uintptr_t value,
+                                                                   unsigned int height,
+                                                                   skiplist_persistent_node_t **split )
+{
+	const skiplist_persistent_node_t *last;
+	skiplist_persistent_node_t *first_copy;
+	skiplist_persistent_node_t *last_copy;
+	skiplist_persistent_node_t *down;
+	skiplist_persistent_node_t *down_split = NULL;
+	skiplist_persistent_node_t *node;
+
+	*split = NULL;
+
+	/* The new node goes after the last cell of the run that isn't greater than it. */
+	for( last = first; NULL != last->next && version->compare( last->next->value, value ) <= 0; last = last->next )
+	{
+	}
+
+	first_copy = skiplist_persistent_copy_run( first, last, &last_copy );
+	if( NULL == first_copy )
+	{
+		return NULL;
+	}
+
+	if( 0 != level )
+	{
+		down = skiplist_persistent_insert_run( version, last->down, level - 1, value, height, &down_split );
+		if( NULL == down )
+		{
+			skiplist_persistent_node_release( first_copy );
+			return NULL;
+		}
+		skiplist_persistent_set_down( last_copy, down );
+	}
+
+	if( level < height )
+	{
+		node = (skiplist_persistent_node_t *) malloc( sizeof( skiplist_persistent_node_t ) );
+		if( NULL == node )
+		{
+			skiplist_persistent_node_release( down_split );
+			skiplist_persistent_node_release( first_copy );
+			return NULL;
+		}
+
+		/* The new cell takes over the copy's reference to the rest of the run. */
+		node->value = value;
+		node->width = 1;
+		node->refs = 1;
+		node->next = last_copy->next;
+		node->down = down_split;
+		last_copy->next = NULL;
+		if( NULL != down_split )
+		{
+			node->width = skiplist_persistent_run_width( down_split );
+		}
+
+		/* Below the node's top level the run ends here, the new cell starts the next one. */
+		if( level + 1 == height )
+		{
+			last_copy->next = node;
+		}
+		else
+		{
+			*split = node;
+		}
+	}
+
+	return first_copy;
+}
+
+/**
+ * @brief Copy the run starting at @p first on @p level and append the cells after @p removed to it.
+ *
+ * Removing a node's cell from above leaves the cells under it on each level
+ * below without a cell above, so they join the end of the run before them.
+ *
+ * @return The copy of @p first, NULL if out of memory.
+ */
+static skiplist_persistent_node_t *skiplist_persistent_merge_run( const skiplist_persistent_node_t *first,
+                                                                  unsigned int level,
+                                                                  const skiplist_persistent_node_t *removed )
+{
+	const skiplist_persistent_node_t *last;
+	skiplist_persistent_node_t *first_copy;
+	skiplist_persistent_node_t *last_copy;
+	skiplist_persistent_node_t *down;
+
+	for( last = first; NULL != last->next; last = last->next )
+	{
+	}
+
+	first_copy = skiplist_persistent_copy_run( first, last, &last_copy );
+	if( NULL == first_copy )
+	{
+		return NULL;
+	}
+
+	last_copy->next = removed->next;
+	if( NULL != last_copy->next )
+	{
+		++last_copy->next->refs;
+	}
+
+	if( 0 != level )
+	{
+		down = skiplist_persistent_merge_run( last->down, level - 1, removed->down );
+		if( NULL == down )
+		{
+			skiplist_persistent_node_release( first_copy );
+			return NULL;
+		}
+		skiplist_persistent_set_down( last_copy, down );
+	}
+
+	return first_copy;
+}
+
+/**
+ * @brief Copy the run starting at @p first on @p level with @p value removed below it.
+ *
+ * @p value must be in the version, and @p first less than it.
+ *
+ * @return The copy of @p first, NULL if out of memory.
+ */
+static skiplist_persistent_node_t *skiplist_persistent_remove_run( const skiplist_persistent_t *version,
+                                                                   const skiplist_persistent_node_t *first,
+                                                                   unsigned int level, uintptr_t value )
+{
+	const skiplist_persistent_node_t *last;
+	const skiplist_persistent_node_t *removed;
+	skiplist_persistent_node_t *first_copy;
+	skiplist_persistent_node_t *last_copy;
+	skiplist_persistent_node_t *down = NULL;
+
+	for( last = first; NULL != last->next && version->compare( last->next->value, value ) < 0; last = last->next )
+	{
+	}
+
+	first_copy = skiplist_persistent_copy_run( first, last, &last_copy );
+	if( NULL == first_copy )
+	{
+		return NULL;
+	}
+
+	removed = last->next;
+	if( NULL != removed && 0 == version->compare( removed->value, value ) )
+	{
+		/* This is the node's top level, so its cells below join the runs before them. */
+		if( NULL != removed->next )
+		{
+			++removed->next->refs;
+		}
+		skiplist_persistent_set_next( last_copy, removed->next );
+		if( 0 != level )
+		{
+			down = skiplist_persistent_merge_run( last->down, level - 1, removed->down );
+		}
+	}
+	else
+	{
+		assert( 0 != level );
+		down = skiplist_persistent_remove_run( version, last->down, level - 1, value );
+	}
+
+	if( 0 != level )
+	{
+		if( NULL == down )
+		{
+			skiplist_persistent_node_release( first_copy );
+			return NULL;
+		}
+		skiplist_persistent_set_down( last_copy, down );
+	}
+
+	return first_copy;
+}
+
+/**
+ * @brief Allocate a version with the same settings as @p version, holding @p head.
+ */
+static skiplist_persistent_t *skiplist_persistent_allocate( const skiplist_persistent_t *version,
+                                                            skiplist_persistent_node_t *head )
+{
+	skiplist_persistent_t *next;
+
+	next = (skiplist_persistent_t *) malloc( sizeof( skiplist_persistent_t ) );
+	if( NULL != next )
+	{
+		*next = *version;
+		next->head = head;
+	}
+
+	return next;
+}
+
+static skiplist_error_t skiplist_persistent_create_check_clean( skiplist_properties_t properties,
+                                                                unsigned int size_estimate_log2,
+                                                                skiplist_compare_pfn compare )
+{
+	if( SKIPLIST_PROPERTY_NONE != properties && SKIPLIST_PROPERTY_UNIQUE != properties )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( size_estimate_log2 <= 0 || size_estimate_log2 > SKIPLIST_MAX_LINKS )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( NULL == compare )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+static skiplist_persistent_t *skiplist_persistent_create_clean( skiplist_properties_t properties,
+                                                                unsigned int size_estimate_log2,
+                                                                skiplist_compare_pfn compare )
+{
+	skiplist_persistent_t *version;
+	skiplist_persistent_node_t *head = NULL;
+	skiplist_persistent_node_t *cell;
+	unsigned int i;
+
+	/* Build the head's tower from the bottom up, each cell pointing down at the last. */
+	for( i = 0; i < size_estimate_log2; ++i )
+	{
+		cell = (skiplist_persistent_node_t *) malloc( sizeof( skiplist_persistent_node_t ) );
+		if( NULL == cell )
+		{
+			skiplist_persistent_node_release( head );
+			return NULL;
+		}
+		cell->value = 0;
+		cell->width = 0;
+		cell->refs = 1;
+		cell->next = NULL;
+		cell->down = head;
+		head = cell;
+	}
+
+	version = (skiplist_persistent_t *) malloc( sizeof( skiplist_persistent_t ) );
+	if( NULL == version )
+	{
+		skiplist_persistent_node_release( head );
+		return NULL;
+	}
+
+	version->head = head;
+	version->num_nodes = 0;
+	version->levels = size_estimate_log2;
+	version->properties = properties;
+	version->compare = compare;
+	version->rng.m_w = 0xcafef00d;
+	version->rng.m_z = 0xabcd1234;
+
+	return version;
+}
+
+skiplist_persistent_t *skiplist_persistent_create( skiplist_properties_t properties, unsigned int size_estimate_log2,
+                                                   skiplist_compare_pfn compare, skiplist_error_t * const error )
+{
+	skiplist_persistent_t *version = NULL;
+	skiplist_error_t err;
+
+	err = skiplist_persistent_create_check_clean( properties, size_estimate_log2, compare );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		version = skiplist_persistent_create_clean( properties, size_estimate_log2, compare );
+		if( NULL == version )
+		{
+			err = SKIPLIST_ERROR_OUT_OF_MEMORY;
+		}
+	}
+
+	if( NULL != error )
+	{
+		*error = err;
+	}
+
+	return version;
+}
+
+static skiplist_error_t skiplist_persistent_check_clean( const skiplist_persistent_t *version )
+{
+	if( NULL == version )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+static unsigned int skiplist_persistent_contains_clean( const skiplist_persistent_t *version, uintptr_t value )
+{
+	const skiplist_persistent_node_t *cur;
+	int comparison;
+
+	for( cur = version->head; NULL != cur; cur = cur->down )
+	{
+		for( ; NULL != cur->next; cur = cur->next )
+		{
+			comparison = version->compare( cur->next->value, value );
+			if( comparison > 0 )
+			{
+				break;
+			}
+			else if( 0 == comparison )
+			{
+				return 1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+unsigned int skiplist_persistent_contains( const skiplist_persistent_t *version, uintptr_t value,
+                                           skiplist_error_t * const error )
+{
+	unsigned int contains = 0;
+	skiplist_error_t err;
+
+	err = skiplist_persistent_check_clean( version );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		contains = skiplist_persistent_contains_clean( version, value );
+	}
+
+	if( NULL != error )
+	{
+		*error = err;
+	}
+
+	return contains;
+}
+
+static skiplist_persistent_t *skiplist_persistent_insert_clean( const skiplist_persistent_t *version, uintptr_t value,
+                                                                skiplist_error_t *error )
+{
+	skiplist_persistent_t *next;
+	skiplist_persistent_node_t *head;
+	skiplist_persistent_node_t *split;
+
+	/* A set that already holds the value gets an identical version. */
+	if( (version->properties & SKIPLIST_PROPERTY_UNIQUE) && skiplist_persistent_contains_clean( version, value ) )
+	{
+		next = skiplist_persistent_allocate( version, version->head );
+		if( NULL != next )
+		{
+			++next->head->refs;
+		}
+	}
+	else if( version->num_nodes >= SKIPLIST_MAX_SIZE )
+	{
+		*error = SKIPLIST_ERROR_FULL;
+		return NULL;
+	}
+	else
+	{
+		next = skiplist_persistent_allocate( version, NULL );
+		if( NULL != next )
+		{
+			/* The new node is never taller than the head, so it can't split the top level. */
+			head = skiplist_persistent_insert_run( version, version->head, version->levels - 1, value,
+			                                       skiplist_persistent_compute_node_level( next ), &split );
+			assert( NULL == split );
+			if( NULL == head )
+			{
+				free( next );
+				next = NULL;
+			}
+			else
+			{
+				next->head = head;
+				++next->num_nodes;
+			}
+		}
+	}
+
+	*error = NULL == next ? SKIPLIST_ERROR_OUT_OF_MEMORY : SKIPLIST_ERROR_SUCCESS;
+
+	return next;
+}
+
+skiplist_persistent_t *skiplist_persistent_insert( const skiplist_persistent_t *version, uintptr_t value,
+                                                   skiplist_error_t * const error )
+{
+	skiplist_persistent_t *next = NULL;
+	skiplist_error_t err;
+
+	err = skiplist_persistent_check_clean( version );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		next = skiplist_persistent_insert_clean( version, value, &err );
+	}
+
+	if( NULL != error )
+	{
+		*error = err;
+	}
+
+	return next;
+}
+
+static skiplist_error_t skiplist_persistent_remove_check_clean( const skiplist_persistent_t *version,
+                                                                uintptr_t value )
+{
+	if( NULL == version )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( !skiplist_persistent_contains_clean( version, value ) )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+static skiplist_persistent_t *skiplist_persistent_remove_clean( const skiplist_persistent_t *version,
+                                                                uintptr_t value )
+{
+	skiplist_persistent_t *next;
+	skiplist_persistent_node_t *head;
+
+	next = skiplist_persistent_allocate( version, NULL );
+	if( NULL != next )
+	{
+		head = skiplist_persistent_remove_run( version, version->head, version->levels - 1, value );
+		if( NULL == head )
+		{
+			free( next );
+			return NULL;
+		}
+		next->head = head;
+		--next->num_nodes;
+	}
+
+	return next;
+}
+
+skiplist_persistent_t *skiplist_persistent_remove( const skiplist_persistent_t *version, uintptr_t value,
+                                                   skiplist_error_t * const error )
+{
+	skiplist_persistent_t *next = NULL;
+	skiplist_error_t err;
+
+	err = skiplist_persistent_remove_check_clean( version, value );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		next = skiplist_persistent_remove_clean( version, value );
+		if( NULL == next )
+		{
+			err = SKIPLIST_ERROR_OUT_OF_MEMORY;
+		}
+	}
+
+	if( NULL != error )
+	{
+		*error = err;
+	}
+
+	return next;
+}
+
+skiplist_error_t skiplist_persistent_release( skiplist_persistent_t *version )
+{
+	skiplist_error_t err;
+
+	err = skiplist_persistent_check_clean( version );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		skiplist_persistent_node_release( version->head );
+		free( version );
+	}
+
+	return err;
+}
+
+static skiplist_error_t skiplist_persistent_at_index_check_clean( const skiplist_persistent_t *version,
+                                                                  skiplist_size_t index )
+{
+	if( NULL == version )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( index >= version->num_nodes )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+static uintptr_t skiplist_persistent_at_index_clean( const skiplist_persistent_t *version, skiplist_size_t index )
+{
+	const skiplist_persistent_node_t *cur;
+	skiplist_size_t remaining;
+
+	/* Skip whole cells along each run, then descend into the one holding the index. The
+	   head's bottom cell has no width, so the bottom level always stops at a node. */
+	remaining = index;
+	for( cur = version->head;; cur = cur->down )
+	{
+		while( remaining >= cur->width )
+		{
+			remaining -= cur->width;
+			cur = cur->next;
+		}
+
+		if( NULL == cur->down )
+		{
+			return cur->value;
+		}
+	}
+}
+
+uintptr_t skiplist_persistent_at_index( const skiplist_persistent_t *version, skiplist_size_t index,
+                                        skiplist_error_t * const error )
+{
+	uintptr_t value = 0;
+	skiplist_error_t err;
+
+	err = skiplist_persistent_at_index_check_clean( version, index );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		value = skiplist_persistent_at_index_clean( version, index );
+	}
+
+	if( NULL != error )
+	{
+		*error = err;
+	}
+
+	return value;
+}
+
+skiplist_size_t skiplist_persistent_size( const skiplist_persistent_t *version, skiplist_error_t * const error )
+{
+	skiplist_size_t size = 0;
+	skiplist_error_t err;
+
+	err = skiplist_persistent_check_clean( version );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		size = version->num_nodes;
+	}
+
+	if( NULL != error )
+	{
+		*error = err;
+	}
+
+	return size;
+}
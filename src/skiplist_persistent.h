@@ -0,0 +1,177 @@
+#ifndef SKIPLIST_PERSISTENT_H
+#define SKIPLIST_PERSISTENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "skiplist_types.h"
+
+/**
+ * @brief A cell of a persistent skiplist, one level of one node's tower.
+ *
+ * A persistent skiplist is stored as a skip tree: the same towers and links
+ * as a skiplist, except a level ends where the next taller tower starts. A
+ * tower's cell on the level below continues from there instead, with @p down
+ * pointing at it. Every cell then has a single cell pointing at it, so an
+ * update only copies the cells on its search path, and the cells before them
+ * in the same runs, leaving everything else shared with the version it
+ * was made from.
+ */
+typedef struct skiplist_persistent_node_t
+{
+	/** The value for this cell's node, unused for the head. */
+	uintptr_t value;
+
+	/** The number of nodes under this cell, the same as the width of the
+	    node's link on this level in a skiplist. 1 for a node's bottom cell
+	    and 0 for the head's. */
+	skiplist_size_t width;
+
+	/** The number of cells and versions pointing at this cell. */
+	unsigned int refs;
+
+	/** The next cell on this level, NULL where the next taller tower starts. */
+	struct skiplist_persistent_node_t *next;
+
+	/** The cell of the same node on the level below, NULL on the bottom level. */
+	struct skiplist_persistent_node_t *down;
+} skiplist_persistent_node_t;
+
+/**
+ * @brief One immutable version of a persistent skiplist.
+ *
+ * Versions are never changed once made. skiplist_persistent_insert() and
+ * skiplist_persistent_remove() return a new version sharing all but
+ * O(log N) cells with the one they're given, which stays valid.
+ * Versions can be read by any number of threads without locking. Making
+ * and releasing versions updates the reference counts of shared cells,
+ * so those calls must be serialized with each other, and a new version
+ * must be handed to readers through a lock or other barrier.
+ */
+typedef struct skiplist_persistent_t
+{
+	/** The head's cell on the top level, the start of every search. */
+	skiplist_persistent_node_t *head;
+
+	/** The number of nodes in this version. */
+	skiplist_size_t num_nodes;
+
+	/** The number of levels, the height of the head's tower. */
+	unsigned int levels;
+
+	/** Properties for this skiplist, i.e. Unique entries or not. */
+	skiplist_properties_t properties;
+
+	/** Function pointer for comparing nodes. */
+	skiplist_compare_pfn compare;
+
+	/** The random number generator state the next version's node levels are drawn from. */
+	skiplist_rng_t rng;
+} skiplist_persistent_t;
+
+/**
+ * @brief Creates the first, empty version of a persistent skiplist.
+ *
+ * @param [in]  properties          The properties for this skiplist. i.e. Unique entries or not.
+ * @param [in]  size_estimate_log2  An estimate of log2() of the maximum number of elements that will
+ *                                  appear in a version. This is the number of levels.
+ * @param [in]  compare             Function for comparing the values that will be used in this skiplist.
+ * @param [out] error               Will point to the error status of the function on return. May be set to NULL.
+ *                                  SKIPLIST_ERROR_SUCCESS if successful.
+ *                                  SKIPLIST_ERROR_INVALID_INPUT if this function was called with invalid input values.
+ *                                  SKIPLIST_ERROR_OUT_OF_MEMORY if this function failed to allocate memory.
+ *
+ * @return If successful the empty version, otherwise NULL.
+ */
+skiplist_persistent_t *skiplist_persistent_create( skiplist_properties_t properties, unsigned int size_estimate_log2,
+                                                   skiplist_compare_pfn compare, skiplist_error_t * const error );
+
+/**
+ * @brief Makes a new version with a value inserted, copying only the cells on its path.
+ *
+ * Inserting a value already in a SKIPLIST_PROPERTY_UNIQUE skiplist makes a
+ * version sharing every cell with @p version.
+ *
+ * @param [in]  version  The version to insert into, which is left unchanged.
+ * @param [in]  value    The value to insert.
+ * @param [out] error    Will point to the error status of the function on return. May be set to NULL.
+ *                       SKIPLIST_ERROR_SUCCESS if successful.
+ *                       SKIPLIST_ERROR_INVALID_INPUT if this function was called with invalid input values.
+ *                       SKIPLIST_ERROR_OUT_OF_MEMORY if this function failed to allocate memory.
+ *                       SKIPLIST_ERROR_FULL if @p version already holds SKIPLIST_MAX_SIZE nodes.
+ *
+ * @return If successful the new version, otherwise NULL.
+ */
+skiplist_persistent_t *skiplist_persistent_insert( const skiplist_persistent_t *version, uintptr_t value,
+                                                   skiplist_error_t * const error );
+
+/**
+ * @brief Makes a new version with a value removed, copying only the cells on its path.
+ *
+ * @param [in]  version  The version to remove from, which is left unchanged.
+ * @param [in]  value    The value to remove. Must be in @p version for this function to succeed.
+ * @param [out] error    Will point to the error status of the function on return. May be set to NULL.
+ *                       SKIPLIST_ERROR_SUCCESS if successful.
+ *                       SKIPLIST_ERROR_INVALID_INPUT if this function was called with invalid input values
+ *                       or @p value isn't in @p version.
+ *                       SKIPLIST_ERROR_OUT_OF_MEMORY if this function failed to allocate memory.
+ *
+ * @return If successful the new version, otherwise NULL.
+ */
+skiplist_persistent_t *skiplist_persistent_remove( const skiplist_persistent_t *version, uintptr_t value,
+                                                   skiplist_error_t * const error );
+
+/**
+ * @brief Releases a version, freeing the cells no other version shares.
+ *
+ * Versions may be released in any order.
+ *
+ * @param [in] version  The version to release.
+ *
+ * @retval SKIPLIST_ERROR_SUCCESS if successful.
+ * @retval SKIPLIST_ERROR_INVALID_INPUT if input values were invalid.
+ */
+skiplist_error_t skiplist_persistent_release( skiplist_persistent_t *version );
+
+/**
+ * @brief Searches for a value in a version of a persistent skiplist.
+ *
+ * @param [in]  version  The version to search in.
+ * @param [in]  value    The value to search for.
+ * @param [out] error    Will point to the error status of the function on return. May be set to NULL.
+ *                       SKIPLIST_ERROR_SUCCESS if successful.
+ *                       SKIPLIST_ERROR_INVALID_INPUT if this function was called with invalid input values.
+ *
+ * @return 1 if @p value is in @p version, 0 otherwise.
+ */
+unsigned int skiplist_persistent_contains( const skiplist_persistent_t *version, uintptr_t value,
+                                           skiplist_error_t * const error );
+
+/**
+ * @brief Returns the value at a given index in a version of a persistent skiplist.
+ *
+ * @param [in]  version  The version to index.
+ * @param [in]  index    The index of the value to return, starting at 0.
+ * @param [out] error    Will point to the error status of the function on return. May be set to NULL.
+ *                       SKIPLIST_ERROR_SUCCESS if successful.
+ *                       SKIPLIST_ERROR_INVALID_INPUT if this function was called with invalid input values.
+ *
+ * @return The value at @p index. 0 on invalid input.
+ */
+uintptr_t skiplist_persistent_at_index( const skiplist_persistent_t *version, skiplist_size_t index,
+                                        skiplist_error_t * const error );
+
+/**
+ * @brief Returns the number of nodes in a version of a persistent skiplist.
+ *
+ * @param [in]  version  The version to count the nodes in.
+ * @param [out] error    Will point to the error status of the function on return. May be set to NULL.
+ *                       SKIPLIST_ERROR_SUCCESS if successful.
+ *                       SKIPLIST_ERROR_INVALID_INPUT if this function was called with invalid input values.
+ *
+ * @return The number of nodes in @p version. 0 on invalid input.
+ */
+skiplist_size_t skiplist_persistent_size( const skiplist_persistent_t *version, skiplist_error_t * const error );
+
+#endif
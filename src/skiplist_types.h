@@ -1,18 +1,58 @@
 #ifndef SKIPLIST_TYPES_H
 #define SKIPLIST_TYPES_H
 
+#include "skiplist_arena.h"
+
 /**
  * The maximum number of next pointers per node in this skip list
- * implementation is 32, due to the random number generator only
- * generating 32 bit numbers. This value allows for efficient
- * O(log(n)) skiplist insertion where n is up to 2^32 nodes.
+ * implementation defaults to 32. This value allows for efficient
+ * O(log(n)) skiplist insertion where n is up to 2^32 nodes. It can be
+ * raised to at most 64 at build time (e.g. make LINKS=64), usually
+ * together with SKIPLIST_64BIT, for lists with more nodes than that.
  *
  * Always picking the maximum number of links will increase memory
  * consumption and has a high constant overhead due to the number
  * of links that need to be maintained. So where possible pick a
  * smaller number.
  */
+#ifndef SKIPLIST_MAX_LINKS
 #define SKIPLIST_MAX_LINKS (32)
+#endif
+
+#if SKIPLIST_MAX_LINKS < 1 || SKIPLIST_MAX_LINKS > 64
+#error "SKIPLIST_MAX_LINKS must be between 1 and 64"
+#endif
+
+/**
+ * @brief The type of node counts, link widths and indices.
+ *
+ * This is unsigned int unless the library is compiled with SKIPLIST_64BIT
+ * defined (e.g. make WIDE=1), which makes it 64 bits wide so a list can hold
+ * more than 2^32 nodes at the cost of larger links. The library and every
+ * file including its headers must be compiled with the same setting.
+ */
+#ifdef SKIPLIST_64BIT
+typedef uint64_t skiplist_size_t;
+#else
+typedef unsigned int skiplist_size_t;
+#endif
+
+/**
+ * The most nodes a skiplist can hold. One less than the largest skiplist_size_t
+ * so the width of a link to the end of the list, one past the last node, fits.
+ */
+#define SKIPLIST_MAX_SIZE ((skiplist_size_t) -2)
+
+/**
+ * The largest payload that can be stored inline in every node of a map.
+ * Larger records are better kept out of line, with a pointer as the payload.
+ */
+#define SKIPLIST_MAX_PAYLOAD_SIZE (4096)
+
+/**
+ * The longest byte string key a SKIPLIST_KEY_BYTES skiplist accepts.
+ */
+#define SKIPLIST_MAX_KEY_SIZE ((size_t)1 << 24)
 
 /**
  * @brief Skiplist property bitset.
@@ -24,11 +64,78 @@ typedef unsigned int skiplist_properties_t;
  */
 #define SKIPLIST_PROPERTY_UNIQUE (1 << 0)
 
+/**
+ * @brief Remove values by marking their nodes as tombstones instead of unlinking them.
+ *
+ * Lookups, iteration, skiplist_size() and skiplist_at_index() skip tombstones.
+ * They're unlinked and freed together by skiplist_compact(), which also runs
+ * automatically once there are more than compact_percent tombstones for every
+ * 100 live nodes, see skiplist_options_t.
+ */
+#define SKIPLIST_PROPERTY_LAZY_DELETE (1 << 1)
+
+/**
+ * @brief Stamp every node with the versions it was inserted and removed at, so snapshots can be taken.
+ *
+ * Removes leave tombstones as with SKIPLIST_PROPERTY_LAZY_DELETE, which is
+ * implied. A skiplist_snapshot_t sees the list as it was when it was created,
+ * and tombstones it can still see aren't freed until it's released. See
+ * skiplist_snapshot_create().
+ */
+#define SKIPLIST_PROPERTY_VERSIONED (1 << 2)
+
+/**
+ * @brief Give every node a link back to the node before it on the bottom level.
+ *
+ * This allows iterating the list backwards with skiplist_rbegin() and
+ * skiplist_prev(), at the cost of a pointer per node.
+ */
+#define SKIPLIST_PROPERTY_BACK_LINKS (1 << 3)
+
 /**
  * @brief No properties for the skiplist, by default duplicate entries are allowed.
  */
 #define SKIPLIST_PROPERTY_NONE (0)
 
+/**
+ * @brief Write only the values to a snapshot, levels are drawn again when it's loaded.
+ */
+#define SKIPLIST_SAVE_VALUES (0)
+
+/**
+ * @brief Also write each node's level count to a snapshot, so loading reproduces the same structure.
+ */
+#define SKIPLIST_SAVE_LEVELS (1 << 0)
+
+/**
+ * @brief Selects where a skiplist's header and nodes are allocated from.
+ */
+typedef enum skiplist_memory_backend_t
+{
+	/** Every node is allocated individually with malloc(). */
+	SKIPLIST_MEMORY_MALLOC = 0,
+
+	/** Nodes are carved out of large mmap()'d regions which are advised to be
+	    backed by transparent huge pages and optionally bound to a NUMA node.
+	    This reduces TLB misses when descending very large skiplists. */
+	SKIPLIST_MEMORY_HUGE_PAGES
+} skiplist_memory_backend_t;
+
+/**
+ * @brief Selects what a skiplist's nodes are ordered by.
+ */
+typedef enum skiplist_key_type_t
+{
+	/** Nodes are ordered by their value with the skiplist's compare function. */
+	SKIPLIST_KEY_VALUE = 0,
+
+	/** Every node holds a byte string key inline, ordered as by memcmp() with
+	    a shorter key first when one is a prefix of the other. The value holds
+	    the first bytes of the key so most comparisons don't touch the rest.
+	    See skiplist_insert_bytes(). */
+	SKIPLIST_KEY_BYTES
+} skiplist_key_type_t;
+
 /**
  * @brief Represents a link between two nodes in a skiplist.
  */
@@ -36,12 +143,17 @@ typedef struct skiplist_link_t
 {
 	/** The width of the link. i.e. if we follow this link,
 	    how many nodes have we advanced. */
-	unsigned int width;
+	skiplist_size_t width;
 
 	/** A pointer to the next node in this link's level. */
 	struct skiplist_node_t *next;
 } skiplist_link_t;
 
+/**
+ * @brief Set in skiplist_node_t::flags for a node that has been removed but not yet unlinked.
+ */
+#define SKIPLIST_NODE_TOMBSTONE (1 << 0)
+
 /**
  * @brief Represents a single node in a skiplist.
  */
@@ -53,10 +165,34 @@ typedef struct skiplist_node_t
 	/** The number of next pointers in this node. */
 	unsigned int levels;
 
+	/** SKIPLIST_NODE_TOMBSTONE if the node's value has been removed from a
+	    SKIPLIST_PROPERTY_LAZY_DELETE skiplist, otherwise 0. */
+	unsigned int flags;
+
 	/** An array of links, one entry for each level in the node. */
 	skiplist_link_t link[1];
 } skiplist_node_t;
 
+/**
+ * @brief A version of a SKIPLIST_PROPERTY_VERSIONED skiplist, counting the inserts and removes made to it.
+ */
+typedef uint64_t skiplist_version_t;
+
+/**
+ * @brief The versions a node of a SKIPLIST_PROPERTY_VERSIONED skiplist was inserted and removed at.
+ *
+ * These are stored after the node's payload, the removed version is only
+ * meaningful once the node is a tombstone.
+ */
+typedef struct skiplist_node_versions_t
+{
+	/** The version of the skiplist the node was inserted at. */
+	skiplist_version_t inserted;
+
+	/** The version of the skiplist the node was removed at. */
+	skiplist_version_t removed;
+} skiplist_node_versions_t;
+
 /**
  * @brief Holds the state for the skiplist's random number generator.
  */
@@ -69,6 +205,92 @@ typedef struct skiplist_rng_t
 	unsigned int m_z;
 } skiplist_rng_t;
 
+/**
+ * @brief Operation counters for a skiplist.
+ *
+ * These are only gathered when the library is compiled with SKIPLIST_STATS
+ * defined (e.g. make STATS=1), otherwise they're compiled out entirely and
+ * skiplist_get_stats() returns SKIPLIST_ERROR_NOT_SUPPORTED. Code using
+ * skiplist_t must be compiled with the same setting as the library as the
+ * counters change the layout of skiplist_t.
+ */
+typedef struct skiplist_stats_t
+{
+	/** The number of calls to skiplist_contains(). */
+	unsigned long lookups;
+
+	/** The number of calls to skiplist_insert(), skiplist_insert_bytes() and
+	    skiplist_push(), and to skiplist_put() with a key not in the map. */
+	unsigned long inserts;
+
+	/** The number of calls to skiplist_remove(), skiplist_remove_bytes(),
+	    skiplist_remove_node(), skiplist_pop_min() and skiplist_erase(). */
+	unsigned long removes;
+
+	/** The number of calls to skiplist_update_node(), and to skiplist_put()
+	    replacing the payload of a key already in the map. Neither counts as
+	    an insert or a remove, even when the node is moved or replaced. */
+	unsigned long updates;
+
+	/** The number of calls to skiplist_at_index(). */
+	unsigned long index_lookups;
+
+	/** The number of compare callbacks made by lookups. */
+	unsigned long lookup_comparisons;
+
+	/** The number of compare callbacks made by insertions. */
+	unsigned long insert_comparisons;
+
+	/** The number of compare callbacks made by removals. */
+	unsigned long remove_comparisons;
+
+	/** The number of links followed on each level by all operations. A search
+	    doesn't count the link it compares against and stops in front of. */
+	unsigned long nodes_visited[SKIPLIST_MAX_LINKS];
+
+	/** The total number of bytes allocated for nodes. */
+	unsigned long bytes_allocated;
+
+	/** The total number of bytes of nodes that have been freed. */
+	unsigned long bytes_freed;
+
+	/** The number of nodes currently in the skiplist with each number of
+	    levels, entry 0 is for nodes with a single level. This isn't a
+	    counter so it's left alone by skiplist_reset_stats(). */
+	unsigned long level_histogram[SKIPLIST_MAX_LINKS];
+} skiplist_stats_t;
+
+/**
+ * @brief A breakdown of the memory used by a skiplist, in bytes.
+ */
+typedef struct skiplist_memory_usage_t
+{
+	/** The skiplist_t itself including the head node's links, and the arena when one is used. */
+	size_t header;
+
+	/** The value, level count and flags stored in every node, and the
+	    version stamps of SKIPLIST_PROPERTY_VERSIONED skiplists. */
+	size_t node_headers;
+
+	/** The links stored in every node, including the back links of SKIPLIST_PROPERTY_BACK_LINKS skiplists
+	    and the link aggregates of skiplists keeping them. */
+	size_t links;
+
+	/** The payloads stored in every node of a map, see skiplist_options_t::payload_size. */
+	size_t payloads;
+
+	/** The byte string keys and their lengths stored in every node, see SKIPLIST_KEY_BYTES. */
+	size_t keys;
+
+	/** Memory held but not used for any of the above. For malloc() this is an
+	    estimate of the allocator's per block overhead and rounding, for the
+	    huge page arena it's rounding, freed blocks and unused region space. */
+	size_t slack;
+
+	/** The sum of all of the above. */
+	size_t total;
+} skiplist_memory_usage_t;
+
 /**
  * @brief Function pointer callback for comparing nodes.
  *
@@ -86,6 +308,28 @@ typedef int (*skiplist_compare_pfn)( const uintptr_t a, const uintptr_t b );
  */
 typedef void (*skiplist_fprintf_pfn)( FILE *stream, const uintptr_t value );
 
+/**
+ * @brief Function pointer callback combining two aggregates, see skiplist_options_t::aggregate.
+ *
+ * Must be associative, combine( combine( a, b ), c ) == combine( a, combine( b, c ) ),
+ * with skiplist_options_t::aggregate_identity as its identity.
+ *
+ * @param [in] a  The aggregate of the earlier nodes.
+ * @param [in] b  The aggregate of the later nodes.
+ *
+ * @return The aggregate of the nodes of both.
+ */
+typedef uintptr_t (*skiplist_aggregate_pfn)( const uintptr_t a, const uintptr_t b );
+
+/**
+ * @brief Function pointer callback returning the aggregate of a single node's value.
+ *
+ * @param [in] value  The value of the node.
+ *
+ * @return The aggregate of that node alone.
+ */
+typedef uintptr_t (*skiplist_lift_pfn)( const uintptr_t value );
+
 /**
  * @brief The skiplist datastructure.
  */
@@ -112,13 +356,148 @@ typedef struct skiplist_t
 	/** Function pointer for printing nodes. */
 	skiplist_fprintf_pfn print;
 
-	/** The number of nodes in this skiplist. */
-	unsigned int num_nodes;
+	/** The number of nodes in this skiplist, not counting tombstones. */
+	skiplist_size_t num_nodes;
+
+	/** The number of tombstones waiting for skiplist_compact(). */
+	skiplist_size_t tombstones;
+
+	/** Tombstones per 100 live nodes that trigger skiplist_compact() from a
+	    remove, 0 to only compact when asked. */
+	unsigned int compact_percent;
+
+	/** The current version of a SKIPLIST_PROPERTY_VERSIONED skiplist,
+	    incremented by every insert and remove. */
+	skiplist_version_t version;
+
+	/** The open snapshots of this skiplist, newest first. */
+	struct skiplist_snapshot_t *snapshots;
+
+	/** The last node on the bottom level, tombstone or not, NULL when the list is empty. */
+	skiplist_node_t *tail;
+
+	/** Node storage for SKIPLIST_MEMORY_HUGE_PAGES skiplists, NULL when nodes
+	    are allocated with malloc(). The arena is allocated from itself. */
+	skiplist_arena_t *arena;
+
+	/** The number of bytes allocated with malloc() for this skiplist when
+	    it doesn't use an arena. */
+	size_t malloc_bytes;
+
+	/** The number of payload bytes stored after the links of every node, 0 if
+	    the skiplist isn't a map. */
+	size_t payload_size;
+
+	/** What the nodes are ordered by. */
+	skiplist_key_type_t key_type;
+
+	/** The write-ahead log inserts and removes are recorded in, NULL when the
+	    skiplist isn't logged. See skiplist_wal_attach(). */
+	struct skiplist_wal_t *wal;
+
+	/** Combines the aggregates kept with every link, NULL when the skiplist
+	    doesn't keep aggregates. See skiplist_options_t::aggregate. */
+	skiplist_aggregate_pfn aggregate;
+
+	/** Makes the aggregate of one node's value, NULL to use the value itself. */
+	skiplist_lift_pfn aggregate_lift;
+
+	/** The aggregate of no nodes. */
+	uintptr_t aggregate_identity;
+
+#ifdef SKIPLIST_STATS
+	/** Operation counters for this skiplist. */
+	skiplist_stats_t stats;
+#endif
 
 	/** The head node. */
 	skiplist_node_t head;
 } skiplist_t;
 
+/**
+ * @brief A consistent, read only view of a SKIPLIST_PROPERTY_VERSIONED skiplist as it was at one version.
+ *
+ * Created by skiplist_snapshot_create() and freed by skiplist_snapshot_release().
+ */
+typedef struct skiplist_snapshot_t
+{
+	/** The skiplist this is a snapshot of, NULL once the skiplist is destroyed. */
+	skiplist_t *skiplist;
+
+	/** The version of the skiplist this snapshot sees. */
+	skiplist_version_t version;
+
+	/** The number of nodes the skiplist had at that version. */
+	skiplist_size_t size;
+
+	/** The next newer snapshot of the same skiplist. */
+	struct skiplist_snapshot_t *newer;
+
+	/** The next older snapshot of the same skiplist. */
+	struct skiplist_snapshot_t *older;
+} skiplist_snapshot_t;
+
+/**
+ * @brief Options for creating a skiplist with skiplist_create_with_options().
+ *
+ * Initialize with skiplist_options_init() before setting any fields so that
+ * fields added in the future receive their default values.
+ */
+typedef struct skiplist_options_t
+{
+	/** Properties for the skiplist, i.e. Unique entries or not. */
+	skiplist_properties_t properties;
+
+	/** An estimate of log2() of the maximum number of elements that will
+	    appear in the list at the same time. */
+	unsigned int size_estimate_log2;
+
+	/** Function for comparing the values that will be used in the skiplist. */
+	skiplist_compare_pfn compare;
+
+	/** Function for printing the values in the skiplist. */
+	skiplist_fprintf_pfn print;
+
+	/** Where the skiplist's memory is allocated from. */
+	skiplist_memory_backend_t memory_backend;
+
+	/** The NUMA node to bind SKIPLIST_MEMORY_HUGE_PAGES memory to, or -1 to
+	    use the default memory policy. Binding is best effort. */
+	int numa_node;
+
+	/** The size of each region mapped by SKIPLIST_MEMORY_HUGE_PAGES, rounded
+	    up to a multiple of the huge page size. 0 selects the default. */
+	size_t region_size;
+
+	/** The number of bytes of payload stored inline in every node, up to
+	    SKIPLIST_MAX_PAYLOAD_SIZE. Non-zero makes the skiplist a map from each
+	    value to its payload, see skiplist_put(). */
+	size_t payload_size;
+
+	/** What the skiplist's nodes are ordered by. compare isn't needed for
+	    SKIPLIST_KEY_BYTES. */
+	skiplist_key_type_t key_type;
+
+	/** For SKIPLIST_PROPERTY_LAZY_DELETE skiplists, a remove compacts the list
+	    once there are more than this many tombstones for every 100 live nodes.
+	    0 leaves compaction to skiplist_compact(). Defaults to 100. */
+	unsigned int compact_percent;
+
+	/** Non-NULL to keep an aggregate of the nodes each link skips, alongside
+	    its width, so skiplist_range_aggregate() can combine the values in any
+	    range in O(log N). Sums, minimums, maximums or anything else with an
+	    associative combine and an identity work. Not supported for
+	    SKIPLIST_KEY_BYTES. Defaults to NULL. */
+	skiplist_aggregate_pfn aggregate;
+
+	/** Makes the aggregate of a single value, e.g. squaring it to sum squares.
+	    NULL uses the value itself. */
+	skiplist_lift_pfn aggregate_lift;
+
+	/** The identity of aggregate, e.g. 0 for a sum or UINTPTR_MAX for a minimum. */
+	uintptr_t aggregate_identity;
+} skiplist_options_t;
+
 typedef enum skiplist_error_t
 {
 	/* SKIPLIST_ERROR_SUCCESS must always be 0. */
@@ -126,7 +505,11 @@ typedef enum skiplist_error_t
 
 	SKIPLIST_ERROR_OUT_OF_MEMORY,
 	SKIPLIST_ERROR_INVALID_INPUT,
-	SKIPLIST_ERROR_OPENING_FILE
+	SKIPLIST_ERROR_OPENING_FILE,
+	SKIPLIST_ERROR_NOT_SUPPORTED,
+	SKIPLIST_ERROR_IO,
+	SKIPLIST_ERROR_INVALID_SNAPSHOT,
+	SKIPLIST_ERROR_FULL
 } skiplist_error_t;
 
 #endif
@@ -0,0 +1,652 @@
+#include <assert.h>
+#include <errno.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "skiplist_wal.h"
+
+/** Each batch starts with its length and checksum, both 4 byte little endian. */
+#define SKIPLIST_WAL_BATCH_HEADER_SIZE (8)
+
+/** The longest record, an operation byte and a 64 bit value in 7 bit groups. */
+#define SKIPLIST_WAL_MAX_RECORD_SIZE (11)
+
+/** The operation byte of an insert record. */
+#define SKIPLIST_WAL_INSERT (1)
+
+/** The operation byte of a remove record. */
+#define SKIPLIST_WAL_REMOVE (2)
+
+/**
+ * @brief Returns the CLOCK_MONOTONIC time in nanoseconds.
+ */
+static uint64_t skiplist_wal_now_ns( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+
+	return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+/**
+ * @brief The 32 bit FNV-1a hash of @p size bytes, used to detect torn batches.
+ */
+static uint32_t skiplist_wal_checksum( const unsigned char *bytes, size_t size )
+{
+	uint32_t hash = 2166136261u;
+	size_t i;
+
+	for( i = 0; i < size; ++i )
+	{
+		hash ^= bytes[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static void skiplist_wal_encode_u32( unsigned char *bytes, uint32_t value )
+{
+	bytes[0] = (unsigned char) value;
+	bytes[1] = (unsigned char) (value >> 8);
+	bytes[2] = (unsigned char) (value >> 16);
+	bytes[3] = (unsigned char) (value >> 24);
+}
+
+static uint32_t skiplist_wal_decode_u32( const unsigned char *bytes )
+{
+	return (uint32_t) bytes[0] | ((uint32_t) bytes[1] << 8) | ((uint32_t) bytes[2] << 16) | ((uint32_t) bytes[3] << 24);
+}
+
+/**
+ * @brief Write all @p size bytes to @p fd, retrying short and interrupted writes.
+ */
+static skiplist_error_t skiplist_wal_write( int fd, const unsigned char *bytes, size_t size )
+{
+	size_t done = 0;
+
+	while( done < size )
+	{
+		ssize_t written = write( fd, bytes + done, size - done );
+
+		if( written < 0 )
+		{
+			if( EINTR == errno )
+			{
+				continue;
+			}
+			return SKIPLIST_ERROR_IO;
+		}
+		done += (size_t) written;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+/**
+ * @brief Read up to @p size bytes from @p fd, stopping early only at the end of the file.
+ *
+ * @return The number of bytes read, or -1 on error.
+ */
+static ssize_t skiplist_wal_read( int fd, unsigned char *bytes, size_t size )
+{
+	size_t done = 0;
+
+	while( done < size )
+	{
+		ssize_t got = read( fd, bytes + done, size - done );
+
+		if( got < 0 )
+		{
+			if( EINTR == errno )
+			{
+				continue;
+			}
+			return -1;
+		}
+		if( 0 == got )
+		{
+			break;
+		}
+		done += (size_t) got;
+	}
+
+	return (ssize_t) done;
+}
+
+/**
+ * @brief Write the buffered records to the file as one batch, without syncing.
+ *
+ * A failed write can leave part of the batch in the file. Replay stops at a torn
+ * batch, so the part is cut off again before the batch is retried, or every batch
+ * after it would be lost. If that fails too the log refuses to write any more.
+ */
+static skiplist_error_t skiplist_wal_flush( skiplist_wal_t *wal )
+{
+	skiplist_error_t err;
+	off_t start;
+
+	if( wal->failed )
+	{
+		return SKIPLIST_ERROR_IO;
+	}
+
+	if( 0 == wal->pos )
+	{
+		return SKIPLIST_ERROR_SUCCESS;
+	}
+
+	start = lseek( wal->fd, 0, SEEK_CUR );
+	if( start < 0 )
+	{
+		return SKIPLIST_ERROR_IO;
+	}
+
+	skiplist_wal_encode_u32( wal->buffer, (uint32_t) wal->pos );
+	skiplist_wal_encode_u32( wal->buffer + 4,
+	                         skiplist_wal_checksum( wal->buffer + SKIPLIST_WAL_BATCH_HEADER_SIZE, wal->pos ) );
+
+	err = skiplist_wal_write( wal->fd, wal->buffer, SKIPLIST_WAL_BATCH_HEADER_SIZE + wal->pos );
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		wal->pos = 0;
+	}
+	else if( 0 != ftruncate( wal->fd, start ) || lseek( wal->fd, start, SEEK_SET ) != start )
+	{
+		wal->failed = 1;
+	}
+
+	return err;
+}
+
+static skiplist_error_t skiplist_wal_sync_clean( skiplist_wal_t *wal )
+{
+	skiplist_error_t err;
+	int rc;
+
+	err = skiplist_wal_flush( wal );
+	if( SKIPLIST_ERROR_SUCCESS != err )
+	{
+		return err;
+	}
+
+#ifdef __linux__
+	/* Only the data matters, the file's timestamps can be left behind. */
+	rc = fdatasync( wal->fd );
+#else
+	rc = fsync( wal->fd );
+#endif
+	if( 0 != rc )
+	{
+		return SKIPLIST_ERROR_IO;
+	}
+
+	wal->unsynced = 0;
+	wal->last_sync_ns = skiplist_wal_now_ns();
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+skiplist_error_t skiplist_wal_options_init( skiplist_wal_options_t *options )
+{
+	if( NULL == options )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	memset( options, 0, sizeof( *options ) );
+	options->sync = SKIPLIST_WAL_SYNC_RECORDS;
+	options->sync_records = 1024;
+	options->sync_interval_ms = 10;
+	options->buffer_size = (size_t)1 << 16;
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+static skiplist_error_t skiplist_wal_open_check_clean( int fd, const skiplist_wal_options_t *options )
+{
+	if( fd < 0 )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( NULL == options )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( SKIPLIST_WAL_SYNC_MANUAL != options->sync && SKIPLIST_WAL_SYNC_RECORDS != options->sync &&
+	    SKIPLIST_WAL_SYNC_INTERVAL != options->sync )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( SKIPLIST_WAL_SYNC_RECORDS == options->sync && 0 == options->sync_records )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( options->buffer_size < SKIPLIST_WAL_MIN_BUFFER_SIZE || options->buffer_size > SKIPLIST_WAL_MAX_BUFFER_SIZE )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+static skiplist_wal_t *skiplist_wal_open_clean( int fd, const skiplist_wal_options_t *options,
+                                                skiplist_error_t *error )
+{
+	skiplist_wal_t *wal;
+
+	if( lseek( fd, 0, SEEK_END ) < 0 )
+	{
+		*error = SKIPLIST_ERROR_IO;
+		return NULL;
+	}
+
+	wal = (skiplist_wal_t *) malloc( sizeof( skiplist_wal_t ) );
+	if( NULL == wal )
+	{
+		*error = SKIPLIST_ERROR_OUT_OF_MEMORY;
+		return NULL;
+	}
+
+	wal->buffer = (unsigned char *) malloc( SKIPLIST_WAL_BATCH_HEADER_SIZE + options->buffer_size +
+	                                          SKIPLIST_WAL_MAX_RECORD_SIZE );
+	if( NULL == wal->buffer )
+	{
+		free( wal );
+		*error = SKIPLIST_ERROR_OUT_OF_MEMORY;
+		return NULL;
+	}
+
+	wal->fd = fd;
+	wal->options = *options;
+	wal->pos = 0;
+	wal->unsynced = 0;
+	wal->last_sync_ns = skiplist_wal_now_ns();
+	wal->failed = 0;
+
+	*error = SKIPLIST_ERROR_SUCCESS;
+
+	return wal;
+}
+
+skiplist_wal_t *skiplist_wal_open( int fd, const skiplist_wal_options_t *options, skiplist_error_t * const error )
+{
+	skiplist_wal_t *wal = NULL;
+	skiplist_error_t err;
+
+	err = skiplist_wal_open_check_clean( fd, options );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		wal = skiplist_wal_open_clean( fd, options, &err );
+	}
+
+	if( NULL != error )
+	{
+		*error = err;
+	}
+
+	return wal;
+}
+
+static skiplist_error_t skiplist_wal_attach_check_clean( const skiplist_t *skiplist )
+{
+	if( NULL == skiplist )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	/* Records hold only the value, so a map's payloads or byte string keys couldn't be replayed. */
+	if( 0 != skiplist->payload_size || SKIPLIST_KEY_VALUE != skiplist->key_type )
+	{
+		return SKIPLIST_ERROR_NOT_SUPPORTED;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+skiplist_error_t skiplist_wal_attach( skiplist_t *skiplist, skiplist_wal_t *wal )
+{
+	skiplist_error_t err;
+
+	err = skiplist_wal_attach_check_clean( skiplist );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		skiplist->wal = wal;
+	}
+
+	return err;
+}
+
+static skiplist_error_t skiplist_wal_append_check_clean( const skiplist_wal_t *wal )
+{
+	if( NULL == wal )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+static skiplist_error_t skiplist_wal_append_clean( skiplist_wal_t *wal, unsigned int remove, uintptr_t value )
+{
+	unsigned char *record;
+	uint64_t remaining;
+	skiplist_error_t err = SKIPLIST_ERROR_SUCCESS;
+
+	if( wal->failed )
+	{
+		return SKIPLIST_ERROR_IO;
+	}
+
+	/* The list has already changed, so the record is kept even if the flush fails, in the room
+	   left past buffer_size for one record. Once that's taken a record would be lost instead. */
+	if( wal->pos + SKIPLIST_WAL_MAX_RECORD_SIZE > wal->options.buffer_size )
+	{
+		err = skiplist_wal_flush( wal );
+		if( SKIPLIST_ERROR_SUCCESS != err && wal->pos > wal->options.buffer_size )
+		{
+			wal->failed = 1;
+			return err;
+		}
+	}
+
+	/* An operation byte, then the value 7 bits at a time with the top bit set on all but the last byte. */
+	record = wal->buffer + SKIPLIST_WAL_BATCH_HEADER_SIZE + wal->pos;
+	*record++ = remove ? SKIPLIST_WAL_REMOVE : SKIPLIST_WAL_INSERT;
+	for( remaining = value; remaining >= 0x80; remaining >>= 7 )
+	{
+		*record++ = (unsigned char) (remaining | 0x80);
+	}
+	*record++ = (unsigned char) remaining;
+	wal->pos = (size_t) (record - (wal->buffer + SKIPLIST_WAL_BATCH_HEADER_SIZE));
+
+	++wal->unsynced;
+
+	if( SKIPLIST_ERROR_SUCCESS != err )
+	{
+		return err;
+	}
+
+	switch( wal->options.sync )
+	{
+	case SKIPLIST_WAL_SYNC_RECORDS:
+		if( wal->unsynced >= wal->options.sync_records )
+		{
+			return skiplist_wal_sync_clean( wal );
+		}
+		break;
+
+	case SKIPLIST_WAL_SYNC_INTERVAL:
+		if( skiplist_wal_now_ns() - wal->last_sync_ns >= (uint64_t) wal->options.sync_interval_ms * 1000000u )
+		{
+			return skiplist_wal_sync_clean( wal );
+		}
+		break;
+
+	case SKIPLIST_WAL_SYNC_MANUAL:
+		break;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+skiplist_error_t skiplist_wal_append( skiplist_wal_t *wal, unsigned int remove, uintptr_t value )
+{
+	skiplist_error_t err;
+
+	err = skiplist_wal_append_check_clean( wal );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		err = skiplist_wal_append_clean( wal, remove, value );
+	}
+
+	return err;
+}
+
+static skiplist_error_t skiplist_wal_sync_check_clean( const skiplist_wal_t *wal )
+{
+	if( NULL == wal )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+skiplist_error_t skiplist_wal_sync( skiplist_wal_t *wal )
+{
+	skiplist_error_t err;
+
+	err = skiplist_wal_sync_check_clean( wal );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		err = skiplist_wal_sync_clean( wal );
+	}
+
+	return err;
+}
+
+skiplist_error_t skiplist_wal_close( skiplist_wal_t *wal )
+{
+	skiplist_error_t err;
+
+	err = skiplist_wal_sync_check_clean( wal );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		err = skiplist_wal_sync_clean( wal );
+		free( wal->buffer );
+		free( wal );
+	}
+
+	return err;
+}
+
+/**
+ * @brief Apply the records of one batch to @p skiplist.
+ */
+static skiplist_error_t skiplist_wal_replay_batch( skiplist_t *skiplist, const unsigned char *bytes, size_t size,
+                                                   unsigned long *records )
+{
+	const unsigned char *end = bytes + size;
+
+	while( bytes < end )
+	{
+		unsigned char op = *bytes++;
+		uint64_t value = 0;
+		unsigned int shift;
+		skiplist_error_t err;
+
+		for( shift = 0; ; shift += 7 )
+		{
+			if( bytes == end || shift >= 64 )
+			{
+				return SKIPLIST_ERROR_INVALID_SNAPSHOT;
+			}
+			value |= (uint64_t) (*bytes & 0x7f) << shift;
+			if( 0 == (*bytes++ & 0x80) )
+			{
+				break;
+			}
+		}
+
+		if( value != (uint64_t) (uintptr_t) value )
+		{
+			return SKIPLIST_ERROR_INVALID_SNAPSHOT;
+		}
+
+		if( SKIPLIST_WAL_INSERT == op )
+		{
+			err = skiplist_insert( skiplist, (uintptr_t) value );
+		}
+		else if( SKIPLIST_WAL_REMOVE == op )
+		{
+			/* Only removes that found their value are logged. */
+			err = skiplist_remove( skiplist, (uintptr_t) value );
+			if( SKIPLIST_ERROR_INVALID_INPUT == err )
+			{
+				err = SKIPLIST_ERROR_INVALID_SNAPSHOT;
+			}
+		}
+		else
+		{
+			err = SKIPLIST_ERROR_INVALID_SNAPSHOT;
+		}
+
+		if( SKIPLIST_ERROR_SUCCESS != err )
+		{
+			return err;
+		}
+		++*records;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+static skiplist_error_t skiplist_wal_replay_check_clean( const skiplist_t *skiplist, int fd )
+{
+	if( NULL == skiplist )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	if( fd < 0 )
+	{
+		return SKIPLIST_ERROR_INVALID_INPUT;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+static skiplist_error_t skiplist_wal_replay_clean( skiplist_t *skiplist, int fd, unsigned long *records )
+{
+	unsigned char header[SKIPLIST_WAL_BATCH_HEADER_SIZE];
+	unsigned char *batch = NULL;
+	size_t batch_capacity = 0;
+	skiplist_wal_t *wal;
+	off_t valid;
+	off_t end;
+	skiplist_error_t err = SKIPLIST_ERROR_SUCCESS;
+
+	*records = 0;
+
+	valid = lseek( fd, 0, SEEK_CUR );
+	if( valid < 0 )
+	{
+		return SKIPLIST_ERROR_IO;
+	}
+
+	/* Replayed records are already in the log. */
+	wal = skiplist->wal;
+	skiplist->wal = NULL;
+
+	for( ;; )
+	{
+		ssize_t got;
+		size_t size;
+
+		got = skiplist_wal_read( fd, header, sizeof( header ) );
+		if( got < 0 )
+		{
+			err = SKIPLIST_ERROR_IO;
+			break;
+		}
+		if( (size_t) got < sizeof( header ) )
+		{
+			break;
+		}
+
+		size = skiplist_wal_decode_u32( header );
+		if( 0 == size || size > SKIPLIST_WAL_MAX_BUFFER_SIZE + SKIPLIST_WAL_MAX_RECORD_SIZE )
+		{
+			break;
+		}
+
+		if( size > batch_capacity )
+		{
+			unsigned char *grown = (unsigned char *) realloc( batch, size );
+			if( NULL == grown )
+			{
+				err = SKIPLIST_ERROR_OUT_OF_MEMORY;
+				break;
+			}
+			batch = grown;
+			batch_capacity = size;
+		}
+
+		got = skiplist_wal_read( fd, batch, size );
+		if( got < 0 )
+		{
+			err = SKIPLIST_ERROR_IO;
+			break;
+		}
+		if( (size_t) got < size || skiplist_wal_checksum( batch, size ) != skiplist_wal_decode_u32( header + 4 ) )
+		{
+			break;
+		}
+
+		err = skiplist_wal_replay_batch( skiplist, batch, size, records );
+		if( SKIPLIST_ERROR_SUCCESS != err )
+		{
+			break;
+		}
+		valid += (off_t) (SKIPLIST_WAL_BATCH_HEADER_SIZE + size);
+	}
+
+	skiplist->wal = wal;
+	free( batch );
+
+	if( SKIPLIST_ERROR_SUCCESS != err )
+	{
+		return err;
+	}
+
+	/* Cut off a torn batch so batches appended from here on are found by the next replay. */
+	end = lseek( fd, 0, SEEK_END );
+	if( end < 0 )
+	{
+		return SKIPLIST_ERROR_IO;
+	}
+	if( end > valid && 0 != ftruncate( fd, valid ) )
+	{
+		return SKIPLIST_ERROR_IO;
+	}
+	if( lseek( fd, valid, SEEK_SET ) < 0 )
+	{
+		return SKIPLIST_ERROR_IO;
+	}
+
+	return SKIPLIST_ERROR_SUCCESS;
+}
+
+skiplist_error_t skiplist_wal_replay( skiplist_t *skiplist, int fd, unsigned long *records )
+{
+	unsigned long replayed = 0;
+	skiplist_error_t err;
+
+	err = skiplist_wal_replay_check_clean( skiplist, fd );
+
+	if( SKIPLIST_ERROR_SUCCESS == err )
+	{
+		err = skiplist_wal_replay_clean( skiplist, fd, &replayed );
+	}
+
+	if( NULL != records )
+	{
+		*records = replayed;
+	}
+
+	return err;
+}
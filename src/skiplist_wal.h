@@ -0,0 +1,208 @@
+#ifndef SKIPLIST_WAL_H
+#define SKIPLIST_WAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "skiplist.h"
+
+/** The largest buffer a write-ahead log may use, which also bounds the size of a batch on replay. */
+#define SKIPLIST_WAL_MAX_BUFFER_SIZE ((size_t)1 << 26)
+
+/** The smallest buffer a write-ahead log may use, enough for the largest record. */
+#define SKIPLIST_WAL_MIN_BUFFER_SIZE ((size_t)16)
+
+/**
+ * @brief When the records appended to a write-ahead log are forced to disk.
+ *
+ * Records are always buffered and written to the file in batches. Syncing
+ * waits for every batch written so far to reach the disk, so its cost is
+ * shared by all the records since the previous sync.
+ */
+typedef enum skiplist_wal_sync_t
+{
+	/** Only skiplist_wal_sync() and skiplist_wal_close() sync the log. */
+	SKIPLIST_WAL_SYNC_MANUAL,
+
+	/** Sync once every sync_records records. */
+	SKIPLIST_WAL_SYNC_RECORDS,
+
+	/** Sync when a record is appended sync_interval_ms or more after the last sync.
+	    An idle log isn't synced until its next record or skiplist_wal_sync(). */
+	SKIPLIST_WAL_SYNC_INTERVAL
+} skiplist_wal_sync_t;
+
+/**
+ * @brief Options for opening a write-ahead log with skiplist_wal_open().
+ *
+ * Initialize with skiplist_wal_options_init() before setting any fields so
+ * that fields added in the future receive their default values.
+ */
+typedef struct skiplist_wal_options_t
+{
+	/** When the log is synced. */
+	skiplist_wal_sync_t sync;
+
+	/** The number of records between syncs for SKIPLIST_WAL_SYNC_RECORDS. */
+	unsigned int sync_records;
+
+	/** The milliseconds between syncs for SKIPLIST_WAL_SYNC_INTERVAL. */
+	unsigned int sync_interval_ms;
+
+	/** The number of bytes of records buffered before a batch is written to the file. */
+	size_t buffer_size;
+} skiplist_wal_options_t;
+
+/**
+ * @brief A write-ahead log recording the inserts and removes made to a skiplist.
+ *
+ * Each record is an operation byte followed by the value as a variable
+ * length integer, so small values take only a couple of bytes. Records are
+ * written in batches, each prefixed with its length and a checksum so a batch
+ * torn by a crash is detected and ignored on replay.
+ */
+typedef struct skiplist_wal_t
+{
+	/** The file descriptor the log is appended to. */
+	int fd;
+
+	/** The options the log was opened with. */
+	skiplist_wal_options_t options;
+
+	/** Space for a batch header followed by options.buffer_size bytes of records,
+	    and room for one more record that arrives while a full buffer can't be written. */
+	unsigned char *buffer;
+
+	/** The number of bytes of records in the buffer. */
+	size_t pos;
+
+	/** The number of records appended since the log was last synced. */
+	unsigned long unsynced;
+
+	/** The CLOCK_MONOTONIC time of the last sync in nanoseconds. */
+	uint64_t last_sync_ns;
+
+	/** Non-zero once part of a batch was written and couldn't be cut off again, or a
+	    record couldn't be buffered, after which every append and sync fails. */
+	int failed;
+} skiplist_wal_t;
+
+/**
+ * @brief Initializes @p options with default values, syncing every 1024 records through a 64KiB buffer.
+ *
+ * @param [out] options  The options to initialize.
+ *
+ * @retval SKIPLIST_ERROR_SUCCESS if successful.
+ * @retval SKIPLIST_ERROR_INVALID_INPUT if input values were invalid.
+ */
+skiplist_error_t skiplist_wal_options_init( skiplist_wal_options_t *options );
+
+/**
+ * @brief Opens a write-ahead log that appends to the end of @p fd.
+ *
+ * The log doesn't take ownership of @p fd, it must stay open until the log
+ * is closed and is then the caller's to close.
+ *
+ * @param [in]  fd       A file descriptor open for writing.
+ * @param [in]  options  The sync policy and buffer size.
+ * @param [out] error    Will point to the error status of the function on return. May be set to NULL.
+ *                       SKIPLIST_ERROR_SUCCESS if successful.
+ *                       SKIPLIST_ERROR_INVALID_INPUT if this function was called with invalid input values.
+ *                       SKIPLIST_ERROR_OUT_OF_MEMORY if this function failed to allocate memory.
+ *                       SKIPLIST_ERROR_IO if the end of @p fd couldn't be found.
+ *
+ * @return If successful the open log, otherwise NULL.
+ */
+skiplist_wal_t *skiplist_wal_open( int fd, const skiplist_wal_options_t *options, skiplist_error_t * const error );
+
+/**
+ * @brief Attaches a write-ahead log to a skiplist, or detaches it.
+ *
+ * Once attached, every successful skiplist_insert() and skiplist_remove()
+ * that changes @p skiplist appends a record to @p wal. If the record can't be
+ * written they return SKIPLIST_ERROR_IO, though the list itself has changed.
+ *
+ * @param [in] skiplist  The skiplist to log.
+ * @param [in] wal       The log to append to, or NULL to stop logging.
+ *
+ * @retval SKIPLIST_ERROR_SUCCESS if successful.
+ * @retval SKIPLIST_ERROR_INVALID_INPUT if input values were invalid.
+ * @retval SKIPLIST_ERROR_NOT_SUPPORTED if @p skiplist is a map or has byte string keys, which records can't hold.
+ */
+skiplist_error_t skiplist_wal_attach( skiplist_t *skiplist, skiplist_wal_t *wal );
+
+/**
+ * @brief Appends a record of an insert or remove to a write-ahead log.
+ *
+ * skiplist_insert() and skiplist_remove() call this for skiplists with an
+ * attached log, it's only needed directly to log changes made elsewhere.
+ *
+ * @param [in] wal     The log to append to.
+ * @param [in] remove  Non-zero to record a remove, otherwise an insert.
+ * @param [in] value   The value inserted or removed.
+ *
+ * @retval SKIPLIST_ERROR_SUCCESS if successful.
+ * @retval SKIPLIST_ERROR_INVALID_INPUT if input values were invalid.
+ * @retval SKIPLIST_ERROR_IO if a batch couldn't be written or synced.
+ */
+skiplist_error_t skiplist_wal_append( skiplist_wal_t *wal, unsigned int remove, uintptr_t value );
+
+/**
+ * @brief Writes the buffered records and waits for the log to reach the disk.
+ *
+ * If the records can't be written, whatever part of them reached the file is
+ * cut off again and they stay buffered, so a later append or sync retries
+ * them. An append that finds the buffer full still buffers its record after
+ * a failed write, but only one such record fits. If another arrives before
+ * the batch is written, or the part can't be cut off, every later append and
+ * sync fails.
+ *
+ * @param [in] wal  The log to sync.
+ *
+ * @retval SKIPLIST_ERROR_SUCCESS if successful.
+ * @retval SKIPLIST_ERROR_INVALID_INPUT if input values were invalid.
+ * @retval SKIPLIST_ERROR_IO if the log couldn't be written or synced.
+ */
+skiplist_error_t skiplist_wal_sync( skiplist_wal_t *wal );
+
+/**
+ * @brief Syncs and frees a write-ahead log. The log is freed even if the sync fails.
+ *
+ * Detach the log from its skiplist before closing it.
+ *
+ * @param [in] wal  The log to close.
+ *
+ * @retval SKIPLIST_ERROR_SUCCESS if successful.
+ * @retval SKIPLIST_ERROR_INVALID_INPUT if input values were invalid.
+ * @retval SKIPLIST_ERROR_IO if the final sync failed.
+ */
+skiplist_error_t skiplist_wal_close( skiplist_wal_t *wal );
+
+/**
+ * @brief Applies the records of a write-ahead log to a skiplist.
+ *
+ * Recovery loads the snapshot taken when the log was started with
+ * skiplist_load() and replays the log on top of it. Reading starts at the
+ * current offset of @p fd and stops at the end of the file or at the first
+ * batch that is incomplete or fails its checksum, which is what a crash
+ * part way through a write leaves behind. That tail is cut off, so @p fd
+ * must be open for writing, and a log opened on @p fd afterwards continues
+ * after the last complete batch. Records aren't logged again if
+ * @p skiplist has a log attached.
+ *
+ * @param [in]  skiplist  The skiplist to apply the records to.
+ * @param [in]  fd        The file descriptor of the log, open for reading and writing.
+ * @param [out] records   The number of records applied. May be set to NULL.
+ *
+ * @retval SKIPLIST_ERROR_SUCCESS if successful.
+ * @retval SKIPLIST_ERROR_INVALID_INPUT if input values were invalid.
+ * @retval SKIPLIST_ERROR_OUT_OF_MEMORY if this function failed to allocate memory.
+ * @retval SKIPLIST_ERROR_IO if the log couldn't be read or its torn tail couldn't be cut off.
+ * @retval SKIPLIST_ERROR_INVALID_SNAPSHOT if a complete batch holds a malformed record or a
+ *                                         remove of a value that isn't in @p skiplist, which
+ *                                         means the log doesn't belong to the snapshot.
+ */
+skiplist_error_t skiplist_wal_replay( skiplist_t *skiplist, int fd, unsigned long *records );
+
+#endif
@@ -0,0 +1,30 @@
+#include <time.h>
+
+#ifdef __MACH__
+#include <mach/clock.h>
+#include <mach/mach.h>
+#endif
+
+#include "timestamp.h"
+
+void time_stamp( struct timespec *stamp )
+{
+#ifdef __MACH__
+	clock_serv_t cclock;
+	mach_timespec_t mts;
+	host_get_clock_service( mach_host_self(), CALENDAR_CLOCK, &cclock );
+	clock_get_time( cclock, &mts );
+	mach_port_deallocate( mach_task_self(), cclock );
+	stamp->tv_sec = mts.tv_sec;
+	stamp->tv_nsec = mts.tv_nsec;
+#else
+	clock_gettime( CLOCK_MONOTONIC, stamp );
+#endif
+}
+
+unsigned long long time_diff_ns( const struct timespec *start, const struct timespec *end )
+{
+	unsigned long long seconds = end->tv_sec - start->tv_sec;
+	unsigned long long nano_seconds = end->tv_nsec - start->tv_nsec;
+	return seconds * 1000000000ULL + nano_seconds;
+}
@@ -0,0 +1,16 @@
+#ifndef TIMESTAMP_H
+#define TIMESTAMP_H
+
+#include <time.h>
+
+/**
+ * @brief Acquire a current timestamp
+ */
+void time_stamp( struct timespec *stamp );
+
+/**
+ * @brief Return the difference between two timestamps in nanoseconds
+ */
+unsigned long long time_diff_ns( const struct timespec *start, const struct timespec *end );
+
+#endif